@@ -0,0 +1,123 @@
+// Renders an sequence of drifting random spheres, and reports the cost of
+// updating the scene and of rendering it for every frame. The hierarchy is
+// refit between the frames until the spheres have drifted so far it's cheaper
+// to rebuild it. Some of the frames are rendered again from an scene built
+// from scratch, which has to give the exact same image. Exits with an non-zero
+// status when it does not.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Animation.hpp"
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "RayCaster.hpp"
+#include "Scenes.hpp"
+#include "SequenceRenderer.hpp"
+#include "ThreadPool.hpp"
+
+static const size_t width = 320, height = 240;
+static const size_t sphereCount = 100000;
+static const size_t frameCount = 24;
+static const double frameTime = 1.0 / 24.0;
+static const double duration = frameCount * frameTime;
+static const size_t checkEvery = 4;
+
+static void createScene(GeometryRegister<double> &geometryRegister,
+                        Animator<double> &animator) {
+  createDriftingSpheresScene(geometryRegister, animator, sphereCount, duration);
+}
+
+int main() {
+  ThreadPool threadPool(0);
+  Camera<double> camera = createRandomSpheresCamera<double>(width, height);
+
+  // Compares the ways of updating the hierarchy once, after half the
+  // animation.
+  {
+    GeometryRegister<double> geometryRegister;
+    Animator<double> animator;
+    createScene(geometryRegister, animator);
+    geometryRegister.Build();
+    animator.Apply(duration / 2.0, threadPool);
+
+    const auto serialStart = std::chrono::steady_clock::now();
+    geometryRegister.Refit();
+    const double serial =
+        milliseconds(std::chrono::steady_clock::now() - serialStart);
+    const auto parallelStart = std::chrono::steady_clock::now();
+    geometryRegister.Refit(threadPool);
+    const double parallel =
+        milliseconds(std::chrono::steady_clock::now() - parallelStart);
+    const auto buildStart = std::chrono::steady_clock::now();
+    geometryRegister.Build();
+    const double build =
+        milliseconds(std::chrono::steady_clock::now() - buildStart);
+
+    std::printf("%zu spheres on %zu threads: refit %.1f ms, parallel refit "
+                "%.1f ms, rebuild %.1f ms\n",
+                sphereCount, threadPool.ThreadCount(), serial, parallel, build);
+  }
+
+  SequenceRenderer<double> sequenceRenderer(threadPool, createScene);
+  std::vector<std::pair<SequenceFrame, FrameBuffer>> checkedFrames;
+  double updateTotal = 0.0, renderTotal = 0.0;
+  size_t rebuilds = 0;
+
+  std::printf("%5s %9s %9s %8s %12s\n", "frame", "update ms", "render ms",
+              "rebuilt", "degradation");
+  const auto start = std::chrono::steady_clock::now();
+  sequenceRenderer.Render(
+      frameCount, frameTime, camera,
+      [&](const SequenceFrame &frame, const FrameBuffer &frameBuffer) {
+        std::printf("%5zu %9.2f %9.2f %8s %12.3f\n", frame.index,
+                    frame.updateMilliseconds, frame.renderMilliseconds,
+                    frame.rebuilt ? "yes" : "no", frame.degradation);
+        updateTotal += frame.updateMilliseconds;
+        renderTotal += frame.renderMilliseconds;
+        rebuilds += frame.rebuilt ? 1 : 0;
+        if (frame.index % checkEvery == checkEvery / 2) {
+          checkedFrames.emplace_back(frame, frameBuffer);
+        }
+      });
+  const double total = milliseconds(std::chrono::steady_clock::now() - start);
+
+  std::printf("%zu frames in %.1f ms, updates %.1f ms and renders %.1f ms "
+              "(%.0f%% of the updates hidden), %zu rebuilds\n",
+              frameCount, total, updateTotal, renderTotal,
+              100.0 * (updateTotal + renderTotal - total) / updateTotal,
+              rebuilds);
+
+  // Renders the checked frames from scratch.
+  size_t mismatches = 0, refitFrames = 0;
+  for (const auto &[frame, checkedFrame] : checkedFrames) {
+    std::shared_ptr<GeometryRegister<double>> geometryRegister =
+        std::make_shared<GeometryRegister<double>>();
+    Animator<double> animator;
+    createScene(*geometryRegister, animator);
+    animator.Apply(frame.time, threadPool);
+    geometryRegister->Build();
+
+    FrameBuffer frameBuffer(width, height);
+    RayCaster<double>(frameBuffer, camera, geometryRegister).Render(threadPool);
+    if (frameBuffer.pixels != checkedFrame.pixels) {
+      std::printf("Frame %zu differs from the scene built from scratch.\n",
+                  frame.index);
+      ++mismatches;
+    }
+    refitFrames += frame.rebuilt ? 0 : 1;
+  }
+
+  std::printf("Checked %zu frames against an rebuilt scene, %zu of them were "
+              "refit, %zu differ\n",
+              checkedFrames.size(), refitFrames, mismatches);
+
+  return mismatches == 0 ? 0 : 1;
+}
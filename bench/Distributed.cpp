@@ -0,0 +1,183 @@
+// Renders frames on several worker processes on this machine, over an Unix
+// domain socket and over TCP, and compares them with the same frames rendered
+// in this process. They have to be exactly the same, whatever the settings.
+// Every run reports its time and the tiles it sent. The last run of every
+// scene kills one of its workers and freezes an other one halfway through the
+// frame, their tiles have to be handed out again and the frame has to come out
+// the same anyway. Exits with an non-zero status when any frame differs.
+
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "DistributedRenderer.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "RayCaster.hpp"
+#include "Sampler.hpp"
+#include "Socket.hpp"
+#include "ThreadPool.hpp"
+
+static const size_t width = 320, height = 240;
+static const size_t workerCount = 3;
+
+static const std::vector<BenchScene<double>> distributedScenes = {
+    BenchScene<double>::TwoSpheres(), BenchScene<double>::RandomSpheres(10000)};
+
+/// The settings of an frame, with the name they're reported by.
+class DistributedRun {
+public:
+  std::string name;
+  BenchSettings settings;
+};
+
+static const std::vector<DistributedRun> runs = {
+    {"per pixel", BenchSettings()},
+    {"wavefront", BenchSettings(SampleSettings(), TraceMode::Wavefront)},
+    {"adaptive 4-16x", BenchSettings(SampleSettings(16, 4, 0.01f))},
+    {"roulette 0.5", BenchSettings(SampleSettings(), TraceMode::PerPixel,
+                                   PathTermination(16, 0.5, true))},
+};
+
+/// Starts an worker process with an single thread, which connects to the
+/// given address.
+static pid_t spawnWorker(const std::string &address) {
+  const pid_t pid = fork();
+  if (pid != 0) {
+    return pid;
+  }
+
+  // The child leaves without unwinding, so nothing of the parent it has a
+  // copy of is cleaned up twice.
+  try {
+    Socket socket = Socket::Connect(address, 10000);
+    ThreadPool threadPool(1);
+    RenderWorker::Serve(socket, threadPool);
+  } catch (const std::exception &) {
+    _exit(1);
+  }
+  _exit(0);
+}
+
+/// Renders an frame on new worker processes. When faulty, one of them is
+/// killed once an quarter of the tiles is done and an other is frozen once
+/// half of them is done. Gets whether all the workers which were left alone
+/// exited cleanly.
+static bool render(std::shared_ptr<GeometryRegister<double>> scene,
+                   Camera<double> camera, const DistributedRun &run,
+                   const std::string &address, const bool &faulty,
+                   FrameBuffer &frameBuffer, double &milliseconds,
+                   DistributedFrame &frame) {
+  Listener listener(address);
+  std::vector<pid_t> workers;
+  for (size_t i = 0; i < workerCount + (faulty ? 1 : 0); ++i) {
+    workers.push_back(spawnWorker(listener.Address()));
+  }
+
+  DistributedRenderer<double> renderer(frameBuffer, camera, scene);
+  renderer.Supersample(run.settings.sampling)
+      .Mode(run.settings.mode)
+      .Terminate(run.settings.termination);
+  const auto start = std::chrono::steady_clock::now();
+  frame = renderer.Render(listener, [&](const size_t &done,
+                                        const size_t &total) {
+    if (faulty && done == total / 4) {
+      kill(workers[0], SIGKILL);
+    }
+    if (faulty && done == total / 2) {
+      kill(workers[1], SIGSTOP);
+    }
+  });
+  milliseconds = millisecondsSince(start);
+
+  bool clean = true;
+  for (size_t i = 0; i < workers.size(); ++i) {
+    if (faulty && i < 2) {
+      kill(workers[i], SIGKILL);
+      kill(workers[i], SIGCONT);
+    }
+
+    int status = 0;
+    waitpid(workers[i], &status, 0);
+    const bool exited = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    clean = clean && (exited || (faulty && i < 2));
+  }
+
+  return clean;
+}
+
+int main() {
+  const std::string unixAddress =
+      "unix:/tmp/raytracer-distributed-" + std::to_string(getpid()) + ".sock";
+  const std::string tcpAddress = "127.0.0.1:0";
+  bool failed = false;
+
+  for (const BenchScene<double> &distributedScene : distributedScenes) {
+    std::shared_ptr<GeometryRegister<double>> scene = distributedScene.Build();
+    Camera<double> camera = distributedScene.camera(width, height);
+
+    // Renders the references first, the workers are forked once the threads
+    // of the pool are gone.
+    std::vector<FrameBuffer> references;
+    std::vector<double> referenceTimes;
+    {
+      ThreadPool threadPool(1);
+      for (const DistributedRun &run : runs) {
+        const BenchFrame reference =
+            renderBench(scene, camera, run.settings, threadPool);
+        references.push_back(reference.image);
+        referenceTimes.push_back(reference.Fastest());
+      }
+    }
+
+    std::printf("%s, %zu workers of one thread\n",
+                distributedScene.name.c_str(), workerCount);
+    std::printf("%-16s %-6s %-7s %10s %10s %8s %8s %10s %10s %10s\n",
+                "settings", "socket", "faults", "local ms", "ms", "tiles",
+                "lost", "reassigned", "duplicated", "identical");
+    for (size_t i = 0; i < runs.size(); ++i) {
+      for (const bool &faulty : {false, true}) {
+        for (const std::string &address : {unixAddress, tcpAddress}) {
+          // Only the last settings are also rendered with faults.
+          if (faulty && i + 1 != runs.size()) {
+            continue;
+          }
+
+          FrameBuffer frameBuffer(width, height);
+          double milliseconds;
+          DistributedFrame frame;
+          const bool clean =
+              render(scene, camera, runs[i], address, faulty, frameBuffer,
+                     milliseconds, frame);
+          const bool identical =
+              clean && frameBuffer.pixels == references[i].pixels;
+
+          std::printf("%-16s %-6s %-7s %10.1f %10.1f %8zu %8zu %10zu %10zu "
+                      "%10s\n",
+                      runs[i].name.c_str(), address == tcpAddress ? "tcp" : "unix",
+                      faulty ? "yes" : "no", referenceTimes[i], milliseconds,
+                      frame.tilesSent, frame.workersLost, frame.reassigned,
+                      frame.duplicated, identical ? "yes" : "no");
+          failed = failed || !identical;
+        }
+      }
+    }
+    std::printf("\n");
+  }
+
+  if (failed) {
+    std::printf("The workers rendered an frame differently.\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,142 @@
+// Counts the heap allocations made while rendering frames, by replacing the
+// global operator new. Once the first frame has set up the buffers, rendering
+// should not allocate at all: the hit records are plain data, and the thread
+// pool only takes an reference to the task. Exits with an non-zero status when
+// anything was allocated, so it can be used as an check.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "Material.hpp"
+#include "RayCaster.hpp"
+#include "Scenes.hpp"
+#include "Sphere.hpp"
+#include "ThreadPool.hpp"
+#include "Vector3D.hpp"
+
+static const size_t frameCount = 10;
+
+static std::atomic<size_t> allocationCount(0);
+
+static void *allocate(const size_t &size, const size_t &alignment) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+  void *pointer = alignment <= alignof(std::max_align_t)
+                      ? std::malloc(size != 0 ? size : 1)
+                      : std::aligned_alloc(alignment, (size + alignment - 1) /
+                                                          alignment * alignment);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return pointer;
+}
+
+void *operator new(size_t size) { return allocate(size, 0); }
+void *operator new[](size_t size) { return allocate(size, 0); }
+void *operator new(size_t size, std::align_val_t alignment) {
+  return allocate(size, static_cast<size_t>(alignment));
+}
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return allocate(size, static_cast<size_t>(alignment));
+}
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void *pointer, size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+/// Renders an warm-up frame followed by the measured ones, and gets the number
+/// of allocations made during the measured frames.
+static size_t measure(std::shared_ptr<GeometryRegister<double>> geometryRegister,
+                      const size_t &threads, const TraceMode &mode) {
+  FrameBuffer frameBuffer(640, 480);
+  Camera<double> camera = createTwoSphereCamera<double>(640, 480);
+  ThreadPool threadPool(threads);
+  RayCaster<double> rayCaster(frameBuffer, camera, geometryRegister);
+
+  rayCaster.Mode(mode).Render(threadPool);
+
+  const size_t before = allocationCount.load();
+  for (size_t frame = 0; frame < frameCount; ++frame) {
+    rayCaster.Render(threadPool);
+  }
+
+  return allocationCount.load() - before;
+}
+
+int main() {
+  // The scene of the viewer, and one with lots of spheres around it so the
+  // rays bounce through an deeper hierarchy.
+  std::shared_ptr<GeometryRegister<double>> twoSpheres =
+      std::make_shared<GeometryRegister<double>>();
+  createTwoSphereScene(*twoSpheres).Build();
+
+  std::shared_ptr<GeometryRegister<double>> manySpheres =
+      std::make_shared<GeometryRegister<double>>();
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<double> position(-250.0, 250.0);
+  std::uniform_real_distribution<double> channel(0.0, 1.0);
+  createTwoSphereScene(*manySpheres);
+  for (size_t i = 0; i < 1000; ++i) {
+    manySpheres->Register(std::make_shared<Sphere<double>>(
+        Vector3D<double>(position(random), position(random),
+                         position(random) + 300.0),
+        Material<double>(Vector3D<double>(channel(random), channel(random),
+                                          channel(random)),
+                         0.5),
+        10.0));
+  }
+  manySpheres->Build();
+
+  std::vector<size_t> threadCounts = {1, 4};
+  if (std::thread::hardware_concurrency() > 4) {
+    threadCounts.push_back(std::thread::hardware_concurrency());
+  }
+
+  bool allocated = false;
+  std::printf("%-14s %10s %8s %14s\n", "scene", "mode", "threads",
+              "allocations");
+  for (const auto &[name, geometryRegister] :
+       {std::make_pair("two spheres", twoSpheres),
+        std::make_pair("1000 spheres", manySpheres)}) {
+    for (const auto &[modeName, mode] :
+         {std::make_pair("per pixel", TraceMode::PerPixel),
+          std::make_pair("wavefront", TraceMode::Wavefront)}) {
+      for (const size_t &threads : threadCounts) {
+        const size_t allocations = measure(geometryRegister, threads, mode);
+        std::printf("%-14s %10s %8zu %14zu\n", name, modeName, threads,
+                    allocations);
+        allocated = allocated || allocations != 0;
+      }
+    }
+  }
+
+  if (allocated) {
+    std::printf("Rendering allocated memory after the first frame.\n");
+    return 1;
+  }
+
+  return 0;
+}
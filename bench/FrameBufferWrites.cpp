@@ -0,0 +1,95 @@
+// Compares writing an frame pixel by pixel through FrameBuffer::PutPixel with
+// gathering every tile in an thread-local tile buffer and flushing it at once.
+// The colors are cheap to compute, so this measures the writes alone.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "FrameBuffer.hpp"
+#include "ThreadPool.hpp"
+#include "Tile.hpp"
+#include "TileBuffer.hpp"
+
+static const size_t width = 1920;
+static const size_t height = 1080;
+static const size_t tileSize = 16;
+static const size_t frameCount = 50;
+
+/// Gets the current time in seconds.
+static double now() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/// An color gradient over the frame.
+static inline double shade(const size_t &x, const size_t &y, const size_t &k) {
+  return static_cast<double>((x + y + k) % 256) / 255.0;
+}
+
+/// Renders the frames and returns the time per frame, in milliseconds.
+template <typename F>
+static double measure(ThreadPool &threadPool, const std::vector<Tile> &tiles,
+                      F &&castTile) {
+  const double start = now();
+  for (size_t frame = 0; frame < frameCount; ++frame) {
+    threadPool.Run(tiles.size(), [&](const size_t &n, const size_t &thread) {
+      castTile(tiles[n], thread);
+    });
+  }
+
+  return (now() - start) / frameCount * 1e3;
+}
+
+int main() {
+  const std::vector<Tile> tiles = Tile::Split(width, height, tileSize);
+  const size_t hardwareThreads =
+      std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+  std::printf("%8s %16s %16s %10s\n", "threads", "per-pixel (ms)",
+              "tile flush (ms)", "speedup");
+
+  for (size_t threads = 1; threads <= hardwareThreads; threads *= 2) {
+    ThreadPool threadPool(threads);
+    FrameBuffer perPixel(width, height), flushed(width, height);
+
+    // Writes every pixel on its own, with an bounds check every time.
+    const double perPixelTime =
+        measure(threadPool, tiles, [&](const Tile &tile, const size_t &) {
+          for (size_t y = tile.y; y < tile.y + tile.height; ++y) {
+            for (size_t x = tile.x; x < tile.x + tile.width; ++x) {
+              const double value = shade(x, y, 0);
+              perPixel.PutPixel(x, y, FrameBuffer::Quantize(value),
+                                FrameBuffer::Quantize(value),
+                                FrameBuffer::Quantize(value), 255);
+            }
+          }
+        });
+
+    // Gathers the tile in the buffer of the thread, and flushes it.
+    std::vector<TileBuffer> tileBuffers(threads, TileBuffer(tileSize));
+    const double flushTime = measure(
+        threadPool, tiles, [&](const Tile &tile, const size_t &thread) {
+          TileBuffer &tileBuffer = tileBuffers[thread];
+          tileBuffer.Reset(tile);
+          for (size_t y = 0; y < tile.height; ++y) {
+            for (size_t x = 0; x < tile.width; ++x) {
+              const float value =
+                  static_cast<float>(shade(tile.x + x, tile.y + y, 0));
+              tileBuffer.Put(x, y, value, value, value, 1.0f);
+            }
+          }
+          tileBuffer.Flush(flushed);
+        });
+
+    std::printf("%8zu %16.3f %16.3f %9.2fx%s\n", threads, perPixelTime,
+                flushTime, perPixelTime / flushTime,
+                perPixel.pixels == flushed.pixels ? "" : " (images differ)");
+  }
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Measures how the ray throughput of the geometry register scales with the
+// number of registered spheres, compared to testing every sphere for every ray.
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "GeometryRegister.hpp"
+#include "Material.hpp"
+#include "Ray.hpp"
+#include "Sphere.hpp"
+#include "Vector3D.hpp"
+
+static const size_t raysPerSide = 256;
+static const size_t linearLimit = 10000;
+
+/// Gets the current time in seconds.
+static double now() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/// Casts an grid of parallel rays through the cube containing the spheres,
+/// returns the number of hits so the work can't be optimized away.
+template <typename F>
+static size_t castGrid(const double &side, F &&cast) {
+  size_t hits = 0;
+  for (size_t y = 0; y < raysPerSide; ++y) {
+    for (size_t x = 0; x < raysPerSide; ++x) {
+      const Ray<double> ray(
+          Vector3D<double>(side * static_cast<double>(x) / raysPerSide,
+                           side * static_cast<double>(y) / raysPerSide, -1.0),
+          Vector3D<double>(0.0, 0.0, 1.0));
+      hits += cast(ray) ? 1 : 0;
+    }
+  }
+
+  return hits;
+}
+
+int main() {
+  std::printf("%10s %12s %14s %14s %10s\n", "spheres", "build (ms)",
+              "bvh (Mray/s)", "linear (Mray/s)", "hits");
+
+  for (size_t count = 10; count <= 1000000; count *= 10) {
+    // Places the spheres randomly in an cube, the volume grows with the number
+    // of spheres so the density stays the same.
+    std::mt19937 random(1234);
+    const double side = 4.0 * std::cbrt(static_cast<double>(count));
+    std::uniform_real_distribution<double> position(0.0, side);
+
+    GeometryRegister<double> geometryRegister;
+    for (size_t i = 0; i < count; ++i) {
+      geometryRegister.Register(std::make_shared<Sphere<double>>(
+          Vector3D<double>(position(random), position(random),
+                           position(random)),
+          Material<double>(Vector3D<double>(1.0, 1.0, 1.0), 0.5), 1.0));
+    }
+
+    const double buildStart = now();
+    geometryRegister.Build();
+    const double buildTime = now() - buildStart;
+
+    // Casts the rays through the hierarchy.
+    const double bvhStart = now();
+    const size_t hits = castGrid(side, [&](const Ray<double> &ray) {
+      return geometryRegister.ClosestHit(ray).has_value();
+    });
+    const double bvhTime = now() - bvhStart;
+
+    // Casts the rays against every sphere, this gets too slow for the larger
+    // scenes so it's skipped there.
+    double linearRate = 0.0;
+    if (count <= linearLimit) {
+      const double linearStart = now();
+      castGrid(side, [&](const Ray<double> &ray) {
+        std::optional<double> nearest = std::nullopt;
+        for (const std::shared_ptr<Geometry<double>> &geometry :
+             geometryRegister.geometries) {
+          std::optional<RayHitResult<double>> hitResult = geometry->RayHit(ray);
+          if (hitResult.has_value() &&
+              (!nearest.has_value() || hitResult->distance < *nearest)) {
+            nearest = hitResult->distance;
+          }
+        }
+        return nearest.has_value();
+      });
+      linearRate = raysPerSide * raysPerSide / (now() - linearStart) / 1e6;
+    }
+
+    std::printf("%10zu %12.2f %14.3f %14.3f %10zu\n", count, buildTime * 1e3,
+                raysPerSide * raysPerSide / bvhTime / 1e6, linearRate, hits);
+  }
+
+  return 0;
+}
@@ -0,0 +1,200 @@
+// Renders the reference scenes with one, four and one thread per hardware
+// thread, and compares them with the golden images in ./golden. The renders
+// with different thread counts have to be exactly the same, and within the
+// tolerance of the golden image: an root mean square difference of at most
+// maximumRootMeanSquare steps, and at most maximumOffShare of the channels
+// more than offSteps apart, which leaves room for other compilers without
+// letting an real change through. The seeded scenes are also rendered with the
+// next seed, which has to give an other image. Takes about an second, so it
+// can gate every build, see make check. With --update the golden images are
+// written instead. Exits with an non-zero status when any check fails.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "ImageWriter.hpp"
+#include "Light.hpp"
+#include "RayCaster.hpp"
+#include "Sampler.hpp"
+#include "Scenes.hpp"
+#include "ThreadPool.hpp"
+#include "Vector3D.hpp"
+
+static const size_t width = 160, height = 120;
+static const std::string goldenDirectory = "./golden/";
+
+static const double maximumRootMeanSquare = 0.5;
+static const double maximumOffShare = 0.002;
+static const int offSteps = 2;
+
+/// An reference scene, and how it's rendered.
+class GoldenScene {
+public:
+  std::string name;
+  BenchScene<double> scene;
+  BenchSettings settings;
+};
+
+static const std::vector<GoldenScene> goldenScenes = {
+    {"two-spheres", BenchScene<double>::TwoSpheres(), BenchSettings()},
+    {"sphere-grid", BenchScene<double>::SphereGrid(20),
+     BenchSettings(SampleSettings(), TraceMode::Wavefront)},
+    {"random-spheres-10k", BenchScene<double>::RandomSpheres(10000),
+     BenchSettings()},
+    {"random-spheres-1k-lit",
+     {"random-spheres-1k-lit",
+      [](GeometryRegister<double> &geometryRegister) {
+        createRandomSpheresScene(geometryRegister, 1000);
+        geometryRegister
+            .Illuminate(
+                Light<double>::Ambient(Vector3D<double>(1.0, 1.0, 1.0), 0.2))
+            .Illuminate(Light<double>::Directional(
+                Vector3D<double>(0.3, -1.0, 0.5),
+                Vector3D<double>(1.0, 1.0, 0.9), 0.6))
+            .Illuminate(Light<double>::Point(Vector3D<double>(0.0, 40.0, 60.0),
+                                             Vector3D<double>(1.0, 0.9, 0.8),
+                                             2000.0));
+      },
+      createRandomSpheresCamera<double>},
+     BenchSettings(SampleSettings(), TraceMode::Wavefront)},
+    {"mirror-box-roulette", BenchScene<double>::MirrorBox(),
+     BenchSettings(SampleSettings(1, 4, 0.0f, SamplePattern::Stratified, 3),
+                   TraceMode::Wavefront, PathTermination(16, 0.5, true))},
+    {"two-spheres-adaptive", BenchScene<double>::TwoSpheres(),
+     BenchSettings(SampleSettings(16, 4, 0.01f, SamplePattern::Stratified, 7))},
+    {"sphere-grid-blue-noise", BenchScene<double>::SphereGrid(20),
+     BenchSettings(SampleSettings(8, 4, 0.0f, SamplePattern::BlueNoise, 11))},
+};
+
+/// Renders the scene with the given seed.
+static FrameBuffer render(std::shared_ptr<GeometryRegister<double>> scene,
+                          Camera<double> camera,
+                          const GoldenScene &goldenScene, const uint64_t &seed,
+                          ThreadPool &threadPool) {
+  BenchSettings settings = goldenScene.settings;
+  settings.sampling.seed = seed;
+  return renderBench(scene, camera, settings, threadPool, 0).image;
+}
+
+/// Reads an binary PPM written by ImageWriter::WritePPM(), gets nullopt when
+/// there is none or it has an other size.
+static std::optional<FrameBuffer> readPPM(const std::string &path) {
+  std::ifstream stream(path, std::ios::binary);
+  std::string magic;
+  size_t imageWidth = 0, imageHeight = 0, maximum = 0;
+  stream >> magic >> imageWidth >> imageHeight >> maximum;
+  stream.get();
+  if (!stream || magic != "P6" || imageWidth != width ||
+      imageHeight != height || maximum != 255) {
+    return std::nullopt;
+  }
+
+  FrameBuffer frameBuffer(width, height);
+  std::vector<uint8_t> row(width * 3);
+  for (size_t y = 0; y < height; ++y) {
+    stream.read(reinterpret_cast<char *>(row.data()), row.size());
+    for (size_t x = 0; x < width; ++x) {
+      frameBuffer.PutPixel(x, y, row[x * 3], row[x * 3 + 1], row[x * 3 + 2], 255);
+    }
+  }
+
+  if (!stream) {
+    return std::nullopt;
+  }
+  return frameBuffer;
+}
+
+/// Gets the share of the color channels which are more than offSteps apart.
+static double offShare(const FrameBuffer &a, const FrameBuffer &b) {
+  size_t count = 0, off = 0;
+  for (size_t i = 0; i < a.pixels.size(); ++i) {
+    if (i % FrameBuffer::channelCount == 3) {
+      continue;
+    }
+
+    const int difference =
+        static_cast<int>(a.pixels[i]) - static_cast<int>(b.pixels[i]);
+    off += std::abs(difference) > offSteps ? 1 : 0;
+    ++count;
+  }
+
+  return static_cast<double>(off) / static_cast<double>(count);
+}
+
+int main(int argc, char *argv[]) {
+  const bool update = argc > 1 && std::string(argv[1]) == "--update";
+  const auto start = std::chrono::steady_clock::now();
+
+  ThreadPool one(1), four(4), all(0);
+  const std::vector<ThreadPool *> threadPools = {&one, &four, &all};
+  bool failed = false;
+
+  std::printf("%-24s %14s %10s %10s %8s %8s %8s\n", "scene", "threads",
+              "identical", "rms", "off", "seeded", "passed");
+  for (const GoldenScene &goldenScene : goldenScenes) {
+    std::shared_ptr<GeometryRegister<double>> scene = goldenScene.scene.Build();
+    const Camera<double> camera = goldenScene.scene.camera(width, height);
+    const uint64_t &seed = goldenScene.settings.sampling.seed;
+
+    std::vector<FrameBuffer> images;
+    for (ThreadPool *threadPool : threadPools) {
+      images.push_back(render(scene, camera, goldenScene, seed, *threadPool));
+    }
+    bool identical = true;
+    for (const FrameBuffer &image : images) {
+      identical = identical && image.pixels == images.front().pixels;
+    }
+
+    // The seeded scenes have to depend on their seed.
+    const bool seeded = seed != 0;
+    const bool reseeded =
+        !seeded ||
+        render(scene, camera, goldenScene, seed + 1, one).pixels !=
+            images.front().pixels;
+
+    const std::string path = goldenDirectory + goldenScene.name + ".ppm";
+    double difference = 0.0, off = 0.0;
+    bool matches = true;
+    if (update) {
+      ImageWriter::WritePPM(images.front(), path);
+    } else if (const std::optional<FrameBuffer> golden = readPPM(path)) {
+      difference = rootMeanSquare(images.front(), *golden);
+      off = offShare(images.front(), *golden);
+      matches = difference <= maximumRootMeanSquare && off <= maximumOffShare;
+    } else {
+      std::printf("%s is missing, or has an other size.\n", path.c_str());
+      matches = false;
+    }
+
+    const bool passed = identical && reseeded && matches;
+    std::printf("%-24s %5zu, %zu, %-4zu %10s %10.3f %7.3f%% %8s %8s\n",
+                goldenScene.name.c_str(), one.ThreadCount(),
+                four.ThreadCount(), all.ThreadCount(),
+                identical ? "yes" : "no", difference, off * 100.0,
+                seeded ? (reseeded ? "yes" : "no") : "-",
+                passed ? "yes" : "no");
+    failed = failed || !passed;
+  }
+
+  std::printf("%s in %.0f ms\n", update ? "Updated" : "Checked",
+              millisecondsSince(start));
+  if (failed) {
+    std::printf("An image depends on the thread count, its seed or differs "
+                "from its golden image.\n");
+    return 1;
+  }
+
+  return 0;
+}
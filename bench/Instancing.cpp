@@ -0,0 +1,204 @@
+// Measures the two-level hierarchy: an grid of instances of one group of
+// spheres. First an small grid is checked against the same spheres registered
+// one by one, every ray has to hit the same sphere at the same distance. Then
+// an large grid measures the memory it takes, the cost of an rebuild versus a
+// refit after all instances moved, and how fast it renders. Exits with an
+// non-zero status when the instances and the flat spheres disagree.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "Instance.hpp"
+#include "Matrix3D.hpp"
+#include "Ray.hpp"
+#include "RayCaster.hpp"
+#include "Scenes.hpp"
+#include "Sphere.hpp"
+#include "ThreadPool.hpp"
+#include "Vector3D.hpp"
+
+static const size_t checkInstances = 64;
+static const size_t checkGroupSize = 200;
+static const size_t checkRays = 200000;
+
+static const size_t instanceCount = 100000;
+static const size_t groupSize = 1000;
+
+template <typename A> static size_t bytes(const A &array) {
+  return array.capacity() * sizeof(typename A::value_type);
+}
+
+/// Gets the memory the geometry of an register takes, including the objects
+/// the registered pointers point to but not the groups of instances.
+static size_t registerBytes(const GeometryRegister<double> &geometryRegister) {
+  const SceneStore<double> &store = geometryRegister.store;
+  size_t total = bytes(geometryRegister.geometries) +
+                 bytes(geometryRegister.hierarchy.nodes) +
+                 bytes(geometryRegister.hierarchy.indices) +
+                 bytes(store.types) + bytes(store.slots) +
+                 bytes(store.geometries) + bytes(store.sphereX) +
+                 bytes(store.sphereY) + bytes(store.sphereZ) +
+                 bytes(store.sphereRadius) + bytes(store.sphereMaterials) +
+                 bytes(store.others) + bytes(store.otherMaterials) +
+                 bytes(store.instances) + bytes(store.instanceMaterials) +
+                 bytes(store.materialMap) + bytes(store.materials);
+
+  // The objects themselves, and the control blocks of their pointers.
+  for (const std::shared_ptr<Geometry<double>> &geometry :
+       geometryRegister.geometries) {
+    total += 2 * sizeof(void *) +
+             (dynamic_cast<const Instance<double> *>(geometry.get())
+                  ? sizeof(Instance<double>)
+                  : sizeof(Sphere<double>));
+  }
+
+  return total;
+}
+
+/// Registers the spheres of every instance one by one, transformed.
+static void flatten(const GeometryRegister<double> &instances,
+                    GeometryRegister<double> &flat) {
+  for (const std::shared_ptr<Geometry<double>> &geometry :
+       instances.geometries) {
+    const Instance<double> &instance =
+        dynamic_cast<const Instance<double> &>(*geometry);
+    for (const std::shared_ptr<Geometry<double>> &member :
+         instance.group->geometries) {
+      const Sphere<double> &sphere =
+          dynamic_cast<const Sphere<double> &>(*member);
+      flat.Register(std::make_shared<Sphere<double>>(
+          instance.Transformation().TransformPoint(sphere.position),
+          sphere.material, sphere.radius));
+    }
+  }
+}
+
+/// Casts random rays into both registers, and counts the rays for which they
+/// disagree.
+static size_t compare(GeometryRegister<double> &instances,
+                      GeometryRegister<double> &flat) {
+  const BoundingBox<double> bounds = instances.Bounds();
+  const Vector3D<double> extent = bounds.max.Subtract(bounds.min);
+  std::mt19937 random(1234);
+  std::uniform_int_distribution<size_t> sphere(0, flat.geometries.size() - 1);
+  std::uniform_real_distribution<double> jitter(-2.0, 2.0);
+
+  size_t mismatches = 0, hits = 0;
+  for (size_t i = 0; i < checkRays; ++i) {
+    // From an point in front of the grid, towards an point near one of the
+    // spheres so most of the rays hit something.
+    const Vector3D<double> target =
+        flat.geometries[sphere(random)]->position.Add(
+            Vector3D<double>(jitter(random), jitter(random), jitter(random)));
+    const Vector3D<double> origin(0.0, 0.0, bounds.min.z - extent.x);
+    const Ray<double> ray(origin, target.Subtract(origin).Normalize());
+
+    const std::optional<HitRecord<double>> instanceHit =
+        instances.ClosestHit(ray);
+    const std::optional<HitRecord<double>> flatHit = flat.ClosestHit(ray);
+    if (instanceHit.has_value() != flatHit.has_value()) {
+      ++mismatches;
+      continue;
+    }
+    if (!instanceHit.has_value()) {
+      continue;
+    }
+    ++hits;
+
+    const Vector3D<double> &instanceColor =
+        instances.HitMaterial(*instanceHit).color;
+    const Vector3D<double> &flatColor = flat.HitMaterial(*flatHit).color;
+    if (std::abs(instanceHit->distance - flatHit->distance) >
+            1e-9 * flatHit->distance ||
+        instanceHit->normal.Subtract(flatHit->normal).Magnitude() > 1e-6 ||
+        instanceColor.x != flatColor.x || instanceColor.y != flatColor.y ||
+        instanceColor.z != flatColor.z) {
+      ++mismatches;
+    }
+  }
+
+  std::printf("%zu instances of %zu spheres: %zu rays, %zu hits, %zu "
+              "mismatches\n",
+              checkInstances, checkGroupSize, checkRays, hits, mismatches);
+  return mismatches;
+}
+
+int main() {
+  // Checks an small grid against the flat spheres.
+  GeometryRegister<double> checkGrid, checkFlat;
+  createInstancedSpheresScene(checkGrid, checkInstances, checkGroupSize).Build();
+  flatten(checkGrid, checkFlat);
+  checkFlat.Build();
+  const size_t mismatches = compare(checkGrid, checkFlat);
+
+  // The large grid.
+  std::shared_ptr<GeometryRegister<double>> grid =
+      std::make_shared<GeometryRegister<double>>();
+  createInstancedSpheresScene(*grid, instanceCount, groupSize);
+
+  const auto buildStart = std::chrono::steady_clock::now();
+  grid->Build();
+  const double buildTime =
+      milliseconds(std::chrono::steady_clock::now() - buildStart);
+
+  const GeometryRegister<double> &group =
+      *dynamic_cast<const Instance<double> &>(*grid->geometries[0]).group;
+  const size_t groupBytes = registerBytes(group);
+  const size_t instanceBytes = registerBytes(*grid);
+  std::printf("%zu instances of %zu spheres: group %.2f MB, instances %.2f MB, "
+              "flat would be about %.0f MB\n",
+              instanceCount, groupSize, groupBytes / 1e6, instanceBytes / 1e6,
+              static_cast<double>(groupBytes) * instanceCount / 1e6);
+
+  // Moves every instance a bit, and refits the hierarchy over them.
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<double> offset(-5.0, 5.0);
+  for (const std::shared_ptr<Geometry<double>> &geometry : grid->geometries) {
+    Instance<double> &instance = dynamic_cast<Instance<double> &>(*geometry);
+    instance.Transform(
+        AffineMatrix3D<double>::Translation(
+            Vector3D<double>(offset(random), offset(random), offset(random)))
+            .Multiply(instance.Transformation()));
+  }
+
+  const auto refitStart = std::chrono::steady_clock::now();
+  grid->Refit();
+  const double refitTime =
+      milliseconds(std::chrono::steady_clock::now() - refitStart);
+  std::printf("Build %.1f ms, refit after moving every instance %.1f ms "
+              "(%.1fx faster)\n",
+              buildTime, refitTime, buildTime / refitTime);
+
+  // Renders the grid.
+  FrameBuffer frameBuffer(320, 240);
+  Camera<double> camera = createInstancedSpheresCamera<double>(
+      320, 240, instanceCount, groupSize);
+  ThreadPool threadPool(0);
+  RayCaster<double> rayCaster(frameBuffer, camera, grid);
+  rayCaster.Render(threadPool);
+
+  const auto renderStart = std::chrono::steady_clock::now();
+  rayCaster.Render(threadPool);
+  std::printf("Rendered 320x240 on %zu threads in %.1f ms\n",
+              threadPool.ThreadCount(),
+              milliseconds(std::chrono::steady_clock::now() - renderStart));
+
+  if (mismatches != 0) {
+    std::printf("The instances and the flat spheres disagree.\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,175 @@
+// Writes an finely tessellated sphere as an Wavefront OBJ file, and measures how
+// fast it's loaded, how long its hierarchy takes to build and how fast rays are
+// cast against it. The rays start at the center of the closed mesh so every one
+// of them has to hit it, including the ones aimed exactly at the vertices and
+// edges where the triangles meet. Exits with an non-zero status when any ray
+// slipped through, so it can be used as an check.
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Bench.hpp"
+#include "Material.hpp"
+#include "ObjLoader.hpp"
+#include "Ray.hpp"
+#include "TriangleMesh.hpp"
+#include "Vector3D.hpp"
+
+static const size_t rings = 256;
+static const size_t segments = 512;
+static const double radius = 10.0;
+static const size_t randomRays = 1000000;
+
+/// Writes an sphere of quads between the rings, closed by triangle fans at the
+/// poles. The caps use negative indices and the quads give texture
+/// coordinates, so the different forms of faces are all parsed.
+static void writeSphere(const std::string &path) {
+  std::ofstream stream(path);
+  stream << "# An sphere of " << rings << " rings\no sphere\n";
+  stream.precision(17);
+
+  stream << "v 0 " << radius << " 0\n";
+  for (size_t ring = 1; ring < rings; ++ring) {
+    const double theta = M_PI * static_cast<double>(ring) / rings;
+    for (size_t segment = 0; segment < segments; ++segment) {
+      const double phi = 2.0 * M_PI * static_cast<double>(segment) / segments;
+      stream << "v " << radius * std::sin(theta) * std::cos(phi) << ' '
+             << radius * std::cos(theta) << ' '
+             << radius * std::sin(theta) * std::sin(phi) << '\n';
+    }
+  }
+  stream << "v 0 " << -radius << " 0\nvt 0 0\n";
+
+  // Vertex 1 is the top, the rings start at 2 and the bottom is last.
+  const auto vertex = [](const size_t &ring, const size_t &segment) {
+    return 2 + (ring - 1) * segments + segment % segments;
+  };
+
+  for (size_t segment = 0; segment < segments; ++segment) {
+    stream << "f 1 " << vertex(1, segment + 1) << ' ' << vertex(1, segment)
+           << '\n';
+  }
+  for (size_t ring = 1; ring + 1 < rings; ++ring) {
+    for (size_t segment = 0; segment < segments; ++segment) {
+      stream << "f " << vertex(ring, segment) << "/1 "
+             << vertex(ring, segment + 1) << "/1 "
+             << vertex(ring + 1, segment + 1) << "/1 "
+             << vertex(ring + 1, segment) << "/1\n";
+    }
+  }
+
+  // The bottom cap is written last, so -1 is the bottom vertex.
+  const size_t last = vertex(rings - 1, 0) + segments;
+  for (size_t segment = 0; segment < segments; ++segment) {
+    stream << "f -1 " << static_cast<long>(vertex(rings - 1, segment)) -
+                             static_cast<long>(last) - 1
+           << ' '
+           << static_cast<long>(vertex(rings - 1, segment + 1)) -
+                  static_cast<long>(last) - 1
+           << '\n';
+  }
+
+  if (!stream) {
+    throw std::runtime_error("Failed to write " + path);
+  }
+}
+
+/// Casts rays from the center towards the given points, and counts the misses.
+static size_t castTowards(TriangleMesh<double> &mesh,
+                          const std::vector<Vector3D<double>> &targets) {
+  size_t misses = 0;
+  for (const Vector3D<double> &target : targets) {
+    const Ray<double> ray(Vector3D<double>(0.0, 0.0, 0.0), target.Normalize());
+    if (!mesh.RayHit(ray).has_value()) {
+      ++misses;
+    }
+  }
+
+  return misses;
+}
+
+int main() {
+  char path[] = "/tmp/MeshTracingXXXXXX";
+  const int file = mkstemp(path);
+  if (file < 0) {
+    std::fprintf(stderr, "Failed to create an temporary file.\n");
+    return 1;
+  }
+  close(file);
+
+  writeSphere(path);
+
+  const auto loadStart = std::chrono::steady_clock::now();
+  const ObjMesh obj = ObjLoader::Load(path);
+  const double loadTime =
+      milliseconds(std::chrono::steady_clock::now() - loadStart);
+
+  std::ifstream size(path, std::ios::ate | std::ios::binary);
+  const double megabytes = static_cast<double>(size.tellg()) / 1e6;
+  unlink(path);
+
+  const auto buildStart = std::chrono::steady_clock::now();
+  TriangleMesh<double> mesh(obj.vertices, obj.indices,
+                            Material<double>(Vector3D<double>(1.0, 1.0, 1.0),
+                                             0.0));
+  const double buildTime =
+      milliseconds(std::chrono::steady_clock::now() - buildStart);
+
+  std::printf("%zu vertices, %zu triangles, %.1f MB\n", obj.vertices.size(),
+              mesh.TriangleCount(), megabytes);
+  std::printf("Loaded in %.1f ms (%.1f MB/s), hierarchy built in %.1f ms\n",
+              loadTime, megabytes / (loadTime / 1e3), buildTime);
+
+  // Random directions, timed.
+  std::mt19937 random(1234);
+  std::normal_distribution<double> normal(0.0, 1.0);
+  std::vector<Vector3D<double>> directions;
+  directions.reserve(randomRays);
+  for (size_t i = 0; i < randomRays; ++i) {
+    directions.emplace_back(normal(random), normal(random), normal(random));
+  }
+
+  const auto castStart = std::chrono::steady_clock::now();
+  const size_t randomMisses = castTowards(mesh, directions);
+  const double castTime =
+      milliseconds(std::chrono::steady_clock::now() - castStart);
+  std::printf("%zu random rays in %.1f ms (%.2f Mrays/s), %zu missed\n",
+              randomRays, castTime, randomRays / (castTime * 1e3),
+              randomMisses);
+
+  // Every vertex, and the middle of every edge, where the rays are the most
+  // likely to slip between the triangles.
+  std::vector<Vector3D<double>> seams(obj.vertices);
+  for (size_t triangle = 0; triangle < mesh.TriangleCount(); ++triangle) {
+    for (size_t corner = 0; corner < 3; ++corner) {
+      const Vector3D<double> &a =
+          mesh.vertices[mesh.indices[triangle * 3 + corner]];
+      const Vector3D<double> &b =
+          mesh.vertices[mesh.indices[triangle * 3 + (corner + 1) % 3]];
+      seams.push_back(a.Add(b).Multiply(0.5));
+    }
+  }
+
+  const size_t seamMisses = castTowards(mesh, seams);
+  std::printf("%zu rays through vertices and edges, %zu missed\n",
+              seams.size(), seamMisses);
+
+  if (randomMisses != 0 || seamMisses != 0) {
+    std::printf("Rays slipped through the closed mesh.\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,126 @@
+// Compares the packet path of the geometry register against the scalar path,
+// which is the reference: every lane must hit the same geometry at the same
+// distance. Also measures the throughput of both paths for coherent rays.
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <random>
+
+#include "GeometryRegister.hpp"
+#include "Material.hpp"
+#include "Ray.hpp"
+#include "RayPacket.hpp"
+#include "Simd.hpp"
+#include "Sphere.hpp"
+#include "Vector3D.hpp"
+
+static const size_t raysPerSide = 512;
+static const size_t sphereCount = 1000;
+
+/// Gets the current time in seconds.
+static double now() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/// Gets the primary ray of the given pixel, slightly diverging so the rays are
+/// coherent but not parallel.
+template <typename T> static Ray<T> primaryRay(const size_t &x, const size_t &y) {
+  const T u = static_cast<T>(x) / raysPerSide - static_cast<T>(0.5);
+  const T v = static_cast<T>(y) / raysPerSide - static_cast<T>(0.5);
+  return Ray<T>(Vector3D<T>(static_cast<T>(20.0) + u * 40, static_cast<T>(20.0) + v * 40, -10.0),
+                Vector3D<T>(u * static_cast<T>(0.2), v * static_cast<T>(0.2), 1.0)
+                    .Normalize());
+}
+
+template <typename T> static bool run(const char *name) {
+  // Places the spheres randomly in an cube in front of the rays.
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<T> position(0.0, 40.0);
+  std::uniform_real_distribution<T> radius(0.5, 2.0);
+
+  GeometryRegister<T> geometryRegister;
+  for (size_t i = 0; i < sphereCount; ++i) {
+    geometryRegister.Register(std::make_shared<Sphere<T>>(
+        Vector3D<T>(position(random), position(random), position(random)),
+        Material<T>(Vector3D<T>(1.0, 1.0, 1.0), 0.5), radius(random)));
+  }
+  geometryRegister.Build();
+
+  // Casts all the rays through the scalar path.
+  size_t scalarHits = 0;
+  const double scalarStart = now();
+  for (size_t y = 0; y < raysPerSide; ++y) {
+    for (size_t x = 0; x < raysPerSide; ++x) {
+      scalarHits += geometryRegister.ClosestHit(primaryRay<T>(x, y)) ? 1 : 0;
+    }
+  }
+  const double scalarTime = now() - scalarStart;
+
+  // Casts all the rays through the packet path.
+  RayPacket<T> packet;
+  size_t packetHits = 0;
+  const double packetStart = now();
+  for (size_t y = 0; y < raysPerSide; ++y) {
+    for (size_t x = 0; x < raysPerSide; x += RayPacket<T>::size) {
+      packet.Clear();
+      for (size_t lane = 0; lane < RayPacket<T>::size; ++lane) {
+        packet.Push(primaryRay<T>(x + lane, y));
+      }
+
+      geometryRegister.CastPacket(packet);
+      for (size_t lane = 0; lane < RayPacket<T>::size; ++lane) {
+        packetHits += packet.geometry[lane] != RayPacket<T>::noGeometry;
+      }
+    }
+  }
+  const double packetTime = now() - packetStart;
+
+  // Compares the results of both paths, ray by ray.
+  size_t mismatches = 0;
+  for (size_t y = 0; y < raysPerSide; ++y) {
+    for (size_t x = 0; x < raysPerSide; x += RayPacket<T>::size) {
+      packet.Clear();
+      for (size_t lane = 0; lane < RayPacket<T>::size; ++lane) {
+        packet.Push(primaryRay<T>(x + lane, y));
+      }
+
+      geometryRegister.CastPacket(packet);
+      for (size_t lane = 0; lane < RayPacket<T>::size; ++lane) {
+        const auto scalar = geometryRegister.ClosestHit(packet.At(lane));
+        const auto packed = geometryRegister.PacketHit(packet, lane);
+        if (scalar.has_value() != packed.has_value()) {
+          ++mismatches;
+          continue;
+        }
+
+        if (scalar.has_value() &&
+            (scalar->primitive != packed->primitive ||
+             scalar->distance != packed->distance ||
+             scalar->normal.Dot(packed->normal) < static_cast<T>(0.9999))) {
+          ++mismatches;
+        }
+      }
+    }
+  }
+
+  const double rayCount = static_cast<double>(raysPerSide * raysPerSide);
+  std::printf("%-7s %2zu lanes: scalar %8.3f Mray/s, packet %8.3f Mray/s "
+              "(%.2fx), hits %zu/%zu, mismatches %zu\n",
+              name, Simd<T>::width, rayCount / scalarTime / 1e6,
+              rayCount / packetTime / 1e6, scalarTime / packetTime, scalarHits,
+              packetHits, mismatches);
+
+  return mismatches == 0;
+}
+
+int main() {
+  const bool doubleMatches = run<double>("double");
+  const bool floatMatches = run<float>("float");
+  return doubleMatches && floatMatches ? 0 : 1;
+}
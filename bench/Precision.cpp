@@ -0,0 +1,97 @@
+// Renders the standard scenes in single and double precision, and compares
+// both the speed and the images. The double precision image is the reference,
+// an pixel counts as different when any of its channels is more than a few
+// steps off. Exits with an non-zero status when too many pixels of an scene
+// are different, so it can be used as an check of the float path.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "Bench.hpp"
+#include "FrameBuffer.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+
+static const size_t width = 320, height = 240;
+static const size_t frameCount = 5;
+
+// An channel may be this many steps off, and this fraction of the pixels may
+// be off by more.
+static const int channelTolerance = 3;
+static const double pixelTolerance = 0.01;
+
+template <typename T> static std::vector<BenchScene<T>> scenes() {
+  return {BenchScene<T>::TwoSpheres(), BenchScene<T>::SphereGrid(100),
+          BenchScene<T>::RandomSpheres(100000),
+          BenchScene<T>::InstancedSpheres(1000, 1000),
+          BenchScene<T>::MirrorBox()};
+}
+
+/// Renders the scene in its precision, the profiled frame also warms up.
+template <typename T>
+static BenchFrame render(const BenchScene<T> &scene, ThreadPool &threadPool) {
+  return renderBench(scene.Build(), scene.camera(width, height),
+                     BenchSettings(), threadPool, frameCount, true);
+}
+
+/// Gets the fraction of pixels which differ by more than the tolerance, and
+/// the largest difference of any channel.
+static double difference(const FrameBuffer &a, const FrameBuffer &b,
+                         int &largest) {
+  size_t different = 0;
+  largest = 0;
+  for (size_t i = 0; i < a.pixels.size(); i += FrameBuffer::channelCount) {
+    int pixel = 0;
+    for (size_t channel = 0; channel < 3; ++channel) {
+      pixel = std::max(pixel, std::abs(static_cast<int>(a.pixels[i + channel]) -
+                                       static_cast<int>(b.pixels[i + channel])));
+    }
+
+    largest = std::max(largest, pixel);
+    different += pixel > channelTolerance ? 1 : 0;
+  }
+
+  return static_cast<double>(different) / (a.width * a.height);
+}
+
+int main() {
+  ThreadPool threadPool(0);
+  const std::vector<BenchScene<float>> floatScenes = scenes<float>();
+  const std::vector<BenchScene<double>> doubleScenes = scenes<double>();
+
+  std::printf("%zux%zu on %zu threads, median of %zu frames\n", width, height,
+              threadPool.ThreadCount(), frameCount);
+  std::printf("%-22s %12s %12s %8s %10s %8s\n", "scene", "double Mray/s",
+              "float Mray/s", "speedup", "different", "largest");
+
+  bool failed = false;
+  for (size_t i = 0; i < doubleScenes.size(); ++i) {
+    const BenchFrame doubleRun = render(doubleScenes[i], threadPool);
+    const BenchFrame floatRun = render(floatScenes[i], threadPool);
+
+    int largest;
+    const double different =
+        difference(doubleRun.image, floatRun.image, largest);
+    const double doubleSpeed = doubleRun.Counter(ProfileCounter::Rays) /
+                               (doubleRun.Median() * 1e3);
+    const double floatSpeed = floatRun.Counter(ProfileCounter::Rays) /
+                              (floatRun.Median() * 1e3);
+
+    std::printf("%-22s %12.3f %12.3f %7.2fx %9.2f%% %8d\n",
+                doubleScenes[i].name.c_str(),
+                doubleSpeed, floatSpeed, floatSpeed / doubleSpeed,
+                different * 100.0, largest);
+    failed = failed || different > pixelTolerance;
+  }
+
+  if (failed) {
+    std::printf("The float images differ too much from the double ones.\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+// Renders scenes full of reflections as wavefronts, with the reflected rays
+// extended in the order of their pixels, sorted by their direction and sorted
+// by their direction and their origin, see RayOrder. Reports the throughput of
+// the reflected rays, which is timed as the frame without the primary-only
+// frame, and the nodes they visit per ray, which drops as more of them are
+// cast in packets. Every order has to give the exact same image. Exits with an
+// non-zero status when one does not.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "GeometryRegister.hpp"
+#include "Profiler.hpp"
+#include "RayCaster.hpp"
+#include "Sampler.hpp"
+#include "ThreadPool.hpp"
+
+static const size_t width = 640, height = 480;
+static const size_t frameCount = 5;
+
+static const std::vector<BenchScene<double>> sortingScenes = {
+    BenchScene<double>::MirrorBox(), BenchScene<double>::SphereGrid(100),
+    BenchScene<double>::RandomSpheres(100000)};
+
+static const std::vector<std::pair<const char *, RayOrder>> rayOrders = {
+    {"pixel", RayOrder::Pixel},
+    {"octant", RayOrder::Octant},
+    {"morton", RayOrder::Morton},
+};
+
+/// Renders the frames as wavefronts with paths of up to the given number of
+/// rays.
+static BenchFrame render(std::shared_ptr<GeometryRegister<double>> scene,
+                         Camera<double> camera, const RayOrder &order,
+                         const size_t &maximumRays, ThreadPool &threadPool) {
+  return renderBench(scene, camera,
+                     BenchSettings(SampleSettings(), TraceMode::Wavefront,
+                                   PathTermination(maximumRays), order),
+                     threadPool, frameCount, true);
+}
+
+int main() {
+  ThreadPool threadPool(0);
+  const size_t maximumRays = PathTermination().maximumRays;
+  bool failed = false;
+
+  for (const BenchScene<double> &sortingScene : sortingScenes) {
+    std::shared_ptr<GeometryRegister<double>> scene = sortingScene.Build();
+    const Camera<double> camera = sortingScene.camera(width, height);
+
+    std::printf("%s\n", sortingScene.name.c_str());
+    std::printf("%-8s %12s %10s %14s %10s %12s %10s\n", "order",
+                "reflected", "frame ms", "reflected ms", "Mrays/s",
+                "nodes/ray", "identical");
+
+    std::vector<uint8_t> reference;
+    for (const auto &[name, order] : rayOrders) {
+      const BenchFrame primary = render(scene, camera, order, 1, threadPool);
+      const BenchFrame frame =
+          render(scene, camera, order, maximumRays, threadPool);
+      const auto &pixels = frame.image.pixels;
+      if (reference.empty()) {
+        reference.assign(pixels.begin(), pixels.end());
+      }
+      const bool identical = std::equal(reference.begin(), reference.end(),
+                                        pixels.begin(), pixels.end());
+
+      const uint64_t reflected = frame.Counter(ProfileCounter::Rays) -
+                                 primary.Counter(ProfileCounter::Rays);
+      const uint64_t nodes = frame.Counter(ProfileCounter::NodesVisited) -
+                             primary.Counter(ProfileCounter::NodesVisited);
+      const double reflectedMilliseconds =
+          std::max(frame.Fastest() - primary.Fastest(), 0.0);
+      std::printf("%-8s %12llu %10.1f %14.1f %10.2f %12.1f %10s\n", name,
+                  static_cast<unsigned long long>(reflected), frame.Fastest(),
+                  reflectedMilliseconds,
+                  static_cast<double>(reflected) / reflectedMilliseconds /
+                      1000.0,
+                  static_cast<double>(nodes) / static_cast<double>(reflected),
+                  identical ? "yes" : "no");
+      failed = failed || !identical;
+    }
+    std::printf("\n");
+  }
+
+  if (failed) {
+    std::printf("An order of the reflected rays changed the image.\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,201 @@
+// Renders the standard scenes headlessly at an fixed resolution, and measures
+// the frame times on 1, 2, 4 ... threads up to the number of hardware threads.
+// The results are written to stdout as JSON so the runs of different commits
+// can be compared, the progress goes to stderr.
+//
+// Usage: RenderSuite [--label name] [--frames 10] [--width 640] [--height 480]
+//                    [--max-threads N] [--scenes two-spheres,sphere-grid,...]
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "GeometryRegister.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+
+static const std::vector<BenchScene<double>> suiteScenes = {
+    BenchScene<double>::TwoSpheres(), BenchScene<double>::SphereGrid(100),
+    BenchScene<double>::RandomSpheres(1000000),
+    BenchScene<double>::InstancedSpheres(100000, 1000),
+    BenchScene<double>::MirrorBox()};
+
+class Options {
+public:
+  std::string label;
+  size_t frames;
+  size_t width, height;
+  size_t maxThreads;
+  std::vector<std::string> scenes;
+
+public:
+  Options()
+      : label(""), frames(10), width(640), height(480),
+        maxThreads(std::max<size_t>(std::thread::hardware_concurrency(), 1)),
+        scenes() {
+    for (const BenchScene<double> &scene : suiteScenes) {
+      this->scenes.push_back(scene.name);
+    }
+  }
+
+  static Options Parse(int argc, char *argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+      const std::string argument = argv[i];
+      if (i + 1 >= argc) {
+        throw std::runtime_error("Missing value for " + argument);
+      }
+
+      const std::string value = argv[++i];
+      if (argument == "--label") {
+        options.label = value;
+      } else if (argument == "--frames") {
+        options.frames = std::max<size_t>(std::stoul(value), 1);
+      } else if (argument == "--width") {
+        options.width = std::stoul(value);
+      } else if (argument == "--height") {
+        options.height = std::stoul(value);
+      } else if (argument == "--max-threads") {
+        options.maxThreads = std::max<size_t>(std::stoul(value), 1);
+      } else if (argument == "--scenes") {
+        options.scenes.clear();
+        std::stringstream stream(value);
+        for (std::string name; std::getline(stream, name, ',');) {
+          options.scenes.push_back(name);
+        }
+      } else {
+        throw std::runtime_error("Unknown option " + argument);
+      }
+    }
+
+    return options;
+  }
+};
+
+/// Gets the given percentile of the sorted samples, by nearest rank.
+static double percentile(const std::vector<double> &sorted, const double &p) {
+  const size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+  return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+/// Gets the thread counts to measure: the powers of two below the maximum, and
+/// the maximum itself.
+static std::vector<size_t> threadCounts(const size_t &maxThreads) {
+  std::vector<size_t> counts;
+  for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+    counts.push_back(threads);
+  }
+  counts.push_back(maxThreads);
+
+  return counts;
+}
+
+static void runScene(const BenchScene<double> &scene, const Options &options,
+                     const bool &first) {
+  std::cerr << scene.name << ": building" << std::endl;
+  std::shared_ptr<GeometryRegister<double>> geometryRegister =
+      std::make_shared<GeometryRegister<double>>();
+  scene.create(*geometryRegister);
+
+  const double buildTime =
+      timeMilliseconds([&]() { geometryRegister->Build(); });
+
+  Camera<double> camera = scene.camera(options.width, options.height);
+
+  // Counts the rays of an frame once, every frame casts the same rays.
+  uint64_t raysPerFrame = 0;
+  {
+    ThreadPool threadPool(1);
+    raysPerFrame =
+        renderBench(geometryRegister, camera, BenchSettings(), threadPool, 0,
+                    true)
+            .Counter(ProfileCounter::Rays);
+  }
+
+  std::printf("%s\n    {\"name\": \"%s\", \"primitives\": %zu, "
+              "\"buildMilliseconds\": %.3f, \"raysPerFrame\": %llu, "
+              "\"runs\": [",
+              first ? "" : ",", scene.name.c_str(),
+              geometryRegister->geometries.size(), buildTime,
+              static_cast<unsigned long long>(raysPerFrame));
+
+  double singleThreadMedian = 0.0;
+  const std::vector<size_t> counts = threadCounts(options.maxThreads);
+  for (size_t i = 0; i < counts.size(); ++i) {
+    // The counted frame also warms up the buffers of the threads.
+    ThreadPool threadPool(counts[i]);
+    const std::vector<double> frameTimes =
+        renderBench(geometryRegister, camera, BenchSettings(), threadPool,
+                    options.frames, true)
+            .milliseconds;
+
+    double mean = 0.0;
+    for (const double &frameTime : frameTimes) {
+      mean += frameTime / static_cast<double>(frameTimes.size());
+    }
+
+    const double median = percentile(frameTimes, 50.0);
+    if (counts[i] == 1) {
+      singleThreadMedian = median;
+    }
+
+    std::printf("%s\n      {\"threads\": %zu, \"frameMilliseconds\": "
+                "{\"min\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+                "\"p99\": %.3f, \"max\": %.3f}, \"mraysPerSecond\": %.3f, "
+                "\"speedup\": %.3f}",
+                i == 0 ? "" : ",", counts[i], frameTimes.front(), mean, median,
+                percentile(frameTimes, 90.0), percentile(frameTimes, 99.0),
+                frameTimes.back(),
+                static_cast<double>(raysPerFrame) / (median * 1e3),
+                singleThreadMedian / median);
+    std::fflush(stdout);
+    std::cerr << scene.name << ": " << counts[i] << " threads, " << median
+              << " ms" << std::endl;
+  }
+
+  std::printf("\n    ]}");
+}
+
+int main(int argc, char *argv[]) {
+  Options options;
+  try {
+    options = Options::Parse(argc, argv);
+  } catch (const std::exception &exception) {
+    std::cerr << "Error: " << exception.what() << std::endl;
+    return 1;
+  }
+
+  std::vector<const BenchScene<double> *> scenes;
+  for (const std::string &name : options.scenes) {
+    const auto scene =
+        std::find_if(suiteScenes.begin(), suiteScenes.end(),
+                     [&](const BenchScene<double> &scene) { return scene.name == name; });
+    if (scene == suiteScenes.end()) {
+      std::cerr << "Error: Unknown scene " << name << std::endl;
+      return 1;
+    }
+    scenes.push_back(&*scene);
+  }
+
+  std::printf("{\n  \"label\": \"%s\", \"width\": %zu, \"height\": %zu, "
+              "\"frames\": %zu, \"hardwareThreads\": %u,\n  \"scenes\": [",
+              options.label.c_str(), options.width, options.height,
+              options.frames, std::thread::hardware_concurrency());
+  for (size_t i = 0; i < scenes.size(); ++i) {
+    runScene(*scenes[i], options, i == 0);
+  }
+  std::printf("\n  ]\n}\n");
+
+  return 0;
+}
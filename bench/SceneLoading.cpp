@@ -0,0 +1,235 @@
+// Compares starting up from an scene file with building the scene. Every scene
+// is created and built in memory, written to an scene file and mapped again,
+// and both are rendered. The images have to be exactly the same, since the
+// mapped scene is the built one without the copying. Then the arrays holding
+// indices are corrupted one by one, and loading has to reject every corrupted
+// file. Exits with an non-zero status when the images differ or an corrupted
+// file is loaded.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "Geometry.hpp"
+#include "GeometryRegister.hpp"
+#include "Instance.hpp"
+#include "Material.hpp"
+#include "Matrix3D.hpp"
+#include "SceneFile.hpp"
+#include "Sphere.hpp"
+#include "ThreadPool.hpp"
+#include "TriangleMesh.hpp"
+#include "Vector3D.hpp"
+
+static const size_t width = 320, height = 240;
+static const size_t terrainSize = 1024;
+
+/// An rolling heightfield of two triangles per cell, with an sphere floating
+/// above it so there's an mesh and an sphere in the same file.
+static void createTerrainScene(GeometryRegister<double> &geometryRegister) {
+  std::vector<Vector3D<double>> vertices;
+  std::vector<uint32_t> indices;
+  for (size_t z = 0; z <= terrainSize; ++z) {
+    for (size_t x = 0; x <= terrainSize; ++x) {
+      vertices.emplace_back(
+          static_cast<double>(x), 8.0 * std::sin(x * 0.05) * std::cos(z * 0.03),
+          static_cast<double>(z));
+    }
+  }
+  for (uint32_t z = 0; z < terrainSize; ++z) {
+    for (uint32_t x = 0; x < terrainSize; ++x) {
+      const uint32_t corner = z * (terrainSize + 1) + x;
+      const uint32_t above = corner + terrainSize + 1;
+      indices.insert(indices.end(), {corner, corner + 1, above + 1, corner,
+                                     above + 1, above});
+    }
+  }
+
+  geometryRegister
+      .Register(std::make_shared<TriangleMesh<double>>(
+          std::move(vertices), std::move(indices),
+          Material<double>(Vector3D<double>(0.4, 0.7, 0.3), 0.1)))
+      .Register(std::make_shared<Sphere<double>>(
+          Vector3D<double>(512.0, 60.0, 512.0),
+          Material<double>(Vector3D<double>(1.0, 0.2, 0.2), 0.5), 40.0));
+}
+
+/// An row of spheres which the scene has an instance of, and which an other
+/// group has instances of as well. The scene reaches the row before the other
+/// group, which still has to be able to refer to it.
+static void createSharedGroupScene(GeometryRegister<double> &geometryRegister) {
+  std::shared_ptr<GeometryRegister<double>> row =
+      std::make_shared<GeometryRegister<double>>();
+  for (size_t i = 0; i < 3; ++i) {
+    row->Register(std::make_shared<Sphere<double>>(
+        Vector3D<double>(4.0 * static_cast<double>(i), 0.0, 0.0),
+        Material<double>(Vector3D<double>(0.2, 0.4, 0.9), 0.3), 1.5));
+  }
+  row->Build();
+
+  std::shared_ptr<GeometryRegister<double>> rows =
+      std::make_shared<GeometryRegister<double>>();
+  for (const double &y : {5.0, 10.0}) {
+    rows->Register(std::make_shared<Instance<double>>(
+        row,
+        AffineMatrix3D<double>::Translation(Vector3D<double>(0.0, y, 0.0))));
+  }
+  rows->Build();
+
+  geometryRegister
+      .Register(std::make_shared<Instance<double>>(
+          row, AffineMatrix3D<double>::Translation(
+                   Vector3D<double>(0.0, 0.0, 0.0))))
+      .Register(std::make_shared<Instance<double>>(
+          rows, AffineMatrix3D<double>::Translation(
+                    Vector3D<double>(0.0, 0.0, 0.0))));
+}
+
+static const std::vector<BenchScene<double>> loadingScenes = {
+    BenchScene<double>::RandomSpheres(1000000),
+    BenchScene<double>::InstancedSpheres(100000, 1000),
+    {"terrain-2m", createTerrainScene,
+     [](const size_t &viewportWidth, const size_t &viewportHeight) {
+       return Camera<double>(Vector3D<double>(512.0, 150.0, -200.0),
+                             Vector3D<double>(0.5, 0.0, 0.0), viewportWidth,
+                             viewportHeight, Projection::Perspective);
+     }},
+    {"shared-nested-group", createSharedGroupScene,
+     [](const size_t &viewportWidth, const size_t &viewportHeight) {
+       return Camera<double>(Vector3D<double>(4.0, 5.0, -30.0),
+                             Vector3D<double>(0.0, 0.0, 0.0), viewportWidth,
+                             viewportHeight, Projection::Perspective);
+     }},
+};
+
+/// Builds the hierarchy of the scene, and the ones of its meshes again. The
+/// meshes built theirs when they were created, which isn't timed.
+static void build(GeometryRegister<double> &geometryRegister) {
+  for (const std::shared_ptr<Geometry<double>> &geometry :
+       geometryRegister.geometries) {
+    if (TriangleMesh<double> *mesh =
+            dynamic_cast<TriangleMesh<double> *>(geometry.get())) {
+      mesh->Build();
+    }
+  }
+  geometryRegister.Build();
+}
+
+static FrameBuffer render(std::shared_ptr<GeometryRegister<double>> scene,
+                          Camera<double> camera, ThreadPool &threadPool) {
+  return renderBench(scene, camera, BenchSettings(), threadPool, 0).image;
+}
+
+// The arrays holding indices, which an corrupted file has to be rejected for.
+static const std::vector<SceneSection> indexSections = {
+    SceneSection::Nodes,           SceneSection::Indices,
+    SceneSection::Types,           SceneSection::Slots,
+    SceneSection::SphereMaterials, SceneSection::OtherMaterials,
+    SceneSection::Instances,       SceneSection::InstanceMaterials,
+    SceneSection::MaterialMap,     SceneSection::MeshIndices,
+    SceneSection::MeshNodes,       SceneSection::MeshHierarchyIndices,
+};
+
+/// Sets all the bits of the first element of every array holding indices in
+/// turn, and loads the file every time. Gets whether every load threw, the
+/// file is restored afterwards.
+static bool rejectsCorruption(const std::string &path) {
+  std::fstream stream(path, std::ios::in | std::ios::out | std::ios::binary);
+  SceneFileHeader header;
+  stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+  std::vector<SceneFileSection> sections(header.sectionCount);
+  stream.read(reinterpret_cast<char *>(sections.data()),
+              sections.size() * sizeof(SceneFileSection));
+
+  bool rejected = true;
+  for (const SceneFileSection &section : sections) {
+    if (section.count == 0 ||
+        std::find(indexSections.begin(), indexSections.end(), section.kind) ==
+            indexSections.end()) {
+      continue;
+    }
+
+    std::vector<char> original(section.elementSize);
+    const std::vector<char> corrupted(section.elementSize, '\xff');
+    stream.seekg(section.offset);
+    stream.read(original.data(), original.size());
+    stream.seekp(section.offset);
+    stream.write(corrupted.data(), corrupted.size());
+    stream.flush();
+
+    try {
+      SceneFile<double>::Load(path);
+      rejected = false;
+    } catch (const std::runtime_error &) {
+    }
+
+    stream.seekp(section.offset);
+    stream.write(original.data(), original.size());
+    stream.flush();
+  }
+
+  return rejected && static_cast<bool>(stream);
+}
+
+int main() {
+  char path[] = "/tmp/SceneLoadingXXXXXX";
+  const int file = mkstemp(path);
+  if (file < 0) {
+    std::fprintf(stderr, "Failed to create an temporary file.\n");
+    return 1;
+  }
+  close(file);
+
+  ThreadPool threadPool(0);
+  std::printf("%-24s %10s %10s %10s %10s %10s %10s\n", "scene", "build ms",
+              "write ms", "MB", "map ms", "identical", "rejected");
+
+  bool failed = false;
+  for (const BenchScene<double> &scene : loadingScenes) {
+    // Only building is timed, generating the geometry is not part of it.
+    std::shared_ptr<GeometryRegister<double>> built =
+        std::make_shared<GeometryRegister<double>>();
+    std::shared_ptr<GeometryRegister<double>> mapped;
+    scene.create(*built);
+    const double buildTime = timeMilliseconds([&]() { build(*built); });
+    const double writeTime =
+        timeMilliseconds([&]() { SceneFile<double>::Write(*built, path); });
+    const double loadTime =
+        timeMilliseconds([&]() { mapped = SceneFile<double>::Load(path); });
+    const double megabytes = mapped->mapping->Size() / 1e6;
+
+    const Camera<double> camera = scene.camera(width, height);
+    const FrameBuffer builtImage = render(built, camera, threadPool);
+    const FrameBuffer mappedImage = render(mapped, camera, threadPool);
+    const bool identical = builtImage.pixels == mappedImage.pixels;
+    mapped.reset();
+    const bool rejected = rejectsCorruption(path);
+
+    std::printf("%-24s %10.1f %10.1f %10.1f %10.2f %10s %10s\n",
+                scene.name.c_str(), buildTime, writeTime, megabytes, loadTime,
+                identical ? "yes" : "no", rejected ? "yes" : "no");
+    failed = failed || !identical || !rejected;
+  }
+
+  unlink(path);
+
+  if (failed) {
+    std::printf("The mapped scenes render differently from the built ones, "
+                "or an corrupted scene file was loaded.\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,226 @@
+// Renders scenes lit by different sets of lights, per pixel and as an
+// wavefront, which have to give the exact same image and count the same rays
+// and shadow rays. Every set reports its frame times next to the unlit frame.
+// Then casts the shadow rays of the first hits of all the pixels towards every
+// light on their own, with the occlusion query, in packets of them and with an
+// full search for the nearest hit, which all have to agree on what is blocked,
+// and reports what every way of casting them costs. Exits with an non-zero
+// status when anything differs.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "BoundingBox.hpp"
+#include "Camera.hpp"
+#include "GeometryRegister.hpp"
+#include "Light.hpp"
+#include "Profiler.hpp"
+#include "Ray.hpp"
+#include "RayCaster.hpp"
+#include "RayPacket.hpp"
+#include "Sampler.hpp"
+#include "ThreadPool.hpp"
+
+static const size_t width = 320, height = 240;
+
+static const std::vector<BenchScene<double>> shadowScenes = {
+    BenchScene<double>::TwoSpheres(), BenchScene<double>::RandomSpheres(100000),
+    BenchScene<double>::InstancedSpheres(1000, 1000),
+    BenchScene<double>::MirrorBox()};
+
+/// An set of lights, placed relative to the bounds of the scene.
+class ShadowLights {
+public:
+  std::string name;
+  std::function<std::vector<Light<double>>(const BoundingBox<double> &)>
+      create;
+};
+
+/// Gets an point light above the front of the scene at the given side, bright
+/// enough to light its center about as much as an directional light does.
+static Light<double> pointLight(const BoundingBox<double> &bounds,
+                                const double &side) {
+  const Vector3D<double> center = (bounds.min + bounds.max) * 0.5;
+  const Vector3D<double> extent = bounds.max - bounds.min;
+  const Vector3D<double> position =
+      center + Vector3D<double>(side * extent.x * 0.25, extent.y * 0.25,
+                                -extent.z * 0.25);
+  return Light<double>::Point(position, Vector3D<double>(1.0, 1.0, 1.0),
+                              0.8 * (position - center).LengthSquared());
+}
+
+static const std::vector<ShadowLights> shadowLights = {
+    {"unlit", [](const BoundingBox<double> &) {
+       return std::vector<Light<double>>();
+     }},
+    {"ambient, directional",
+     [](const BoundingBox<double> &) {
+       return std::vector<Light<double>>{
+           Light<double>::Ambient(Vector3D<double>(1.0, 1.0, 1.0), 0.2),
+           Light<double>::Directional(Vector3D<double>(0.3, -1.0, 0.5),
+                                      Vector3D<double>(1.0, 1.0, 0.9), 0.8)};
+     }},
+    {"ambient, point",
+     [](const BoundingBox<double> &bounds) {
+       return std::vector<Light<double>>{
+           Light<double>::Ambient(Vector3D<double>(1.0, 1.0, 1.0), 0.2),
+           pointLight(bounds, 0.0)};
+     }},
+    {"ambient, directional, 2 points",
+     [](const BoundingBox<double> &bounds) {
+       return std::vector<Light<double>>{
+           Light<double>::Ambient(Vector3D<double>(1.0, 1.0, 1.0), 0.1),
+           Light<double>::Directional(Vector3D<double>(0.3, -1.0, 0.5),
+                                      Vector3D<double>(1.0, 1.0, 0.9), 0.4),
+           pointLight(bounds, -1.0), pointLight(bounds, 1.0)};
+     }},
+};
+
+/// Renders an frame in the given mode, and counts its rays and shadow rays.
+static BenchFrame render(std::shared_ptr<GeometryRegister<double>> scene,
+                         Camera<double> camera, const TraceMode &mode,
+                         ThreadPool &threadPool) {
+  return renderBench(scene, camera, BenchSettings(SampleSettings(), mode),
+                     threadPool, 1, true);
+}
+
+/// Casts the shadow rays of the first hits of all the pixels on their own.
+/// Gets whether the ways of casting them agree.
+static bool castShadowRays(GeometryRegister<double> &scene,
+                           const Camera<double> &camera) {
+  // Collects the shadow rays light by light, like the wavefront does.
+  std::vector<Ray<double>> rays;
+  std::vector<double> distances;
+  for (const Light<double> &light : scene.lights) {
+    for (size_t y = 0; y < height; ++y) {
+      for (size_t x = 0; x < width; ++x) {
+        const Ray<double> ray = camera.GetRay(static_cast<double>(x),
+                                              static_cast<double>(y));
+        const std::optional<HitRecord<double>> hit = scene.ClosestHit(ray);
+        if (!hit.has_value()) {
+          continue;
+        }
+
+        const Vector3D<double> normal = ray.Facing(hit->normal);
+        const Vector3D<double> point =
+            Ray<double>::Offset(hit->Point(ray), normal);
+        Ray<double> shadow(point, normal);
+        double distance = 0.0;
+        Vector3D<double> irradiance(0.0, 0.0, 0.0);
+        if (light.Illuminate(point, normal, shadow, distance, irradiance) &&
+            distance > 0.0) {
+          rays.push_back(shadow);
+          distances.push_back(distance);
+        }
+      }
+    }
+  }
+
+  std::vector<bool> occluded(rays.size()), packed(rays.size()),
+      nearest(rays.size());
+  const double occludedTime = timeMilliseconds([&]() {
+    for (size_t i = 0; i < rays.size(); ++i) {
+      occluded[i] = scene.Occluded(rays[i], distances[i]);
+    }
+  });
+  const double packetTime = timeMilliseconds([&]() {
+    RayPacket<double> packet;
+    for (size_t first = 0; first < rays.size(); first += packet.size) {
+      const size_t count = std::min(packet.size, rays.size() - first);
+      packet.Clear();
+      for (size_t lane = 0; lane < count; ++lane) {
+        packet.Push(rays[first + lane]);
+        packet.distance[lane] = distances[first + lane];
+      }
+
+      scene.OccludedPacket(packet);
+      for (size_t lane = 0; lane < count; ++lane) {
+        packed[first + lane] =
+            packet.geometry[lane] != RayPacket<double>::noGeometry;
+      }
+    }
+  });
+  const double nearestTime = timeMilliseconds([&]() {
+    for (size_t i = 0; i < rays.size(); ++i) {
+      const std::optional<HitRecord<double>> hit = scene.ClosestHit(rays[i]);
+      nearest[i] = hit.has_value() && hit->distance <= distances[i];
+    }
+  });
+
+  size_t blocked = 0, mismatches = 0;
+  for (size_t i = 0; i < rays.size(); ++i) {
+    blocked += occluded[i] ? 1 : 0;
+    mismatches += occluded[i] != packed[i] || occluded[i] != nearest[i];
+  }
+
+  std::printf("  %zu shadow rays of the first hits, %zu blocked, %zu "
+              "mismatches\n",
+              rays.size(), blocked, mismatches);
+  std::printf("  %-14s %10s %10s\n", "cast", "ms", "Mrays/s");
+  for (const auto &[name, milliseconds] :
+       {std::pair<const char *, double>("occluded", occludedTime),
+        std::pair<const char *, double>("packets", packetTime),
+        std::pair<const char *, double>("nearest hit", nearestTime)}) {
+    std::printf("  %-14s %10.1f %10.2f\n", name, milliseconds,
+                static_cast<double>(rays.size()) / milliseconds / 1000.0);
+  }
+
+  return mismatches == 0;
+}
+
+int main() {
+  ThreadPool threadPool(0);
+  bool failed = false;
+
+  for (const BenchScene<double> &shadowScene : shadowScenes) {
+    std::printf("%s\n", shadowScene.name.c_str());
+    std::printf("%-32s %10s %12s %10s %12s %10s\n", "lights", "rays",
+                "shadow rays", "ms", "wavefront ms", "identical");
+
+    for (const ShadowLights &lights : shadowLights) {
+      std::shared_ptr<GeometryRegister<double>> scene = shadowScene.Build();
+      for (const Light<double> &light : lights.create(scene->Bounds())) {
+        scene->Illuminate(light);
+      }
+      const Camera<double> camera = shadowScene.camera(width, height);
+
+      const BenchFrame image =
+          render(scene, camera, TraceMode::PerPixel, threadPool);
+      const BenchFrame wavefront =
+          render(scene, camera, TraceMode::Wavefront, threadPool);
+      const uint64_t rays = image.Counter(ProfileCounter::Rays);
+      const uint64_t shadowRays = image.Counter(ProfileCounter::ShadowRays);
+      const bool identical =
+          image.image.pixels == wavefront.image.pixels &&
+          rays == wavefront.Counter(ProfileCounter::Rays) &&
+          shadowRays == wavefront.Counter(ProfileCounter::ShadowRays);
+
+      std::printf("%-32s %10llu %12llu %10.1f %12.1f %10s\n",
+                  lights.name.c_str(), static_cast<unsigned long long>(rays),
+                  static_cast<unsigned long long>(shadowRays), image.Fastest(),
+                  wavefront.Fastest(), identical ? "yes" : "no");
+      failed = failed || !identical;
+
+      // The shadow rays are cast on their own with all the lights.
+      if (&lights == &shadowLights.back()) {
+        failed = !castShadowRays(*scene, camera) || failed;
+      }
+    }
+    std::printf("\n");
+  }
+
+  if (failed) {
+    std::printf("The shadow rays were cast differently.\n");
+    return 1;
+  }
+
+  return 0;
+}
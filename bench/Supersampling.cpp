@@ -0,0 +1,97 @@
+// Compares the ways of antialiasing an scene with large flat areas and one
+// full of edges. An render with many stratified samples per pixel is the
+// reference, every setting reports its time, the samples it took per pixel and
+// its error against the reference. Adaptive sampling should get to the error
+// of uniform 16x sampling with an fraction of the samples where there's little
+// to antialias, and spend them on the edges where there's a lot. Every setting
+// is also rendered on one and on several threads, the images have to be
+// exactly the same since the random numbers only depend on the tiles. Exits
+// with an non-zero status when they're not.
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "GeometryRegister.hpp"
+#include "Sampler.hpp"
+#include "ThreadPool.hpp"
+
+static const size_t width = 320, height = 240;
+static const size_t referenceSamples = 256;
+static const size_t checkThreads = 4;
+
+static const std::vector<BenchScene<double>> samplingScenes = {
+    BenchScene<double>::TwoSpheres(), BenchScene<double>::RandomSpheres(10000)};
+
+/// An way of sampling, with the name it's reported by.
+class SamplingRun {
+public:
+  std::string name;
+  SampleSettings settings;
+};
+
+static const std::vector<SamplingRun> runs = {
+    {"1x", SampleSettings(1)},
+    {"stratified 16x", SampleSettings(16)},
+    {"blue noise 16x", SampleSettings(16, 4, 0.0f, SamplePattern::BlueNoise)},
+    {"adaptive 4-16x, 0.01", SampleSettings(16, 4, 0.01f)},
+    {"adaptive 4-64x, 0.01", SampleSettings(64, 4, 0.01f)},
+    {"adaptive blue noise 4-64x",
+     SampleSettings(64, 4, 0.01f, SamplePattern::BlueNoise)},
+};
+
+/// Renders an frame with the given sampling.
+static BenchFrame render(std::shared_ptr<GeometryRegister<double>> scene,
+                         Camera<double> camera, const SampleSettings &sampling,
+                         ThreadPool &threadPool) {
+  return renderBench(scene, camera, BenchSettings(sampling), threadPool);
+}
+
+/// Gets the samples the frame took per pixel.
+static double samplesPerPixel(const BenchFrame &frame) {
+  return static_cast<double>(frame.samples) /
+         static_cast<double>(width * height);
+}
+
+int main() {
+  ThreadPool threadPool(1), checkPool(checkThreads);
+  bool failed = false;
+
+  for (const BenchScene<double> &samplingScene : samplingScenes) {
+    std::shared_ptr<GeometryRegister<double>> scene = samplingScene.Build();
+    const Camera<double> camera = samplingScene.camera(width, height);
+
+    const BenchFrame reference =
+        render(scene, camera, SampleSettings(referenceSamples), threadPool);
+    std::printf("%s, reference of %zu samples per pixel in %.1f ms\n",
+                samplingScene.name.c_str(), referenceSamples,
+                reference.Fastest());
+
+    std::printf("%-28s %10s %10s %10s %14s\n", "sampling", "ms", "samples",
+                "rms error", "deterministic");
+    for (const SamplingRun &run : runs) {
+      const BenchFrame image =
+          render(scene, camera, run.settings, threadPool);
+      const BenchFrame check = render(scene, camera, run.settings, checkPool);
+      const bool deterministic = image.image.pixels == check.image.pixels;
+
+      std::printf("%-28s %10.1f %10.2f %10.3f %14s\n", run.name.c_str(),
+                  image.Fastest(), samplesPerPixel(image),
+                  rootMeanSquare(image.image, reference.image),
+                  deterministic ? "yes" : "no");
+      failed = failed || !deterministic;
+    }
+    std::printf("\n");
+  }
+
+  if (failed) {
+    std::printf("The images depend on the number of threads.\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,110 @@
+// Compares the ways of stopping paths early on scenes with few and with many
+// reflections. Every setting reports the rays it traced and the paths it
+// stopped, its frame time, and how far its image is from the one with the
+// default eight rays per path and from one with many more. Every setting is
+// rendered per pixel and as an wavefront, which have to give the exact same
+// image and ray count. Exits with an non-zero status when they do not.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "GeometryRegister.hpp"
+#include "Profiler.hpp"
+#include "RayCaster.hpp"
+#include "Sampler.hpp"
+#include "ThreadPool.hpp"
+
+static const size_t width = 320, height = 240;
+static const size_t referenceRays = 64;
+
+static const std::vector<BenchScene<double>> terminationScenes = {
+    BenchScene<double>::TwoSpheres(), BenchScene<double>::RandomSpheres(100000),
+    BenchScene<double>::MirrorBox()};
+
+/// An way of stopping the paths, with the name it's reported by.
+class TerminationRun {
+public:
+  std::string name;
+  PathTermination termination;
+};
+
+static const std::vector<TerminationRun> runs = {
+    {"8 rays", PathTermination(8)},
+    {"4 rays", PathTermination(4)},
+    {"16 rays", PathTermination(16)},
+    {"16 rays, cutoff 0.5", PathTermination(16, 0.5)},
+    {"16 rays, cutoff 0.7", PathTermination(16, 0.7)},
+    {"16 rays, roulette 0.5", PathTermination(16, 0.5, true)},
+    {"16 rays, roulette 0.7", PathTermination(16, 0.7, true)},
+};
+
+/// Renders an frame in the given mode, and counts its rays and the paths it
+/// stopped early.
+static BenchFrame render(std::shared_ptr<GeometryRegister<double>> scene,
+                         Camera<double> camera,
+                         const PathTermination &termination,
+                         const TraceMode &mode, ThreadPool &threadPool) {
+  return renderBench(scene, camera,
+                     BenchSettings(SampleSettings(), mode, termination),
+                     threadPool, 1, true);
+}
+
+int main() {
+  ThreadPool threadPool(0);
+  bool failed = false;
+
+  for (const BenchScene<double> &terminationScene : terminationScenes) {
+    std::shared_ptr<GeometryRegister<double>> scene = terminationScene.Build();
+    const Camera<double> camera = terminationScene.camera(width, height);
+
+    const BenchFrame reference =
+        render(scene, camera, PathTermination(referenceRays),
+               TraceMode::PerPixel, threadPool);
+    const BenchFrame standard = render(scene, camera, PathTermination(),
+                                       TraceMode::PerPixel, threadPool);
+    const double standardRays =
+        static_cast<double>(standard.Counter(ProfileCounter::Rays));
+    std::printf("%s, reference of %zu rays per path\n",
+                terminationScene.name.c_str(), referenceRays);
+
+    std::printf("%-24s %10s %8s %12s %8s %10s %12s %10s\n", "termination",
+                "rays", "of 8", "terminated", "ms", "rms vs 8",
+                "rms vs ref", "identical");
+    for (const TerminationRun &run : runs) {
+      const BenchFrame image = render(scene, camera, run.termination,
+                                      TraceMode::PerPixel, threadPool);
+      const BenchFrame wavefront = render(scene, camera, run.termination,
+                                          TraceMode::Wavefront, threadPool);
+      const uint64_t rays = image.Counter(ProfileCounter::Rays);
+      const uint64_t terminations = image.Counter(ProfileCounter::Terminations);
+      const bool identical =
+          image.image.pixels == wavefront.image.pixels &&
+          rays == wavefront.Counter(ProfileCounter::Rays) &&
+          terminations == wavefront.Counter(ProfileCounter::Terminations);
+
+      std::printf("%-24s %10llu %7.0f%% %12llu %8.1f %10.3f %12.3f %10s\n",
+                  run.name.c_str(), static_cast<unsigned long long>(rays),
+                  100.0 * static_cast<double>(rays) / standardRays,
+                  static_cast<unsigned long long>(terminations),
+                  image.Fastest(), rootMeanSquare(image.image, standard.image),
+                  rootMeanSquare(image.image, reference.image),
+                  identical ? "yes" : "no");
+      failed = failed || !identical;
+    }
+    std::printf("\n");
+  }
+
+  if (failed) {
+    std::printf("The wavefront terminates differently from the per pixel "
+                "mode.\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,249 @@
+// Renders views progressively up to their last sample, then moves one small
+// object and renders them again. Only the tiles the object can be seen in are
+// rendered again, the others are kept by the tile cache. Reports the share of
+// the tiles which were kept and the ones which were invalidated, and the time
+// to finish the view again next to the time of the first render. The edited
+// view has to come out exactly the same as an view of the edited scene
+// rendered from scratch. Paths go on from matte surfaces unless they're cut
+// off, so only then the cache can keep the tiles around an matte object. Moving
+// an object which is only seen through such paths, behind the camera, has to
+// invalidate them too. Reflective surfaces and shadows make the cache
+// invalidate more, and moving the camera invalidates everything. Exits with an
+// non-zero status when an view differs.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+#include "ProgressiveRenderer.hpp"
+#include "RayCaster.hpp"
+#include "Scenes.hpp"
+#include "Sphere.hpp"
+#include "ThreadPool.hpp"
+#include "TileCache.hpp"
+#include "Vector3D.hpp"
+
+static const size_t width = 500, height = 500;
+static const size_t maximumSamples = 8;
+
+/// An scene, and the change made to it.
+class CacheScene {
+public:
+  BenchScene<double> scene;
+  // Changes the scene, when there is no change the camera is moved instead.
+  std::function<void(GeometryRegister<double> &)> edit;
+  PathTermination termination;
+};
+
+// Ends the paths at matte surfaces.
+static const PathTermination cutOff(8, 0.01);
+
+/// Makes all the registered geometry matte.
+static void matte(GeometryRegister<double> &geometryRegister) {
+  for (const std::shared_ptr<Geometry<double>> &geometry :
+       geometryRegister.geometries) {
+    geometry->material.reflectivity = 0.0;
+  }
+}
+
+/// Moves the registered geometry with the given index.
+static void move(GeometryRegister<double> &scene, const size_t &index,
+                 const Vector3D<double> &offset) {
+  scene.geometries[index]->position += offset;
+  scene.Refit();
+}
+
+/// An matte sphere in front of the camera, and an other one behind it which is
+/// only seen in the first one through the paths going on from it. Their
+/// colors are dark, so the colors the paths add up stay below white.
+static void createHiddenSphereScene(GeometryRegister<double> &geometryRegister) {
+  geometryRegister
+      .Register(std::make_shared<Sphere<double>>(
+          Vector3D<double>(0.0, 0.0, 0.0),
+          Material<double>(Vector3D<double>(0.02, 0.02, 0.02), 0.0), 10.0))
+      .Register(std::make_shared<Sphere<double>>(
+          Vector3D<double>(0.0, 0.0, -100.0),
+          Material<double>(Vector3D<double>(0.0, 0.0, 0.05), 0.0), 30.0));
+}
+
+static Camera<double> createHiddenSphereCamera(const size_t &viewportWidth,
+                                               const size_t &viewportHeight) {
+  return Camera<double>(Vector3D<double>(0.0, 0.0, -40.0),
+                        Vector3D<double>(0.0, 0.0, 0.0), viewportWidth,
+                        viewportHeight, Projection::Perspective,
+                        1.2217304763960306); // 70 degrees.
+}
+
+static const std::vector<CacheScene> cacheScenes = {
+    {{"sphere-grid, matte",
+      [](GeometryRegister<double> &geometryRegister) {
+        createSphereGridScene(geometryRegister, 60);
+        matte(geometryRegister);
+      },
+      createSphereGridCamera<double>},
+     [](GeometryRegister<double> &scene) {
+       move(scene, 1830, Vector3D<double>(20.0, 0.0, 0.0));
+     },
+     PathTermination()},
+    {{"sphere-grid, matte, cut off",
+      [](GeometryRegister<double> &geometryRegister) {
+        createSphereGridScene(geometryRegister, 60);
+        matte(geometryRegister);
+      },
+      createSphereGridCamera<double>},
+     [](GeometryRegister<double> &scene) {
+       move(scene, 1830, Vector3D<double>(20.0, 0.0, 0.0));
+     },
+     cutOff},
+    {{"sphere-grid, reflective",
+      [](GeometryRegister<double> &geometryRegister) {
+        createSphereGridScene(geometryRegister, 60);
+      },
+      createSphereGridCamera<double>},
+     [](GeometryRegister<double> &scene) {
+       move(scene, 1830, Vector3D<double>(20.0, 0.0, 0.0));
+     },
+     cutOff},
+    {{"sphere-grid, matte, lit",
+      [](GeometryRegister<double> &geometryRegister) {
+        createSphereGridScene(geometryRegister, 60);
+        matte(geometryRegister);
+        geometryRegister
+            .Illuminate(
+                Light<double>::Ambient(Vector3D<double>(1.0, 1.0, 1.0), 0.2))
+            .Illuminate(Light<double>::Directional(
+                Vector3D<double>(0.3, -1.0, 0.5),
+                Vector3D<double>(1.0, 1.0, 1.0), 0.8));
+      },
+      createSphereGridCamera<double>},
+     [](GeometryRegister<double> &scene) {
+       move(scene, 1830, Vector3D<double>(20.0, 0.0, 0.0));
+     },
+     cutOff},
+    {{"random-spheres-10k, cut off",
+      [](GeometryRegister<double> &geometryRegister) {
+        createRandomSpheresScene(geometryRegister, 10000);
+        matte(geometryRegister);
+      },
+      createRandomSpheresCamera<double>},
+     [](GeometryRegister<double> &scene) {
+       move(scene, 0, Vector3D<double>(1.0, 1.0, 0.0));
+     },
+     cutOff},
+    {{"matte, hidden sphere moved", createHiddenSphereScene,
+      createHiddenSphereCamera},
+     [](GeometryRegister<double> &scene) {
+       move(scene, 1, Vector3D<double>(5.0, 0.0, 0.0));
+     },
+     PathTermination()},
+    {{"sphere-grid, camera moved",
+      [](GeometryRegister<double> &geometryRegister) {
+        createSphereGridScene(geometryRegister, 60);
+        matte(geometryRegister);
+      },
+      createSphereGridCamera<double>},
+     nullptr, cutOff},
+};
+
+/// Waits for the progressive renderer to finish its view.
+class Completion {
+private:
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::optional<ProgressivePass> last;
+
+public:
+  void Finish(const ProgressivePass &pass) {
+    if (pass.samples != maximumSamples) {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->last = pass;
+    }
+    this->condition.notify_all();
+  }
+
+  ProgressivePass Wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->condition.wait(lock, [this]() { return this->last.has_value(); });
+    const ProgressivePass pass = *this->last;
+    this->last.reset();
+    return pass;
+  }
+};
+
+int main() {
+  ThreadPool threadPool(0);
+  bool failed = false;
+
+  std::printf("%-30s %8s %8s %12s %10s %10s %10s\n", "scene", "reused",
+              "hit rate", "invalidated", "first ms", "edit ms", "identical");
+  for (const CacheScene &cacheScene : cacheScenes) {
+    std::shared_ptr<GeometryRegister<double>> scene = cacheScene.scene.Build();
+    const Camera<double> camera = cacheScene.scene.camera(width, height);
+
+    Completion completion;
+    auto start = std::chrono::steady_clock::now();
+    ProgressiveRenderer<double> renderer(
+        threadPool, scene, camera, maximumSamples,
+        [&completion](const ProgressivePass &pass) { completion.Finish(pass); },
+        cacheScene.termination);
+    completion.Wait();
+    const double firstMilliseconds = millisecondsSince(start);
+
+    // Edits the scene, or moves the camera.
+    Camera<double> moved = camera;
+    start = std::chrono::steady_clock::now();
+    if (cacheScene.edit != nullptr) {
+      renderer.Edit(cacheScene.edit);
+    } else {
+      moved.Move(camera.position + Vector3D<double>(5.0, 0.0, 0.0));
+      renderer.Restart(moved);
+    }
+    const ProgressivePass pass = completion.Wait();
+    const double editMilliseconds = millisecondsSince(start);
+
+    FrameBuffer edited(width, height), reference(width, height);
+    renderer.CopyResult(edited);
+    {
+      Completion referenceCompletion;
+      ProgressiveRenderer<double> referenceRenderer(
+          threadPool, scene, moved, maximumSamples,
+          [&referenceCompletion](const ProgressivePass &pass) {
+            referenceCompletion.Finish(pass);
+          },
+          cacheScene.termination);
+      referenceCompletion.Wait();
+      referenceRenderer.CopyResult(reference);
+    }
+    const bool identical = edited.pixels == reference.pixels;
+
+    std::printf("%-30s %8zu %7.1f%% %12zu %10.1f %10.1f %10s\n",
+                cacheScene.scene.name.c_str(), pass.tiles.reused,
+                pass.tiles.HitRate() * 100.0, pass.tiles.invalidated,
+                firstMilliseconds, editMilliseconds, identical ? "yes" : "no");
+    failed = failed || !identical;
+  }
+
+  if (failed) {
+    std::printf("An view rendered with cached tiles differs from one "
+                "rendered from scratch.\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,227 @@
+// Times the vector operations one by one in both precisions, each next to the
+// way it used to be done, and the slab test of an box with the plain and the
+// padded layout. Every operation runs over the same random vectors many times
+// and reports its nanoseconds per call. The operations which have to give the
+// same results are checked, the padded slab test against the plain one on
+// random boxes and rays and on rays which lie exactly on the planes of the
+// boxes, and in double the magnitude against the one with std::pow(). For
+// float std::pow() promoted to double, and normalizing with an reciprocal may
+// round differently, their largest differences are only reported.
+// Exits with an non-zero status when any check fails.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BoundingBox.hpp"
+#include "PaddedVector3D.hpp"
+#include "Ray.hpp"
+#include "Sphere.hpp"
+#include "Vector3D.hpp"
+
+static const size_t count = 4096;
+static const size_t repetitions = 2000;
+
+/// Keeps the compiler from removing the timed loops.
+static volatile double sink = 0.0;
+
+/// Runs the given operation on every index for all the repetitions, and gets
+/// the nanoseconds per call.
+template <typename F> static double time(F &&operation) {
+  double sum = 0.0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t repetition = 0; repetition < repetitions; ++repetition) {
+    for (size_t i = 0; i < count; ++i) {
+      sum += static_cast<double>(operation(i));
+    }
+  }
+  const double nanoseconds = std::chrono::duration<double, std::nano>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+  sink = sink + sum;
+  return nanoseconds / static_cast<double>(count * repetitions);
+}
+
+/// Gets the number of representable steps between two values.
+template <typename T> static uint64_t ulps(const T &a, const T &b) {
+  T low = std::min(a, b), high = std::max(a, b);
+  uint64_t steps = 0;
+  while (low < high && steps < 1000) {
+    low = std::nextafter(low, high);
+    ++steps;
+  }
+
+  return steps;
+}
+
+template <typename T> static bool run(const std::string &precision) {
+  std::mt19937_64 random(1234);
+  std::uniform_real_distribution<T> coordinate(static_cast<T>(-100.0),
+                                               static_cast<T>(100.0));
+  const auto randomVector = [&]() {
+    return Vector3D<T>(coordinate(random), coordinate(random),
+                       coordinate(random));
+  };
+
+  std::vector<Vector3D<T>> a, b;
+  std::vector<BoundingBox<T>> boxes;
+  std::vector<Ray<T>> rays;
+  for (size_t i = 0; i < count; ++i) {
+    a.push_back(randomVector());
+    b.push_back(randomVector());
+    boxes.push_back(
+        BoundingBox<T>().Extend(randomVector()).Extend(randomVector()));
+
+    // Every eighth ray lies on the plane of an side of its box, with an
+    // direction along that plane, which is where the slab test gets NaNs.
+    Ray<T> ray(randomVector(), randomVector().Normalize());
+    if (i % 8 == 0) {
+      ray.origin.x = boxes.back().min.x;
+      ray.direction.x = static_cast<T>(0.0);
+    }
+    rays.push_back(ray);
+  }
+
+  std::vector<Vector3D<T>> inverses;
+  std::vector<PaddedVector3D<T>> paddedOrigins, paddedInverses;
+  for (const Ray<T> &ray : rays) {
+    inverses.emplace_back(static_cast<T>(1.0) / ray.direction.x,
+                          static_cast<T>(1.0) / ray.direction.y,
+                          static_cast<T>(1.0) / ray.direction.z);
+    paddedOrigins.emplace_back(ray.origin);
+    paddedInverses.emplace_back(inverses.back());
+  }
+
+  // Checks the operations which have to give the exact same results.
+  size_t slabMismatches = 0;
+  uint64_t magnitudeUlps = 0, normalizeUlps = 0;
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t j = 0; j < 8; ++j) {
+      const BoundingBox<T> &box = boxes[(i + j) % count];
+      T plainEntry = 0.0, paddedEntry = 0.0;
+      const bool plain = box.Intersect(rays[i], inverses[i], 0.0, 1000.0,
+                                       plainEntry);
+      const bool padded = box.Intersect(paddedOrigins[i], paddedInverses[i],
+                                        0.0, 1000.0, paddedEntry);
+      const bool sameEntry = std::isnan(plainEntry)
+                                 ? std::isnan(paddedEntry)
+                                 : plainEntry == paddedEntry;
+      slabMismatches += plain != padded || (plain && !sameEntry) ? 1 : 0;
+    }
+
+    const T magnitude = static_cast<T>(std::sqrt(
+        std::pow(a[i].x, 2) + std::pow(a[i].y, 2) + std::pow(a[i].z, 2)));
+    magnitudeUlps = std::max(magnitudeUlps, ulps(magnitude, a[i].Magnitude()));
+
+    const Vector3D<T> divided = a[i].Divide(a[i].Magnitude());
+    const Vector3D<T> normalized = a[i].Normalize();
+    normalizeUlps = std::max({normalizeUlps, ulps(divided.x, normalized.x),
+                              ulps(divided.y, normalized.y),
+                              ulps(divided.z, normalized.z)});
+  }
+
+  using Operation = std::pair<std::string, std::function<double()>>;
+  const std::vector<Operation> operations = {
+      {"add",
+       [&]() { return time([&](const size_t &i) { return (a[i] + b[i]).x; }); }},
+      {"multiply",
+       [&]() {
+         return time([&](const size_t &i) { return (a[i] * b[i].y).z; });
+       }},
+      {"dot",
+       [&]() { return time([&](const size_t &i) { return a[i].Dot(b[i]); }); }},
+      {"dot padded",
+       [&]() {
+         return time([&](const size_t &i) {
+           return paddedOrigins[i].Dot(paddedInverses[i]);
+         });
+       }},
+      {"cross",
+       [&]() {
+         return time([&](const size_t &i) { return a[i].Cross(b[i]).y; });
+       }},
+      {"length squared",
+       [&]() {
+         return time([&](const size_t &i) { return a[i].LengthSquared(); });
+       }},
+      {"magnitude, pow",
+       [&]() {
+         return time([&](const size_t &i) {
+           return static_cast<T>(std::sqrt(std::pow(a[i].x, 2) +
+                                           std::pow(a[i].y, 2) +
+                                           std::pow(a[i].z, 2)));
+         });
+       }},
+      {"magnitude",
+       [&]() {
+         return time([&](const size_t &i) { return a[i].Magnitude(); });
+       }},
+      {"normalize, divide",
+       [&]() {
+         return time(
+             [&](const size_t &i) { return a[i].Divide(a[i].Magnitude()).x; });
+       }},
+      {"normalize",
+       [&]() {
+         return time([&](const size_t &i) { return a[i].Normalize().x; });
+       }},
+      {"sphere intersect",
+       [&]() {
+         return time([&](const size_t &i) {
+           return Sphere<T>::Intersect(rays[i], b[i], static_cast<T>(50.0))
+               .value_or(static_cast<T>(0.0));
+         });
+       }},
+      {"slab test",
+       [&]() {
+         return time([&](const size_t &i) {
+           T entry;
+           return boxes[(i * 7) % count].Intersect(rays[i], inverses[i], 0.0,
+                                                   1000.0, entry)
+                      ? entry
+                      : static_cast<T>(0.0);
+         });
+       }},
+      {"slab test padded",
+       [&]() {
+         return time([&](const size_t &i) {
+           T entry;
+           return boxes[(i * 7) % count].Intersect(
+                      paddedOrigins[i], paddedInverses[i], 0.0, 1000.0, entry)
+                      ? entry
+                      : static_cast<T>(0.0);
+         });
+       }},
+  };
+
+  std::printf("%s\n", precision.c_str());
+  std::printf("%-20s %10s\n", "operation", "ns");
+  for (const Operation &operation : operations) {
+    std::printf("%-20s %10.3f\n", operation.first.c_str(), operation.second());
+  }
+  std::printf("slab test mismatches: %zu, magnitude differs by up to %llu "
+              "ulps, normalize by up to %llu ulps\n\n",
+              slabMismatches, static_cast<unsigned long long>(magnitudeUlps),
+              static_cast<unsigned long long>(normalizeUlps));
+
+  return slabMismatches == 0 && (sizeof(T) == 4 || magnitudeUlps == 0);
+}
+
+int main() {
+  const bool floats = run<float>("float");
+  const bool doubles = run<double>("double");
+  if (!floats || !doubles) {
+    std::printf("An operation gave different results than it has to.\n");
+    return 1;
+  }
+
+  return 0;
+}
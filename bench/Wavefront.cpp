@@ -0,0 +1,62 @@
+// Compares tracing the pixels one by one with tracing the tiles as wavefronts,
+// on scenes with few and with many reflections. Both have to give exactly the
+// same image, the wavefront only changes the order the rays are cast in. Exits
+// with an non-zero status when they do not.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Camera.hpp"
+#include "GeometryRegister.hpp"
+#include "Profiler.hpp"
+#include "RayCaster.hpp"
+#include "Sampler.hpp"
+#include "ThreadPool.hpp"
+
+static const size_t width = 640, height = 480;
+static const size_t frameCount = 5;
+
+static const std::vector<BenchScene<double>> wavefrontScenes = {
+    BenchScene<double>::TwoSpheres(), BenchScene<double>::SphereGrid(100),
+    BenchScene<double>::RandomSpheres(100000), BenchScene<double>::MirrorBox()};
+
+int main() {
+  ThreadPool threadPool(0);
+  std::printf("%-22s %10s %12s %12s %10s %10s\n", "scene", "rays",
+              "per pixel ms", "wavefront ms", "speedup", "identical");
+
+  bool failed = false;
+  for (const BenchScene<double> &wavefrontScene : wavefrontScenes) {
+    std::shared_ptr<GeometryRegister<double>> scene = wavefrontScene.Build();
+    const Camera<double> camera = wavefrontScene.camera(width, height);
+
+    const BenchFrame perPixel =
+        renderBench(scene, camera, BenchSettings(), threadPool, frameCount,
+                    true);
+    const BenchFrame wavefront = renderBench(
+        scene, camera, BenchSettings(SampleSettings(), TraceMode::Wavefront),
+        threadPool, frameCount, true);
+    const uint64_t rays = perPixel.Counter(ProfileCounter::Rays);
+    const bool identical =
+        perPixel.image.pixels == wavefront.image.pixels &&
+        rays == wavefront.Counter(ProfileCounter::Rays);
+
+    std::printf("%-22s %10llu %12.2f %12.2f %9.2fx %10s\n",
+                wavefrontScene.name.c_str(),
+                static_cast<unsigned long long>(rays), perPixel.Fastest(),
+                wavefront.Fastest(), perPixel.Fastest() / wavefront.Fastest(),
+                identical ? "yes" : "no");
+    failed = failed || !identical;
+  }
+
+  if (failed) {
+    std::printf("The wavefront renders differently from the per pixel mode.\n");
+    return 1;
+  }
+
+  return 0;
+}
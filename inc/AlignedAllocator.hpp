@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+/// An allocator which aligns the storage of containers to the given boundary,
+/// used to start buffers at the beginning of an cache line.
+template <typename T, size_t Alignment> class AlignedAllocator {
+public:
+  using value_type = T;
+
+  template <typename U> struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+public:
+  AlignedAllocator() noexcept = default;
+
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+  T *allocate(const size_t n) {
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+  }
+
+  void deallocate(T *pointer, const size_t) noexcept {
+    ::operator delete(pointer, std::align_val_t(Alignment));
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept {
+    return false;
+  }
+};
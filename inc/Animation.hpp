@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "GeometryRegister.hpp"
+#include "Instance.hpp"
+#include "Matrix3D.hpp"
+#include "Sphere.hpp"
+#include "ThreadPool.hpp"
+#include "Vector3D.hpp"
+
+/// An transformation at an point in time, as an translation of an rotation of
+/// an scaling.
+template <typename T> class Keyframe {
+public:
+  T time; // In seconds.
+  Vector3D<T> translation;
+  Vector3D<T> angles; // In radians, see Matrix3D::Rotation().
+  Vector3D<T> scale;
+
+public:
+  Keyframe<T>(const T &time, const Vector3D<T> &translation,
+              const Vector3D<T> &angles = Vector3D<T>(0.0, 0.0, 0.0),
+              const Vector3D<T> &scale = Vector3D<T>(1.0, 1.0, 1.0)) noexcept
+      : time(time), translation(translation), angles(angles), scale(scale) {}
+
+  AffineMatrix3D<T> Transformation() const noexcept {
+    return AffineMatrix3D<T>::Translation(this->translation)
+        .Multiply(AffineMatrix3D<T>::Rotation(this->angles))
+        .Multiply(AffineMatrix3D<T>::Scale(this->scale));
+  }
+
+  ~Keyframe<T>() noexcept = default;
+};
+
+/// An transformation changing over time, interpolated linearly between
+/// keyframes. Before the first keyframe and after the last one it holds still.
+template <typename T> class Animation {
+public:
+  std::vector<Keyframe<T>> keyframes; // Ordered by time.
+
+public:
+  Animation<T>() : keyframes() {}
+
+  /// Adds an keyframe, which has to be later than all the others.
+  Animation<T> &Add(const Keyframe<T> &keyframe) {
+    if (!this->keyframes.empty() && keyframe.time <= this->keyframes.back().time) {
+      throw std::invalid_argument("The keyframes have to be added in order.");
+    }
+
+    this->keyframes.push_back(keyframe);
+    return *this;
+  }
+
+  /// Gets the transformation at the given time, the identity if there are no
+  /// keyframes at all.
+  AffineMatrix3D<T> At(const T &time) const noexcept {
+    if (this->keyframes.empty()) {
+      return AffineMatrix3D<T>::Identity();
+    }
+
+    const auto next = std::upper_bound(
+        this->keyframes.begin(), this->keyframes.end(), time,
+        [](const T &time, const Keyframe<T> &keyframe) {
+          return time < keyframe.time;
+        });
+    if (next == this->keyframes.begin()) {
+      return next->Transformation();
+    }
+    if (next == this->keyframes.end()) {
+      return this->keyframes.back().Transformation();
+    }
+
+    const Keyframe<T> &previous = *(next - 1);
+    const T t = (time - previous.time) / (next->time - previous.time);
+    const auto mix = [&t](const Vector3D<T> &a, const Vector3D<T> &b) {
+      return a.Add(b.Subtract(a).Multiply(t));
+    };
+
+    return Keyframe<T>(time, mix(previous.translation, next->translation),
+                       mix(previous.angles, next->angles),
+                       mix(previous.scale, next->scale))
+        .Transformation();
+  }
+
+  ~Animation<T>() = default;
+};
+
+/// Moves registered geometry along animations. Instances are placed by the
+/// transformation of their animation applied to where they were placed when
+/// they were added. Spheres have their center moved the same way, their
+/// radius stays the same. Anything else can be animated by instancing it.
+///
+/// Apply() only changes the geometry, the register has to be refit or rebuilt
+/// afterwards. See GeometryRegister::RefitOrBuild().
+template <typename T> class Animator {
+private:
+  class Track {
+  public:
+    std::shared_ptr<Geometry<T>> geometry;
+    Animation<T> animation;
+    Instance<T> *instance; // Or nullptr for an sphere.
+    AffineMatrix3D<T> base; // The placement of an instance when added.
+    Vector3D<T> position;   // The center of an sphere when added.
+  };
+
+  std::vector<Track> tracks;
+
+public:
+  Animator<T>() : tracks() {}
+
+  /// Moves the given geometry along the given animation from now on, throws
+  /// when it's neither an instance nor an sphere.
+  Animator<T> &Animate(std::shared_ptr<Geometry<T>> geometry,
+                       const Animation<T> &animation) {
+    Instance<T> *instance = dynamic_cast<Instance<T> *>(geometry.get());
+    if (instance == nullptr &&
+        dynamic_cast<Sphere<T> *>(geometry.get()) == nullptr) {
+      throw std::invalid_argument("Only instances and spheres can be animated.");
+    }
+
+    this->tracks.push_back(Track{
+        geometry, animation, instance,
+        instance != nullptr ? instance->Transformation()
+                            : AffineMatrix3D<T>::Identity(),
+        geometry->position});
+    return *this;
+  }
+
+  inline size_t Size() const noexcept { return this->tracks.size(); }
+
+  /// Moves all the animated geometry to where it is at the given time, the
+  /// tracks are spread over the threads of the given pool.
+  Animator<T> &Apply(const T &time, ThreadPool &threadPool) {
+    static constexpr size_t chunkSize = 256;
+    threadPool.Run(
+        (this->tracks.size() + chunkSize - 1) / chunkSize,
+        [this, &time](const size_t &n, const size_t &) {
+          const size_t end = std::min(this->tracks.size(), (n + 1) * chunkSize);
+          for (size_t i = n * chunkSize; i < end; ++i) {
+            Track &track = this->tracks[i];
+            const AffineMatrix3D<T> transformation = track.animation.At(time);
+            if (track.instance != nullptr) {
+              track.instance->Transform(transformation.Multiply(track.base));
+            } else {
+              track.geometry->position =
+                  transformation.TransformPoint(track.position);
+            }
+          }
+        });
+
+    return *this;
+  }
+
+  ~Animator<T>() = default;
+};
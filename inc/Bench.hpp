@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "Profiler.hpp"
+#include "RayCaster.hpp"
+#include "Sampler.hpp"
+#include "Scenes.hpp"
+#include "ThreadPool.hpp"
+
+/// Gets the given number of primitives the way the benchmarks name them, like
+/// 400, 10k or 1m.
+inline std::string benchCount(const size_t &count) {
+  if (count >= 1000000 && count % 1000000 == 0) {
+    return std::to_string(count / 1000000) + "m";
+  }
+  if (count >= 1000 && count % 1000 == 0) {
+    return std::to_string(count / 1000) + "k";
+  }
+  return std::to_string(count);
+}
+
+/// An scene of an benchmark, and the camera it's rendered with. The standard
+/// scenes of Scenes.hpp are named by their number of spheres.
+template <typename T> class BenchScene {
+public:
+  std::string name;
+  std::function<void(GeometryRegister<T> &)> create;
+  std::function<Camera<T>(const size_t &, const size_t &)> camera;
+
+public:
+  /// Creates the scene and builds its hierarchy.
+  std::shared_ptr<GeometryRegister<T>> Build() const {
+    std::shared_ptr<GeometryRegister<T>> geometryRegister =
+        std::make_shared<GeometryRegister<T>>();
+    this->create(*geometryRegister);
+    geometryRegister->Build();
+    return geometryRegister;
+  }
+
+  static BenchScene<T> TwoSpheres() {
+    return {"two-spheres",
+            [](GeometryRegister<T> &geometryRegister) {
+              createTwoSphereScene(geometryRegister);
+            },
+            createTwoSphereCamera<T>};
+  }
+
+  static BenchScene<T> SphereGrid(const size_t &count) {
+    return {"sphere-grid-" + benchCount(count * count),
+            [count](GeometryRegister<T> &geometryRegister) {
+              createSphereGridScene(geometryRegister, count);
+            },
+            createSphereGridCamera<T>};
+  }
+
+  static BenchScene<T> RandomSpheres(const size_t &count) {
+    return {"random-spheres-" + benchCount(count),
+            [count](GeometryRegister<T> &geometryRegister) {
+              createRandomSpheresScene(geometryRegister, count);
+            },
+            createRandomSpheresCamera<T>};
+  }
+
+  static BenchScene<T> InstancedSpheres(const size_t &instanceCount,
+                                        const size_t &groupSize) {
+    return {"instanced-spheres-" + benchCount(instanceCount * groupSize),
+            [instanceCount, groupSize](GeometryRegister<T> &geometryRegister) {
+              createInstancedSpheresScene(geometryRegister, instanceCount,
+                                          groupSize);
+            },
+            [instanceCount, groupSize](const size_t &viewportWidth,
+                                       const size_t &viewportHeight) {
+              return createInstancedSpheresCamera<T>(
+                  viewportWidth, viewportHeight, instanceCount, groupSize);
+            }};
+  }
+
+  static BenchScene<T> MirrorBox() {
+    return {"mirror-box",
+            [](GeometryRegister<T> &geometryRegister) {
+              createMirrorBoxScene(geometryRegister);
+            },
+            createMirrorBoxCamera<T>};
+  }
+};
+
+/// How an benchmark renders its frames, see RayCaster.
+class BenchSettings {
+public:
+  SampleSettings sampling;
+  TraceMode mode;
+  PathTermination termination;
+  RayOrder order;
+
+public:
+  BenchSettings(const SampleSettings &sampling = SampleSettings(),
+                const TraceMode &mode = TraceMode::PerPixel,
+                const PathTermination &termination = PathTermination(),
+                const RayOrder &order = RayOrder::Morton) noexcept
+      : sampling(sampling), mode(mode), termination(termination),
+        order(order) {}
+
+  ~BenchSettings() noexcept = default;
+};
+
+/// An frame rendered by an benchmark.
+class BenchFrame {
+public:
+  FrameBuffer image;
+  std::vector<double> milliseconds; // Of the timed renders, fastest first.
+  uint64_t counters[ThreadProfile::counterCount]; // Zero unless counted.
+  uint64_t samples;                               // Of the last render.
+
+public:
+  BenchFrame(const size_t &width, const size_t &height)
+      : image(width, height), milliseconds(), counters(), samples(0) {}
+
+  inline double Fastest() const { return this->milliseconds.front(); }
+
+  inline double Median() const {
+    return this->milliseconds[this->milliseconds.size() / 2];
+  }
+
+  inline uint64_t Counter(const ProfileCounter &counter) const noexcept {
+    return this->counters[static_cast<size_t>(counter)];
+  }
+
+  ~BenchFrame() = default;
+};
+
+inline double milliseconds(const std::chrono::steady_clock::duration &time) {
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+
+inline double millisecondsSince(
+    const std::chrono::steady_clock::time_point &start) {
+  return milliseconds(std::chrono::steady_clock::now() - start);
+}
+
+/// Runs the given operation once, and gets its milliseconds.
+template <typename F> double timeMilliseconds(F &&operation) {
+  const auto start = std::chrono::steady_clock::now();
+  operation();
+  return millisecondsSince(start);
+}
+
+/// Renders the scene with the given settings, the given number of times. When
+/// counting, or when no render is timed, an untimed frame is rendered first,
+/// with the profiler when counting. It also warms up the buffers of the
+/// threads. Every frame casts the same rays, so the timed ones are rendered
+/// without the profiler.
+template <typename T>
+BenchFrame renderBench(std::shared_ptr<GeometryRegister<T>> scene,
+                       Camera<T> camera, const BenchSettings &settings,
+                       ThreadPool &threadPool, const size_t &frames = 1,
+                       const bool &count = false) {
+  BenchFrame frame(camera.viewportWidth, camera.viewportHeight);
+  RayCaster<T> rayCaster(frame.image, camera, scene);
+  rayCaster.Supersample(settings.sampling)
+      .Mode(settings.mode)
+      .Terminate(settings.termination)
+      .Order(settings.order);
+
+  if (count) {
+    Profiler profiler;
+    rayCaster.Profile(&profiler).Render(threadPool).Profile(nullptr);
+    for (size_t i = 0; i < ThreadProfile::counterCount; ++i) {
+      frame.counters[i] = profiler.Total(static_cast<ProfileCounter>(i));
+    }
+  } else if (frames == 0) {
+    rayCaster.Render(threadPool);
+  }
+
+  for (size_t i = 0; i < frames; ++i) {
+    frame.milliseconds.push_back(
+        timeMilliseconds([&]() { rayCaster.Render(threadPool); }));
+  }
+  std::sort(frame.milliseconds.begin(), frame.milliseconds.end());
+  frame.samples = rayCaster.SampleCount();
+
+  return frame;
+}
+
+/// Gets the root mean square difference of the channels, in 8-bit steps.
+inline double rootMeanSquare(const FrameBuffer &a, const FrameBuffer &b) {
+  double sum = 0.0;
+  size_t count = 0;
+  for (size_t i = 0; i < a.pixels.size(); ++i) {
+    if (i % FrameBuffer::channelCount == 3) {
+      continue;
+    }
+
+    const double difference =
+        static_cast<double>(a.pixels[i]) - static_cast<double>(b.pixels[i]);
+    sum += difference * difference;
+    ++count;
+  }
+
+  return std::sqrt(sum / count);
+}
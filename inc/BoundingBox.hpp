@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "PaddedVector3D.hpp"
+#include "Ray.hpp"
+#include "Vector3D.hpp"
+
+template <typename T> class BoundingBox {
+public:
+  Vector3D<T> min, max;
+
+public:
+  /// Creates an empty bounding box, extending it with anything will result in
+  /// the bounds of that thing.
+  BoundingBox<T>() noexcept
+      : min(std::numeric_limits<T>::infinity(),
+            std::numeric_limits<T>::infinity(),
+            std::numeric_limits<T>::infinity()),
+        max(-std::numeric_limits<T>::infinity(),
+            -std::numeric_limits<T>::infinity(),
+            -std::numeric_limits<T>::infinity()) {}
+
+  BoundingBox<T>(const Vector3D<T> &min, const Vector3D<T> &max) noexcept
+      : min(min), max(max) {}
+
+  ~BoundingBox<T>() noexcept = default;
+
+public:
+  BoundingBox<T> &Extend(const Vector3D<T> &point) noexcept {
+    this->min = Vector3D<T>(std::min(this->min.x, point.x),
+                            std::min(this->min.y, point.y),
+                            std::min(this->min.z, point.z));
+    this->max = Vector3D<T>(std::max(this->max.x, point.x),
+                            std::max(this->max.y, point.y),
+                            std::max(this->max.z, point.z));
+    return *this;
+  }
+
+  /// Extends the box to contain the other one, extending it with an empty box
+  /// leaves it as is.
+  BoundingBox<T> &Extend(const BoundingBox<T> &other) noexcept {
+    this->min = Vector3D<T>(std::min(this->min.x, other.min.x),
+                            std::min(this->min.y, other.min.y),
+                            std::min(this->min.z, other.min.z));
+    this->max = Vector3D<T>(std::max(this->max.x, other.max.x),
+                            std::max(this->max.y, other.max.y),
+                            std::max(this->max.z, other.max.z));
+    return *this;
+  }
+
+  /// Grows the box a little for rounding. Otherwise an ray which just touches
+  /// the contents lies on the plane of the box, where the slab test multiplies
+  /// zero by infinity and misses.
+  BoundingBox<T> &Pad() noexcept {
+    if (this->Empty()) {
+      return *this;
+    }
+
+    const T magnitude = std::max(
+        {std::abs(this->min.x), std::abs(this->min.y), std::abs(this->min.z),
+         std::abs(this->max.x), std::abs(this->max.y), std::abs(this->max.z)});
+    const T padding =
+        static_cast<T>(16.0) * std::numeric_limits<T>::epsilon() * magnitude;
+    const Vector3D<T> extent(padding, padding, padding);
+    this->min = this->min.Subtract(extent);
+    this->max = this->max.Add(extent);
+    return *this;
+  }
+
+  inline bool Empty() const noexcept {
+    return this->min.x > this->max.x || this->min.y > this->max.y ||
+           this->min.z > this->max.z;
+  }
+
+  inline Vector3D<T> Centroid() const noexcept {
+    return this->min.Add(this->max).Multiply(static_cast<T>(0.5));
+  }
+
+  /// Gets the surface area of the box, this is what the surface area heuristic
+  /// uses to estimate the probability of an ray hitting the box.
+  inline T SurfaceArea() const noexcept {
+    if (this->Empty()) {
+      return static_cast<T>(0.0);
+    }
+
+    const Vector3D<T> extent = this->max.Subtract(this->min);
+    return static_cast<T>(2.0) *
+           (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+  }
+
+  /// Performs the slab test, the inverse direction is passed in since it's
+  /// shared between all the boxes an single ray is tested against. Returns
+  /// if the box is hit within [tMin, tMax], and sets the entry distance.
+  inline bool Intersect(const Ray<T> &ray, const Vector3D<T> &inverseDirection,
+                        const T &tMin, const T &tMax, T &tEntry) const noexcept {
+    const T tx1 = (this->min.x - ray.origin.x) * inverseDirection.x;
+    const T tx2 = (this->max.x - ray.origin.x) * inverseDirection.x;
+    const T ty1 = (this->min.y - ray.origin.y) * inverseDirection.y;
+    const T ty2 = (this->max.y - ray.origin.y) * inverseDirection.y;
+    const T tz1 = (this->min.z - ray.origin.z) * inverseDirection.z;
+    const T tz2 = (this->max.z - ray.origin.z) * inverseDirection.z;
+
+    const T tNear = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)),
+                             std::max(std::min(tz1, tz2), tMin));
+    const T tFar = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)),
+                            std::min(std::max(tz1, tz2), tMax));
+
+    tEntry = tNear;
+    return tNear <= tFar;
+  }
+
+  /// Performs the same slab test with all three axes at once, on an ray origin
+  /// and inverse direction padded to an register each. The results are exactly
+  /// the ones of the scalar version.
+  inline bool Intersect(const PaddedVector3D<T> &origin,
+                        const PaddedVector3D<T> &inverseDirection,
+                        const T &tMin, const T &tMax, T &tEntry) const noexcept {
+    const PaddedVector3D<T> t1 =
+        (PaddedVector3D<T>(this->min) - origin) * inverseDirection;
+    const PaddedVector3D<T> t2 =
+        (PaddedVector3D<T>(this->max) - origin) * inverseDirection;
+
+    T near[4], far[4];
+    PaddedVector3D<T>::Min(t1, t2).Store(near);
+    PaddedVector3D<T>::Max(t1, t2).Store(far);
+    const T tNear =
+        std::max(std::max(near[0], near[1]), std::max(near[2], tMin));
+    const T tFar = std::min(std::min(far[0], far[1]), std::min(far[2], tMax));
+
+    tEntry = tNear;
+    return tNear <= tFar;
+  }
+};
@@ -0,0 +1,531 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "BoundingBox.hpp"
+#include "FlatArray.hpp"
+#include "PaddedVector3D.hpp"
+#include "Ray.hpp"
+#include "ThreadPool.hpp"
+#include "Vector3D.hpp"
+
+template <typename T> class BoundingVolumeNode {
+public:
+  BoundingBox<T> bounds;
+  uint32_t first; // The left child for interior nodes (the right child is
+                  // always first + 1), or the first primitive for leaves.
+  uint32_t count; // The number of primitives, zero for interior nodes.
+
+public:
+  BoundingVolumeNode<T>() noexcept : bounds(), first(0), count(0) {}
+
+  inline bool Leaf() const noexcept { return this->count != 0; }
+
+  ~BoundingVolumeNode<T>() noexcept = default;
+};
+
+/// An bounding volume hierarchy over an set of primitive bounds, built top-down
+/// with an binned surface area heuristic. The hierarchy only knows about
+/// primitive indices, the actual intersection is performed by the callback
+/// given to Traverse().
+template <typename T> class BoundingVolumeHierarchy {
+public:
+  static constexpr size_t binCount = 16;
+  static constexpr size_t maxLeafSize = 8;
+  static constexpr size_t maxDepth = 64;
+
+  FlatArray<BoundingVolumeNode<T>> nodes;
+  FlatArray<uint32_t> indices;
+
+public:
+  BoundingVolumeHierarchy<T>() : nodes({}), indices({}) {}
+
+  /// Rebuilds the entire hierarchy from the given primitive bounds, primitives
+  /// with empty bounds can never be hit and are left out.
+  BoundingVolumeHierarchy<T> &
+  Build(const std::vector<BoundingBox<T>> &primitiveBounds) {
+    this->nodes.clear();
+    this->indices.clear();
+
+    // Collects the primitives which can actually be hit, and their centroids.
+    std::vector<Vector3D<T>> centroids;
+    centroids.reserve(primitiveBounds.size());
+    for (size_t i = 0; i < primitiveBounds.size(); ++i) {
+      centroids.push_back(primitiveBounds[i].Centroid());
+      if (!primitiveBounds[i].Empty()) {
+        this->indices.push_back(static_cast<uint32_t>(i));
+      }
+    }
+
+    if (this->indices.empty()) {
+      return *this;
+    }
+
+    // Creates the root node, containing all the primitives.
+    this->nodes.reserve(2 * this->indices.size() - 1);
+    this->nodes.emplace_back();
+    this->nodes[0].first = 0;
+    this->nodes[0].count = static_cast<uint32_t>(this->indices.size());
+
+    // Subdivides the nodes until the heuristic tells us to stop, we're using
+    // an explicit stack of (node, depth) pairs instead of recursion.
+    std::vector<std::pair<uint32_t, size_t>> stack;
+    stack.push_back({0, 0});
+    while (!stack.empty()) {
+      const auto [nodeIndex, depth] = stack.back();
+      stack.pop_back();
+
+      const std::optional<uint32_t> left =
+          this->Subdivide(nodeIndex, depth, primitiveBounds, centroids);
+      if (left.has_value()) {
+        stack.push_back({*left, depth + 1});
+        stack.push_back({*left + 1, depth + 1});
+      }
+    }
+
+    this->nodes.shrink_to_fit();
+    return *this;
+  }
+
+  /// Recalculates the bounds of all the nodes from the given primitive bounds,
+  /// keeping the structure of the hierarchy. This is much cheaper than an
+  /// rebuild when the primitives have moved, but the hierarchy gets worse as
+  /// they move further from where they were when it was built.
+  BoundingVolumeHierarchy<T> &
+  Refit(const std::vector<BoundingBox<T>> &primitiveBounds) {
+    // The children are always stored after their parent, so going backwards
+    // updates them before the parent is.
+    for (size_t i = this->nodes.size(); i-- > 0;) {
+      this->RefitNode(static_cast<uint32_t>(i), primitiveBounds);
+    }
+
+    return *this;
+  }
+
+  /// Refits the hierarchy like Refit(), with the subtrees spread over the
+  /// threads of the given pool. The few nodes above the subtrees are refit
+  /// afterwards, on the calling thread.
+  BoundingVolumeHierarchy<T> &
+  Refit(const std::vector<BoundingBox<T>> &primitiveBounds,
+        ThreadPool &threadPool) {
+    if (this->nodes.empty()) {
+      return *this;
+    }
+
+    // Splits the top of the hierarchy level by level, until there are enough
+    // subtrees to keep all the threads busy when some are much larger.
+    const size_t subtreeCount = threadPool.ThreadCount() * 8;
+    std::vector<uint32_t> subtrees = {0}, next, top;
+    while (subtrees.size() < subtreeCount) {
+      next.clear();
+      for (const uint32_t &node : subtrees) {
+        if (this->nodes[node].Leaf()) {
+          next.push_back(node);
+        } else {
+          top.push_back(node);
+          next.push_back(this->nodes[node].first);
+          next.push_back(this->nodes[node].first + 1);
+        }
+      }
+
+      if (next.size() == subtrees.size()) {
+        break;
+      }
+      subtrees.swap(next);
+    }
+
+    threadPool.Run(subtrees.size(), [&](const size_t &n, const size_t &) {
+      // Lists the nodes of the subtree parents first, so going backwards
+      // updates the children before their parent like Refit() does.
+      std::vector<uint32_t> order = {subtrees[n]};
+      for (size_t i = 0; i < order.size(); ++i) {
+        const BoundingVolumeNode<T> &node = this->nodes[order[i]];
+        if (!node.Leaf()) {
+          order.push_back(node.first);
+          order.push_back(node.first + 1);
+        }
+      }
+
+      for (size_t i = order.size(); i-- > 0;) {
+        this->RefitNode(order[i], primitiveBounds);
+      }
+    });
+
+    // The top was split level by level, so backwards is bottom up.
+    for (size_t i = top.size(); i-- > 0;) {
+      this->RefitNode(top[i], primitiveBounds);
+    }
+
+    return *this;
+  }
+
+  /// Gets the expected cost of an ray by the surface area heuristic the
+  /// hierarchy was built with, relative to the cost of an single primitive
+  /// test. This grows as refits stretch the nodes, so comparing it to the cost
+  /// right after the build tells how much worse the hierarchy has become.
+  T Cost() const noexcept {
+    if (this->nodes.empty()) {
+      return static_cast<T>(0.0);
+    }
+
+    T cost = static_cast<T>(0.0);
+    for (const BoundingVolumeNode<T> &node : this->nodes) {
+      cost += node.bounds.SurfaceArea() *
+              (node.Leaf() ? static_cast<T>(node.count) : static_cast<T>(1.0));
+    }
+
+    return cost / this->nodes[0].bounds.SurfaceArea();
+  }
+
+  /// Checks the hierarchy can be traversed over the given number of
+  /// primitives, for one which wasn't built here: every index refers to an
+  /// primitive, every leaf to indices which exist, and every child comes
+  /// after its parent and no deeper than the traversal stacks allow. Reads
+  /// every node and index once.
+  bool Valid(const size_t &primitiveCount) const {
+    for (const uint32_t &index : this->indices) {
+      if (index >= primitiveCount) {
+        return false;
+      }
+    }
+
+    // The children come after their parents, so the depth of an node is
+    // known by the time it's reached.
+    std::vector<uint8_t> depths(this->nodes.size(), 0);
+    for (size_t i = 0; i < this->nodes.size(); ++i) {
+      const BoundingVolumeNode<T> &node = this->nodes[i];
+      if (node.Leaf()) {
+        if (static_cast<uint64_t>(node.first) + node.count >
+            this->indices.size()) {
+          return false;
+        }
+        continue;
+      }
+
+      if (node.first <= i ||
+          static_cast<uint64_t>(node.first) + 1 >= this->nodes.size() ||
+          depths[i] + 1u >= maxDepth) {
+        return false;
+      }
+      for (const uint32_t &child : {node.first, node.first + 1}) {
+        depths[child] =
+            std::max(depths[child], static_cast<uint8_t>(depths[i] + 1));
+      }
+    }
+
+    return true;
+  }
+
+  /// Traverses the hierarchy front-to-back, calling intersect(primitive, tMax)
+  /// for every primitive in the leaves we reach. The callback should return
+  /// true and shrink tMax when it found an closer hit, this allows us to skip
+  /// all the nodes which are further away than the nearest hit so far. The
+  /// number of nodes entered is added to nodesVisited, if given.
+  template <typename F>
+  bool Traverse(const Ray<T> &ray, const T &tMin, T &tMax, F &&intersect,
+                uint64_t *nodesVisited = nullptr) const {
+    if (this->nodes.empty()) {
+      return false;
+    }
+
+    // The slab tests do all three axes at once, on the padded origin and
+    // inverse direction.
+    const PaddedVector3D<T> origin(ray.origin);
+    const PaddedVector3D<T> inverseDirection(
+        static_cast<T>(1.0) / ray.direction.x,
+        static_cast<T>(1.0) / ray.direction.y,
+        static_cast<T>(1.0) / ray.direction.z);
+
+    // The stack of nodes to visit, together with the distance at which the ray
+    // enters them.
+    uint32_t stackNodes[maxDepth * 2];
+    T stackEntries[maxDepth * 2];
+    size_t stackSize = 0;
+
+    T tEntry;
+    if (!this->nodes[0].bounds.Intersect(origin, inverseDirection, tMin, tMax,
+                                         tEntry)) {
+      return false;
+    }
+
+    stackNodes[stackSize] = 0;
+    stackEntries[stackSize++] = tEntry;
+
+    bool hit = false;
+    uint64_t visited = 0;
+    while (stackSize != 0) {
+      --stackSize;
+
+      // Skips the node if we've found an hit closer than its entry point since
+      // it was pushed.
+      if (stackEntries[stackSize] > tMax) {
+        continue;
+      }
+
+      const BoundingVolumeNode<T> &node = this->nodes[stackNodes[stackSize]];
+      ++visited;
+
+      // Intersects all the primitives if this is an leaf.
+      if (node.Leaf()) {
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+          if (intersect(this->indices[i], tMax)) {
+            hit = true;
+          }
+        }
+
+        continue;
+      }
+
+      // Tests both children, and pushes them so the nearest one is visited
+      // first.
+      T tLeft, tRight;
+      const bool hitLeft = this->nodes[node.first].bounds.Intersect(
+          origin, inverseDirection, tMin, tMax, tLeft);
+      const bool hitRight = this->nodes[node.first + 1].bounds.Intersect(
+          origin, inverseDirection, tMin, tMax, tRight);
+
+      if (hitLeft && hitRight) {
+        const bool leftFirst = tLeft <= tRight;
+        stackNodes[stackSize] = leftFirst ? node.first + 1 : node.first;
+        stackEntries[stackSize++] = leftFirst ? tRight : tLeft;
+        stackNodes[stackSize] = leftFirst ? node.first : node.first + 1;
+        stackEntries[stackSize++] = leftFirst ? tLeft : tRight;
+      } else if (hitLeft) {
+        stackNodes[stackSize] = node.first;
+        stackEntries[stackSize++] = tLeft;
+      } else if (hitRight) {
+        stackNodes[stackSize] = node.first + 1;
+        stackEntries[stackSize++] = tRight;
+      }
+    }
+
+    if (nodesVisited != nullptr) {
+      *nodesVisited += visited;
+    }
+
+    return hit;
+  }
+
+  /// Traverses the hierarchy until an primitive blocks the ray, calling
+  /// intersect(primitive) for the primitives in the leaves the ray reaches
+  /// within [tMin, tMax]. The callback returns true when the primitive is hit
+  /// within that range, which ends the traversal right away. Gets whether any
+  /// primitive was hit, the number of nodes entered is added to nodesVisited,
+  /// if given.
+  template <typename F>
+  bool Occluded(const Ray<T> &ray, const T &tMin, const T &tMax,
+                F &&intersect, uint64_t *nodesVisited = nullptr) const {
+    if (this->nodes.empty()) {
+      return false;
+    }
+
+    const PaddedVector3D<T> origin(ray.origin);
+    const PaddedVector3D<T> inverseDirection(
+        static_cast<T>(1.0) / ray.direction.x,
+        static_cast<T>(1.0) / ray.direction.y,
+        static_cast<T>(1.0) / ray.direction.z);
+
+    T tEntry;
+    if (!this->nodes[0].bounds.Intersect(origin, inverseDirection, tMin, tMax,
+                                         tEntry)) {
+      return false;
+    }
+
+    // Any hit will do, so the children are only ordered to try the nearest
+    // one first, which is the most likely to block the ray.
+    uint32_t stack[maxDepth * 2];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    bool hit = false;
+    uint64_t visited = 0;
+    while (stackSize != 0 && !hit) {
+      const BoundingVolumeNode<T> &node = this->nodes[stack[--stackSize]];
+      ++visited;
+
+      if (node.Leaf()) {
+        for (uint32_t i = node.first; i < node.first + node.count && !hit;
+             ++i) {
+          hit = intersect(this->indices[i]);
+        }
+
+        continue;
+      }
+
+      T tLeft, tRight;
+      const bool hitLeft = this->nodes[node.first].bounds.Intersect(
+          origin, inverseDirection, tMin, tMax, tLeft);
+      const bool hitRight = this->nodes[node.first + 1].bounds.Intersect(
+          origin, inverseDirection, tMin, tMax, tRight);
+
+      const bool leftFirst = !hitRight || (hitLeft && tLeft <= tRight);
+      if (hitLeft && hitRight) {
+        stack[stackSize++] = leftFirst ? node.first + 1 : node.first;
+      }
+      if (hitLeft || hitRight) {
+        stack[stackSize++] = leftFirst ? node.first : node.first + 1;
+      }
+    }
+
+    if (nodesVisited != nullptr) {
+      *nodesVisited += visited;
+    }
+
+    return hit;
+  }
+
+  ~BoundingVolumeHierarchy<T>() = default;
+
+private:
+  /// Recalculates the bounds of the given node, from its primitives or from
+  /// its children which have to be refit already.
+  inline void RefitNode(const uint32_t &index,
+                        const std::vector<BoundingBox<T>> &primitiveBounds) {
+    BoundingVolumeNode<T> &node = this->nodes[index];
+    BoundingBox<T> bounds;
+    if (node.Leaf()) {
+      for (uint32_t j = node.first; j < node.first + node.count; ++j) {
+        bounds.Extend(primitiveBounds[this->indices[j]]);
+      }
+    } else {
+      bounds.Extend(this->nodes[node.first].bounds)
+          .Extend(this->nodes[node.first + 1].bounds);
+    }
+
+    node.bounds = bounds;
+  }
+
+  /// Computes the bounds of the given node from its primitives, and splits it
+  /// if the surface area heuristic says that's cheaper than intersecting all
+  /// the primitives. Returns the index of the left child if it was split.
+  std::optional<uint32_t>
+  Subdivide(const uint32_t &nodeIndex, const size_t &depth,
+            const std::vector<BoundingBox<T>> &primitiveBounds,
+            const std::vector<Vector3D<T>> &centroids) {
+    const uint32_t first = this->nodes[nodeIndex].first;
+    const uint32_t count = this->nodes[nodeIndex].count;
+
+    // Calculates the bounds of the node, and the bounds of the centroids which
+    // are used to place the bins.
+    BoundingBox<T> bounds, centroidBounds;
+    for (uint32_t i = first; i < first + count; ++i) {
+      bounds.Extend(primitiveBounds[this->indices[i]]);
+      centroidBounds.Extend(centroids[this->indices[i]]);
+    }
+
+    this->nodes[nodeIndex].bounds = bounds;
+
+    if (count <= 1 || depth + 1 >= maxDepth) {
+      return std::nullopt;
+    }
+
+    // Finds the cheapest split plane along all the axes, the costs are relative
+    // to the surface area of the node and an primitive intersection costs as
+    // much as an traversal step.
+    const T leafCost = static_cast<T>(count);
+    T bestCost = std::numeric_limits<T>::infinity();
+    size_t bestAxis = 0;
+    size_t bestSplit = 0;
+
+    for (size_t axis = 0; axis < 3; ++axis) {
+      const T axisMin = centroidBounds.min.At(axis);
+      const T axisMax = centroidBounds.max.At(axis);
+      if (axisMax <= axisMin) {
+        continue;
+      }
+
+      const T scale = static_cast<T>(binCount) / (axisMax - axisMin);
+
+      // Places all the primitives in the bins.
+      BoundingBox<T> binBounds[binCount];
+      size_t binCounts[binCount] = {};
+      for (uint32_t i = first; i < first + count; ++i) {
+        const size_t bin = this->Bin(centroids[this->indices[i]].At(axis),
+                                     axisMin, scale);
+        binBounds[bin].Extend(primitiveBounds[this->indices[i]]);
+        ++binCounts[bin];
+      }
+
+      // Sweeps from both sides to get the area and count left and right of
+      // each of the planes between the bins.
+      T leftAreas[binCount - 1], rightAreas[binCount - 1];
+      size_t leftCounts[binCount - 1], rightCounts[binCount - 1];
+      BoundingBox<T> leftBox, rightBox;
+      size_t leftSum = 0, rightSum = 0;
+      for (size_t i = 0; i < binCount - 1; ++i) {
+        leftSum += binCounts[i];
+        leftCounts[i] = leftSum;
+        leftAreas[i] = leftBox.Extend(binBounds[i]).SurfaceArea();
+
+        rightSum += binCounts[binCount - 1 - i];
+        rightCounts[binCount - 2 - i] = rightSum;
+        rightAreas[binCount - 2 - i] =
+            rightBox.Extend(binBounds[binCount - 1 - i]).SurfaceArea();
+      }
+
+      const T area = bounds.SurfaceArea();
+      for (size_t i = 0; i < binCount - 1; ++i) {
+        if (leftCounts[i] == 0 || rightCounts[i] == 0) {
+          continue;
+        }
+
+        const T cost =
+            static_cast<T>(1.0) +
+            (leftAreas[i] * static_cast<T>(leftCounts[i]) +
+             rightAreas[i] * static_cast<T>(rightCounts[i])) /
+                area;
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestSplit = i;
+        }
+      }
+    }
+
+    // Keeps the node as an leaf if splitting is not worth it, or if all the
+    // centroids are on top of each other and there's nothing to split.
+    if (bestCost == std::numeric_limits<T>::infinity() ||
+        (bestCost >= leafCost && count <= maxLeafSize)) {
+      return std::nullopt;
+    }
+
+    // Partitions the primitives around the chosen plane.
+    const T axisMin = centroidBounds.min.At(bestAxis);
+    const T scale = static_cast<T>(binCount) /
+                    (centroidBounds.max.At(bestAxis) - axisMin);
+    uint32_t *middle = std::partition(
+        this->indices.data() + first, this->indices.data() + first + count,
+        [&](const uint32_t &index) {
+          return this->Bin(centroids[index].At(bestAxis), axisMin, scale) <=
+                 bestSplit;
+        });
+    const uint32_t leftCount =
+        static_cast<uint32_t>(middle - (this->indices.data() + first));
+
+    // Creates the two children, they're always stored next to each other.
+    const uint32_t left = static_cast<uint32_t>(this->nodes.size());
+    this->nodes.emplace_back();
+    this->nodes.emplace_back();
+    this->nodes[left].first = first;
+    this->nodes[left].count = leftCount;
+    this->nodes[left + 1].first = first + leftCount;
+    this->nodes[left + 1].count = count - leftCount;
+
+    this->nodes[nodeIndex].first = left;
+    this->nodes[nodeIndex].count = 0;
+
+    return left;
+  }
+
+  inline size_t Bin(const T &value, const T &min, const T &scale) const
+      noexcept {
+    const size_t bin = static_cast<size_t>((value - min) * scale);
+    return std::min(bin, binCount - 1);
+  }
+};
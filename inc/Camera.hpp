@@ -1,11 +1,23 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <limits>
 #include <stdexcept>
+#include <vector>
 
+#include "BoundingBox.hpp"
 #include "Matrix3D.hpp"
 #include "Vector3D.hpp"
 #include "Ray.hpp"
+#include "RayPacket.hpp"
+#include "Tile.hpp"
+
+enum class Projection {
+  Orthographic, // Parallel rays, one world unit per pixel.
+  Perspective,  // All rays start at the position, spread by the field of view.
+};
 
 template <typename T> class Camera {
 public:
@@ -14,12 +26,123 @@ public:
   size_t viewportWidth,
       viewportHeight; // The width and height of the viewport, number of rays
                       // being cast: width * height.
+  Projection projection;
+  T fieldOfView; // The vertical field of view in radians, perspective only,
+                 // defaults to 60 degrees.
+
+private:
+  // The basis of the camera, baked from the angles and the projection by
+  // Update() so generating an ray needs no trigonometry.
+  Vector3D<T> right, up, forward;
+  T halfWidth, halfHeight;
 
 public:
   Camera<T>(const Vector3D<T> &position, const Vector3D<T> &angles,
-            const size_t &viewportWidth, const size_t &viewportHeight) noexcept
-      : position(position), angles(angles),
-        viewportWidth(viewportWidth), viewportHeight(viewportHeight) {}
+            const size_t &viewportWidth, const size_t &viewportHeight,
+            const Projection &projection = Projection::Orthographic,
+            const T &fieldOfView = static_cast<T>(1.0471975511965976)) noexcept
+      : position(position), angles(angles), viewportWidth(viewportWidth),
+        viewportHeight(viewportHeight), projection(projection),
+        fieldOfView(fieldOfView), right(1.0, 0.0, 0.0), up(0.0, 1.0, 0.0),
+        forward(0.0, 0.0, 1.0), halfWidth(0.0), halfHeight(0.0) {
+    this->Update();
+  }
+
+  /// Recalculates the basis of the camera, this has to be called after any of
+  /// the public members has been changed directly.
+  Camera<T> &Update() noexcept {
+    // Calculates the transformation matrix, to rotate the camera.
+    const Matrix3D<T> transformationMatrix = Matrix3D<T>::Rotation(this->angles);
+
+    this->right = transformationMatrix.Multiply(Vector3D<T>(1.0, 0.0, 0.0));
+    this->up = transformationMatrix.Multiply(Vector3D<T>(0.0, 1.0, 0.0));
+    this->forward = transformationMatrix.Multiply(Vector3D<T>(0.0, 0.0, 1.0));
+    this->halfWidth = static_cast<T>(this->viewportWidth / 2);
+    this->halfHeight = static_cast<T>(this->viewportHeight / 2);
+
+    // For perspective the steps are scaled so the viewport spans the field of
+    // view at an distance of one.
+    if (this->projection == Projection::Perspective) {
+      const T scale = std::tan(this->fieldOfView / static_cast<T>(2.0)) /
+                      std::max(this->halfHeight, static_cast<T>(1.0));
+      this->right *= scale;
+      this->up *= scale;
+    }
+
+    return *this;
+  }
+
+  Camera<T> &Move(const Vector3D<T> &position) noexcept {
+    this->position = position;
+    return this->Update();
+  }
+
+  Camera<T> &Rotate(const Vector3D<T> &angles) noexcept {
+    this->angles = angles;
+    return this->Update();
+  }
+
+  /// Checks if the cameras give the same rays.
+  bool operator==(const Camera<T> &other) const noexcept {
+    return this->position == other.position && this->angles == other.angles &&
+           this->viewportWidth == other.viewportWidth &&
+           this->viewportHeight == other.viewportHeight &&
+           this->projection == other.projection &&
+           this->fieldOfView == other.fieldOfView;
+  }
+
+  bool operator!=(const Camera<T> &other) const noexcept {
+    return !(*this == other);
+  }
+
+  /// Gets the rectangle of the viewport, in pixels, through which rays can hit
+  /// anything within the given bounds. It covers the projections of all the
+  /// corners of the bounds, and the entire viewport when they reach behind an
+  /// perspective camera. Gets false when no ray can hit them.
+  bool Footprint(const BoundingBox<T> &bounds, T &minX, T &minY, T &maxX,
+                 T &maxY) const noexcept {
+    if (bounds.Empty()) {
+      return false;
+    }
+
+    minX = minY = std::numeric_limits<T>::infinity();
+    maxX = maxY = -std::numeric_limits<T>::infinity();
+    size_t behind = 0;
+    for (size_t corner = 0; corner < 8; ++corner) {
+      const Vector3D<T> offset =
+          Vector3D<T>(corner & 1 ? bounds.max.x : bounds.min.x,
+                      corner & 2 ? bounds.max.y : bounds.min.y,
+                      corner & 4 ? bounds.max.z : bounds.min.z) -
+          this->position;
+      const T depth = offset.Dot(this->forward);
+      T x = offset.Dot(this->right) / this->right.LengthSquared();
+      T y = offset.Dot(this->up) / this->up.LengthSquared();
+      if (this->projection == Projection::Perspective) {
+        if (!(depth > static_cast<T>(0.0))) {
+          ++behind;
+          continue;
+        }
+
+        x /= depth;
+        y /= depth;
+      }
+
+      minX = std::min(minX, x + this->halfWidth);
+      minY = std::min(minY, y + this->halfHeight);
+      maxX = std::max(maxX, x + this->halfWidth);
+      maxY = std::max(maxY, y + this->halfHeight);
+    }
+
+    if (behind == 8) {
+      return false;
+    }
+    if (behind != 0) {
+      minX = minY = -std::numeric_limits<T>::infinity();
+      maxX = maxY = std::numeric_limits<T>::infinity();
+    }
+
+    return true;
+  }
 
   /// Calculates the origin of the given ray.
   Ray<T> GetRayOrigin(const size_t &n) const {
@@ -28,34 +151,56 @@ public:
       throw std::runtime_error("n out of viewport range!");
     }
 
-    // Gets the X and Y in the viewport.
-    const size_t viewportY = this->ViewportY(n);
-    const size_t viewportX = this->ViewportX(n);
+    return this->GetRay(static_cast<T>(this->ViewportX(n)),
+                        static_cast<T>(this->ViewportY(n)));
+  }
 
-    // Calculates the world coordinates of the ray origin.
-    const Vector3D<T> origin(
-        static_cast<T>(viewportX) - static_cast<T>(this->viewportWidth / 2),
-        static_cast<T>(viewportY) - static_cast<T>(this->viewportHeight / 2),
-        0.0);
+  /// Gets the ray through the given point of the viewport, in pixels. Integer
+  /// coordinates are the corners of the pixels, the point is not checked.
+  inline Ray<T> GetRay(const T &x, const T &y) const noexcept {
+    const T offsetX = x - this->halfWidth;
+    const T offsetY = y - this->halfHeight;
 
-    // Creates the direction vector.
-    const Vector3D<T> direction(0.0, 0.0, 1.0);
+    if (this->projection == Projection::Perspective) {
+      return Ray<T>(this->position,
+                    (this->forward + this->right * offsetX + this->up * offsetY)
+                        .Normalize());
+    }
 
-    // Calculates the transformation matrix, to rotate the camera.
-    Matrix3D<double> transformationMatrix =
-        Matrix3D<double>::Rotation(this->angles);
+    return Ray<T>(this->position + this->right * offsetX + this->up * offsetY,
+                  this->forward);
+  }
 
-    // Transforms the origin.
-    const Vector3D<T> transformedOrigin = transformationMatrix.Multiply(origin).Add(this->position);
+  /// Generates the rays of count pixels on an row into the packet, starting at
+  /// the given pixel. The caller makes sure they fit in the packet, the offset
+  /// moves every ray by the same fraction of an pixel.
+  const Camera<T> &GenerateRow(const size_t &x, const size_t &y,
+                               const size_t &count, RayPacket<T> &packet,
+                               const T &offsetX = static_cast<T>(0.0),
+                               const T &offsetY = static_cast<T>(0.0)) const
+      noexcept {
+    packet.Clear();
+    for (size_t i = 0; i < count; ++i) {
+      packet.Push(this->GetRay(static_cast<T>(x + i) + offsetX,
+                               static_cast<T>(y) + offsetY));
+    }
 
-    // Transforms the direction vector.
-    const Vector3D<T> transformedDirection = transformationMatrix.Multiply(direction);
+    return *this;
+  }
 
-    // Creates the result ray.
-    Ray<T> ray(transformedOrigin, transformedDirection);
+  /// Generates the rays of all the pixels in the tile row by row, the buffer
+  /// keeps its capacity between calls.
+  const Camera<T> &GenerateTile(const Tile &tile,
+                                std::vector<Ray<T>> &rays) const {
+    rays.clear();
+    rays.reserve(tile.PixelCount());
+    for (size_t y = tile.y; y < tile.y + tile.height; ++y) {
+      for (size_t x = tile.x; x < tile.x + tile.width; ++x) {
+        rays.push_back(this->GetRay(static_cast<T>(x), static_cast<T>(y)));
+      }
+    }
 
-    // Returns the ray.
-    return ray;
+    return *this;
   }
 
   inline size_t ViewportX(const size_t &n) const noexcept {
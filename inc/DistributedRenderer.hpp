@@ -0,0 +1,628 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "MappedFile.hpp"
+#include "RayCaster.hpp"
+#include "Sampler.hpp"
+#include "SceneFile.hpp"
+#include "Socket.hpp"
+#include "ThreadPool.hpp"
+#include "Tile.hpp"
+#include "Vector3D.hpp"
+
+/// The kinds of messages between an coordinator and its workers. Every message
+/// is an RenderMessageHeader followed by its body, the numbers are part of the
+/// protocol and never change.
+enum class RenderMessage : uint32_t {
+  Hello = 0,  // Worker to coordinator, an RenderHello.
+  Job = 1,    // Coordinator to worker, an RenderJob and then the scene file.
+  Tiles = 2,  // Coordinator to worker, the indices of tiles as uint32_t.
+  Result = 3, // Worker to coordinator, the index of an tile as uint32_t and
+              // then its pixels, row by row.
+  Stop = 4,   // Coordinator to worker, the frame is done.
+};
+
+class RenderMessageHeader {
+public:
+  RenderMessage type;
+  uint32_t reserved;
+  uint64_t size; // Of the body.
+};
+
+/// What an worker announces itself with when it connects.
+class RenderHello {
+public:
+  static constexpr char signature[8] = {'R', 'T', 'W', 'O', 'R', 'K', 'E', 'R'};
+  static constexpr uint32_t currentVersion = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t threads; // The tiles it renders at once.
+};
+
+/// The settings of an frame, everything an worker needs to render tiles of it
+/// but the scene. Like the scene files, the messages are only understood by
+/// machines with the same byte order.
+class RenderJob {
+public:
+  uint32_t precision; // The size of an coordinate, 4 or 8 bytes.
+  uint32_t projection;
+  uint64_t width, height;
+  double position[3], angles[3];
+  double fieldOfView;
+  uint64_t minimumSamples, maximumSamples;
+  float threshold;
+  uint32_t pattern;
+  uint64_t seed;
+  uint32_t mode;
+  uint32_t russianRoulette;
+  uint64_t maximumRays;
+  double minimumReflectivity;
+};
+
+/// What happened while an frame was rendered by the workers.
+class DistributedFrame {
+public:
+  size_t workers;     // Which connected during the frame.
+  size_t workersLost; // Which went away before the frame was done.
+  size_t tilesSent;   // Counting every time an tile was sent.
+  size_t reassigned;  // Tiles sent again since their worker went away.
+  size_t duplicated;  // Tiles sent again since their worker was slow.
+  size_t sceneBytes;  // Sent to every worker.
+};
+
+/// Renders frames on worker processes, see RenderWorker, which may be on other
+/// machines. The frame is split into the same tiles as by an RayCaster with
+/// the same settings, and the workers render them the same way, so the image
+/// is exactly the same as one rendered in an single process.
+///
+/// Every worker which connects gets the scene once, as an scene file, and
+/// then the tiles to render in batches of as many as it has threads. It's
+/// given the next batch before it's done with the one it's on, so it's never
+/// left waiting. An worker which goes away has its tiles handed out again.
+/// Once there's nothing left to hand out, the workers which run out of tiles
+/// take over the oldest ones the others are still on, so an slow worker
+/// doesn't hold up the frame. Whichever copy of an tile is done first is used.
+template <typename T> class DistributedRenderer {
+public:
+  /// Called whenever an tile is done, with the number of tiles done so far.
+  using Progress = std::function<void(const size_t &done, const size_t &total)>;
+
+  FrameBuffer &frameBuffer;
+  std::shared_ptr<GeometryRegister<T>> geometryRegister;
+  RayCaster<T> rayCaster; // Holds the settings and the tiles, never renders.
+  size_t timeoutMilliseconds; // How long to wait for any worker to answer.
+
+  // The batches an worker is given ahead, and the most workers an tile is
+  // given to at once when they're slow.
+  static constexpr size_t batchesAhead = 2;
+  static constexpr size_t maximumCopies = 2;
+  // How long the workers get to finish the tiles they're still on once the
+  // frame is done, before the connections are closed on them.
+  static constexpr int stopMilliseconds = 1000;
+
+private:
+  /// An worker, and the tiles it has been given but hasn't sent back yet.
+  class Connection {
+  public:
+    Socket socket;
+    size_t threads; // Zero until it said hello.
+    std::vector<uint32_t> tiles; // Oldest first.
+    std::vector<char> received;  // Of messages which aren't complete yet.
+    bool lost;
+
+  public:
+    explicit Connection(Socket &&socket)
+        : socket(std::move(socket)), threads(0), tiles(), received(),
+          lost(false) {}
+  };
+
+  /// The state of the frame being rendered.
+  class Session {
+  public:
+    const std::vector<Tile> &tiles;
+    std::vector<uint8_t> done;
+    std::vector<uint8_t> copies; // The workers which have the tile.
+    std::deque<uint32_t> pending;
+    std::vector<Connection> connections;
+    size_t doneCount;
+    DistributedFrame frame;
+
+  public:
+    explicit Session(const std::vector<Tile> &tiles)
+        : tiles(tiles), done(tiles.size(), 0), copies(tiles.size(), 0),
+          pending(), connections(), doneCount(0), frame() {
+      for (size_t i = 0; i < tiles.size(); ++i) {
+        this->pending.push_back(static_cast<uint32_t>(i));
+      }
+    }
+  };
+
+  std::string scene; // The scene file, written once.
+
+public:
+  DistributedRenderer<T>(FrameBuffer &frameBuffer, Camera<T> &camera,
+                         std::shared_ptr<GeometryRegister<T>> geometryRegister,
+                         const size_t &timeoutMilliseconds = 60000)
+      : frameBuffer(frameBuffer), geometryRegister(geometryRegister),
+        rayCaster(frameBuffer, camera, geometryRegister),
+        timeoutMilliseconds(timeoutMilliseconds), scene() {}
+
+  DistributedRenderer<T>(const DistributedRenderer<T> &) = delete;
+  DistributedRenderer<T> &operator=(const DistributedRenderer<T> &) = delete;
+
+  /// See RayCaster::Supersample().
+  DistributedRenderer<T> &Supersample(const SampleSettings &settings) {
+    this->rayCaster.Supersample(settings);
+    return *this;
+  }
+
+  /// See RayCaster::Mode().
+  DistributedRenderer<T> &Mode(const TraceMode &mode) noexcept {
+    this->rayCaster.Mode(mode);
+    return *this;
+  }
+
+  /// See RayCaster::Terminate().
+  DistributedRenderer<T> &Terminate(const PathTermination &termination) {
+    this->rayCaster.Terminate(termination);
+    return *this;
+  }
+
+  /// Renders the frame on the workers which connect to the listener, and
+  /// tells them to stop once it's done. Throws when no worker has answered for
+  /// longer than the timeout.
+  DistributedFrame Render(Listener &listener,
+                          const Progress &progress = nullptr) {
+    if (this->scene.empty()) {
+      std::ostringstream stream;
+      SceneFile<T>::Write(*this->geometryRegister, stream);
+      this->scene = stream.str();
+    }
+
+    Session session(this->rayCaster.Tiles());
+    session.frame.sceneBytes = this->scene.size();
+    std::vector<pollfd> descriptors;
+    std::vector<char> buffer(1 << 16);
+
+    while (session.doneCount < session.tiles.size()) {
+      for (Connection &connection : session.connections) {
+        this->Assign(session, connection);
+      }
+      this->Forget(session);
+
+      descriptors.assign(1, pollfd{listener.Descriptor(), POLLIN, 0});
+      for (const Connection &connection : session.connections) {
+        descriptors.push_back(pollfd{connection.socket.Descriptor(), POLLIN, 0});
+      }
+
+      const int ready =
+          poll(descriptors.data(), descriptors.size(),
+               static_cast<int>(this->timeoutMilliseconds));
+      if (ready < 0 && errno != EINTR) {
+        throw std::runtime_error(std::string("Failed to wait for workers: ") +
+                                 std::strerror(errno));
+      }
+      if (ready == 0) {
+        throw std::runtime_error(
+            "No worker answered for " +
+            std::to_string(this->timeoutMilliseconds) + " ms, " +
+            std::to_string(session.tiles.size() - session.doneCount) +
+            " tiles are left");
+      }
+
+      for (size_t i = 0; i < session.connections.size(); ++i) {
+        Connection &connection = session.connections[i];
+        if ((descriptors[i + 1].revents & (POLLIN | POLLERR | POLLHUP)) == 0) {
+          continue;
+        }
+
+        try {
+          const size_t count =
+              connection.socket.ReceiveAvailable(buffer.data(), buffer.size());
+          connection.received.insert(connection.received.end(), buffer.data(),
+                                     buffer.data() + count);
+          this->Handle(session, connection, progress);
+        } catch (const std::runtime_error &) {
+          this->Lose(session, connection);
+        }
+      }
+      this->Forget(session);
+
+      if ((descriptors[0].revents & POLLIN) != 0) {
+        session.connections.emplace_back(listener.Accept());
+        ++session.frame.workers;
+      }
+    }
+
+    this->Stop(session, buffer);
+    return session.frame;
+  }
+
+  ~DistributedRenderer<T>() = default;
+
+private:
+  /// Gets the settings the workers need, from the ray caster.
+  RenderJob Job() const noexcept {
+    const Camera<T> &camera = this->rayCaster.camera;
+    const SampleSettings &sampling = this->rayCaster.sampler.settings;
+    const PathTermination &termination = this->rayCaster.termination;
+
+    RenderJob job;
+    std::memset(&job, 0, sizeof(job));
+    job.precision = sizeof(T);
+    job.projection = static_cast<uint32_t>(camera.projection);
+    job.width = camera.viewportWidth;
+    job.height = camera.viewportHeight;
+    job.position[0] = static_cast<double>(camera.position.x);
+    job.position[1] = static_cast<double>(camera.position.y);
+    job.position[2] = static_cast<double>(camera.position.z);
+    job.angles[0] = static_cast<double>(camera.angles.x);
+    job.angles[1] = static_cast<double>(camera.angles.y);
+    job.angles[2] = static_cast<double>(camera.angles.z);
+    job.fieldOfView = static_cast<double>(camera.fieldOfView);
+    job.minimumSamples = sampling.minimumSamples;
+    job.maximumSamples = sampling.maximumSamples;
+    job.threshold = sampling.threshold;
+    job.pattern = static_cast<uint32_t>(sampling.pattern);
+    job.seed = sampling.seed;
+    job.mode = static_cast<uint32_t>(this->rayCaster.mode);
+    job.russianRoulette = termination.russianRoulette ? 1 : 0;
+    job.maximumRays = termination.maximumRays;
+    job.minimumReflectivity = termination.minimumReflectivity;
+    return job;
+  }
+
+  /// Handles the complete messages the worker has sent, throws when they're
+  /// not what's expected.
+  void Handle(Session &session, Connection &connection,
+              const Progress &progress) {
+    std::vector<char> &received = connection.received;
+    size_t offset = 0;
+    while (received.size() - offset >= sizeof(RenderMessageHeader)) {
+      RenderMessageHeader header;
+      std::memcpy(&header, received.data() + offset, sizeof(header));
+      if (header.size > sizeof(uint32_t) + RayCaster<T>::wavefrontTileSize *
+                                               RayCaster<T>::wavefrontTileSize *
+                                               FrameBuffer::channelCount) {
+        throw std::runtime_error("Message too large");
+      }
+      if (received.size() - offset - sizeof(header) < header.size) {
+        break;
+      }
+
+      const char *body = received.data() + offset + sizeof(header);
+      offset += sizeof(header) + header.size;
+      if (header.type == RenderMessage::Hello) {
+        this->Welcome(session, connection, header, body);
+      } else if (header.type == RenderMessage::Result) {
+        this->Collect(session, connection, header, body, progress);
+      } else {
+        throw std::runtime_error("Unexpected message");
+      }
+    }
+
+    received.erase(received.begin(), received.begin() + offset);
+  }
+
+  /// Checks the hello of an worker, and sends it the job.
+  void Welcome(Session &session, Connection &connection,
+               const RenderMessageHeader &header, const char *body) {
+    RenderHello hello;
+    if (connection.threads != 0 || header.size != sizeof(hello)) {
+      throw std::runtime_error("Unexpected hello");
+    }
+    std::memcpy(&hello, body, sizeof(hello));
+    if (std::memcmp(hello.magic, RenderHello::signature,
+                    sizeof(hello.magic)) != 0 ||
+        hello.version != RenderHello::currentVersion) {
+      throw std::runtime_error("Not an worker of this version");
+    }
+
+    const RenderJob job = this->Job();
+    const RenderMessageHeader jobHeader{RenderMessage::Job, 0,
+                                        sizeof(job) + this->scene.size()};
+    connection.socket.Send(&jobHeader, sizeof(jobHeader))
+        .Send(&job, sizeof(job))
+        .Send(this->scene.data(), this->scene.size());
+    connection.threads = std::max<size_t>(hello.threads, 1);
+  }
+
+  /// Copies an tile an worker is done with into the frame buffer, unless an
+  /// other worker was done with it first.
+  void Collect(Session &session, Connection &connection,
+               const RenderMessageHeader &header, const char *body,
+               const Progress &progress) {
+    uint32_t index;
+    if (header.size < sizeof(index)) {
+      throw std::runtime_error("Malformed result");
+    }
+    std::memcpy(&index, body, sizeof(index));
+
+    const auto found =
+        std::find(connection.tiles.begin(), connection.tiles.end(), index);
+    if (found == connection.tiles.end()) {
+      throw std::runtime_error("Result of an tile which wasn't asked for");
+    }
+    const Tile &tile = session.tiles[index];
+    const size_t rowSize = tile.width * FrameBuffer::channelCount;
+    if (header.size != sizeof(index) + rowSize * tile.height) {
+      throw std::runtime_error("Malformed result");
+    }
+
+    connection.tiles.erase(found);
+    --session.copies[index];
+    if (session.done[index] != 0) {
+      return;
+    }
+
+    const char *pixels = body + sizeof(index);
+    for (size_t y = 0; y < tile.height; ++y) {
+      std::memcpy(this->frameBuffer.Row(tile.y + y) +
+                      tile.x * FrameBuffer::channelCount,
+                  pixels + y * rowSize, rowSize);
+    }
+    session.done[index] = 1;
+    ++session.doneCount;
+
+    if (progress) {
+      progress(session.doneCount, session.tiles.size());
+    }
+  }
+
+  /// Gives the worker as many tiles as it should have ahead of it, or the
+  /// tiles of the slower workers once there's nothing else left.
+  void Assign(Session &session, Connection &connection) {
+    if (connection.lost || connection.threads == 0) {
+      return;
+    }
+
+    std::vector<uint32_t> batch;
+    while (connection.tiles.size() + batch.size() <
+               batchesAhead * connection.threads &&
+           !session.pending.empty()) {
+      batch.push_back(session.pending.front());
+      session.pending.pop_front();
+    }
+
+    if (batch.empty() && connection.tiles.empty()) {
+      for (const Connection &other : session.connections) {
+        for (const uint32_t &index : other.tiles) {
+          if (batch.size() < connection.threads &&
+              session.done[index] == 0 &&
+              session.copies[index] < maximumCopies &&
+              std::find(batch.begin(), batch.end(), index) == batch.end()) {
+            batch.push_back(index);
+          }
+        }
+      }
+      session.frame.duplicated += batch.size();
+    }
+
+    if (batch.empty()) {
+      return;
+    }
+
+    for (const uint32_t &index : batch) {
+      ++session.copies[index];
+      connection.tiles.push_back(index);
+    }
+    session.frame.tilesSent += batch.size();
+
+    const RenderMessageHeader header{RenderMessage::Tiles, 0,
+                                     batch.size() * sizeof(uint32_t)};
+    try {
+      connection.socket.Send(&header, sizeof(header))
+          .Send(batch.data(), batch.size() * sizeof(uint32_t));
+    } catch (const std::runtime_error &) {
+      this->Lose(session, connection);
+    }
+  }
+
+  /// Hands the tiles of an worker which went away out again.
+  void Lose(Session &session, Connection &connection) {
+    if (connection.lost) {
+      return;
+    }
+
+    for (const uint32_t &index : connection.tiles) {
+      --session.copies[index];
+      if (session.done[index] == 0 && session.copies[index] == 0) {
+        session.pending.push_front(index);
+        ++session.frame.reassigned;
+      }
+    }
+    connection.tiles.clear();
+    connection.lost = true;
+    ++session.frame.workersLost;
+  }
+
+  /// Tells the workers the frame is done, and throws away what they send
+  /// until they close their connections. The ones which are too slow to do so
+  /// find out once they catch up.
+  static void Stop(Session &session, std::vector<char> &buffer) {
+    const RenderMessageHeader stop{RenderMessage::Stop, 0, 0};
+    for (Connection &connection : session.connections) {
+      try {
+        connection.socket.Send(&stop, sizeof(stop));
+      } catch (const std::runtime_error &) {
+        connection.lost = true;
+      }
+    }
+    Forget(session);
+
+    std::vector<pollfd> descriptors;
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(stopMilliseconds);
+    while (!session.connections.empty()) {
+      const int remaining = static_cast<int>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              deadline - std::chrono::steady_clock::now())
+              .count());
+      descriptors.clear();
+      for (const Connection &connection : session.connections) {
+        descriptors.push_back(pollfd{connection.socket.Descriptor(), POLLIN, 0});
+      }
+      if (remaining <= 0 ||
+          poll(descriptors.data(), descriptors.size(), remaining) <= 0) {
+        return;
+      }
+
+      for (size_t i = 0; i < session.connections.size(); ++i) {
+        if (descriptors[i].revents != 0) {
+          try {
+            session.connections[i].socket.ReceiveAvailable(buffer.data(),
+                                                           buffer.size());
+          } catch (const std::runtime_error &) {
+            session.connections[i].lost = true;
+          }
+        }
+      }
+      Forget(session);
+    }
+  }
+
+  /// Closes the connections of the workers which went away.
+  static void Forget(Session &session) {
+    session.connections.erase(
+        std::remove_if(session.connections.begin(), session.connections.end(),
+                       [](const Connection &connection) {
+                         return connection.lost;
+                       }),
+        session.connections.end());
+  }
+};
+
+/// Renders tiles for an coordinator, see DistributedRenderer.
+class RenderWorker {
+public:
+  /// Renders the tiles the coordinator at the other end of the socket asks
+  /// for on the threads of the pool, until it's done with the frame. Throws
+  /// when the coordinator goes away before that, or sends something which
+  /// isn't expected.
+  static void Serve(Socket &socket, ThreadPool &threadPool) {
+    RenderHello hello;
+    std::memcpy(hello.magic, RenderHello::signature, sizeof(hello.magic));
+    hello.version = RenderHello::currentVersion;
+    hello.threads = static_cast<uint32_t>(threadPool.ThreadCount());
+    const RenderMessageHeader helloHeader{RenderMessage::Hello, 0,
+                                          sizeof(hello)};
+    socket.Send(&helloHeader, sizeof(helloHeader)).Send(&hello, sizeof(hello));
+
+    // The scene is received straight into an mapping, and used from there
+    // like an scene file.
+    RenderMessageHeader header;
+    RenderJob job;
+    socket.Receive(&header, sizeof(header));
+    if (header.type != RenderMessage::Job || header.size < sizeof(job)) {
+      throw std::runtime_error("Expected an job");
+    }
+    socket.Receive(&job, sizeof(job));
+    std::shared_ptr<MappedFile> scene =
+        std::make_shared<MappedFile>(header.size - sizeof(job));
+    socket.Receive(scene->Data(), scene->Size());
+
+    if (job.precision == sizeof(float)) {
+      Serve<float>(socket, threadPool, job, scene);
+    } else if (job.precision == sizeof(double)) {
+      Serve<double>(socket, threadPool, job, scene);
+    } else {
+      throw std::runtime_error("Unknown precision");
+    }
+  }
+
+private:
+  template <typename T>
+  static void Serve(Socket &socket, ThreadPool &threadPool,
+                    const RenderJob &job,
+                    const std::shared_ptr<MappedFile> &scene) {
+    std::shared_ptr<GeometryRegister<T>> geometryRegister =
+        SceneFile<T>::Load(scene, "The scene of the coordinator");
+    Camera<T> camera(
+        Vector3D<T>(static_cast<T>(job.position[0]),
+                    static_cast<T>(job.position[1]),
+                    static_cast<T>(job.position[2])),
+        Vector3D<T>(static_cast<T>(job.angles[0]),
+                    static_cast<T>(job.angles[1]),
+                    static_cast<T>(job.angles[2])),
+        job.width, job.height, static_cast<Projection>(job.projection),
+        static_cast<T>(job.fieldOfView));
+    FrameBuffer frameBuffer(job.width, job.height);
+    RayCaster<T> rayCaster(frameBuffer, camera, geometryRegister);
+    rayCaster
+        .Supersample(SampleSettings(job.maximumSamples, job.minimumSamples,
+                                    job.threshold,
+                                    static_cast<SamplePattern>(job.pattern),
+                                    job.seed))
+        .Mode(static_cast<TraceMode>(job.mode))
+        .Terminate(PathTermination(job.maximumRays, job.minimumReflectivity,
+                                   job.russianRoulette != 0));
+
+    const std::vector<Tile> &tiles = rayCaster.Tiles();
+    std::vector<uint32_t> indices;
+    std::vector<Tile> batch;
+    std::vector<char> message;
+    while (true) {
+      RenderMessageHeader header;
+      socket.Receive(&header, sizeof(header));
+      if (header.type == RenderMessage::Stop) {
+        return;
+      }
+      if (header.type != RenderMessage::Tiles ||
+          header.size % sizeof(uint32_t) != 0 ||
+          header.size / sizeof(uint32_t) > tiles.size()) {
+        throw std::runtime_error("Expected tiles");
+      }
+
+      indices.resize(header.size / sizeof(uint32_t));
+      socket.Receive(indices.data(), header.size);
+      batch.clear();
+      for (const uint32_t &index : indices) {
+        if (index >= tiles.size()) {
+          throw std::runtime_error("No tile " + std::to_string(index));
+        }
+        batch.push_back(tiles[index]);
+      }
+      rayCaster.Render(threadPool, batch);
+
+      // Sends every tile as an message of its own.
+      for (size_t i = 0; i < batch.size(); ++i) {
+        const Tile &tile = batch[i];
+        const size_t rowSize = tile.width * FrameBuffer::channelCount;
+        const RenderMessageHeader result{
+            RenderMessage::Result, 0,
+            sizeof(uint32_t) + rowSize * tile.height};
+        message.resize(sizeof(result) + result.size);
+        std::memcpy(message.data(), &result, sizeof(result));
+        std::memcpy(message.data() + sizeof(result), &indices[i],
+                    sizeof(uint32_t));
+        for (size_t y = 0; y < tile.height; ++y) {
+          std::memcpy(message.data() + sizeof(result) + sizeof(uint32_t) +
+                          y * rowSize,
+                      frameBuffer.Row(tile.y + y) +
+                          tile.x * FrameBuffer::channelCount,
+                      rowSize);
+        }
+        socket.Send(message.data(), message.size());
+      }
+    }
+  }
+};
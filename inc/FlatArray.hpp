@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// An contiguous array which either owns its elements, or refers to elements
+/// owned by something else such as an mapped scene file. It has the parts of
+/// the interface of std::vector the geometry uses, so the arrays of an scene
+/// can be built in memory or used straight from an file without copying.
+///
+/// Changing the size of an array which refers to elements elsewhere copies
+/// them into storage of its own first. Writing to the elements writes to
+/// wherever they are, which is fine for mapped files since those are mapped
+/// copy-on-write.
+template <typename V> class FlatArray {
+public:
+  using value_type = V;
+  using iterator = V *;
+  using const_iterator = const V *;
+
+  static_assert(std::is_trivially_copyable<V>::value,
+                "The elements have to be plain data to be stored in an file");
+
+private:
+  std::vector<V> owned;
+  V *elements; // Either the data of the owned vector, or somewhere else.
+  size_t count;
+
+public:
+  FlatArray<V>() noexcept : owned(), elements(nullptr), count(0) {}
+
+  FlatArray<V>(std::vector<V> vector) noexcept
+      : owned(std::move(vector)), elements(owned.data()),
+        count(owned.size()) {}
+
+  FlatArray<V>(std::initializer_list<V> values)
+      : FlatArray<V>(std::vector<V>(values)) {}
+
+  FlatArray<V>(const FlatArray<V> &other)
+      : owned(other.owned), elements(other.elements), count(other.count) {
+    if (other.Owning()) {
+      this->elements = this->owned.data();
+    }
+  }
+
+  FlatArray<V>(FlatArray<V> &&other) noexcept
+      : owned(std::move(other.owned)), elements(other.elements),
+        count(other.count) {
+    other.Forget();
+  }
+
+  FlatArray<V> &operator=(const FlatArray<V> &other) {
+    if (this != &other) {
+      const bool owning = other.Owning();
+      this->owned = other.owned;
+      this->elements = owning ? this->owned.data() : other.elements;
+      this->count = other.count;
+    }
+
+    return *this;
+  }
+
+  FlatArray<V> &operator=(FlatArray<V> &&other) noexcept {
+    if (this != &other) {
+      this->owned = std::move(other.owned);
+      this->elements = other.elements;
+      this->count = other.count;
+      other.Forget();
+    }
+
+    return *this;
+  }
+
+  /// Refers to the given elements, which have to outlive the array.
+  static FlatArray<V> View(V *elements, const size_t &count) noexcept {
+    FlatArray<V> array;
+    array.elements = elements;
+    array.count = count;
+    return array;
+  }
+
+  /// Checks if the elements are stored in the array itself.
+  inline bool Owning() const noexcept {
+    return this->elements == this->owned.data();
+  }
+
+  inline size_t size() const noexcept { return this->count; }
+  inline bool empty() const noexcept { return this->count == 0; }
+
+  /// The number of elements there's room for in the array itself, which is
+  /// zero for an array referring to elements elsewhere.
+  inline size_t capacity() const noexcept { return this->owned.capacity(); }
+
+  inline V *data() noexcept { return this->elements; }
+  inline const V *data() const noexcept { return this->elements; }
+
+  inline V &operator[](const size_t &i) noexcept { return this->elements[i]; }
+  inline const V &operator[](const size_t &i) const noexcept {
+    return this->elements[i];
+  }
+
+  inline V &back() noexcept { return this->elements[this->count - 1]; }
+  inline const V &back() const noexcept {
+    return this->elements[this->count - 1];
+  }
+
+  inline iterator begin() noexcept { return this->elements; }
+  inline iterator end() noexcept { return this->elements + this->count; }
+  inline const_iterator begin() const noexcept { return this->elements; }
+  inline const_iterator end() const noexcept {
+    return this->elements + this->count;
+  }
+
+  FlatArray<V> &push_back(const V &value) {
+    this->Own().push_back(value);
+    return this->Sync();
+  }
+
+  template <typename... Arguments>
+  FlatArray<V> &emplace_back(Arguments &&...arguments) {
+    this->Own().emplace_back(std::forward<Arguments>(arguments)...);
+    return this->Sync();
+  }
+
+  FlatArray<V> &resize(const size_t &size) {
+    this->Own().resize(size);
+    return this->Sync();
+  }
+
+  FlatArray<V> &reserve(const size_t &capacity) {
+    this->Own().reserve(capacity);
+    return this->Sync();
+  }
+
+  FlatArray<V> &shrink_to_fit() {
+    this->Own().shrink_to_fit();
+    return this->Sync();
+  }
+
+  /// Empties the array, an array referring to elements elsewhere lets go of
+  /// them.
+  FlatArray<V> &clear() noexcept {
+    this->owned.clear();
+    return this->Sync();
+  }
+
+  ~FlatArray<V>() = default;
+
+private:
+  /// Copies the elements into the array itself if they're elsewhere, and gets
+  /// the storage to change.
+  std::vector<V> &Own() {
+    if (!this->Owning()) {
+      this->owned.assign(this->elements, this->elements + this->count);
+    }
+
+    return this->owned;
+  }
+
+  inline FlatArray<V> &Sync() noexcept {
+    this->elements = this->owned.data();
+    this->count = this->owned.size();
+    return *this;
+  }
+
+  inline void Forget() noexcept {
+    this->owned.clear();
+    this->elements = this->owned.data();
+    this->count = 0;
+  }
+};
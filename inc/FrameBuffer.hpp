@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AlignedAllocator.hpp"
+
+/// An plain 8-bit RGBA image in memory, rows are stored top to bottom without
+/// any padding. This is what the ray casters render into, the front-ends take
+/// it from here. The pixels start at an cache line, so with an width that is a
+/// multiple of 16 every tile row covers whole cache lines.
+class FrameBuffer {
+public:
+  static constexpr size_t channelCount = 4;
+
+  size_t width, height;
+  std::vector<uint8_t, AlignedAllocator<uint8_t, 64>> pixels;
+
+public:
+  FrameBuffer(const size_t &width, const size_t &height);
+
+  FrameBuffer &PutPixel(const size_t &x, const size_t &y, const uint8_t r,
+                        const uint8_t g, const uint8_t b, const uint8_t a);
+
+  FrameBuffer &Fill(const uint8_t r, const uint8_t g, const uint8_t b,
+                    const uint8_t a);
+
+  inline size_t RowStride() const noexcept {
+    return this->width * channelCount;
+  }
+
+  inline const uint8_t *Row(const size_t &y) const noexcept {
+    return this->pixels.data() + y * this->RowStride();
+  }
+
+  inline uint8_t *Row(const size_t &y) noexcept {
+    return this->pixels.data() + y * this->RowStride();
+  }
+
+  /// Converts an color channel in the range [0, 1] to 8 bits, anything outside
+  /// of the range is clamped.
+  template <typename T> static inline uint8_t Quantize(const T &value) noexcept {
+    if (!(value > static_cast<T>(0.0))) {
+      return 0;
+    }
+
+    if (value >= static_cast<T>(1.0)) {
+      return 255;
+    }
+
+    return static_cast<uint8_t>(value * static_cast<T>(255.0) +
+                                static_cast<T>(0.5));
+  }
+
+  ~FrameBuffer() = default;
+};
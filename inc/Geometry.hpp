@@ -5,6 +5,7 @@
 #include <memory>
 #include <optional>
 
+#include "BoundingBox.hpp"
 #include "Material.hpp"
 #include "Ray.hpp"
 #include "Vector3D.hpp"
@@ -26,4 +27,22 @@ public:
   virtual std::optional<RayHitResult<T>> RayHit(const Ray<T> &ray) {
     return std::nullopt;
   }
+
+  /// Checks if the ray hits this target within the given distance. Any
+  /// hit will do, so geometry which can find one sooner than the nearest one
+  /// should override this.
+  virtual bool Occluded(const Ray<T> &ray, const T &maxDistance) {
+    const std::optional<RayHitResult<T>> hitResult = this->RayHit(ray);
+    return hitResult.has_value() && hitResult->distance <= maxDistance;
+  }
+
+  /// Gets the normal of the surface at the given point, which is assumed to be
+  /// on the surface.
+  virtual Vector3D<T> Normal(const Vector3D<T> &point) const {
+    return Vector3D<T>(0.0, 0.0, 0.0);
+  }
+
+  /// Gets the bounds of this piece of geometry, used to place it in the
+  /// bounding volume hierarchy. Empty bounds mean it can never be hit.
+  virtual BoundingBox<T> Bounds() const { return BoundingBox<T>(); }
 };
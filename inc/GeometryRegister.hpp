@@ -1,81 +1,543 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
-#include <list>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <stdexcept>
 #include <tuple>
+#include <vector>
 
+#include "BoundingBox.hpp"
+#include "BoundingVolumeHierarchy.hpp"
 #include "Geometry.hpp"
+#include "Light.hpp"
+#include "MappedFile.hpp"
+#include "Profiler.hpp"
 #include "Ray.hpp"
+#include "RayPacket.hpp"
+#include "SceneStore.hpp"
+#include "Simd.hpp"
+#include "ThreadPool.hpp"
 
+/// Owns the registered geometry, and casts rays against it. The geometry is
+/// kept alive here, but the rays are cast against an flat copy in the scene
+/// store which is laid out in the order of the leaves of the hierarchy.
+///
+/// An register loaded from an scene file has no geometry of its own for its
+/// spheres, its hierarchy and store refer to the mapped file instead. It can
+/// be rendered, but not changed. See SceneFile.
 template <typename T> class GeometryRegister {
 public:
-  std::list<std::shared_ptr<Geometry<T>>> geometries;
+  std::vector<std::shared_ptr<Geometry<T>>> geometries;
+  BoundingVolumeHierarchy<T> hierarchy;
+  SceneStore<T> store;
+  std::shared_ptr<MappedFile> mapping; // The scene file, if loaded from one.
+  FlatArray<Light<T>> lights; // Only the ones of the scene are used.
+
+private:
+  std::atomic<bool> dirty;
+  std::mutex buildMutex;
+  T builtCost; // The cost of the hierarchy right after the last build.
+  std::vector<BoundingBox<T>> primitiveBounds; // Kept between refits.
 
 public:
-  GeometryRegister<T>() : geometries({}) {}
+  GeometryRegister<T>() : geometries({}), hierarchy(), store(), mapping(),
+                          lights(), dirty(false), builtCost(0.0), primitiveBounds() {}
 
+  /// Registers the given geometry, the hierarchy will be rebuilt before the
+  /// next ray is cast.
   GeometryRegister<T> &Register(std::shared_ptr<Geometry<T>> geometry) {
+    this->ThrowIfMapped();
     this->geometries.push_back(geometry);
+    this->dirty.store(true, std::memory_order_release);
+    return *this;
+  }
+
+  /// Adds an light, they don't change the hierarchy so this works for an
+  /// register loaded from an scene file too.
+  GeometryRegister<T> &Illuminate(const Light<T> &light) {
+    this->lights.push_back(light);
     return *this;
   }
 
   GeometryRegister<T> &Print() {
     std::for_each(this->geometries.begin(), this->geometries.end(),
-                  [](std::shared_ptr<Geometry<T>> geometry) {
+                  [](const std::shared_ptr<Geometry<T>> &geometry) {
                     std::cout << geometry << std::endl;
                   });
     return *this;
   }
 
+  /// Rebuilds the bounding volume hierarchy over all the registered geometry.
+  GeometryRegister<T> &Build() {
+    this->ThrowIfMapped();
+    std::vector<BoundingBox<T>> bounds;
+    bounds.reserve(this->geometries.size());
+    for (const std::shared_ptr<Geometry<T>> &geometry : this->geometries) {
+      bounds.push_back(geometry->Bounds());
+    }
+
+    this->hierarchy.Build(bounds);
+
+    // Copies the geometry into the store in the order of the leaves, after
+    // which the hierarchy refers to the primitives of the store instead.
+    this->store.Clear();
+    for (uint32_t &index : this->hierarchy.indices) {
+      this->store.Add(this->geometries[index].get(), index);
+      index = static_cast<uint32_t>(this->store.Size() - 1);
+    }
+
+    this->builtCost = this->hierarchy.Cost();
+    this->dirty.store(false, std::memory_order_release);
+    return *this;
+  }
+
+  /// Updates the hierarchy and the store after geometry has been moved, which
+  /// is much cheaper than an rebuild. Geometry which moved far, or changed
+  /// shape, makes the hierarchy slower to traverse until the next Build().
+  GeometryRegister<T> &Refit() {
+    this->ThrowIfMapped();
+    if (this->dirty.load(std::memory_order_acquire)) {
+      return this->Build();
+    }
+
+    std::vector<BoundingBox<T>> bounds;
+    bounds.reserve(this->store.Size());
+    for (uint32_t primitive = 0; primitive < this->store.Size(); ++primitive) {
+      const Geometry<T> &geometry =
+          *this->geometries[this->store.geometries[primitive]];
+      this->store.Update(primitive, geometry);
+      bounds.push_back(geometry.Bounds());
+    }
+
+    this->hierarchy.Refit(bounds);
+    return *this;
+  }
+
+  /// Refits like Refit(), with the geometry and the hierarchy spread over the
+  /// threads of the given pool.
+  GeometryRegister<T> &Refit(ThreadPool &threadPool) {
+    this->ThrowIfMapped();
+    if (this->dirty.load(std::memory_order_acquire)) {
+      return this->Build();
+    }
+
+    static constexpr size_t chunkSize = 1024;
+    const size_t count = this->store.Size();
+    this->primitiveBounds.resize(count);
+    threadPool.Run((count + chunkSize - 1) / chunkSize,
+                   [this, &count](const size_t &n, const size_t &) {
+                     const size_t end = std::min(count, (n + 1) * chunkSize);
+                     for (size_t primitive = n * chunkSize; primitive < end;
+                          ++primitive) {
+                       const Geometry<T> &geometry =
+                           *this->geometries[this->store.geometries[primitive]];
+                       this->store.Update(static_cast<uint32_t>(primitive),
+                                          geometry);
+                       this->primitiveBounds[primitive] = geometry.Bounds();
+                     }
+                   });
+
+    this->hierarchy.Refit(this->primitiveBounds, threadPool);
+    return *this;
+  }
+
+  /// Refits the hierarchy in parallel after geometry has moved, unless that
+  /// made it more than the given factor slower to traverse than right after
+  /// the last build, in which case it's rebuilt. Gets if it was rebuilt.
+  bool RefitOrBuild(ThreadPool &threadPool,
+                    const T &maximumDegradation = static_cast<T>(1.5)) {
+    if (this->dirty.load(std::memory_order_acquire)) {
+      this->Build();
+      return true;
+    }
+
+    this->Refit(threadPool);
+    if (this->hierarchy.Cost() > maximumDegradation * this->builtCost) {
+      this->Build();
+      return true;
+    }
+
+    return false;
+  }
+
+  /// Gets how much slower the hierarchy is to traverse than right after the
+  /// last build, by the surface area heuristic. See RefitOrBuild().
+  inline T Degradation() const noexcept {
+    return this->builtCost > static_cast<T>(0.0)
+               ? this->hierarchy.Cost() / this->builtCost
+               : static_cast<T>(1.0);
+  }
+
+  /// Gets the bounds of all the registered geometry.
+  BoundingBox<T> Bounds() {
+    this->BuildIfDirty();
+    if (this->hierarchy.nodes.empty()) {
+      return BoundingBox<T>();
+    }
+
+    return this->hierarchy.nodes[0].bounds;
+  }
+
   /// Casts an ray against all the geometry in the register, and returns a
-  /// possible hit.
+  /// possible hit. This is kept for callers which want the geometry itself,
+  /// the ray casters use ClosestHit().
   std::optional<std::tuple<std::shared_ptr<Geometry<T>>, RayHitResult<T>>>
   CastRay(const Ray<T> &ray) {
-    std::optional<RayHitResult<T>> nearestHitResult = std::nullopt;
-    std::optional<std::shared_ptr<Geometry<T>>> nearestGeometry =
-        std::nullopt;
+    this->ThrowIfMapped();
+    const std::optional<HitRecord<T>> hit = this->ClosestHit(ray);
+    if (!hit.has_value()) {
+      return std::nullopt;
+    }
 
-    // Loops over all the pieces of geometry, and performs the ray casting on
-    // them.
-    std::for_each(this->geometries.begin(), this->geometries.end(),
-                  [&](std::shared_ptr<Geometry<T>> geometry) {
-                    // Checks if the casted ray hits the object.
-                    std::optional<RayHitResult<T>> hitResult =
-                        geometry->RayHit(ray);
-
-                    // If the casted ray did not hit the object, simply return.
-                    if (!hitResult.has_value()) {
-                      return;
-                    }
-
-                    // If there is no existing hit result, set this one as the
-                    // new result.
-                    if (!nearestHitResult.has_value()) {
-                      nearestHitResult = hitResult;
-                      nearestGeometry = geometry;
-                      return;
-                    }
-
-                    // Since there already is an nearest hit result, only modify
-                    // it if the current hit is closer to the origin of the ray.
-                    if (hitResult->distance < nearestHitResult->distance) {
-                      nearestHitResult = hitResult;
-                      nearestGeometry = geometry;
-                      return;
-                    }
-                  });
+    return std::tuple(this->geometries[this->store.geometries[hit->primitive]],
+                      RayHitResult<T>(hit->Point(ray), hit->normal,
+                                      hit->distance));
+  }
+
+  /// Finds the nearest primitive the ray hits, without allocating or touching
+  /// any reference counts. The work done is counted in the profile, if given.
+  std::optional<HitRecord<T>> ClosestHit(const Ray<T> &ray,
+                                         ThreadProfile *profile = nullptr) {
+    this->BuildIfDirty();
+
+    std::optional<uint32_t> nearestPrimitive = std::nullopt;
+    Vector3D<T> nearestNormal(0.0, 0.0, 0.0);
+    uint32_t nearestMaterial = 0;
+    uint64_t intersectionTests = 0, nodesVisited = 0;
+
+    // Traverses the hierarchy, only the geometry in the leaves the ray passes
+    // through will be tested, nearest first.
+    T tMax = std::numeric_limits<T>::infinity();
+    this->hierarchy.Traverse(
+        ray, static_cast<T>(0.0), tMax,
+        [&](const uint32_t &primitive, T &nearestDistance) -> bool {
+          // Checks if the casted ray hits the primitive, and if it's closer to
+          // the origin of the ray than the nearest hit so far. Of primitives
+          // hit at the same distance the one with the lowest store index
+          // wins, which after Build() is their order in the leaves and not
+          // the order they were registered in. Either way the order they're
+          // visited in doesn't matter.
+          ++intersectionTests;
+          Vector3D<T> normal(0.0, 0.0, 0.0);
+          uint32_t material = 0;
+          const std::optional<T> distance =
+              this->store.Intersect(primitive, ray, &normal, &material);
+          if (!distance.has_value() || *distance > nearestDistance ||
+              (*distance == nearestDistance && nearestPrimitive.has_value() &&
+               primitive > *nearestPrimitive)) {
+            return false;
+          }
+
+          nearestDistance = *distance;
+          nearestPrimitive = primitive;
+          nearestNormal = normal;
+          nearestMaterial = material;
+          return true;
+        },
+        &nodesVisited);
+
+    if (profile != nullptr) {
+      profile->Count(ProfileCounter::IntersectionTests, intersectionTests)
+          .Count(ProfileCounter::NodesVisited, nodesVisited);
+    }
 
     // Checks if there is any result in the first place.
-    if (!nearestHitResult.has_value() || !nearestGeometry.has_value()) {
+    if (!nearestPrimitive.has_value()) {
+      return std::nullopt;
+    }
+
+    // Returns the nearest hit result, the surface found while intersecting is
+    // only used for the primitives which can't compute it afterwards.
+    if (this->store.types[*nearestPrimitive] != PrimitiveType::Sphere) {
+      return HitRecord<T>(*nearestPrimitive, tMax, nearestNormal,
+                          nearestMaterial);
+    }
+
+    return this->Hit(ray, *nearestPrimitive, tMax);
+  }
+
+  /// Casts all the rays in the packet, the nodes of the hierarchy are visited
+  /// if any of the rays hits them. Afterwards the packet contains the nearest
+  /// distance and geometry of every lane, which PacketHit() turns into the same
+  /// result ClosestHit() would give for that ray.
+  GeometryRegister<T> &CastPacket(RayPacket<T> &packet,
+                                  ThreadProfile *profile = nullptr) {
+    this->BuildIfDirty();
+
+    const FlatArray<BoundingVolumeNode<T>> &nodes = this->hierarchy.nodes;
+    if (nodes.empty() || packet.count == 0) {
+      return *this;
+    }
+
+    // Calculates the inverse directions of all the rays once.
+    alignas(64) T inverseX[RayPacket<T>::size];
+    alignas(64) T inverseY[RayPacket<T>::size];
+    alignas(64) T inverseZ[RayPacket<T>::size];
+    Invert(packet, inverseX, inverseY, inverseZ);
+
+    uint32_t stack[BoundingVolumeHierarchy<T>::maxDepth * 2];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    uint64_t intersectionTests = 0, nodesVisited = 0;
+
+    while (stackSize != 0) {
+      const BoundingVolumeNode<T> &node = nodes[stack[--stackSize]];
+      if (!AnyHit(packet, inverseX, inverseY, inverseZ, node.bounds)) {
+        continue;
+      }
+      ++nodesVisited;
+
+      // Intersects the primitives in the leaf, spheres are done for the entire
+      // packet at once while the others fall back to the per ray path.
+      if (node.Leaf()) {
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+          this->store.IntersectPacket(this->hierarchy.indices[i], packet);
+        }
+        intersectionTests += node.count * packet.count;
+
+        continue;
+      }
+
+      // Visits the child which is nearest along the direction of the first ray
+      // first, the rays are coherent so this is good enough for the others.
+      const Vector3D<T> leftCentroid = nodes[node.first].bounds.Centroid();
+      const Vector3D<T> rightCentroid = nodes[node.first + 1].bounds.Centroid();
+      const Vector3D<T> separation = rightCentroid.Subtract(leftCentroid);
+      const T along = separation.x * packet.directionX[0] +
+                      separation.y * packet.directionY[0] +
+                      separation.z * packet.directionZ[0];
+
+      stack[stackSize++] = along >= 0.0 ? node.first + 1 : node.first;
+      stack[stackSize++] = along >= 0.0 ? node.first : node.first + 1;
+    }
+
+    if (profile != nullptr) {
+      profile->Count(ProfileCounter::IntersectionTests, intersectionTests)
+          .Count(ProfileCounter::NodesVisited, nodesVisited);
+    }
+
+    return *this;
+  }
+
+  /// Gets the result of the given lane of an packet cast with CastPacket().
+  std::optional<HitRecord<T>> PacketHit(const RayPacket<T> &packet,
+                                        const size_t &lane) const {
+    if (packet.geometry[lane] == RayPacket<T>::noGeometry) {
       return std::nullopt;
     }
 
-    // Returns the nearest hit result, may be nullopt if nothing was hit.
-    return std::tuple(*nearestGeometry, *nearestHitResult);
+    return this->Hit(packet.At(lane), packet.geometry[lane],
+                     packet.distance[lane]);
+  }
+
+  /// Checks if anything blocks the ray within the given distance, which is
+  /// much cheaper than finding the nearest hit since the traversal ends at the
+  /// first hit. The work done is counted in the profile, if given.
+  bool Occluded(const Ray<T> &ray, const T &maxDistance,
+                ThreadProfile *profile = nullptr) {
+    this->BuildIfDirty();
+
+    uint64_t intersectionTests = 0, nodesVisited = 0;
+    const bool occluded = this->hierarchy.Occluded(
+        ray, static_cast<T>(0.0), maxDistance,
+        [&](const uint32_t &primitive) -> bool {
+          ++intersectionTests;
+          return this->store.Occludes(primitive, ray, maxDistance);
+        },
+        &nodesVisited);
+
+    if (profile != nullptr) {
+      profile->Count(ProfileCounter::IntersectionTests, intersectionTests)
+          .Count(ProfileCounter::NodesVisited, nodesVisited);
+    }
+
+    return occluded;
+  }
+
+  /// Checks all the rays in the packet like Occluded(), the distance of every
+  /// lane being the one within which it's blocked. Afterwards the lanes which
+  /// are blocked have an geometry, which is whatever blocks them. Lanes drop
+  /// out of the traversal once they're blocked, and it ends once all of them
+  /// are. The results are the same as those of Occluded() for every lane.
+  GeometryRegister<T> &OccludedPacket(RayPacket<T> &packet,
+                                      ThreadProfile *profile = nullptr) {
+    this->BuildIfDirty();
+
+    const FlatArray<BoundingVolumeNode<T>> &nodes = this->hierarchy.nodes;
+    if (nodes.empty() || packet.count == 0) {
+      return *this;
+    }
+
+    alignas(64) T inverseX[RayPacket<T>::size];
+    alignas(64) T inverseY[RayPacket<T>::size];
+    alignas(64) T inverseZ[RayPacket<T>::size];
+    Invert(packet, inverseX, inverseY, inverseZ);
+
+    uint32_t stack[BoundingVolumeHierarchy<T>::maxDepth * 2];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    size_t open = packet.count;
+    uint64_t intersectionTests = 0, nodesVisited = 0;
+
+    while (stackSize != 0 && open != 0) {
+      const BoundingVolumeNode<T> &node = nodes[stack[--stackSize]];
+      if (!AnyHit(packet, inverseX, inverseY, inverseZ, node.bounds)) {
+        continue;
+      }
+      ++nodesVisited;
+
+      if (!node.Leaf()) {
+        stack[stackSize++] = node.first + 1;
+        stack[stackSize++] = node.first;
+        continue;
+      }
+
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        this->store.OccludesPacket(this->hierarchy.indices[i], packet);
+      }
+      intersectionTests += node.count * open;
+
+      // The lanes which are blocked now get an distance no box or primitive
+      // is ever within.
+      open = 0;
+      for (size_t lane = 0; lane < packet.count; ++lane) {
+        if (packet.geometry[lane] != RayPacket<T>::noGeometry) {
+          packet.distance[lane] = -std::numeric_limits<T>::infinity();
+        } else {
+          ++open;
+        }
+      }
+    }
+
+    if (profile != nullptr) {
+      profile->Count(ProfileCounter::IntersectionTests, intersectionTests)
+          .Count(ProfileCounter::NodesVisited, nodesVisited);
+    }
+
+    return *this;
+  }
+
+  /// Rebuilds the hierarchy if geometry has been registered since the last
+  /// build, the ray casters may all get here at the same time.
+  inline void BuildIfDirty() {
+    if (this->dirty.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lock(this->buildMutex);
+      if (this->dirty.load(std::memory_order_acquire)) {
+        this->Build();
+      }
+    }
+  }
+
+  /// Gets the material an hit refers to.
+  inline const Material<T> &HitMaterial(const HitRecord<T> &hit) const noexcept {
+    return this->store.materials[hit.material];
   }
 
   ~GeometryRegister<T>() = default;
+
+private:
+  /// Calculates the inverse directions of all the lanes of the packet, the
+  /// unused ones included so the box test can load whole registers.
+  static inline void Invert(const RayPacket<T> &packet, T *inverseX,
+                            T *inverseY, T *inverseZ) noexcept {
+    for (size_t lane = 0; lane < RayPacket<T>::size; ++lane) {
+      inverseX[lane] = static_cast<T>(1.0) / packet.directionX[lane];
+      inverseY[lane] = static_cast<T>(1.0) / packet.directionY[lane];
+      inverseZ[lane] = static_cast<T>(1.0) / packet.directionZ[lane];
+    }
+  }
+
+  /// Checks if any of the rays of the packet hits the given box before their
+  /// distance. This is BoundingBox::Intersect() on several lanes at once, the
+  /// minimum and maximum are selects so NaNs come out the same as with
+  /// std::min() and std::max().
+  static inline bool AnyHit(const RayPacket<T> &packet, const T *inverseX,
+                            const T *inverseY, const T *inverseZ,
+                            const BoundingBox<T> &bounds) noexcept {
+    using S = Simd<T>;
+    const auto minimum = [](const typename S::Register &a,
+                            const typename S::Register &b) {
+      return S::Select(S::Less(b, a), b, a);
+    };
+    const auto maximum = [](const typename S::Register &a,
+                            const typename S::Register &b) {
+      return S::Select(S::Less(a, b), b, a);
+    };
+
+    const typename S::Register zero = S::Set(static_cast<T>(0.0));
+    const typename S::Register minX = S::Set(bounds.min.x);
+    const typename S::Register minY = S::Set(bounds.min.y);
+    const typename S::Register minZ = S::Set(bounds.min.z);
+    const typename S::Register maxX = S::Set(bounds.max.x);
+    const typename S::Register maxY = S::Set(bounds.max.y);
+    const typename S::Register maxZ = S::Set(bounds.max.z);
+
+    for (size_t lane = 0; lane < packet.count; lane += S::width) {
+      const typename S::Register originX = S::Load(packet.originX + lane);
+      const typename S::Register originY = S::Load(packet.originY + lane);
+      const typename S::Register originZ = S::Load(packet.originZ + lane);
+      const typename S::Register inverseDirectionX = S::Load(inverseX + lane);
+      const typename S::Register inverseDirectionY = S::Load(inverseY + lane);
+      const typename S::Register inverseDirectionZ = S::Load(inverseZ + lane);
+
+      const typename S::Register tx1 =
+          S::Mul(S::Sub(minX, originX), inverseDirectionX);
+      const typename S::Register tx2 =
+          S::Mul(S::Sub(maxX, originX), inverseDirectionX);
+      const typename S::Register ty1 =
+          S::Mul(S::Sub(minY, originY), inverseDirectionY);
+      const typename S::Register ty2 =
+          S::Mul(S::Sub(maxY, originY), inverseDirectionY);
+      const typename S::Register tz1 =
+          S::Mul(S::Sub(minZ, originZ), inverseDirectionZ);
+      const typename S::Register tz2 =
+          S::Mul(S::Sub(maxZ, originZ), inverseDirectionZ);
+
+      const typename S::Register tNear =
+          maximum(maximum(minimum(tx1, tx2), minimum(ty1, ty2)),
+                  maximum(minimum(tz1, tz2), zero));
+      const typename S::Register tFar =
+          minimum(minimum(maximum(tx1, tx2), maximum(ty1, ty2)),
+                  minimum(maximum(tz1, tz2), S::Load(packet.distance + lane)));
+
+      // Leaves out the unused lanes, they could be inside of the box.
+      const size_t used = std::min(packet.count - lane, S::width);
+      const uint32_t usedBits =
+          used >= 32 ? ~0u : (1u << static_cast<uint32_t>(used)) - 1u;
+      if ((S::Bits(S::GreaterEqual(tFar, tNear)) & usedBits) != 0) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /// Creates the record of an ray which hits the given primitive at the given
+  /// distance.
+  inline HitRecord<T> Hit(const Ray<T> &ray, const uint32_t &primitive,
+                          const T &distance) const {
+    Vector3D<T> normal(0.0, 0.0, 0.0);
+    uint32_t material = 0;
+    this->store.Surface(primitive, ray, distance, normal, material);
+
+    return HitRecord<T>(primitive, distance, normal, material);
+  }
+
+  /// Throws when the register was loaded from an scene file, the arrays of
+  /// those can't be rebuilt from the registered geometry.
+  inline void ThrowIfMapped() const {
+    if (this->mapping != nullptr) {
+      throw std::logic_error(
+          "An register loaded from an scene file can't be changed");
+    }
+  }
 };
+
+// Instances refer to an register, so they're defined after it. Including it
+// here makes sure the scene store can use them whichever header came first.
+#include "Instance.hpp"
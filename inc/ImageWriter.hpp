@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+#include "FrameBuffer.hpp"
+
+/// Writes frame buffers to disk, without depending on any image library.
+class ImageWriter {
+public:
+  /// Writes an binary PPM (P6), the alpha channel is dropped.
+  static void WritePPM(const FrameBuffer &frameBuffer, const std::string &path);
+
+  /// Writes an RGBA PNG, the image data is stored without compression.
+  static void WritePNG(const FrameBuffer &frameBuffer, const std::string &path);
+
+  /// Writes either an PNG or an PPM, depending on the extension of the path.
+  static void Write(const FrameBuffer &frameBuffer, const std::string &path);
+};
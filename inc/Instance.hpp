@@ -0,0 +1,120 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+
+#include "BoundingBox.hpp"
+#include "Geometry.hpp"
+#include "GeometryRegister.hpp"
+#include "Material.hpp"
+#include "Matrix3D.hpp"
+#include "Ray.hpp"
+#include "Vector3D.hpp"
+
+/// An copy of an group of geometry placed in the scene by an transformation.
+/// The group is an register of its own which is shared by all its instances,
+/// so an instance costs an transformation no matter how large the group is.
+/// Rays are transformed into the space of the group and cast against its own
+/// hierarchy, the register the instances are in is the level above that.
+///
+/// The group has to be built before the register the instances are in, and
+/// that register has to be rebuilt whenever an group changes.
+template <typename T> class Instance : public Geometry<T> {
+public:
+  std::shared_ptr<GeometryRegister<T>> group;
+
+private:
+  AffineMatrix3D<T> transformation;
+  AffineMatrix3D<T> inverse; // From the scene into the space of the group.
+
+public:
+  Instance<T>(std::shared_ptr<GeometryRegister<T>> group,
+              const AffineMatrix3D<T> &transformation)
+      : Geometry<T>::Geometry(transformation.translation,
+                              Material<T>(Vector3D<T>(1.0, 1.0, 1.0), 0.0)),
+        group(group), transformation(transformation),
+        inverse(transformation.Inverse()) {}
+
+  ~Instance<T>() = default;
+
+  inline const AffineMatrix3D<T> &Transformation() const noexcept {
+    return this->transformation;
+  }
+
+  /// Places the group somewhere else, the register the instance is in has to
+  /// be refit afterwards.
+  Instance<T> &Transform(const AffineMatrix3D<T> &transformation) noexcept {
+    this->transformation = transformation;
+    this->inverse = transformation.Inverse();
+    this->position = transformation.translation;
+    return *this;
+  }
+
+  /// Finds the nearest primitive of the group the ray hits. The distance and
+  /// the normal are in the space of the scene, the material is one of the
+  /// group.
+  std::optional<HitRecord<T>> ClosestHit(const Ray<T> &ray) const {
+    // The primitives expect an unit direction, so the distances in the space
+    // of the group are scaled by its length.
+    const Vector3D<T> direction =
+        this->inverse.TransformDirection(ray.direction);
+    const T scale = direction.Magnitude();
+    const Ray<T> localRay(this->inverse.TransformPoint(ray.origin),
+                          direction.Divide(scale));
+
+    std::optional<HitRecord<T>> hit = this->group->ClosestHit(localRay);
+    if (!hit.has_value()) {
+      return std::nullopt;
+    }
+
+    // Normals are transformed by the inverse transpose, so they stay
+    // perpendicular to the surface under non-uniform scaling.
+    hit->distance /= scale;
+    hit->normal =
+        this->inverse.linear.Transpose().Multiply(hit->normal).Normalize();
+    return hit;
+  }
+
+  /// Checks if the ray hits any primitive of the group within the given
+  /// distance, which is scaled into the space of the group.
+  bool Occluded(const Ray<T> &ray, const T &maxDistance) const {
+    const Vector3D<T> direction =
+        this->inverse.TransformDirection(ray.direction);
+    const T scale = direction.Magnitude();
+    const Ray<T> localRay(this->inverse.TransformPoint(ray.origin),
+                          direction.Divide(scale));
+
+    return this->group->Occluded(localRay, maxDistance * scale);
+  }
+
+  virtual bool Occluded(const Ray<T> &ray, const T &maxDistance) {
+    return static_cast<const Instance<T> *>(this)->Occluded(ray, maxDistance);
+  }
+
+  virtual std::optional<RayHitResult<T>> RayHit(const Ray<T> &ray) {
+    const std::optional<HitRecord<T>> hit = this->ClosestHit(ray);
+    if (!hit.has_value()) {
+      return std::nullopt;
+    }
+
+    return RayHitResult<T>(hit->Point(ray), hit->normal, hit->distance);
+  }
+
+  /// Gets the bounds of the transformed bounds of the group.
+  virtual BoundingBox<T> Bounds() const {
+    const BoundingBox<T> groupBounds = this->group->Bounds();
+    if (groupBounds.Empty()) {
+      return groupBounds;
+    }
+
+    BoundingBox<T> bounds;
+    for (size_t corner = 0; corner < 8; ++corner) {
+      bounds.Extend(this->transformation.TransformPoint(Vector3D<T>(
+          corner & 1 ? groupBounds.max.x : groupBounds.min.x,
+          corner & 2 ? groupBounds.max.y : groupBounds.min.y,
+          corner & 4 ? groupBounds.max.z : groupBounds.min.z)));
+    }
+
+    return bounds.Pad();
+  }
+};
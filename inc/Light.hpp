@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "Ray.hpp"
+#include "Vector3D.hpp"
+
+/// The kinds of lights, the numbers are part of the scene file format.
+enum class LightType : uint32_t {
+  Ambient = 0,     // Lights every surface evenly, and casts no shadows.
+  Point = 1,       // Shines in all directions, falls off with the distance.
+  Directional = 2, // Shines in one direction from infinitely far away.
+};
+
+/// An light in the scene. This is plain data, so the lights of an register
+/// can be stored in an scene file as they are.
+template <typename T> class Light {
+public:
+  LightType type;
+  uint32_t reserved;
+  // The position of an point light, or the unit direction an directional light
+  // shines in. Unused for ambient lights.
+  Vector3D<T> vector;
+  Vector3D<T> radiance; // The color, times the intensity.
+
+public:
+  Light<T>(const LightType &type, const Vector3D<T> &vector,
+           const Vector3D<T> &radiance) noexcept
+      : type(type), reserved(0), vector(vector), radiance(radiance) {}
+
+  static Light<T> Ambient(const Vector3D<T> &color, const T &intensity) noexcept {
+    return Light<T>(LightType::Ambient, Vector3D<T>(0.0, 0.0, 0.0),
+                    color * intensity);
+  }
+
+  /// Creates an point light, its intensity is what it gives an surface facing
+  /// it at an distance of one.
+  static Light<T> Point(const Vector3D<T> &position, const Vector3D<T> &color,
+                        const T &intensity) noexcept {
+    return Light<T>(LightType::Point, position, color * intensity);
+  }
+
+  static Light<T> Directional(const Vector3D<T> &direction,
+                              const Vector3D<T> &color,
+                              const T &intensity) noexcept {
+    return Light<T>(LightType::Directional, direction.Normalize(),
+                    color * intensity);
+  }
+
+  /// Gets what this light gives an point on an surface, the normal being the
+  /// one on the side the light has to be on. Sets the shadow ray from the
+  /// point towards the light and the distance within which anything shadows
+  /// it, which is zero for lights that can't be shadowed. Gets false when the
+  /// light doesn't reach the surface at all.
+  inline bool Illuminate(const Vector3D<T> &point, const Vector3D<T> &normal,
+                         Ray<T> &shadow, T &distance,
+                         Vector3D<T> &irradiance) const noexcept {
+    switch (this->type) {
+    case LightType::Ambient:
+      distance = static_cast<T>(0.0);
+      irradiance = this->radiance;
+      return true;
+    case LightType::Point: {
+      const Vector3D<T> toLight = this->vector - point;
+      const T distanceSquared = toLight.LengthSquared();
+      distance = std::sqrt(distanceSquared);
+      const Vector3D<T> direction = toLight * (static_cast<T>(1.0) / distance);
+      const T cosine = normal.Dot(direction);
+      if (!(cosine > static_cast<T>(0.0))) {
+        return false;
+      }
+
+      shadow = Ray<T>(point, direction);
+      irradiance = this->radiance * (cosine / distanceSquared);
+      return true;
+    }
+    case LightType::Directional: {
+      const Vector3D<T> direction = -this->vector;
+      const T cosine = normal.Dot(direction);
+      if (!(cosine > static_cast<T>(0.0))) {
+        return false;
+      }
+
+      distance = std::numeric_limits<T>::infinity();
+      shadow = Ray<T>(point, direction);
+      irradiance = this->radiance * cosine;
+      return true;
+    }
+    }
+
+    return false;
+  }
+
+  ~Light<T>() noexcept = default;
+};
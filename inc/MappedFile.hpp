@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// How an mapped file is going to be read, which tells the operating system
+/// which pages to load ahead of time.
+enum class MappedFileAccess {
+  Sequential, // Front to back, once.
+  Preload,    // All over the place, the entire file is loaded right away.
+};
+
+/// An file mapped into memory, the pages are loaded by the operating system as
+/// they're touched so large files can be streamed without copying them into
+/// buffers first. The mapping is copy-on-write, so the contents can be changed
+/// in memory without ever changing the file. The mapping is released when
+/// this is destroyed.
+class MappedFile {
+private:
+  char *data;
+  size_t size;
+
+public:
+  /// Maps the entire file at the given path, throws if it can't be opened.
+  MappedFile(const std::string &path,
+             const MappedFileAccess &access = MappedFileAccess::Sequential);
+
+  /// Maps an zeroed region of the given size which belongs to no file, for
+  /// data that arrives from elsewhere but is read like an mapped file.
+  explicit MappedFile(const size_t &size);
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /// Gets the contents of the file, this is not null-terminated.
+  inline const char *Data() const noexcept { return this->data; }
+  inline char *Data() noexcept { return this->data; }
+
+  inline size_t Size() const noexcept { return this->size; }
+
+  ~MappedFile();
+};
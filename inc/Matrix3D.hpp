@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cmath>
 #include <iostream>
 
 #include "Vector3D.hpp"
@@ -23,6 +24,34 @@ public:
     );
   }
 
+  /// Gets the product of this and the other matrix, applying it is the same
+  /// as applying the other matrix first and this one second.
+  Matrix3D<T> Multiply(const Matrix3D<T> &other) const noexcept {
+    return Matrix3D<T>(this->Multiply(other.c1), this->Multiply(other.c2),
+                       this->Multiply(other.c3));
+  }
+
+  Matrix3D<T> Transpose() const noexcept {
+    return Matrix3D<T>(Vector3D<T>(this->c1.x, this->c2.x, this->c3.x),
+                       Vector3D<T>(this->c1.y, this->c2.y, this->c3.y),
+                       Vector3D<T>(this->c1.z, this->c2.z, this->c3.z));
+  }
+
+  T Determinant() const noexcept {
+    return this->c1.Dot(this->c2.Cross(this->c3));
+  }
+
+  /// Gets the inverse, the matrix has to be invertible.
+  Matrix3D<T> Inverse() const noexcept {
+    // The rows of the inverse are the cross products of the columns, divided
+    // by the determinant.
+    const T determinant = this->Determinant();
+    return Matrix3D<T>(this->c2.Cross(this->c3).Divide(determinant),
+                       this->c3.Cross(this->c1).Divide(determinant),
+                       this->c1.Cross(this->c2).Divide(determinant))
+        .Transpose();
+  }
+
 public:
   static constexpr Matrix3D<T> Create(const T data[3][3]) noexcept {
     return Matrix3D<T>(Vector3D<T>(data[0][0], data[1][0], data[2][0]),
@@ -30,6 +59,16 @@ public:
                        Vector3D<T>(data[0][2], data[1][2], data[2][2]));
   }
 
+  static Matrix3D<T> Identity() noexcept {
+    return Matrix3D<T>::Scale(Vector3D<T>(1.0, 1.0, 1.0));
+  }
+
+  static Matrix3D<T> Scale(const Vector3D<T> &scale) noexcept {
+    return Matrix3D<T>(Vector3D<T>(scale.x, 0.0, 0.0),
+                       Vector3D<T>(0.0, scale.y, 0.0),
+                       Vector3D<T>(0.0, 0.0, scale.z));
+  }
+
   static Matrix3D<T> Rotation(const Vector3D<T> &angles) noexcept {
     const T &alpha = angles.x; // Yaw
     const T &beta = angles.y;  // Pitch
@@ -52,6 +91,64 @@ public:
   }
 };
 
+/// An affine transformation as an 3x4 matrix: an linear part, followed by an
+/// translation.
+template <typename T> class AffineMatrix3D {
+public:
+  Matrix3D<T> linear;
+  Vector3D<T> translation;
+
+public:
+  AffineMatrix3D<T>(const Matrix3D<T> &linear,
+                    const Vector3D<T> &translation) noexcept
+      : linear(linear), translation(translation) {}
+
+  ~AffineMatrix3D<T>() noexcept = default;
+
+public:
+  Vector3D<T> TransformPoint(const Vector3D<T> &point) const noexcept {
+    return this->linear.Multiply(point).Add(this->translation);
+  }
+
+  /// Transforms an direction, which is not affected by the translation.
+  Vector3D<T> TransformDirection(const Vector3D<T> &direction) const noexcept {
+    return this->linear.Multiply(direction);
+  }
+
+  /// Gets the combined transformation, applying it is the same as applying
+  /// the other transformation first and this one second.
+  AffineMatrix3D<T> Multiply(const AffineMatrix3D<T> &other) const noexcept {
+    return AffineMatrix3D<T>(this->linear.Multiply(other.linear),
+                             this->TransformPoint(other.translation));
+  }
+
+  /// Gets the inverse, the linear part has to be invertible.
+  AffineMatrix3D<T> Inverse() const noexcept {
+    const Matrix3D<T> inverse = this->linear.Inverse();
+    return AffineMatrix3D<T>(inverse,
+                             inverse.Multiply(this->translation).Multiply(-1.0));
+  }
+
+public:
+  static AffineMatrix3D<T> Identity() noexcept {
+    return AffineMatrix3D<T>::Translation(Vector3D<T>(0.0, 0.0, 0.0));
+  }
+
+  static AffineMatrix3D<T> Translation(const Vector3D<T> &offset) noexcept {
+    return AffineMatrix3D<T>(Matrix3D<T>::Identity(), offset);
+  }
+
+  static AffineMatrix3D<T> Rotation(const Vector3D<T> &angles) noexcept {
+    return AffineMatrix3D<T>(Matrix3D<T>::Rotation(angles),
+                             Vector3D<T>(0.0, 0.0, 0.0));
+  }
+
+  static AffineMatrix3D<T> Scale(const Vector3D<T> &scale) noexcept {
+    return AffineMatrix3D<T>(Matrix3D<T>::Scale(scale),
+                             Vector3D<T>(0.0, 0.0, 0.0));
+  }
+};
+
 template<typename T>
 std::ostream &operator << (std::ostream &stream, const Matrix3D<T> &matrix) {
   stream << '{' << std::endl;
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Vector3D.hpp"
+
+/// The triangles of an Wavefront OBJ file, the vertices are shared between the
+/// triangles through indices.
+class ObjMesh {
+public:
+  std::vector<Vector3D<double>> vertices;
+  std::vector<uint32_t> indices; // Three per triangle.
+
+public:
+  inline size_t TriangleCount() const noexcept {
+    return this->indices.size() / 3;
+  }
+};
+
+/// Reads the geometry of Wavefront OBJ files. Only the positions and the faces
+/// are used, polygons are split into fans of triangles and everything else
+/// (normals, texture coordinates, groups, materials) is skipped.
+class ObjLoader {
+public:
+  /// Maps the file into memory and parses it, throws when it can't be read or
+  /// is malformed.
+  static ObjMesh Load(const std::string &path);
+
+  /// Parses the given contents of an OBJ file, line by line without copying
+  /// them or allocating anything per line.
+  static ObjMesh Parse(const char *data, const size_t &size);
+};
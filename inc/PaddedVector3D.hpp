@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "Simd.hpp"
+#include "Vector3D.hpp"
+
+/// The four lane registers behind PaddedVector3D. The minimum and maximum have
+/// the exact semantics of std::min() and std::max(), NaNs included, so the
+/// kernels built on them match their scalar versions bit for bit. The generic
+/// version is plain arrays, which the compiler vectorizes where it can.
+template <typename T> class Quad {
+public:
+  class Register {
+  public:
+    T lanes[4];
+  };
+
+public:
+  static inline Register Set(const T &x, const T &y, const T &z,
+                             const T &w) noexcept {
+    return Register{{x, y, z, w}};
+  }
+
+  static inline void Store(T *data, const Register &a) noexcept {
+    std::copy(a.lanes, a.lanes + 4, data);
+  }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return Quad<T>::Apply(a, b, [](const T &a, const T &b) { return a + b; });
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return Quad<T>::Apply(a, b, [](const T &a, const T &b) { return a - b; });
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return Quad<T>::Apply(a, b, [](const T &a, const T &b) { return a * b; });
+  }
+  static inline Register Min(const Register &a, const Register &b) noexcept {
+    return Quad<T>::Apply(a, b,
+                          [](const T &a, const T &b) { return std::min(a, b); });
+  }
+  static inline Register Max(const Register &a, const Register &b) noexcept {
+    return Quad<T>::Apply(a, b,
+                          [](const T &a, const T &b) { return std::max(a, b); });
+  }
+
+private:
+  template <typename F>
+  static inline Register Apply(const Register &a, const Register &b,
+                               F &&operation) noexcept {
+    Register result;
+    for (size_t lane = 0; lane < 4; ++lane) {
+      result.lanes[lane] = operation(a.lanes[lane], b.lanes[lane]);
+    }
+
+    return result;
+  }
+};
+
+#if defined(__SSE2__)
+
+template <> class Quad<float> {
+public:
+  using Register = __m128;
+
+public:
+  static inline Register Set(const float &x, const float &y, const float &z,
+                             const float &w) noexcept {
+    return _mm_setr_ps(x, y, z, w);
+  }
+
+  static inline void Store(float *data, const Register &a) noexcept {
+    _mm_storeu_ps(data, a);
+  }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return _mm_add_ps(a, b);
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return _mm_sub_ps(a, b);
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return _mm_mul_ps(a, b);
+  }
+  // The instructions give their second operand when either is NaN, so the
+  // operands are swapped to get b < a ? b : a like std::min().
+  static inline Register Min(const Register &a, const Register &b) noexcept {
+    return _mm_min_ps(b, a);
+  }
+  static inline Register Max(const Register &a, const Register &b) noexcept {
+    return _mm_max_ps(b, a);
+  }
+};
+
+#elif defined(__ARM_NEON)
+
+template <> class Quad<float> {
+public:
+  using Register = float32x4_t;
+
+public:
+  static inline Register Set(const float &x, const float &y, const float &z,
+                             const float &w) noexcept {
+    const float lanes[4] = {x, y, z, w};
+    return vld1q_f32(lanes);
+  }
+
+  static inline void Store(float *data, const Register &a) noexcept {
+    vst1q_f32(data, a);
+  }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return vaddq_f32(a, b);
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return vsubq_f32(a, b);
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return vmulq_f32(a, b);
+  }
+  // The NEON minimum and maximum give NaN when either is NaN, so these are
+  // selects to match std::min() and std::max().
+  static inline Register Min(const Register &a, const Register &b) noexcept {
+    return vbslq_f32(vcltq_f32(b, a), b, a);
+  }
+  static inline Register Max(const Register &a, const Register &b) noexcept {
+    return vbslq_f32(vcltq_f32(a, b), b, a);
+  }
+};
+
+#endif
+
+#if defined(__AVX__)
+
+template <> class Quad<double> {
+public:
+  using Register = __m256d;
+
+public:
+  static inline Register Set(const double &x, const double &y,
+                             const double &z, const double &w) noexcept {
+    return _mm256_setr_pd(x, y, z, w);
+  }
+
+  static inline void Store(double *data, const Register &a) noexcept {
+    _mm256_storeu_pd(data, a);
+  }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return _mm256_add_pd(a, b);
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return _mm256_sub_pd(a, b);
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return _mm256_mul_pd(a, b);
+  }
+  static inline Register Min(const Register &a, const Register &b) noexcept {
+    return _mm256_min_pd(b, a);
+  }
+  static inline Register Max(const Register &a, const Register &b) noexcept {
+    return _mm256_max_pd(b, a);
+  }
+};
+
+#endif
+
+/// An vector of three components padded to four lanes, so it's held in an
+/// single register: 128 bits for float, and 256 bits for double when the
+/// target has AVX. This is the layout for the scalar kernels which do the same
+/// thing on all three axes, like the slab test of an box. The fourth lane is
+/// padding, its value is up to whoever creates the vector.
+template <typename T> class alignas(4 * sizeof(T)) PaddedVector3D {
+public:
+  using Q = Quad<T>;
+  typename Q::Register value;
+
+public:
+  PaddedVector3D<T>(const typename Q::Register &value) noexcept
+      : value(value) {}
+
+  PaddedVector3D<T>(const T &x, const T &y, const T &z,
+                    const T &w = static_cast<T>(0.0)) noexcept
+      : value(Q::Set(x, y, z, w)) {}
+
+  explicit PaddedVector3D<T>(const Vector3D<T> &vector,
+                             const T &w = static_cast<T>(0.0)) noexcept
+      : value(Q::Set(vector.x, vector.y, vector.z, w)) {}
+
+  inline PaddedVector3D<T> operator+(const PaddedVector3D<T> &other) const
+      noexcept {
+    return Q::Add(this->value, other.value);
+  }
+
+  inline PaddedVector3D<T> operator-(const PaddedVector3D<T> &other) const
+      noexcept {
+    return Q::Sub(this->value, other.value);
+  }
+
+  inline PaddedVector3D<T> operator*(const PaddedVector3D<T> &other) const
+      noexcept {
+    return Q::Mul(this->value, other.value);
+  }
+
+  /// Gets the minimum of every lane, like std::min() on each of them.
+  static inline PaddedVector3D<T> Min(const PaddedVector3D<T> &a,
+                                      const PaddedVector3D<T> &b) noexcept {
+    return Q::Min(a.value, b.value);
+  }
+
+  /// Gets the maximum of every lane, like std::max() on each of them.
+  static inline PaddedVector3D<T> Max(const PaddedVector3D<T> &a,
+                                      const PaddedVector3D<T> &b) noexcept {
+    return Q::Max(a.value, b.value);
+  }
+
+  /// Gets the three components, the padding is written to the fourth.
+  inline void Store(T *lanes) const noexcept { Q::Store(lanes, this->value); }
+
+  /// Gets the dot product of the first three lanes, summed in the same order
+  /// as Vector3D::Dot() so the results are the same.
+  inline T Dot(const PaddedVector3D<T> &other) const noexcept {
+    T lanes[4];
+    Q::Store(lanes, Q::Mul(this->value, other.value));
+    return lanes[0] + lanes[1] + lanes[2];
+  }
+
+  inline Vector3D<T> Unpad() const noexcept {
+    T lanes[4];
+    Q::Store(lanes, this->value);
+    return Vector3D<T>(lanes[0], lanes[1], lanes[2]);
+  }
+
+  ~PaddedVector3D<T>() noexcept = default;
+};
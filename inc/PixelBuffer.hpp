@@ -3,7 +3,7 @@
 #include <cstdint>
 #include <gtk/gtk.h>
 
-#include "Vector3D.hpp"
+#include "FrameBuffer.hpp"
 
 class PixelBuffer {
 public:
@@ -15,6 +15,10 @@ public:
   PixelBuffer &PutPixel(const int &x, const int &y, const uint8_t r,
                         const uint8_t g, const uint8_t b, const uint8_t a);
 
+  /// Copies the contents of the given frame buffer, which must have the same
+  /// size, so it can be shown by GTK.
+  PixelBuffer &Upload(const FrameBuffer &frameBuffer);
+
   inline PixelBuffer &Fill(const uint8_t r, const uint8_t g, const uint8_t b,
                            const uint8_t a) {
     gdk_pixbuf_fill(this->pixelBuffer, static_cast<uint32_t>(r) << 24 |
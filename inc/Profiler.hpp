@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "Tile.hpp"
+
+/// The events the profiler counts.
+enum class ProfileCounter : size_t {
+  Rays,              // Rays cast into the scene, primary and reflected.
+  Bounces,           // Rays which hit something and were reflected.
+  IntersectionTests, // Ray-primitive tests, an packet counts every lane.
+  NodesVisited,      // Nodes of the hierarchy entered, an packet counts once.
+  Terminations,      // Paths stopped early, by their reflectivity.
+  ShadowRays,        // Rays cast towards the lights, to check for shadows.
+  Count,
+};
+
+/// The stages of an render the profiler times.
+enum class ProfileStage : size_t {
+  Generation,        // Generating the primary rays.
+  Traversal,         // Finding the nearest hits.
+  Shading,           // Mixing the colors, and reflecting the rays.
+  Shadows,           // Casting the shadow rays, and lighting the hits.
+  FrameBufferWrites, // Flushing the tiles to the frame buffer.
+  Count,
+};
+
+/// An tile as rendered by an thread, for the timeline.
+class TileEvent {
+public:
+  Tile tile;
+  uint64_t startNanoseconds, endNanoseconds; // Since the start of the frame.
+  uint64_t rays;
+  uint64_t nodesVisited;
+
+public:
+  TileEvent(const Tile &tile, const uint64_t &startNanoseconds,
+            const uint64_t &endNanoseconds, const uint64_t &rays,
+            const uint64_t &nodesVisited) noexcept
+      : tile(tile), startNanoseconds(startNanoseconds),
+        endNanoseconds(endNanoseconds), rays(rays), nodesVisited(nodesVisited) {}
+
+  ~TileEvent() noexcept = default;
+};
+
+/// The counters of an single thread, only that thread writes to them so no
+/// locks or atomics are needed. Aligned so the threads never write to the same
+/// cache line.
+class alignas(64) ThreadProfile {
+public:
+  static constexpr size_t counterCount =
+      static_cast<size_t>(ProfileCounter::Count);
+  static constexpr size_t stageCount = static_cast<size_t>(ProfileStage::Count);
+
+  uint64_t counters[counterCount];
+  uint64_t stageNanoseconds[stageCount];
+  std::vector<TileEvent> tiles;
+
+public:
+  ThreadProfile() noexcept : counters(), stageNanoseconds(), tiles() {}
+
+  inline ThreadProfile &Count(const ProfileCounter &counter,
+                              const uint64_t &amount = 1) noexcept {
+    this->counters[static_cast<size_t>(counter)] += amount;
+    return *this;
+  }
+
+  inline uint64_t Counter(const ProfileCounter &counter) const noexcept {
+    return this->counters[static_cast<size_t>(counter)];
+  }
+
+  /// Adds the time since the given start to the stage, and returns the current
+  /// time so consecutive stages can be chained.
+  uint64_t Time(const ProfileStage &stage, const uint64_t &start) noexcept;
+
+  /// Clears the counters, and makes room for the given number of tiles so
+  /// recording them does not allocate.
+  ThreadProfile &Reset(const size_t &tileCount);
+
+  ~ThreadProfile() = default;
+};
+
+/// Measures where the time of an frame goes. The ray casters count into the
+/// profile of the thread they run on, the profiles are only merged once the
+/// frame is done.
+class Profiler {
+public:
+  std::vector<ThreadProfile> threads;
+  uint64_t startNanoseconds, endNanoseconds; // Of the last frame.
+
+public:
+  Profiler() noexcept : threads(), startNanoseconds(0), endNanoseconds(0) {}
+
+  /// Starts an frame rendered by the given number of threads.
+  Profiler &Begin(const size_t &threadCount, const size_t &tileCount);
+
+  Profiler &End();
+
+  inline ThreadProfile &Thread(const size_t &thread) noexcept {
+    return this->threads[thread];
+  }
+
+  /// Gets the sum of an counter over all the threads.
+  uint64_t Total(const ProfileCounter &counter) const noexcept;
+
+  /// Gets the sum of the time spent in an stage over all the threads.
+  uint64_t TotalNanoseconds(const ProfileStage &stage) const noexcept;
+
+  /// Writes the totals and the per-thread counters of the last frame.
+  const Profiler &WriteJSON(std::ostream &stream) const;
+
+  /// Writes the tiles of the last frame in the Trace Event Format, which can
+  /// be opened with chrome://tracing or Perfetto.
+  const Profiler &WriteChromeTrace(std::ostream &stream) const;
+
+  /// Gets an monotonic timestamp.
+  static uint64_t Now() noexcept;
+
+  ~Profiler() = default;
+};
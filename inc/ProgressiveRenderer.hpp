@@ -0,0 +1,373 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "RayCaster.hpp"
+#include "ThreadPool.hpp"
+#include "Tile.hpp"
+#include "TileBuffer.hpp"
+#include "TileCache.hpp"
+#include "Vector3D.hpp"
+
+/// Describes an pass of the progressive renderer which has just finished.
+class ProgressivePass {
+public:
+  size_t index;        // The number of the pass since the last restart.
+  size_t blockSize;    // The pixels share one sample in blocks of this size.
+  size_t samples;      // The samples per pixel so far, zero while coarse.
+  double milliseconds; // The time since the last restart.
+  TileCacheUpdate tiles; // The tiles kept from before the last restart.
+};
+
+/// Renders an view in passes on an background thread, first coarse ones where
+/// blocks of pixels share one sample, then full resolution ones which keep
+/// accumulating samples at different positions within the pixels. Restarting
+/// with another camera cancels the pass in flight, the tiles which have not
+/// been started yet are skipped.
+///
+/// The tiles are cached between restarts. The tiles the camera and the scene
+/// look the same in keep their samples, and only the others are rendered
+/// again, from the coarse passes on. See TileCache.
+template <typename T> class ProgressiveRenderer {
+public:
+  using PassCallback = std::function<void(const ProgressivePass &)>;
+
+  static constexpr size_t coarseBlockSizes[] = {4, 2};
+
+private:
+  ThreadPool &threadPool;
+  std::shared_ptr<GeometryRegister<T>> geometryRegister;
+  size_t maximumSamples;
+  PathTermination termination;
+  PassCallback passCallback;
+
+  // Only touched by the background thread and the tiles it renders.
+  FrameBuffer working;
+  std::vector<float> accumulation; // The sums of the samples, RGB.
+  std::vector<Tile> tiles;
+  std::vector<TileBuffer> tileBuffers;
+  TileCache<T> cache;
+  std::vector<size_t> tileSamples; // Zero while coarse.
+
+  // The latest finished pass.
+  FrameBuffer result;
+  mutable std::mutex resultMutex;
+
+  // The camera and the state of the background thread, guarded by mutex. The
+  // generation is bumped by every restart, the tiles compare it to the one
+  // they were started with. The background thread holds the render mutex
+  // while it renders, the scene is only edited while it doesn't.
+  Camera<T> camera;
+  std::atomic<uint64_t> generation;
+  uint64_t finishedGeneration;
+  bool stopping, editing;
+  std::mutex mutex, renderMutex;
+  std::condition_variable condition;
+
+  std::thread thread;
+
+public:
+  /// Starts rendering the view of the given camera right away, the callback
+  /// is called from the background thread after every pass. The paths stop as
+  /// given, see PathTermination.
+  ProgressiveRenderer<T>(ThreadPool &threadPool,
+                         std::shared_ptr<GeometryRegister<T>> geometryRegister,
+                         const Camera<T> &camera, const size_t &maximumSamples,
+                         PassCallback passCallback,
+                         const PathTermination &termination = PathTermination())
+      : threadPool(threadPool), geometryRegister(geometryRegister),
+        maximumSamples(maximumSamples), termination(termination),
+        passCallback(passCallback),
+        working(camera.viewportWidth, camera.viewportHeight),
+        accumulation(camera.RayCount() * 3, 0.0f),
+        tiles(Tile::Split(camera.viewportWidth, camera.viewportHeight,
+                          RayCaster<T>::tileSize)),
+        tileBuffers(),
+        cache(camera.viewportWidth, camera.viewportHeight,
+              RayCaster<T>::tileSize),
+        tileSamples(this->tiles.size(), 0),
+        result(camera.viewportWidth, camera.viewportHeight), camera(camera),
+        generation(1), finishedGeneration(0), stopping(false), editing(false),
+        mutex(), renderMutex(), condition(), thread() {
+    this->thread = std::thread(&ProgressiveRenderer<T>::Work, this);
+  }
+
+  ProgressiveRenderer<T>(const ProgressiveRenderer<T> &) = delete;
+  ProgressiveRenderer<T> &operator=(const ProgressiveRenderer<T> &) = delete;
+
+  /// Cancels the current render, and starts over with the given camera. The
+  /// viewport has to stay the same.
+  ProgressiveRenderer<T> &Restart(const Camera<T> &camera) {
+    if (camera.viewportWidth != this->working.width ||
+        camera.viewportHeight != this->working.height) {
+      throw std::runtime_error("The viewport of an progressive render is fixed.");
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->camera = camera;
+      ++this->generation;
+    }
+
+    this->condition.notify_one();
+    return *this;
+  }
+
+  /// Cancels the current render, changes the scene once the render has
+  /// stopped, and starts over. Only the tiles the change can be seen in are
+  /// rendered again. The edit has to refit or rebuild the register.
+  ProgressiveRenderer<T> &
+  Edit(const std::function<void(GeometryRegister<T> &)> &edit) {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->editing = true;
+      ++this->generation;
+    }
+
+    const auto restart = [this]() {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->editing = false;
+        ++this->generation;
+      }
+      this->condition.notify_one();
+    };
+
+    try {
+      std::lock_guard<std::mutex> lock(this->renderMutex);
+      edit(*this->geometryRegister);
+    } catch (...) {
+      restart();
+      throw;
+    }
+
+    restart();
+    return *this;
+  }
+
+  /// Copies the latest finished pass into the given frame buffer.
+  const ProgressiveRenderer<T> &CopyResult(FrameBuffer &frameBuffer) const {
+    std::lock_guard<std::mutex> lock(this->resultMutex);
+    if (frameBuffer.width != this->result.width ||
+        frameBuffer.height != this->result.height) {
+      throw std::runtime_error("Frame buffer size does not match the render.");
+    }
+
+    frameBuffer.pixels = this->result.pixels;
+    return *this;
+  }
+
+  ~ProgressiveRenderer<T>() {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stopping = true;
+      ++this->generation;
+    }
+
+    this->condition.notify_one();
+    this->thread.join();
+  }
+
+private:
+  /// The background thread, renders the view of the camera until it has all
+  /// its samples or the renderer is restarted.
+  void Work() {
+    for (;;) {
+      std::optional<std::tuple<Camera<T>, uint64_t>> next = this->Wait();
+      if (!next.has_value()) {
+        return;
+      }
+
+      Camera<T> &camera = std::get<0>(*next);
+      const uint64_t &generation = std::get<1>(*next);
+
+      try {
+        std::lock_guard<std::mutex> lock(this->renderMutex);
+        this->Render(camera, generation);
+      } catch (const std::exception &exception) {
+        // There is nobody to rethrow to, so gives up on this view.
+        std::cerr << "Progressive render failed: " << exception.what()
+                  << std::endl;
+      }
+
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (this->generation.load() == generation) {
+        this->finishedGeneration = generation;
+      }
+    }
+  }
+
+  /// Waits until there is something to render, gets nullopt when stopping.
+  std::optional<std::tuple<Camera<T>, uint64_t>> Wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->condition.wait(lock, [this]() {
+      return this->stopping ||
+             (!this->editing &&
+              this->generation.load() != this->finishedGeneration);
+    });
+
+    if (this->stopping) {
+      return std::nullopt;
+    }
+
+    return std::make_tuple(this->camera, this->generation.load());
+  }
+
+  /// Renders all the passes of an view, stops at the first one which has
+  /// been cancelled. The tiles the cache kept skip the passes they've had.
+  void Render(Camera<T> &camera, const uint64_t &generation) {
+    const auto startTime = std::chrono::steady_clock::now();
+    RayCaster<T> rayCaster(this->working, camera, this->geometryRegister);
+    rayCaster.Terminate(this->termination);
+    while (this->tileBuffers.size() < this->threadPool.ThreadCount()) {
+      this->tileBuffers.emplace_back(RayCaster<T>::tileSize);
+    }
+
+    for (const size_t &n : this->cache.Update(camera, *this->geometryRegister,
+                                             this->termination)) {
+      this->tileSamples[n] = 0;
+    }
+
+    size_t index = 0;
+    const auto pass = [&](const size_t &blockSize,
+                          const size_t &samples) -> bool {
+      // Only the tiles which haven't had this pass yet are rendered, the pass
+      // is left out entirely when there are none unless it's the last one.
+      const auto pending = [&](const size_t &n) {
+        return blockSize > 1 ? this->tileSamples[n] == 0
+                             : this->tileSamples[n] < samples;
+      };
+      size_t pendingCount = 0;
+      for (size_t n = 0; n < this->tiles.size(); ++n) {
+        pendingCount += pending(n) ? 1 : 0;
+      }
+      if (pendingCount == 0 && samples != this->maximumSamples) {
+        return true;
+      }
+
+      this->threadPool.Run(
+          this->tiles.size(), [&](const size_t &n, const size_t &thread) {
+            if (this->generation.load(std::memory_order_relaxed) != generation ||
+                !pending(n)) {
+              return;
+            }
+
+            if (blockSize > 1) {
+              this->CastCoarseTile(rayCaster, this->tiles[n], blockSize,
+                                   this->tileBuffers[thread]);
+            } else {
+              this->CastSampleTile(rayCaster, this->tiles[n], samples,
+                                   this->tileBuffers[thread]);
+              this->tileSamples[n] = samples;
+            }
+          });
+
+      if (this->generation.load() != generation) {
+        return false;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(this->resultMutex);
+        this->result.pixels = this->working.pixels;
+      }
+
+      this->passCallback(ProgressivePass{
+          index++, blockSize, samples,
+          std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - startTime)
+              .count(),
+          this->cache.Last()});
+      return true;
+    };
+
+    for (const size_t &blockSize : coarseBlockSizes) {
+      if (!pass(blockSize, 0)) {
+        return;
+      }
+    }
+
+    for (size_t samples = 1; samples <= this->maximumSamples; ++samples) {
+      if (!pass(1, samples)) {
+        return;
+      }
+    }
+  }
+
+  /// Casts one ray per block of pixels, through the center of the block, and
+  /// fills the entire block with its color.
+  void CastCoarseTile(const RayCaster<T> &rayCaster, const Tile &tile,
+                      const size_t &blockSize, TileBuffer &tileBuffer) {
+    tileBuffer.Reset(tile);
+
+    for (size_t y = 0; y < tile.height; y += blockSize) {
+      for (size_t x = 0; x < tile.width; x += blockSize) {
+        const Vector3D<T> color = rayCaster.CastPoint(
+            static_cast<T>(tile.x + x + blockSize / 2),
+            static_cast<T>(tile.y + y + blockSize / 2));
+
+        for (size_t blockY = y; blockY < std::min(y + blockSize, tile.height);
+             ++blockY) {
+          for (size_t blockX = x; blockX < std::min(x + blockSize, tile.width);
+               ++blockX) {
+            tileBuffer.Put(blockX, blockY, static_cast<float>(color.x),
+                           static_cast<float>(color.y),
+                           static_cast<float>(color.z), 1.0f);
+          }
+        }
+      }
+    }
+
+    tileBuffer.Flush(this->working);
+  }
+
+  /// Traces the given sample of every pixel in the tile, adds it to the sums
+  /// and writes the averages to the frame buffer. The first sample is taken at
+  /// the corner of the pixels, like an single render, the others follow the
+  /// R2 sequence so they spread evenly over the pixels.
+  void CastSampleTile(const RayCaster<T> &rayCaster, const Tile &tile,
+                      const size_t &samples, TileBuffer &tileBuffer) {
+    static constexpr double g = 1.32471795724474602596; // The plastic number.
+    const T offsetX = static_cast<T>(
+        samples == 1 ? 0.0 : std::fmod(0.5 + samples / g, 1.0));
+    const T offsetY = static_cast<T>(
+        samples == 1 ? 0.0 : std::fmod(0.5 + samples / (g * g), 1.0));
+
+    rayCaster.TraceTile(tile, offsetX, offsetY, tileBuffer);
+
+    const float scale = 1.0f / static_cast<float>(samples);
+    for (size_t y = 0; y < tile.height; ++y) {
+      for (size_t x = 0; x < tile.width; ++x) {
+        float *sum = this->accumulation.data() +
+                     ((tile.y + y) * this->working.width + tile.x + x) * 3;
+        const float *color = tileBuffer.colors.data() +
+                             (y * tile.width + x) * FrameBuffer::channelCount;
+
+        for (size_t channel = 0; channel < 3; ++channel) {
+          sum[channel] =
+              samples == 1 ? color[channel] : sum[channel] + color[channel];
+        }
+
+        tileBuffer.Put(x, y, sum[0] * scale, sum[1] * scale, sum[2] * scale,
+                       1.0f);
+      }
+    }
+
+    tileBuffer.Flush(this->working);
+  }
+};
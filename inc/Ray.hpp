@@ -1,5 +1,11 @@
 #pragma once
 
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
 #include "Vector3D.hpp"
 
 template <typename T> class Ray {
@@ -7,16 +13,63 @@ public:
   Vector3D<T> origin;
   Vector3D<T> direction;
 
+  // Hits at or behind the origin are ignored. Reflected rays start just off
+  // the surface they're reflected from, see Offset(), so they can't hit it.
+  static constexpr T minimumDistance = static_cast<T>(0.0);
+
 public:
   Ray<T>(const Vector3D<T> &origin, const Vector3D<T> &direction) noexcept
       : origin(origin), direction(direction) {}
 
+  /// Reflects the ray off an surface at the given position, the new ray starts
+  /// just off the surface on the side the ray came from.
   Ray<T> Reflect(const Vector3D<T> &position, const Vector3D<T> &normal) {
-    Ray<T> ray(position, this->direction.Subtract(normal.Multiply(2.0 * this->direction.Dot(normal))));
-    return ray;
+    const T along = this->direction.Dot(normal);
+    const Vector3D<T> outside = along < static_cast<T>(0.0) ? normal : -normal;
+    return Ray<T>(Ray<T>::Offset(position, outside),
+                  this->direction - normal * (static_cast<T>(2.0) * along));
+  }
+
+  /// Gets the normal of an surface turned to the side the ray came from, which
+  /// is the side reflected and shadow rays leave from.
+  inline Vector3D<T> Facing(const Vector3D<T> &normal) const noexcept {
+    return this->direction.Dot(normal) < static_cast<T>(0.0) ? normal : -normal;
+  }
+
+  /// Moves an point on an surface off of it along the normal, far enough that
+  /// the rounding errors of the hit point can't put it back on the other side.
+  /// The distance is an number of representable steps, so it scales with the
+  /// magnitude of the coordinates in both precisions. Reference: Ray Tracing
+  /// Gems, chapter 6.
+  static Vector3D<T> Offset(const Vector3D<T> &point,
+                            const Vector3D<T> &normal) noexcept {
+    return Vector3D<T>(Ray<T>::Offset(point.x, normal.x),
+                       Ray<T>::Offset(point.y, normal.y),
+                       Ray<T>::Offset(point.z, normal.z));
   }
 
   ~Ray<T>() noexcept = default;
+
+private:
+  static T Offset(const T &value, const T &normal) noexcept {
+    using Integer = std::conditional_t<sizeof(T) == 4, int32_t, int64_t>;
+    static_assert(sizeof(Integer) == sizeof(T), "T is float or double");
+
+    // Close to zero the steps get too small, so there the offset is fixed.
+    if (std::abs(value) < static_cast<T>(1.0 / 32.0)) {
+      return value + static_cast<T>(128.0) *
+                         std::numeric_limits<T>::epsilon() * normal;
+    }
+
+    Integer bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    const Integer steps = static_cast<Integer>(static_cast<T>(256.0) * normal);
+    bits += value < static_cast<T>(0.0) ? -steps : steps;
+
+    T offset;
+    std::memcpy(&offset, &bits, sizeof(T));
+    return offset;
+  }
 };
 
 template <typename T> class RayHitResult {
@@ -33,3 +86,27 @@ public:
   ~RayHitResult<T>() noexcept = default;
 };
 
+
+/// The nearest hit of an ray, as found by GeometryRegister::ClosestHit(). This
+/// is plain data which refers to the scene store by index, so it can be passed
+/// around without touching the reference counts of the geometry.
+template <typename T> class HitRecord {
+public:
+  uint32_t primitive; // The primitive in the scene store.
+  T distance;
+  Vector3D<T> normal;
+  uint32_t material; // The material in the scene store.
+
+public:
+  HitRecord<T>(const uint32_t &primitive, const T &distance,
+               const Vector3D<T> &normal, const uint32_t &material) noexcept
+      : primitive(primitive), distance(distance), normal(normal),
+        material(material) {}
+
+  /// Gets the point at which the given ray hit.
+  inline Vector3D<T> Point(const Ray<T> &ray) const noexcept {
+    return ray.origin + ray.direction * this->distance;
+  }
+
+  ~HitRecord<T>() noexcept = default;
+};
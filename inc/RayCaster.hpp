@@ -1,112 +1,956 @@
 #pragma once
 
 #include "Camera.hpp"
+#include "FrameBuffer.hpp"
 #include "Geometry.hpp"
 #include "GeometryRegister.hpp"
-#include "PixelBuffer.hpp"
+#include "Profiler.hpp"
 #include "Ray.hpp"
+#include "RayPacket.hpp"
+#include "Sampler.hpp"
+#include "ThreadPool.hpp"
+#include "Tile.hpp"
+#include "TileBuffer.hpp"
 #include "Vector3D.hpp"
+#include "WavefrontQueue.hpp"
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <optional>
 #include <stdexcept>
-#include <thread>
 #include <tuple>
+#include <utility>
+#include <vector>
+
+/// How the rays of an frame are traced.
+enum class TraceMode {
+  PerPixel,  // Every pixel follows its reflections on its own, depth first.
+  Wavefront, // The paths of an tile go bounce by bounce, in large batches.
+};
+
+/// The order the reflected rays of an wavefront are extended in. Reflections
+/// scatter the rays of neighbouring pixels, sorting them back together lets
+/// more of them be cast as packets and keeps the nodes they visit in the
+/// cache. The order never changes the image.
+enum class RayOrder {
+  Pixel,  // The order of their pixels, as they were shaded.
+  Octant, // By the octant their direction points into.
+  Morton, // By octant, then along an Morton curve through their directions
+          // and origins, see MortonKeys().
+};
+
+/// When the paths stop. An path always stops at its maximum number of rays.
+/// Once the product of the reflectivities it has hit falls below the minimum
+/// it's either cut off there, or with russian roulette continued with an
+/// chance of the product over the minimum, and its product raised to the
+/// minimum to make up for the paths which were stopped. An minimum of zero
+/// never stops an path early.
+class PathTermination {
+public:
+  size_t maximumRays; // Including the primary one.
+  double minimumReflectivity;
+  bool russianRoulette;
+
+public:
+  PathTermination(const size_t &maximumRays = 8,
+                  const double &minimumReflectivity = 0.0,
+                  const bool &russianRoulette = false) noexcept
+      : maximumRays(maximumRays), minimumReflectivity(minimumReflectivity),
+        russianRoulette(russianRoulette) {}
+
+  ~PathTermination() noexcept = default;
+};
 
 template <typename T> class RayCaster {
 public:
-  std::optional<std::thread> thread;
-  PixelBuffer &pixelBuffer;
+  FrameBuffer &frameBuffer;
   Camera<T> &camera;
   std::shared_ptr<GeometryRegister<T>> geometryRegister;
-  const size_t castFrom, castTo;
+  std::vector<Tile> tiles, wavefrontTiles;
+  std::vector<TileBuffer> tileBuffers;
+  std::vector<WavefrontBuffer<T>> wavefrontBuffers;
+  TraceMode mode;
+  RayOrder order;
+  PathTermination termination;
+  Profiler *profiler; // Measures every frame when set.
+  Sampler sampler; // Supersamples the pixels when enabled.
+  std::vector<SampleBuffer> sampleBuffers;
 
 public:
-  RayCaster<T>(PixelBuffer &pixelBuffer, Camera<T> &camera,
-               std::shared_ptr<GeometryRegister<T>> geometryRegister,
-               const size_t &castFrom, const size_t &castTo) noexcept
-      : thread(std::nullopt), pixelBuffer(pixelBuffer), camera(camera),
-        geometryRegister(geometryRegister), castFrom(castFrom), castTo(castTo) {
-  }
-
-  RayCaster<T> &CreateThread() {
-    if (this->thread.has_value()) {
-      throw std::runtime_error("Thread is already created!");
-    }
-
-    this->thread = std::thread([&]() {
-      for (size_t n = this->castFrom; n < this->castTo; ++n) {
-        // Gets the ray we should cast.
-        Ray<T> ray = this->camera.GetRayOrigin(n);
-
-        // Keeps track of the previous objects reflectivities product.
-        T reflectivityProduct = 1.0;
-
-        // The actual color we will paint.
-        std::optional<Vector3D<T>> color = std::nullopt;
-
-        // Starts casting the ray.
-        for (size_t rayNo = 0; rayNo < 8; ++rayNo) {
-          // Casts the ray onto the geometry registry.. We will either get
-          // an hit result, or nullopt.
-          std::optional<
-              std::tuple<std::shared_ptr<Geometry<T>>, RayHitResult<T>>>
-              hitResult = geometryRegister->CastRay(ray);
-
-          // Checks if we got an nullopt, if so, just draw the background.
-          if (!hitResult.has_value()) {
-            if (color.has_value()) {
-              color = Vector3D<T>::Mix(1.0, *color, reflectivityProduct,
-                                       Vector3D<T>(0.9, 0.9, 0.9));
-            }
-            break;
-          }
-
-          // Gets the result and the geometry.
-          std::shared_ptr<Geometry<T>> geometry = std::get<0>(*hitResult);
-          RayHitResult<T> result = std::get<1>(*hitResult);
-
-          // Reflects the ray.
-          ray = ray.Reflect(result.point, result.normal);
-
-          // If the color has not been set yet, initialize it... Else perform an
-          // mix with the existing one.
-          color = color.has_value()
-                      ? Vector3D<T>::Mix(1.0, *color, reflectivityProduct,
-                                         geometry->material.color)
-                      : geometry->material.color;
-
-          // Checks the type of object we've hit.
-          reflectivityProduct *= geometry->material.reflectivity;
+  static constexpr size_t tileSize = 16;
+  // The tiles of an wavefront are larger, so every stage has enough paths to
+  // work on.
+  static constexpr size_t wavefrontTileSize = 64;
+
+  RayCaster<T>(FrameBuffer &frameBuffer, Camera<T> &camera,
+               std::shared_ptr<GeometryRegister<T>> geometryRegister)
+      : frameBuffer(frameBuffer), camera(camera),
+        geometryRegister(geometryRegister),
+        tiles(Tile::Split(camera.viewportWidth, camera.viewportHeight,
+                          tileSize)),
+        wavefrontTiles(Tile::Split(camera.viewportWidth, camera.viewportHeight,
+                                   wavefrontTileSize)),
+        tileBuffers({}), wavefrontBuffers(), mode(TraceMode::PerPixel),
+        order(RayOrder::Morton), termination(), profiler(nullptr),
+        sampler(SampleSettings()), sampleBuffers() {}
+
+  /// Measures every frame rendered from now on with the given profiler, or
+  /// stops measuring if it's nullptr.
+  RayCaster<T> &Profile(Profiler *profiler) noexcept {
+    this->profiler = profiler;
+    return *this;
+  }
+
+  /// Traces the frames rendered from now on the given way, both give the exact
+  /// same image. Supersampled frames are always traced per pixel.
+  RayCaster<T> &Mode(const TraceMode &mode) noexcept {
+    this->mode = mode;
+    return *this;
+  }
+
+  /// Orders the reflected rays of the wavefronts rendered from now on as given.
+  RayCaster<T> &Order(const RayOrder &order) noexcept {
+    this->order = order;
+    return *this;
+  }
+
+  /// Stops the paths of the frames rendered from now on as given, throws when
+  /// an path would have no rays at all.
+  RayCaster<T> &Terminate(const PathTermination &termination) {
+    if (termination.maximumRays == 0 ||
+        !(termination.minimumReflectivity >= 0.0)) {
+      throw std::invalid_argument("An path needs at least one ray, and an "
+                                  "minimum reflectivity of zero or more");
+    }
+
+    this->termination = termination;
+    return *this;
+  }
+
+  /// Takes several samples per pixel in every frame rendered from now on, see
+  /// SampleSettings. An single sample goes back to the one ray through the
+  /// corner of every pixel.
+  RayCaster<T> &Supersample(const SampleSettings &settings) {
+    this->sampler = Sampler(settings);
+    return *this;
+  }
+
+  /// Gets the number of samples taken by the last frame, the pixel count when
+  /// not supersampling.
+  uint64_t SampleCount() const noexcept {
+    if (!this->sampler.settings.Enabled()) {
+      return this->camera.RayCount();
+    }
+
+    uint64_t count = 0;
+    for (const SampleBuffer &sampleBuffer : this->sampleBuffers) {
+      count += sampleBuffer.sampleCount;
+    }
+    return count;
+  }
+
+  /// Renders the entire viewport, the tiles are handed out to the threads of
+  /// the given pool.
+  RayCaster<T> &Render(ThreadPool &threadPool) {
+    return this->Render(threadPool, this->Tiles());
+  }
+
+  /// Gets the tiles the viewport is rendered in with the current settings.
+  /// Every tile comes out the same no matter which other tiles are rendered
+  /// with it, or on which thread.
+  inline const std::vector<Tile> &Tiles() const noexcept {
+    return this->Wavefront() ? this->wavefrontTiles : this->tiles;
+  }
+
+  /// Renders only the given tiles, which have to be ones of Tiles().
+  RayCaster<T> &Render(ThreadPool &threadPool, const std::vector<Tile> &tiles) {
+    // Every thread gets its own tile buffer, so they never write to the same
+    // memory until the tiles are flushed.
+    while (this->tileBuffers.size() < threadPool.ThreadCount()) {
+      this->tileBuffers.emplace_back(tileSize);
+    }
+    while (this->Wavefront() &&
+           this->wavefrontBuffers.size() < threadPool.ThreadCount()) {
+      this->wavefrontBuffers.emplace_back(wavefrontTileSize);
+    }
+
+    if (this->sampler.settings.Enabled()) {
+      this->sampleBuffers.resize(
+          std::max(this->sampleBuffers.size(), threadPool.ThreadCount()));
+      for (SampleBuffer &sampleBuffer : this->sampleBuffers) {
+        sampleBuffer.sampleCount = 0;
+      }
+    }
+
+    if (this->profiler == nullptr) {
+      threadPool.Run(tiles.size(),
+                     [this, &tiles](const size_t &n, const size_t &thread) {
+                       this->RenderTile(tiles[n], thread);
+                     });
+
+      return *this;
+    }
+
+    // Every thread counts into its own profile, and records the tiles it
+    // rendered for the timeline.
+    this->profiler->Begin(threadPool.ThreadCount(), tiles.size());
+    threadPool.Run(
+        tiles.size(), [this, &tiles](const size_t &n, const size_t &thread) {
+          ThreadProfile &profile = this->profiler->Thread(thread);
+          const uint64_t rays = profile.Counter(ProfileCounter::Rays);
+          const uint64_t nodesVisited =
+              profile.Counter(ProfileCounter::NodesVisited);
+          const uint64_t start = Profiler::Now();
+
+          this->RenderTile(tiles[n], thread, &profile);
+
+          profile.tiles.emplace_back(
+              tiles[n], start - this->profiler->startNanoseconds,
+              Profiler::Now() - this->profiler->startNanoseconds,
+              profile.Counter(ProfileCounter::Rays) - rays,
+              profile.Counter(ProfileCounter::NodesVisited) - nodesVisited);
+        });
+    this->profiler->End();
+
+    return *this;
+  }
+
+  /// Casts the rays of all the pixels in the given tile, the primary rays are
+  /// cast in packets of neighbouring pixels on the same row. The colors are
+  /// gathered in the tile buffer, which is flushed to the frame buffer at the
+  /// end.
+  RayCaster<T> &CastTile(const Tile &tile, TileBuffer &tileBuffer,
+                         ThreadProfile *profile = nullptr) {
+    this->TraceTile(tile, static_cast<T>(0.0), static_cast<T>(0.0), tileBuffer,
+                    profile);
+
+    const uint64_t start = Start(profile);
+    tileBuffer.Flush(this->frameBuffer);
+    Lap(profile, ProfileStage::FrameBufferWrites, start);
+
+    return *this;
+  }
+
+  /// Samples all the pixels in the given tile until they've converged or have
+  /// the maximum number of samples. The first round takes the minimum number
+  /// of samples of every pixel, every round after that as many again of the
+  /// pixels still active, and drops the pixels which have settled. The samples
+  /// of an pixel share an packet, so the packets stay coherent however few
+  /// pixels are left. The means are flushed to the frame buffer at the end.
+  RayCaster<T> &SampleTile(const Tile &tile, TileBuffer &tileBuffer,
+                           SampleBuffer &sampleBuffer,
+                           ThreadProfile *profile = nullptr) {
+    const Sampler &sampler = this->sampler;
+    const SampleSettings &settings = sampler.settings;
+    sampleBuffer.Reset(tile.PixelCount());
+    for (size_t pixel = 0; pixel < tile.PixelCount(); ++pixel) {
+      sampler.Shift(tile.x + pixel % tile.width, tile.y + pixel / tile.width,
+                    sampleBuffer.shifts[pixel * 2],
+                    sampleBuffer.shifts[pixel * 2 + 1]);
+    }
+
+    // Without an threshold nothing ever settles, so all the samples are taken
+    // in one round.
+    const size_t roundSize = settings.threshold > 0.0f
+                                 ? settings.minimumSamples
+                                 : settings.maximumSamples;
+
+    RayPacket<T> packet;
+    uint32_t lanes[RayPacket<T>::size];
+    uint64_t seeds[RayPacket<T>::size];
+    for (size_t taken = 0;
+         taken < settings.maximumSamples && !sampleBuffer.active.empty();) {
+      const size_t round = std::min(roundSize, settings.maximumSamples - taken);
+      const size_t total = sampleBuffer.active.size() * round;
+
+      for (size_t i = 0; i < total; i += RayPacket<T>::size) {
+        const size_t count = std::min(RayPacket<T>::size, total - i);
+
+        uint64_t time = Start(profile);
+        packet.Clear();
+        for (size_t lane = 0; lane < count; ++lane) {
+          const uint32_t pixel = sampleBuffer.active[(i + lane) / round];
+          const size_t pixelX = tile.x + pixel % tile.width;
+          const size_t pixelY = tile.y + pixel / tile.width;
+          float x, y;
+          sampler.Position(taken + (i + lane) % round, pixelX, pixelY,
+                           sampleBuffer.shifts[pixel * 2],
+                           sampleBuffer.shifts[pixel * 2 + 1], x, y);
+          const T pointX = static_cast<T>(pixelX) + static_cast<T>(x);
+          const T pointY = static_cast<T>(pixelY) + static_cast<T>(y);
+          packet.Push(this->camera.GetRay(pointX, pointY));
+          lanes[lane] = pixel;
+          seeds[lane] = this->PathSeed(pointX, pointY);
+        }
+        time = Lap(profile, ProfileStage::Generation, time);
+        this->geometryRegister->CastPacket(packet, profile);
+        Lap(profile, ProfileStage::Traversal, time);
+        if (profile != nullptr) {
+          profile->Count(ProfileCounter::Rays, count);
         }
 
-        // If the color is not present, make it the default environment color.
-        if (!color.has_value()) {
-          color = Vector3D<T>(0.9, 0.9, 0.9);
+        for (size_t lane = 0; lane < count; ++lane) {
+          const Vector3D<T> color =
+              this->Trace(packet.At(lane),
+                          this->geometryRegister->PacketHit(packet, lane),
+                          seeds[lane], profile);
+          sampleBuffer.Add(lanes[lane], static_cast<float>(color.x),
+                           static_cast<float>(color.y),
+                           static_cast<float>(color.z));
         }
+      }
 
-        // Gets the viewport X and Y for pixel drawing.
-        const size_t x = this->camera.ViewportX(n);
-        const size_t y = this->camera.ViewportY(n);
+      taken += round;
+      sampleBuffer.Settle(tile.width, tile.height, settings.threshold);
+    }
 
-        // Draws the pixel.
-        this->pixelBuffer.PutPixel(x, y, color->x * 255.0, color->y * 255.0,
-                                   color->z * 255.9, 255);
-      }
-    });
+    const uint64_t start = Start(profile);
+    tileBuffer.Reset(tile);
+    for (size_t pixel = 0; pixel < tile.PixelCount(); ++pixel) {
+      const double *sum = sampleBuffer.sums.data() + pixel * 3;
+      const double scale = 1.0 / sampleBuffer.counts[pixel];
+      tileBuffer.Put(pixel % tile.width, pixel / tile.width,
+                     static_cast<float>(sum[0] * scale),
+                     static_cast<float>(sum[1] * scale),
+                     static_cast<float>(sum[2] * scale), 1.0f);
+    }
+    tileBuffer.Flush(this->frameBuffer);
+    Lap(profile, ProfileStage::FrameBufferWrites, start);
 
     return *this;
   }
 
-  RayCaster<T> &JoinThread() {
-    if (!this->thread.has_value()) {
-      throw std::runtime_error("Thread does not exist yet!");
+  /// Traces all the pixels of the given tile as an wavefront. The paths go
+  /// through the stages bounce by bounce: the primary rays are generated, all
+  /// the rays are extended to their nearest hits in packets, the hits are
+  /// lit by the shadow rays towards the lights, and shaded into an compacted
+  /// queue of the reflected rays, which is sorted for the next extension, see
+  /// RayOrder. The colors are the same as Trace() gives, they're flushed to
+  /// the frame buffer at the end.
+  RayCaster<T> &WavefrontTile(const Tile &tile, WavefrontBuffer<T> &buffer,
+                              ThreadProfile *profile = nullptr) {
+    buffer.tileBuffer.Reset(tile);
+
+    uint64_t time = Start(profile);
+    this->Generate(tile, buffer.paths);
+    time = Lap(profile, ProfileStage::Generation, time);
+
+    for (size_t rayNo = 0; buffer.paths.count != 0; ++rayNo) {
+      this->Extend(buffer.paths, profile);
+      time = Lap(profile, ProfileStage::Traversal, time);
+      this->Shadow(buffer.paths, buffer.shadows, profile);
+      time = Lap(profile, ProfileStage::Shadows, time);
+      this->Shade(buffer.paths, buffer.next, buffer.tileBuffer, rayNo,
+                  profile);
+      Sort(buffer, this->order);
+      time = Lap(profile, ProfileStage::Shading, time);
     }
 
-    this->thread->join();
+    buffer.tileBuffer.Flush(this->frameBuffer);
+    Lap(profile, ProfileStage::FrameBufferWrites, time);
+
+    return *this;
+  }
+
+  /// Traces one sample of every pixel in the tile into the tile buffer, without
+  /// flushing it. The offset is the position of the sample within the pixels,
+  /// in fractions of an pixel.
+  const RayCaster<T> &TraceTile(const Tile &tile, const T &offsetX,
+                                const T &offsetY, TileBuffer &tileBuffer,
+                                ThreadProfile *profile = nullptr) const {
+    RayPacket<T> packet;
+    tileBuffer.Reset(tile);
+
+    for (size_t y = tile.y; y < tile.y + tile.height; ++y) {
+      for (size_t x = tile.x; x < tile.x + tile.width;
+           x += RayPacket<T>::size) {
+        const size_t count =
+            std::min(RayPacket<T>::size, tile.x + tile.width - x);
+
+        // Fills the packet with the rays of the pixels, and casts them.
+        uint64_t time = Start(profile);
+        this->camera.GenerateRow(x, y, count, packet, offsetX, offsetY);
+        time = Lap(profile, ProfileStage::Generation, time);
+        this->geometryRegister->CastPacket(packet, profile);
+        Lap(profile, ProfileStage::Traversal, time);
+        if (profile != nullptr) {
+          profile->Count(ProfileCounter::Rays, count);
+        }
+
+        // Follows the reflections of every ray on its own, and draws the
+        // pixels.
+        for (size_t lane = 0; lane < count; ++lane) {
+          const Vector3D<T> color =
+              this->Trace(packet.At(lane),
+                          this->geometryRegister->PacketHit(packet, lane),
+                          this->PathSeed(static_cast<T>(x + lane) + offsetX,
+                                         static_cast<T>(y) + offsetY),
+                          profile);
+
+          tileBuffer.Put(x + lane - tile.x, y - tile.y,
+                         static_cast<float>(color.x),
+                         static_cast<float>(color.y),
+                         static_cast<float>(color.z), 1.0f);
+        }
+      }
+    }
 
     return *this;
   }
 
+  /// Casts the ray through the given point of the viewport, in pixels, and
+  /// follows its reflections.
+  Vector3D<T> CastPoint(const T &x, const T &y) const {
+    const Ray<T> ray = this->camera.GetRay(x, y);
+    return this->Trace(ray, this->geometryRegister->ClosestHit(ray),
+                       this->PathSeed(x, y));
+  }
+
+  /// Casts the ray of the given pixel, and follows its reflections.
+  Vector3D<T> CastPixel(const size_t &n) const {
+    const Ray<T> ray = this->camera.GetRayOrigin(n);
+    return this->Trace(ray, this->geometryRegister->ClosestHit(ray),
+                       this->PathSeed(static_cast<T>(this->camera.ViewportX(n)),
+                                      static_cast<T>(this->camera.ViewportY(n))));
+  }
+
+  /// Follows the reflections of the given ray, starting at the already known
+  /// first hit. The seed is where the random numbers of the path start.
+  Vector3D<T> Trace(Ray<T> ray, std::optional<HitRecord<T>> hitResult,
+                    const uint64_t &seed,
+                    ThreadProfile *profile = nullptr) const {
+    uint64_t time = Start(profile);
+
+    // Keeps track of the previous objects reflectivities product.
+    T reflectivityProduct = 1.0;
+
+    // The actual color we will paint.
+    std::optional<Vector3D<T>> color = std::nullopt;
+
+    // Starts casting the ray.
+    for (size_t rayNo = 0;; ++rayNo) {
+      // Casts the ray onto the geometry registry.. We will either get
+      // an hit result, or nullopt.
+      if (rayNo != 0) {
+        time = Lap(profile, ProfileStage::Shading, time);
+        hitResult = geometryRegister->ClosestHit(ray, profile);
+        time = Lap(profile, ProfileStage::Traversal, time);
+        if (profile != nullptr) {
+          profile->Count(ProfileCounter::Rays);
+        }
+      }
+
+      // Checks if we got an nullopt, if so, just draw the background.
+      if (!hitResult.has_value()) {
+        if (color.has_value()) {
+          color = Vector3D<T>::Mix(1.0, *color, reflectivityProduct,
+                                   Vector3D<T>(0.9, 0.9, 0.9));
+        }
+        break;
+      }
+
+      if (profile != nullptr) {
+        profile->Count(ProfileCounter::Bounces);
+      }
+
+      // Gets the material of the geometry we've hit.
+      const Material<T> &material = geometryRegister->HitMaterial(*hitResult);
+
+      // Reflects the ray, the shadow rays start where the reflected one does.
+      const Vector3D<T> normal = ray.Facing(hitResult->normal);
+      ray = ray.Reflect(hitResult->Point(ray), hitResult->normal);
+
+      // Lights the material, if there are any lights.
+      Vector3D<T> surface = material.color;
+      if (!geometryRegister->lights.empty()) {
+        time = Lap(profile, ProfileStage::Shading, time);
+        surface = surface.Scale(this->Illuminate(ray.origin, normal, profile));
+        time = Lap(profile, ProfileStage::Shadows, time);
+      }
+
+      // If the color has not been set yet, initialize it... Else perform an
+      // mix with the existing one.
+      color = color.has_value()
+                  ? Vector3D<T>::Mix(1.0, *color, reflectivityProduct, surface)
+                  : surface;
+
+      // Checks the type of object we've hit.
+      reflectivityProduct *= material.reflectivity;
+      if (!this->Continue(seed, rayNo, reflectivityProduct, profile)) {
+        break;
+      }
+    }
+
+    // If the color is not present, make it the default environment color.
+    if (!color.has_value()) {
+      color = Vector3D<T>(0.9, 0.9, 0.9);
+    }
+
+    Lap(profile, ProfileStage::Shading, time);
+    return *color;
+  }
+
   ~RayCaster<T>() noexcept = default;
+
+private:
+  /// Checks if the frames are traced as wavefronts.
+  inline bool Wavefront() const noexcept {
+    return this->mode == TraceMode::Wavefront &&
+           !this->sampler.settings.Enabled();
+  }
+
+  /// Renders the given tile with the buffers of the given thread, the way
+  /// chosen by the settings.
+  inline void RenderTile(const Tile &tile, const size_t &thread,
+                         ThreadProfile *profile = nullptr) {
+    if (this->sampler.settings.Enabled()) {
+      this->SampleTile(tile, this->tileBuffers[thread],
+                       this->sampleBuffers[thread], profile);
+    } else if (this->Wavefront()) {
+      this->WavefrontTile(tile, this->wavefrontBuffers[thread], profile);
+    } else {
+      this->CastTile(tile, this->tileBuffers[thread], profile);
+    }
+  }
+
+  /// The generation stage, fills the queue with the rays through the corners
+  /// of all the pixels in the tile.
+  const RayCaster<T> &Generate(const Tile &tile,
+                               WavefrontQueue<T> &paths) const {
+    paths.Reset(tile.PixelCount());
+    for (size_t y = 0; y < tile.height; ++y) {
+      for (size_t x = 0; x < tile.width; ++x) {
+        const T pointX = static_cast<T>(tile.x + x);
+        const T pointY = static_cast<T>(tile.y + y);
+        paths.Push(this->camera.GetRay(pointX, pointY),
+                   static_cast<uint32_t>(y * tile.width + x),
+                   this->PathSeed(pointX, pointY), Vector3D<T>(0.0, 0.0, 0.0),
+                   false, static_cast<T>(1.0));
+      }
+    }
+
+    return *this;
+  }
+
+  /// The extension stage, finds the nearest hit of every ray in the queue.
+  /// Consecutive rays which go roughly the same way are cast as an packet,
+  /// the others one by one since an packet of diverging rays visits the nodes
+  /// of all of them.
+  const RayCaster<T> &Extend(WavefrontQueue<T> &paths,
+                             ThreadProfile *profile) const {
+    RayPacket<T> packet;
+    for (size_t first = 0; first < paths.count; first += RayPacket<T>::size) {
+      const size_t count = std::min(RayPacket<T>::size, paths.count - first);
+      if (!Coherent(paths, first, count)) {
+        for (size_t i = first; i < first + count; ++i) {
+          const std::optional<HitRecord<T>> hit =
+              this->geometryRegister->ClosestHit(paths.At(i), profile);
+          paths.SetHit(i, hit);
+        }
+        continue;
+      }
+
+      packet.Clear();
+      for (size_t lane = 0; lane < count; ++lane) {
+        packet.Push(paths.At(first + lane));
+      }
+      this->geometryRegister->CastPacket(packet, profile);
+
+      for (size_t lane = 0; lane < count; ++lane) {
+        paths.SetHit(first + lane,
+                     this->geometryRegister->PacketHit(packet, lane));
+      }
+    }
+
+    if (profile != nullptr) {
+      profile->Count(ProfileCounter::Rays, paths.count);
+    }
+
+    return *this;
+  }
+
+  /// Checks if the given rays all point within about 25 degrees of the first.
+  static bool Coherent(const WavefrontQueue<T> &paths, const size_t &first,
+                       const size_t &count) noexcept {
+    static constexpr T minimumCosine = static_cast<T>(0.9);
+    for (size_t i = first + 1; i < first + count; ++i) {
+      if (paths.directionX[first] * paths.directionX[i] +
+              paths.directionY[first] * paths.directionY[i] +
+              paths.directionZ[first] * paths.directionZ[i] <
+          minimumCosine) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /// The shading stage, mixes the material of every hit into its path and
+  /// queues the reflected ray. The paths which miss, or are terminated, are
+  /// finished and drawn into the tile buffer instead, so the next queue only
+  /// holds the paths still going.
+  const RayCaster<T> &Shade(const WavefrontQueue<T> &paths,
+                            WavefrontQueue<T> &next, TileBuffer &tileBuffer,
+                            const size_t &rayNo, ThreadProfile *profile) const {
+    const Vector3D<T> background(0.9, 0.9, 0.9);
+    const auto draw = [&](const uint32_t &pixel, const Vector3D<T> &color) {
+      tileBuffer.Put(pixel % tileBuffer.tile.width,
+                     pixel / tileBuffer.tile.width, static_cast<float>(color.x),
+                     static_cast<float>(color.y), static_cast<float>(color.z),
+                     1.0f);
+    };
+
+    next.Reset(paths.count);
+    const bool lit = !this->geometryRegister->lights.empty();
+    uint64_t bounces = 0;
+    for (size_t i = 0; i < paths.count; ++i) {
+      const T &reflectivityProduct = paths.reflectivityProducts[i];
+      if (paths.hits[i] == 0) {
+        draw(paths.pixels[i],
+             paths.colored[i] != 0
+                 ? Vector3D<T>::Mix(1.0, paths.Color(i), reflectivityProduct,
+                                    background)
+                 : background);
+        continue;
+      }
+
+      ++bounces;
+      const Material<T> &material =
+          this->geometryRegister->store.materials[paths.materials[i]];
+      Ray<T> ray = paths.At(i);
+      ray = ray.Reflect(ray.origin + ray.direction * paths.distances[i],
+                        paths.Normal(i));
+      const Vector3D<T> surface =
+          lit ? material.color.Scale(paths.Irradiance(i)) : material.color;
+      const Vector3D<T> color =
+          paths.colored[i] != 0
+              ? Vector3D<T>::Mix(1.0, paths.Color(i), reflectivityProduct,
+                                 surface)
+              : surface;
+
+      T product = reflectivityProduct * material.reflectivity;
+      if (this->Continue(paths.seeds[i], rayNo, product, profile)) {
+        next.Push(ray, paths.pixels[i], paths.seeds[i], color, true, product);
+      } else {
+        draw(paths.pixels[i], color);
+      }
+    }
+
+    if (profile != nullptr) {
+      profile->Count(ProfileCounter::Bounces, bounces);
+    }
+
+    return *this;
+  }
+
+  /// The shadow stage, sums the light reaching every hit. An shadow ray goes
+  /// from every hit towards every light, the rays towards the same light are
+  /// queued next to each other and cast in packets when they go the same way,
+  /// which those towards an directional light always do. Gives every hit the
+  /// same light as Illuminate().
+  const RayCaster<T> &Shadow(WavefrontQueue<T> &paths, ShadowQueue<T> &shadows,
+                             ThreadProfile *profile) const {
+    const FlatArray<Light<T>> &lights = this->geometryRegister->lights;
+    if (lights.empty()) {
+      return *this;
+    }
+
+    shadows.Reset(paths.count * lights.size());
+    for (const Light<T> &light : lights) {
+      for (size_t i = 0; i < paths.count; ++i) {
+        if (paths.hits[i] == 0) {
+          continue;
+        }
+
+        const Ray<T> ray = paths.At(i);
+        const Vector3D<T> normal = ray.Facing(paths.Normal(i));
+        const Vector3D<T> point = Ray<T>::Offset(
+            ray.origin + ray.direction * paths.distances[i], normal);
+        Ray<T> shadow(point, normal);
+        T distance = static_cast<T>(0.0);
+        Vector3D<T> irradiance(0.0, 0.0, 0.0);
+        if (light.Illuminate(point, normal, shadow, distance, irradiance)) {
+          shadows.Push(shadow, distance, static_cast<uint32_t>(i), irradiance);
+        }
+      }
+    }
+
+    // Casts the shadow rays in batches, leaving out the lights which can't be
+    // shadowed.
+    RayPacket<T> packet;
+    size_t batch[RayPacket<T>::size];
+    uint64_t shadowRays = 0;
+    for (size_t next = 0; next < shadows.count;) {
+      size_t count = 0;
+      for (; next < shadows.count && count < RayPacket<T>::size; ++next) {
+        if (shadows.distances[next] > static_cast<T>(0.0)) {
+          batch[count++] = next;
+        }
+      }
+      shadowRays += count;
+
+      if (!Coherent(shadows, batch, count)) {
+        for (size_t k = 0; k < count; ++k) {
+          shadows.occluded[batch[k]] = this->geometryRegister->Occluded(
+                                           shadows.At(batch[k]),
+                                           shadows.distances[batch[k]], profile)
+                                           ? 1
+                                           : 0;
+        }
+        continue;
+      }
+
+      packet.Clear();
+      for (size_t k = 0; k < count; ++k) {
+        packet.Push(shadows.At(batch[k]));
+        packet.distance[k] = shadows.distances[batch[k]];
+      }
+      this->geometryRegister->OccludedPacket(packet, profile);
+      for (size_t k = 0; k < count; ++k) {
+        shadows.occluded[batch[k]] =
+            packet.geometry[k] != RayPacket<T>::noGeometry ? 1 : 0;
+      }
+    }
+
+    // Sums the light in the order of the lights.
+    for (size_t i = 0; i < paths.count; ++i) {
+      paths.irradianceR[i] = paths.irradianceG[i] = paths.irradianceB[i] =
+          static_cast<T>(0.0);
+    }
+    for (size_t j = 0; j < shadows.count; ++j) {
+      if (shadows.occluded[j] == 0) {
+        const uint32_t &path = shadows.paths[j];
+        const Vector3D<T> irradiance =
+            paths.Irradiance(path) + shadows.Irradiance(j);
+        paths.irradianceR[path] = irradiance.x;
+        paths.irradianceG[path] = irradiance.y;
+        paths.irradianceB[path] = irradiance.z;
+      }
+    }
+
+    if (profile != nullptr) {
+      profile->Count(ProfileCounter::ShadowRays, shadowRays);
+    }
+
+    return *this;
+  }
+
+  /// Checks if the given shadow rays all point within about 25 degrees of the
+  /// first, like Coherent() does for the paths.
+  static bool Coherent(const ShadowQueue<T> &shadows, const size_t *batch,
+                       const size_t &count) noexcept {
+    static constexpr T minimumCosine = static_cast<T>(0.9);
+    for (size_t k = 1; k < count; ++k) {
+      if (shadows.directionX[batch[0]] * shadows.directionX[batch[k]] +
+              shadows.directionY[batch[0]] * shadows.directionY[batch[k]] +
+              shadows.directionZ[batch[0]] * shadows.directionZ[batch[k]] <
+          minimumCosine) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /// Sums the light reaching an point on an surface, from all the lights which
+  /// aren't blocked. The normal is the one on the side the point is off.
+  Vector3D<T> Illuminate(const Vector3D<T> &point, const Vector3D<T> &normal,
+                         ThreadProfile *profile) const {
+    Vector3D<T> sum(0.0, 0.0, 0.0);
+    uint64_t shadowRays = 0;
+    for (const Light<T> &light : this->geometryRegister->lights) {
+      Ray<T> shadow(point, normal);
+      T distance = static_cast<T>(0.0);
+      Vector3D<T> irradiance(0.0, 0.0, 0.0);
+      if (!light.Illuminate(point, normal, shadow, distance, irradiance)) {
+        continue;
+      }
+
+      if (distance > static_cast<T>(0.0)) {
+        ++shadowRays;
+        if (this->geometryRegister->Occluded(shadow, distance, profile)) {
+          continue;
+        }
+      }
+      sum += irradiance;
+    }
+
+    if (profile != nullptr) {
+      profile->Count(ProfileCounter::ShadowRays, shadowRays);
+    }
+
+    return sum;
+  }
+
+  /// Sorts the paths of the next queue back into the queue of paths in the
+  /// given order. The sort is stable, the paths which are equal in the order
+  /// keep the order of their pixels.
+  static void Sort(WavefrontBuffer<T> &buffer, const RayOrder &order) {
+    const WavefrontQueue<T> &paths = buffer.next;
+    WavefrontQueue<T> &sorted = buffer.paths;
+    sorted.Reset(paths.count);
+    sorted.count = paths.count;
+
+    if (order == RayOrder::Pixel) {
+      for (size_t i = 0; i < paths.count; ++i) {
+        sorted.Copy(paths, i, i);
+      }
+    } else if (order == RayOrder::Octant) {
+      size_t starts[9] = {};
+      for (size_t i = 0; i < paths.count; ++i) {
+        ++starts[paths.Octant(i) + 1];
+      }
+      for (size_t octant = 1; octant < 9; ++octant) {
+        starts[octant] += starts[octant - 1];
+      }
+
+      for (size_t i = 0; i < paths.count; ++i) {
+        sorted.Copy(paths, i, starts[paths.Octant(i)]++);
+      }
+    } else {
+      MortonKeys(paths, buffer.keys);
+      for (size_t i = 0; i < paths.count; ++i) {
+        buffer.order[i] = static_cast<uint32_t>(i);
+      }
+
+      // An radix sort of the keys, by their lower and then their upper half.
+      SortByDigit(buffer.keys, buffer.order, buffer.scratch, paths.count, 0);
+      SortByDigit(buffer.keys, buffer.scratch, buffer.order, paths.count,
+                  mortonBits / 2);
+      for (size_t i = 0; i < paths.count; ++i) {
+        sorted.Copy(paths, buffer.order[i], i);
+      }
+    }
+  }
+
+  // The bits of the keys of the Morton order: 3 of the octant, 6 of the cell
+  // of the direction (2 per axis) and 9 of the cell of the origin (3 per
+  // axis). The radix sort splits them into two halves of 9 bits.
+  static constexpr size_t mortonBits = 18;
+
+  /// Gets the key of every path in the Morton order. Within its octant an
+  /// direction falls into one of 4 cells along every axis, and its origin into
+  /// one of 8 cells along every axis of the bounds of all the origins. The bits
+  /// of the cells along the axes are interleaved, so the paths which go about
+  /// the same way from about the same place come out next to each other.
+  static void MortonKeys(const WavefrontQueue<T> &paths,
+                         std::vector<uint32_t> &keys) noexcept {
+    if (paths.count == 0) {
+      return;
+    }
+
+    Vector3D<T> min = paths.At(0).origin, max = min;
+    for (size_t i = 1; i < paths.count; ++i) {
+      min.x = std::min(min.x, paths.originX[i]);
+      min.y = std::min(min.y, paths.originY[i]);
+      min.z = std::min(min.z, paths.originZ[i]);
+      max.x = std::max(max.x, paths.originX[i]);
+      max.y = std::max(max.y, paths.originY[i]);
+      max.z = std::max(max.z, paths.originZ[i]);
+    }
+
+    const auto scale = [](const T &min, const T &max) {
+      return max > min ? static_cast<T>(8.0) / (max - min)
+                       : static_cast<T>(0.0);
+    };
+    const auto origin = [](const T &value, const T &min,
+                           const T &scale) -> uint32_t {
+      return std::min(static_cast<uint32_t>((value - min) * scale), 7u);
+    };
+    const auto direction = [](const T &value) -> uint32_t {
+      return std::min(
+          static_cast<uint32_t>(std::abs(value) * static_cast<T>(4.0)), 3u);
+    };
+    const T scaleX = scale(min.x, max.x), scaleY = scale(min.y, max.y),
+            scaleZ = scale(min.z, max.z);
+    for (size_t i = 0; i < paths.count; ++i) {
+      const uint32_t directionCell =
+          Spread(direction(paths.directionX[i])) |
+          Spread(direction(paths.directionY[i])) << 1 |
+          Spread(direction(paths.directionZ[i])) << 2;
+      const uint32_t originCell =
+          Spread(origin(paths.originX[i], min.x, scaleX)) |
+          Spread(origin(paths.originY[i], min.y, scaleY)) << 1 |
+          Spread(origin(paths.originZ[i], min.z, scaleZ)) << 2;
+      keys[i] = paths.Octant(i) << 15 | directionCell << 9 | originCell;
+    }
+  }
+
+  /// Spreads the lower 8 bits of the value apart, two zeros between each, so
+  /// three spread values can be interleaved. The Morton keys only pass cells
+  /// of up to 3 bits.
+  static constexpr uint32_t Spread(uint32_t value) noexcept {
+    value = (value | value << 8) & 0x0000F00Fu;
+    value = (value | value << 4) & 0x000C30C3u;
+    value = (value | value << 2) & 0x00249249u;
+    return value;
+  }
+
+  /// Sorts the indices stably by the half of their keys at the given shift,
+  /// into the other indices.
+  static void SortByDigit(const std::vector<uint32_t> &keys,
+                          const std::vector<uint32_t> &indices,
+                          std::vector<uint32_t> &sorted, const size_t &count,
+                          const size_t &shift) noexcept {
+    static constexpr size_t digits = size_t(1) << (mortonBits / 2);
+    uint32_t starts[digits + 1] = {};
+    for (size_t i = 0; i < count; ++i) {
+      ++starts[((keys[indices[i]] >> shift) & (digits - 1)) + 1];
+    }
+    for (size_t digit = 1; digit <= digits; ++digit) {
+      starts[digit] += starts[digit - 1];
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      sorted[starts[(keys[indices[i]] >> shift) & (digits - 1)]++] =
+          indices[i];
+    }
+  }
+
+  /// Gets the seed of the path starting at the given point of the viewport, in
+  /// pixels. It only depends on the point and the seed of the sampling, so
+  /// every mode and every thread makes the same choices along the path.
+  inline uint64_t PathSeed(const T &x, const T &y) const noexcept {
+    return SampleRandom::Hash(this->sampler.settings.seed, x, y);
+  }
+
+  /// Decides if an path goes on after its given ray hit something, see
+  /// PathTermination. The random numbers of the roulette come from the seed of
+  /// the path and the ray, see PathSeed().
+  inline bool Continue(const uint64_t &seed, const size_t &rayNo,
+                       T &reflectivityProduct, ThreadProfile *profile) const {
+    if (rayNo + 1 >= this->termination.maximumRays) {
+      return false;
+    }
+
+    const T minimum = static_cast<T>(this->termination.minimumReflectivity);
+    if (!(reflectivityProduct < minimum)) {
+      return true;
+    }
+
+    const T survival = reflectivityProduct / minimum;
+    if (this->termination.russianRoulette &&
+        SampleRandom::Uniform<T>(SampleRandom::Hash(seed, rayNo)) <
+            survival) {
+      reflectivityProduct = minimum;
+      return true;
+    }
+
+    if (profile != nullptr) {
+      profile->Count(ProfileCounter::Terminations);
+    }
+    return false;
+  }
+
+  /// Gets the time to start an stage at, only reads the clock when profiling.
+  static inline uint64_t Start(const ThreadProfile *profile) noexcept {
+    return profile != nullptr ? Profiler::Now() : 0;
+  }
+
+  /// Ends the stage which started at the given time, and returns the start of
+  /// the next one.
+  static inline uint64_t Lap(ThreadProfile *profile, const ProfileStage &stage,
+                             const uint64_t &start) noexcept {
+    return profile != nullptr ? profile->Time(stage, start) : 0;
+  }
 };
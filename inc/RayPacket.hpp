@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "Ray.hpp"
+#include "Vector3D.hpp"
+
+/// An packet of coherent rays stored as structure-of-arrays, so the packet
+/// kernels can load the same component of several rays into one register.
+/// Unused lanes have an maximum distance of zero, so they never hit anything.
+template <typename T> class RayPacket {
+public:
+  static constexpr size_t size = 16;
+  static constexpr uint32_t noGeometry = std::numeric_limits<uint32_t>::max();
+
+  alignas(64) T originX[size];
+  alignas(64) T originY[size];
+  alignas(64) T originZ[size];
+  alignas(64) T directionX[size];
+  alignas(64) T directionY[size];
+  alignas(64) T directionZ[size];
+
+  // The distance of the nearest hit so far, and the index of the geometry in
+  // the register which was hit.
+  alignas(64) T distance[size];
+  uint32_t geometry[size];
+
+  size_t count;
+
+public:
+  RayPacket<T>() noexcept { this->Clear(); }
+
+  /// Removes all the rays from the packet.
+  RayPacket<T> &Clear() noexcept {
+    for (size_t lane = 0; lane < size; ++lane) {
+      this->originX[lane] = this->originY[lane] = this->originZ[lane] = 0.0;
+      this->directionX[lane] = this->directionY[lane] = 0.0;
+      this->directionZ[lane] = 1.0;
+      this->distance[lane] = 0.0;
+      this->geometry[lane] = noGeometry;
+    }
+
+    this->count = 0;
+    return *this;
+  }
+
+  /// Adds an ray to the next free lane, the caller makes sure there is one.
+  RayPacket<T> &Push(const Ray<T> &ray) noexcept {
+    const size_t lane = this->count++;
+    this->originX[lane] = ray.origin.x;
+    this->originY[lane] = ray.origin.y;
+    this->originZ[lane] = ray.origin.z;
+    this->directionX[lane] = ray.direction.x;
+    this->directionY[lane] = ray.direction.y;
+    this->directionZ[lane] = ray.direction.z;
+    this->distance[lane] = std::numeric_limits<T>::infinity();
+    this->geometry[lane] = noGeometry;
+    return *this;
+  }
+
+  inline Ray<T> At(const size_t &lane) const noexcept {
+    return Ray<T>(Vector3D<T>(this->originX[lane], this->originY[lane],
+                              this->originZ[lane]),
+                  Vector3D<T>(this->directionX[lane], this->directionY[lane],
+                              this->directionZ[lane]));
+  }
+
+  inline bool Full() const noexcept { return this->count == size; }
+
+  ~RayPacket<T>() noexcept = default;
+};
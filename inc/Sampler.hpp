@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+/// An small and fast pseudo random number generator (PCG32), and the hashes
+/// the renders draw their random numbers from. The generator has state, so it's
+/// only used where the numbers are drawn in an fixed order, like generating the
+/// sample patterns. The samples and the paths hash their seed, their pixel and
+/// their number instead, so every pixel has its own stream which doesn't depend
+/// on the tiles, the threads or the order anything is rendered in.
+class SampleRandom {
+private:
+  uint64_t state;
+
+public:
+  explicit SampleRandom(const uint64_t &seed = 0) noexcept : state(0) {
+    this->Seed(seed);
+  }
+
+  SampleRandom &Seed(const uint64_t &seed) noexcept {
+    this->state = 0;
+    this->Next();
+    this->state += seed;
+    this->Next();
+    return *this;
+  }
+
+  inline uint32_t Next() noexcept {
+    const uint64_t previous = this->state;
+    this->state = previous * 6364136223846793005ULL + 1442695040888963407ULL;
+    const uint32_t shifted =
+        static_cast<uint32_t>(((previous >> 18) ^ previous) >> 27);
+    const uint32_t rotation = static_cast<uint32_t>(previous >> 59);
+    return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+  }
+
+  /// Draws an float in [0, 1), from the upper 24 bits so every value is exact.
+  inline float NextFloat() noexcept {
+    return static_cast<float>(this->Next() >> 8) * (1.0f / 16777216.0f);
+  }
+
+  /// Hashes the bits of the given numbers, the same numbers always give the
+  /// same hash.
+  template <typename... Values>
+  static inline uint64_t Hash(const Values &...values) noexcept {
+    uint64_t hash = 0;
+    for (const uint64_t &bits : {Bits(values)...}) {
+      hash = Mix(hash ^ bits);
+    }
+
+    return hash;
+  }
+
+  /// Turns an hash into an number in [0, 1).
+  template <typename T> static inline T Uniform(const uint64_t &hash) noexcept {
+    return static_cast<T>(static_cast<double>(hash >> 11) * 0x1p-53);
+  }
+
+  /// Turns the upper 24 bits of an hash into an float in [0, 1), like
+  /// NextFloat(). Shifting the hash left by 24 bits gives an other one.
+  static inline float Float(const uint64_t &hash) noexcept {
+    return static_cast<float>(hash >> 40) * (1.0f / 16777216.0f);
+  }
+
+  /// Gets the bits of an number of up to 64 bits.
+  template <typename Value>
+  static inline uint64_t Bits(const Value &value) noexcept {
+    static_assert(sizeof(Value) <= sizeof(uint64_t),
+                  "Only numbers of up to 64 bits can be hashed.");
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(Value));
+    return bits;
+  }
+
+  /// The finalizer of SplitMix64, spreads every bit of the input over all the
+  /// bits of the output.
+  static inline uint64_t Mix(uint64_t value) noexcept {
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+  }
+
+  ~SampleRandom() noexcept = default;
+};
+
+/// How the samples are spread over an pixel.
+enum class SamplePattern {
+  Stratified, // One jittered sample per cell of an grid over the pixel.
+  BlueNoise,  // Best candidate points, shifted randomly for every pixel.
+};
+
+/// How many samples the pixels get. With an threshold of zero every pixel gets
+/// the maximum, otherwise the pixels stop as soon as the standard error of
+/// their mean is below the threshold in every channel, in colors from 0 to 1.
+/// The minimum is capped at the maximum.
+class SampleSettings {
+public:
+  size_t minimumSamples, maximumSamples;
+  float threshold;
+  SamplePattern pattern;
+  uint64_t seed;
+
+public:
+  SampleSettings(const size_t &maximumSamples = 1,
+                 const size_t &minimumSamples = 4, const float &threshold = 0.0f,
+                 const SamplePattern &pattern = SamplePattern::Stratified,
+                 const uint64_t &seed = 0) noexcept
+      : minimumSamples(minimumSamples), maximumSamples(maximumSamples),
+        threshold(threshold), pattern(pattern), seed(seed) {}
+
+  /// Checks if there's more than the single ray through the pixel corner.
+  inline bool Enabled() const noexcept { return this->maximumSamples > 1; }
+
+  ~SampleSettings() noexcept = default;
+};
+
+/// The positions of the samples within an pixel, in the order they're taken.
+/// Every prefix of the order is spread evenly over the pixel, so the pixels
+/// which stop early are still sampled evenly. The pattern is the same for all
+/// pixels, every pixel randomizes it on its own to keep the pixels from
+/// aliasing together.
+class Sampler {
+public:
+  SampleSettings settings;
+
+private:
+  std::vector<float> points; // Pairs of x and y in [0, 1).
+  float cellSize;            // The jitter of an stratified sample.
+
+public:
+  /// Generates the pattern, throws on settings which make no sense.
+  Sampler(const SampleSettings &settings);
+
+  /// Gets the random shift of the pixel at the given position of the
+  /// viewport, only the blue noise uses it.
+  inline const Sampler &Shift(const size_t &pixelX, const size_t &pixelY,
+                              float &shiftX, float &shiftY) const noexcept {
+    if (this->settings.pattern != SamplePattern::BlueNoise) {
+      shiftX = shiftY = 0.0f;
+      return *this;
+    }
+
+    const uint64_t hash =
+        SampleRandom::Hash(this->settings.seed, pixelX, pixelY);
+    shiftX = SampleRandom::Float(hash);
+    shiftY = SampleRandom::Float(hash << 24);
+    return *this;
+  }
+
+  /// Gets the position of the given sample within the pixel at the given
+  /// position of the viewport, which has the given shift.
+  inline const Sampler &Position(const size_t &sample, const size_t &pixelX,
+                                 const size_t &pixelY, const float &shiftX,
+                                 const float &shiftY, float &x,
+                                 float &y) const noexcept {
+    x = this->points[sample * 2];
+    y = this->points[sample * 2 + 1];
+
+    if (this->settings.pattern == SamplePattern::Stratified) {
+      const uint64_t hash =
+          SampleRandom::Hash(this->settings.seed, pixelX, pixelY, sample);
+      x += SampleRandom::Float(hash) * this->cellSize;
+      y += SampleRandom::Float(hash << 24) * this->cellSize;
+    } else {
+      x += shiftX;
+      y += shiftY;
+      x -= x >= 1.0f ? 1.0f : 0.0f;
+      y -= y >= 1.0f ? 1.0f : 0.0f;
+    }
+
+    return *this;
+  }
+
+  ~Sampler() = default;
+};
+
+/// The state of the pixels of the tile an thread is sampling, kept between
+/// tiles so sampling does not allocate.
+class SampleBuffer {
+public:
+  std::vector<double> sums, squares; // RGB per pixel.
+  std::vector<uint32_t> counts;
+  std::vector<float> shifts;       // The x and y shift of every pixel.
+  std::vector<uint32_t> active;    // The pixels which have not converged.
+  std::vector<uint32_t> remaining; // Scratch for filtering the active ones.
+  std::vector<uint8_t> noisy;      // The pixels which have not converged.
+  uint64_t sampleCount; // All the samples this thread took this frame.
+
+public:
+  SampleBuffer() noexcept
+      : sums(), squares(), counts(), shifts(), active(), remaining(), noisy(),
+        sampleCount(0) {}
+
+  /// Clears the given number of pixels, and makes them all active.
+  SampleBuffer &Reset(const size_t &pixelCount);
+
+  /// Adds an sample to the given pixel.
+  inline SampleBuffer &Add(const uint32_t &pixel, const float &r,
+                           const float &g, const float &b) noexcept {
+    double *sum = this->sums.data() + pixel * 3;
+    double *square = this->squares.data() + pixel * 3;
+    sum[0] += r;
+    sum[1] += g;
+    sum[2] += b;
+    square[0] += static_cast<double>(r) * r;
+    square[1] += static_cast<double>(g) * g;
+    square[2] += static_cast<double>(b) * b;
+    ++this->counts[pixel];
+    ++this->sampleCount;
+    return *this;
+  }
+
+  /// Checks if the standard error of the mean of the pixel is below the
+  /// threshold in every channel.
+  bool Converged(const uint32_t &pixel, const float &threshold) const noexcept;
+
+  /// Drops the active pixels which have converged, unless one of their direct
+  /// neighbours has not. An edge which the first samples of an pixel missed
+  /// usually shows up as noise in the pixel next to it, so this catches most
+  /// of those. Nothing converges with an threshold of zero.
+  SampleBuffer &Settle(const size_t &width, const size_t &height,
+                       const float &threshold);
+
+  ~SampleBuffer() = default;
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "GeometryRegister.hpp"
+#include "Instance.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+#include "Matrix3D.hpp"
+#include "Sphere.hpp"
+#include "TriangleMesh.hpp"
+#include "Vector3D.hpp"
+
+/// Reads scenes from text files, one statement per line:
+///
+///   # Anything after an hash is an comment.
+///   material NAME R G B REFLECTIVITY
+///   sphere X Y Z RADIUS MATERIAL
+///   mesh PATH MATERIAL
+///   group NAME
+///     (spheres, meshes and instances, until the end)
+///   end
+///   instance GROUP X Y Z [YAW PITCH ROLL [SCALE]]
+///   light ambient R G B INTENSITY
+///   light point X Y Z R G B INTENSITY
+///   light directional X Y Z R G B INTENSITY
+///
+/// Materials and groups have to be defined before they're used, the angles of
+/// instances are in degrees and the paths of meshes are relative to the file.
+/// Lights belong to the scene, not to groups, the vector of an directional
+/// light is the direction it shines in. Without lights the materials are
+/// shown as they are.
+class SceneDescription {
+public:
+  /// Registers everything in the file at the given path, throws when it can't
+  /// be read or is malformed.
+  template <typename T>
+  static GeometryRegister<T> &Load(const std::string &path,
+                                   GeometryRegister<T> &geometryRegister) {
+    std::ifstream stream(path);
+    if (!stream) {
+      throw std::runtime_error("Failed to open " + path + ".");
+    }
+
+    const size_t slash = path.find_last_of('/');
+    const std::string directory =
+        slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+
+    std::map<std::string, Material<T>> materials;
+    std::map<std::string, std::shared_ptr<GeometryRegister<T>>> groups;
+    std::shared_ptr<GeometryRegister<T>> group; // The one being defined.
+
+    std::string line;
+    for (size_t number = 1; std::getline(stream, line); ++number) {
+      const auto fail = [&](const std::string &what) {
+        return std::runtime_error(path + ": " + what + " on line " +
+                                  std::to_string(number));
+      };
+
+      std::istringstream words(line.substr(0, line.find('#')));
+      std::string statement;
+      if (!(words >> statement)) {
+        continue;
+      }
+
+      GeometryRegister<T> &target = group != nullptr ? *group : geometryRegister;
+      const auto material = [&]() -> const Material<T> & {
+        std::string name;
+        words >> name;
+        const auto found = materials.find(name);
+        if (found == materials.end()) {
+          throw fail("Unknown material '" + name + "'");
+        }
+        return found->second;
+      };
+
+      if (statement == "material") {
+        std::string name;
+        double r, g, b, reflectivity;
+        if (!(words >> name >> r >> g >> b >> reflectivity)) {
+          throw fail("Expected an name, an color and an reflectivity");
+        }
+        materials.insert_or_assign(
+            name, Material<T>(Vector3D<T>(r, g, b), reflectivity));
+      } else if (statement == "sphere") {
+        double x, y, z, radius;
+        if (!(words >> x >> y >> z >> radius)) {
+          throw fail("Expected an position and an radius");
+        }
+        target.Register(std::make_shared<Sphere<T>>(Vector3D<T>(x, y, z),
+                                                    material(), radius));
+      } else if (statement == "mesh") {
+        std::string mesh;
+        if (!(words >> mesh)) {
+          throw fail("Expected an path");
+        }
+        target.Register(TriangleMesh<T>::Load(
+            mesh.front() == '/' ? mesh : directory + mesh, material()));
+      } else if (statement == "group") {
+        std::string name;
+        if (!(words >> name)) {
+          throw fail("Expected an name");
+        }
+        if (group != nullptr) {
+          throw fail("Groups can't be nested");
+        }
+        group = std::make_shared<GeometryRegister<T>>();
+        groups.insert_or_assign(name, group);
+      } else if (statement == "end") {
+        if (group == nullptr) {
+          throw fail("End of an group which was never started");
+        }
+        group->Build();
+        group = nullptr;
+      } else if (statement == "instance") {
+        std::string name;
+        double x, y, z;
+        if (!(words >> name >> x >> y >> z)) {
+          throw fail("Expected an group and an position");
+        }
+        const auto found = groups.find(name);
+        if (found == groups.end() || found->second == group) {
+          throw fail("Unknown group '" + name + "'");
+        }
+
+        double yaw = 0.0, pitch = 0.0, roll = 0.0, scale = 1.0;
+        if (words >> yaw) {
+          if (!(words >> pitch >> roll)) {
+            throw fail("Expected three angles");
+          }
+          words >> scale;
+        }
+
+        const T radians = static_cast<T>(M_PI / 180.0);
+        target.Register(std::make_shared<Instance<T>>(
+            found->second,
+            AffineMatrix3D<T>::Translation(Vector3D<T>(x, y, z))
+                .Multiply(AffineMatrix3D<T>::Rotation(
+                    Vector3D<T>(yaw, pitch, roll).Multiply(radians)))
+                .Multiply(AffineMatrix3D<T>::Scale(
+                    Vector3D<T>(scale, scale, scale)))));
+      } else if (statement == "light") {
+        std::string type;
+        double x = 0.0, y = 0.0, z = 0.0, r, g, b, intensity;
+        words >> type;
+        if (type != "ambient" && type != "point" && type != "directional") {
+          throw fail("Unknown light '" + type + "'");
+        }
+        if (type != "ambient" && !(words >> x >> y >> z)) {
+          throw fail("Expected an vector");
+        }
+        if (!(words >> r >> g >> b >> intensity)) {
+          throw fail("Expected an color and an intensity");
+        }
+        if (group != nullptr) {
+          throw fail("Lights can't be in groups");
+        }
+
+        const Vector3D<T> vector(x, y, z), color(r, g, b);
+        if (type == "ambient") {
+          geometryRegister.Illuminate(Light<T>::Ambient(color, intensity));
+        } else if (type == "point") {
+          geometryRegister.Illuminate(
+              Light<T>::Point(vector, color, intensity));
+        } else {
+          geometryRegister.Illuminate(
+              Light<T>::Directional(vector, color, intensity));
+        }
+      } else {
+        throw fail("Unknown statement '" + statement + "'");
+      }
+    }
+
+    if (group != nullptr) {
+      throw std::runtime_error(path + ": The last group never ends");
+    }
+
+    return geometryRegister;
+  }
+};
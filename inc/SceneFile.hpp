@@ -0,0 +1,630 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BoundingVolumeHierarchy.hpp"
+#include "FlatArray.hpp"
+#include "GeometryRegister.hpp"
+#include "Instance.hpp"
+#include "Light.hpp"
+#include "MappedFile.hpp"
+#include "Material.hpp"
+#include "Matrix3D.hpp"
+#include "SceneStore.hpp"
+#include "TriangleMesh.hpp"
+#include "Vector3D.hpp"
+
+/// The kinds of arrays in an scene file. Every array belongs to an register
+/// or to an mesh, the numbers are part of the format and never change.
+enum class SceneSection : uint32_t {
+  // The arrays of an register, the ones of its hierarchy and its store.
+  Nodes = 0,
+  Indices = 1,
+  Types = 2,
+  Slots = 3,
+  SphereX = 4,
+  SphereY = 5,
+  SphereZ = 6,
+  SphereRadius = 7,
+  SphereMaterials = 8,
+  Materials = 9,
+  OtherMeshes = 10, // The mesh every other primitive is.
+  OtherMaterials = 11,
+  Instances = 12,
+  InstanceMaterials = 13,
+  MaterialMap = 14,
+  Lights = 15, // Only the ones of the scene are used.
+
+  // The arrays of an mesh.
+  MeshVertices = 32,
+  MeshIndices = 33,
+  MeshNodes = 34,
+  MeshHierarchyIndices = 35,
+  MeshMaterial = 36, // Only the one.
+};
+
+/// How much of an scene file is checked when it's loaded.
+enum class SceneFileCheck {
+  Indices, // The layout and every index in the arrays, which reads them all.
+  Layout,  // Only the header and the sections, for files which are trusted.
+};
+
+/// The start of an scene file, followed by the table of its sections.
+class SceneFileHeader {
+public:
+  static constexpr char signature[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', 0};
+  static constexpr uint32_t currentVersion = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t precision; // The size of an coordinate, 4 or 8 bytes.
+  uint32_t registerCount; // The scene is the first, then the groups.
+  uint32_t meshCount;
+  uint64_t sectionCount;
+  uint64_t size; // Of the entire file, to catch truncated copies.
+};
+
+/// Where an array is in an scene file.
+class SceneFileSection {
+public:
+  SceneSection kind;
+  uint32_t owner; // The register or the mesh the array belongs to.
+  uint64_t offset;
+  uint64_t count;
+  uint64_t elementSize;
+};
+
+/// An instance as it's stored, the group is the index of an register.
+template <typename T> class SceneFileInstance {
+public:
+  AffineMatrix3D<T> transformation;
+  uint32_t group;
+  uint32_t reserved;
+};
+
+/// Reads and writes registers as binary scene files. An scene file contains
+/// the arrays of the scene store and the prebuilt hierarchy of every register
+/// and mesh in the scene, in the layout they have in memory. Loading maps the
+/// file and points the arrays of new registers straight at it, so nothing is
+/// copied or rebuilt and the pages are only read as the rays reach them.
+///
+/// The arrays start at multiples of 64 bytes, so they're as aligned as they
+/// would be in memory. The files are only read on machines with the byte
+/// order and precision they were written with, which is checked. By default
+/// every index in the arrays is checked as well, so an truncated or corrupted
+/// file throws instead of being read out of bounds, see SceneFileCheck.
+template <typename T> class SceneFile {
+public:
+  static constexpr uint64_t alignment = 64;
+
+  /// Writes the given register, every group of its instances and every mesh
+  /// to the given path. Registers are built first if they changed. Throws
+  /// when the scene contains geometry which can't be stored, which is
+  /// anything but spheres, triangle meshes and instances.
+  static void Write(GeometryRegister<T> &geometryRegister,
+                    const std::string &path) {
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    Write(geometryRegister, stream);
+    if (!stream) {
+      throw std::runtime_error("Failed to write " + path);
+    }
+  }
+
+  /// Writes the scene file of the given register to an stream, see Write().
+  /// The caller checks the stream for errors.
+  static void Write(GeometryRegister<T> &geometryRegister,
+                    std::ostream &stream) {
+    SceneFile<T> file;
+    file.AddRegisters(geometryRegister);
+
+    // Places the arrays after the header and the table.
+    uint64_t offset = Align(sizeof(SceneFileHeader) +
+                            file.sections.size() * sizeof(SceneFileSection));
+    for (SceneFileSection &section : file.sections) {
+      section.offset = offset;
+      offset = Align(offset + section.count * section.elementSize);
+    }
+
+    SceneFileHeader header;
+    std::memcpy(header.magic, SceneFileHeader::signature, sizeof(header.magic));
+    header.version = SceneFileHeader::currentVersion;
+    header.precision = sizeof(T);
+    header.registerCount = static_cast<uint32_t>(file.registers.size());
+    header.meshCount = static_cast<uint32_t>(file.meshes.size());
+    header.sectionCount = file.sections.size();
+    header.size = offset;
+
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char *>(file.sections.data()),
+                 file.sections.size() * sizeof(SceneFileSection));
+
+    static const char padding[alignment] = {};
+    uint64_t position = sizeof(header) +
+                        file.sections.size() * sizeof(SceneFileSection);
+    for (size_t i = 0; i < file.sections.size(); ++i) {
+      const SceneFileSection &section = file.sections[i];
+      stream.write(padding, section.offset - position);
+      stream.write(static_cast<const char *>(file.data[i]),
+                   section.count * section.elementSize);
+      position = section.offset + section.count * section.elementSize;
+    }
+    stream.write(padding, offset - position);
+  }
+
+  /// Maps the scene file at the given path, and gets the register of the
+  /// scene. The registers share the mapping and keep it alive, they can be
+  /// rendered but not changed. Throws when the file can't be read, is not an
+  /// scene file, was written for an other precision or fails the check.
+  static std::shared_ptr<GeometryRegister<T>>
+  Load(const std::string &path,
+       const SceneFileCheck &check = SceneFileCheck::Indices) {
+    return Load(std::make_shared<MappedFile>(path, MappedFileAccess::Preload),
+                path, check);
+  }
+
+  /// Gets the register of the scene file in the given mapping, see Load().
+  /// The name is what the errors refer to it by. The mapping has to start at
+  /// an multiple of the alignment, which they always do.
+  static std::shared_ptr<GeometryRegister<T>>
+  Load(const std::shared_ptr<MappedFile> &mapping, const std::string &path,
+       const SceneFileCheck &check = SceneFileCheck::Indices) {
+    char *data = mapping->Data();
+    const uint64_t size = mapping->Size();
+
+    const auto fail = [&path](const std::string &what) {
+      return std::runtime_error(path + ": " + what);
+    };
+
+    SceneFileHeader header;
+    if (size < sizeof(header)) {
+      throw fail("Not an scene file");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, SceneFileHeader::signature,
+                    sizeof(header.magic)) != 0) {
+      throw fail("Not an scene file");
+    }
+    if (header.version != SceneFileHeader::currentVersion) {
+      throw fail("Unsupported version " + std::to_string(header.version) +
+                 ", expected " +
+                 std::to_string(SceneFileHeader::currentVersion));
+    }
+    if (header.precision != sizeof(T)) {
+      throw fail(std::string("Written in ") +
+                 (header.precision == sizeof(float) ? "float" : "double") +
+                 " precision, expected " +
+                 (sizeof(T) == sizeof(float) ? "float" : "double"));
+    }
+    if (header.size != size) {
+      throw fail("Expected " + std::to_string(header.size) + " bytes, got " +
+                 std::to_string(size));
+    }
+    if (header.registerCount == 0 ||
+        header.sectionCount >
+            (size - sizeof(header)) / sizeof(SceneFileSection)) {
+      throw fail("Malformed header");
+    }
+
+    // Creates the meshes first, the registers refer to them.
+    std::vector<std::shared_ptr<TriangleMesh<T>>> meshes;
+    std::vector<MeshArrays> meshArrays(header.meshCount);
+    std::vector<std::shared_ptr<GeometryRegister<T>>> registers;
+    std::vector<RegisterArrays> registerArrays(header.registerCount);
+    for (uint32_t i = 0; i < header.registerCount; ++i) {
+      registers.push_back(std::make_shared<GeometryRegister<T>>());
+      registers.back()->mapping = mapping;
+    }
+
+    for (uint64_t i = 0; i < header.sectionCount; ++i) {
+      SceneFileSection section;
+      std::memcpy(&section,
+                  data + sizeof(header) + i * sizeof(SceneFileSection),
+                  sizeof(section));
+      if (section.offset % alignment != 0 || section.offset > size ||
+          (section.elementSize != 0 &&
+           section.count > (size - section.offset) / section.elementSize)) {
+        throw fail("Section " + std::to_string(i) + " is out of bounds");
+      }
+
+      char *elements = data + section.offset;
+      const bool mesh = section.kind >= SceneSection::MeshVertices;
+      if (section.owner >= (mesh ? header.meshCount : header.registerCount)) {
+        throw fail("Section " + std::to_string(i) +
+                   " belongs to nothing in the file");
+      }
+
+      if (mesh) {
+        meshArrays[section.owner].Assign(section, elements, fail);
+      } else {
+        registerArrays[section.owner].Assign(section, elements, fail);
+      }
+    }
+
+    for (MeshArrays &arrays : meshArrays) {
+      BoundingVolumeHierarchy<T> hierarchy;
+      hierarchy.nodes = std::move(arrays.nodes);
+      hierarchy.indices = std::move(arrays.hierarchyIndices);
+      if (arrays.material.size() != 1 || arrays.indices.size() % 3 != 0 ||
+          (check == SceneFileCheck::Indices &&
+           (!arrays.Valid() || !hierarchy.Valid(arrays.indices.size() / 3)))) {
+        throw fail("Malformed mesh");
+      }
+
+      meshes.push_back(std::make_shared<TriangleMesh<T>>(
+          std::move(arrays.vertices), std::move(arrays.indices),
+          std::move(hierarchy), arrays.material[0]));
+    }
+
+    for (uint32_t i = 0; i < header.registerCount; ++i) {
+      registerArrays[i].Apply(i, registers, registerArrays, meshes, check,
+                              fail);
+    }
+
+    return registers[0];
+  }
+
+private:
+  std::vector<SceneFileSection> sections;
+  std::vector<const void *> data; // The elements of every section.
+  std::map<const GeometryRegister<T> *, uint32_t> registers;
+  std::map<const TriangleMesh<T> *, uint32_t> meshes;
+
+  // The instances of every register, in the layout they're stored in. They
+  // don't exist anywhere else, so they're kept here until they're written.
+  std::vector<std::vector<SceneFileInstance<T>>> instances;
+  std::vector<std::vector<uint32_t>> otherMeshes;
+
+private:
+  SceneFile<T>() = default;
+
+  static inline uint64_t Align(const uint64_t &offset) noexcept {
+    return (offset + alignment - 1) / alignment * alignment;
+  }
+
+  template <typename A>
+  void AddSection(const SceneSection &kind, const uint32_t &owner,
+                  const A &array) {
+    SceneFileSection section;
+    section.kind = kind;
+    section.owner = owner;
+    section.offset = 0;
+    section.count = array.size();
+    section.elementSize = sizeof(typename A::value_type);
+    this->sections.push_back(section);
+    this->data.push_back(array.data());
+  }
+
+  /// Adds the arrays of the given register and of every group it refers to.
+  /// The registers are numbered in topological order, the given one first and
+  /// every group after all the registers with instances of it, so loading
+  /// can tell there are no cycles. Throws when an group has an instance of
+  /// itself.
+  void AddRegisters(GeometryRegister<T> &geometryRegister) {
+    std::map<const GeometryRegister<T> *, bool> finished;
+    std::vector<GeometryRegister<T> *> order;
+    Visit(geometryRegister, finished, order);
+
+    // Every register comes after the groups it refers to, backwards.
+    for (size_t i = 0; i < order.size(); ++i) {
+      this->registers.emplace(order[order.size() - 1 - i],
+                              static_cast<uint32_t>(i));
+    }
+    this->instances.resize(order.size());
+    this->otherMeshes.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      this->AddRegister(*order[order.size() - 1 - i], static_cast<uint32_t>(i));
+    }
+  }
+
+  /// Adds the given register after the groups it refers to, builds them
+  /// first if they changed.
+  static void Visit(GeometryRegister<T> &geometryRegister,
+                    std::map<const GeometryRegister<T> *, bool> &finished,
+                    std::vector<GeometryRegister<T> *> &order) {
+    const auto found = finished.find(&geometryRegister);
+    if (found != finished.end()) {
+      if (!found->second) {
+        throw std::runtime_error("An group can't contain an instance of "
+                                 "itself");
+      }
+      return;
+    }
+
+    geometryRegister.BuildIfDirty();
+    finished.emplace(&geometryRegister, false);
+    for (const Instance<T> *instance : geometryRegister.store.instances) {
+      Visit(*instance->group, finished, order);
+    }
+    finished[&geometryRegister] = true;
+    order.push_back(&geometryRegister);
+  }
+
+  /// Adds the arrays of the given register, and the meshes it refers to. The
+  /// groups have to be numbered already. Every mesh is only added once.
+  void AddRegister(const GeometryRegister<T> &geometryRegister,
+                   const uint32_t &index) {
+    const SceneStore<T> &store = geometryRegister.store;
+    for (const Instance<T> *instance : store.instances) {
+      const uint32_t &group = this->registers.at(instance->group.get());
+      this->instances[index].push_back(
+          SceneFileInstance<T>{instance->Transformation(), group, 0});
+    }
+    for (Geometry<T> *other : store.others) {
+      const TriangleMesh<T> *mesh = dynamic_cast<const TriangleMesh<T> *>(other);
+      if (mesh == nullptr) {
+        throw std::runtime_error("Only spheres, triangle meshes and instances "
+                                 "can be written to an scene file");
+      }
+      this->otherMeshes[index].push_back(this->AddMesh(*mesh));
+    }
+
+    const BoundingVolumeHierarchy<T> &hierarchy = geometryRegister.hierarchy;
+    this->AddSection(SceneSection::Nodes, index, hierarchy.nodes);
+    this->AddSection(SceneSection::Indices, index, hierarchy.indices);
+    this->AddSection(SceneSection::Types, index, store.types);
+    this->AddSection(SceneSection::Slots, index, store.slots);
+    this->AddSection(SceneSection::SphereX, index, store.sphereX);
+    this->AddSection(SceneSection::SphereY, index, store.sphereY);
+    this->AddSection(SceneSection::SphereZ, index, store.sphereZ);
+    this->AddSection(SceneSection::SphereRadius, index, store.sphereRadius);
+    this->AddSection(SceneSection::SphereMaterials, index,
+                     store.sphereMaterials);
+    this->AddSection(SceneSection::Materials, index, store.materials);
+    this->AddSection(SceneSection::OtherMeshes, index,
+                     this->otherMeshes[index]);
+    this->AddSection(SceneSection::OtherMaterials, index, store.otherMaterials);
+    this->AddSection(SceneSection::Instances, index, this->instances[index]);
+    this->AddSection(SceneSection::InstanceMaterials, index,
+                     store.instanceMaterials);
+    this->AddSection(SceneSection::MaterialMap, index, store.materialMap);
+    this->AddSection(SceneSection::Lights, index, geometryRegister.lights);
+  }
+
+  uint32_t AddMesh(const TriangleMesh<T> &mesh) {
+    const auto [iterator, inserted] = this->meshes.emplace(
+        &mesh, static_cast<uint32_t>(this->meshes.size()));
+    if (inserted) {
+      const uint32_t &index = iterator->second;
+      this->AddSection(SceneSection::MeshVertices, index, mesh.vertices);
+      this->AddSection(SceneSection::MeshIndices, index, mesh.indices);
+      this->AddSection(SceneSection::MeshNodes, index, mesh.hierarchy.nodes);
+      this->AddSection(SceneSection::MeshHierarchyIndices, index,
+                       mesh.hierarchy.indices);
+
+      // The material is the only one not in an array already.
+      this->sections.push_back(SceneFileSection{
+          SceneSection::MeshMaterial, index, 0, 1, sizeof(Material<T>)});
+      this->data.push_back(&mesh.material);
+    }
+
+    return iterator->second;
+  }
+
+  /// Points the given array at the elements of an section, after checking
+  /// they're what the array holds.
+  template <typename V, typename F>
+  static void View(FlatArray<V> &array, const SceneFileSection &section,
+                   char *elements, const F &fail) {
+    if (section.elementSize != sizeof(V)) {
+      throw fail("Section " + std::to_string(static_cast<uint32_t>(section.kind)) +
+                 " has elements of " + std::to_string(section.elementSize) +
+                 " bytes, expected " + std::to_string(sizeof(V)));
+    }
+
+    array = FlatArray<V>::View(reinterpret_cast<V *>(elements),
+                               static_cast<size_t>(section.count));
+  }
+
+  /// The arrays of an mesh in an file being loaded.
+  class MeshArrays {
+  public:
+    FlatArray<Vector3D<T>> vertices;
+    FlatArray<uint32_t> indices;
+    FlatArray<BoundingVolumeNode<T>> nodes;
+    FlatArray<uint32_t> hierarchyIndices;
+    FlatArray<Material<T>> material;
+
+  public:
+    template <typename F>
+    void Assign(const SceneFileSection &section, char *elements,
+                const F &fail) {
+      switch (section.kind) {
+      case SceneSection::MeshVertices:
+        return View(this->vertices, section, elements, fail);
+      case SceneSection::MeshIndices:
+        return View(this->indices, section, elements, fail);
+      case SceneSection::MeshNodes:
+        return View(this->nodes, section, elements, fail);
+      case SceneSection::MeshHierarchyIndices:
+        return View(this->hierarchyIndices, section, elements, fail);
+      case SceneSection::MeshMaterial:
+        return View(this->material, section, elements, fail);
+      default:
+        throw fail("Unknown section " +
+                   std::to_string(static_cast<uint32_t>(section.kind)));
+      }
+    }
+
+    /// Checks the triangles refer to vertices which exist.
+    bool Valid() const {
+      for (const uint32_t &vertex : this->indices) {
+        if (vertex >= this->vertices.size()) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+  };
+
+  /// The arrays of an register in an file being loaded, the ones which
+  /// aren't in the store itself.
+  class RegisterArrays {
+  public:
+    BoundingVolumeHierarchy<T> hierarchy;
+    SceneStore<T> store;
+    FlatArray<uint32_t> otherMeshes;
+    FlatArray<SceneFileInstance<T>> instances;
+    FlatArray<Light<T>> lights;
+
+  public:
+    template <typename F>
+    void Assign(const SceneFileSection &section, char *elements,
+                const F &fail) {
+      switch (section.kind) {
+      case SceneSection::Nodes:
+        return View(this->hierarchy.nodes, section, elements, fail);
+      case SceneSection::Indices:
+        return View(this->hierarchy.indices, section, elements, fail);
+      case SceneSection::Types:
+        return View(this->store.types, section, elements, fail);
+      case SceneSection::Slots:
+        return View(this->store.slots, section, elements, fail);
+      case SceneSection::SphereX:
+        return View(this->store.sphereX, section, elements, fail);
+      case SceneSection::SphereY:
+        return View(this->store.sphereY, section, elements, fail);
+      case SceneSection::SphereZ:
+        return View(this->store.sphereZ, section, elements, fail);
+      case SceneSection::SphereRadius:
+        return View(this->store.sphereRadius, section, elements, fail);
+      case SceneSection::SphereMaterials:
+        return View(this->store.sphereMaterials, section, elements, fail);
+      case SceneSection::Materials:
+        return View(this->store.materials, section, elements, fail);
+      case SceneSection::OtherMeshes:
+        return View(this->otherMeshes, section, elements, fail);
+      case SceneSection::OtherMaterials:
+        return View(this->store.otherMaterials, section, elements, fail);
+      case SceneSection::Instances:
+        return View(this->instances, section, elements, fail);
+      case SceneSection::InstanceMaterials:
+        return View(this->store.instanceMaterials, section, elements, fail);
+      case SceneSection::MaterialMap:
+        return View(this->store.materialMap, section, elements, fail);
+      case SceneSection::Lights:
+        return View(this->lights, section, elements, fail);
+      default:
+        throw fail("Unknown section " +
+                   std::to_string(static_cast<uint32_t>(section.kind)));
+      }
+    }
+
+    /// Checks every index in the arrays of the register with the given
+    /// index, once their sizes match up. The groups of its instances come
+    /// after it, so their arrays haven't been moved into their registers yet.
+    bool Valid(const uint32_t &index,
+               const std::vector<RegisterArrays> &arrays) const {
+      const SceneStore<T> &store = this->store;
+      if (!this->hierarchy.Valid(store.types.size())) {
+        return false;
+      }
+
+      for (size_t i = 0; i < store.types.size(); ++i) {
+        switch (store.types[i]) {
+        case PrimitiveType::Sphere:
+          if (store.slots[i] >= store.sphereRadius.size()) {
+            return false;
+          }
+          break;
+        case PrimitiveType::Geometry:
+          if (store.slots[i] >= this->otherMeshes.size()) {
+            return false;
+          }
+          break;
+        case PrimitiveType::Instance:
+          if (store.slots[i] >= this->instances.size()) {
+            return false;
+          }
+          break;
+        default:
+          return false;
+        }
+      }
+
+      const size_t materialCount = store.materials.size();
+      for (const FlatArray<uint32_t> *materials :
+           {&store.sphereMaterials, &store.otherMaterials, &store.materialMap}) {
+        for (const uint32_t &material : *materials) {
+          if (material >= materialCount) {
+            return false;
+          }
+        }
+      }
+
+      // An instance maps all the materials of its group.
+      for (size_t i = 0; i < this->instances.size(); ++i) {
+        const uint32_t &group = this->instances[i].group;
+        if (group <= index || group >= arrays.size() ||
+            static_cast<uint64_t>(store.instanceMaterials[i]) +
+                    arrays[group].store.materials.size() >
+                store.materialMap.size()) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    /// Moves the arrays into the given register, and creates the instances
+    /// and the meshes its store points to. Groups always come after all the
+    /// registers their instances are in, so there can't be any cycles.
+    template <typename F>
+    void Apply(const uint32_t &index,
+               const std::vector<std::shared_ptr<GeometryRegister<T>>>
+                   &registers,
+               const std::vector<RegisterArrays> &arrays,
+               const std::vector<std::shared_ptr<TriangleMesh<T>>> &meshes,
+               const SceneFileCheck &check, const F &fail) {
+      GeometryRegister<T> &geometryRegister = *registers[index];
+      const size_t sphereCount = this->store.sphereRadius.size();
+      if (this->store.slots.size() != this->store.types.size() ||
+          this->hierarchy.indices.size() > this->store.types.size() ||
+          this->store.sphereX.size() != sphereCount ||
+          this->store.sphereY.size() != sphereCount ||
+          this->store.sphereZ.size() != sphereCount ||
+          this->store.sphereMaterials.size() != sphereCount ||
+          this->otherMeshes.size() != this->store.otherMaterials.size() ||
+          this->instances.size() != this->store.instanceMaterials.size()) {
+        throw fail("The arrays of an register don't match up");
+      }
+      if (check == SceneFileCheck::Indices && !this->Valid(index, arrays)) {
+        throw fail("Register " + std::to_string(index) +
+                   " refers to something which is not in the file");
+      }
+
+      for (const uint32_t &mesh : this->otherMeshes) {
+        if (mesh >= meshes.size()) {
+          throw fail("Reference to mesh " + std::to_string(mesh) +
+                     " which is not in the file");
+        }
+        this->store.others.push_back(meshes[mesh].get());
+        geometryRegister.geometries.push_back(meshes[mesh]);
+      }
+
+      for (const SceneFileInstance<T> &record : this->instances) {
+        if (record.group >= registers.size() || record.group <= index) {
+          throw fail("Reference to group " + std::to_string(record.group) +
+                     " which is not in the file");
+        }
+        std::shared_ptr<Instance<T>> instance = std::make_shared<Instance<T>>(
+            registers[record.group], record.transformation);
+        this->store.instances.push_back(instance.get());
+        geometryRegister.geometries.push_back(instance);
+      }
+
+      geometryRegister.hierarchy = std::move(this->hierarchy);
+      geometryRegister.store = std::move(this->store);
+      geometryRegister.lights = std::move(this->lights);
+    }
+  };
+};
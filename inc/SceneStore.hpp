@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include "FlatArray.hpp"
+#include "Geometry.hpp"
+#include "Material.hpp"
+#include "Ray.hpp"
+#include "RayPacket.hpp"
+#include "Sphere.hpp"
+#include "Vector3D.hpp"
+
+// Defined in Instance.hpp, which is included by GeometryRegister.hpp.
+template <typename T> class Instance;
+
+/// The kinds of primitives the scene store keeps in an flat layout, anything
+/// else goes through the virtual functions of Geometry.
+enum class PrimitiveType : uint8_t {
+  Sphere,   // Stored in the sphere arrays.
+  Geometry, // Stored as an pointer, intersected through the vtable.
+  Instance, // An placed copy of an group, which has its own materials.
+};
+
+/// The primitives of an scene in contiguous arrays, segregated by type. The
+/// primitives are numbered in the order they're added, which the register
+/// makes the order of the leaves of its hierarchy so an leaf covers an
+/// contiguous range of every array.
+template <typename T> class SceneStore {
+public:
+  // Per primitive: its type, its index in the arrays of that type and the
+  // index of the registered geometry it came from.
+  FlatArray<PrimitiveType> types;
+  FlatArray<uint32_t> slots;
+  FlatArray<uint32_t> geometries;
+
+  // The spheres, as an structure of arrays.
+  FlatArray<T> sphereX, sphereY, sphereZ, sphereRadius;
+  FlatArray<uint32_t> sphereMaterials;
+
+  // The primitives without an flat layout.
+  std::vector<Geometry<T> *> others;
+  FlatArray<uint32_t> otherMaterials;
+
+  // The instances, and where the materials of their group start in the
+  // material map. The map turns the material indices of an group into indices
+  // in this store, every group is mapped once no matter how many instances of
+  // it there are.
+  std::vector<const Instance<T> *> instances;
+  FlatArray<uint32_t> instanceMaterials;
+  FlatArray<uint32_t> materialMap;
+
+  // The distinct materials, referred to by index.
+  FlatArray<Material<T>> materials;
+
+private:
+  std::map<std::tuple<T, T, T, T>, uint32_t> materialIndices;
+  std::map<const SceneStore<T> *, uint32_t> groupMaterials;
+
+public:
+  SceneStore<T>() = default;
+
+  SceneStore<T> &Clear() {
+    *this = SceneStore<T>();
+    return *this;
+  }
+
+  /// Adds the given geometry as the next primitive, the geometry has to stay
+  /// alive for as long as the store is used.
+  SceneStore<T> &Add(Geometry<T> *geometry, const uint32_t &geometryIndex) {
+    if (const Instance<T> *instance =
+            dynamic_cast<const Instance<T> *>(geometry)) {
+      this->types.push_back(PrimitiveType::Instance);
+      this->slots.push_back(static_cast<uint32_t>(this->instances.size()));
+      this->instances.push_back(instance);
+      this->instanceMaterials.push_back(
+          this->AddGroupMaterials(instance->group->store));
+      this->geometries.push_back(geometryIndex);
+      return *this;
+    }
+
+    const uint32_t material = this->AddMaterial(geometry->material);
+
+    if (const Sphere<T> *sphere = dynamic_cast<const Sphere<T> *>(geometry)) {
+      this->types.push_back(PrimitiveType::Sphere);
+      this->slots.push_back(static_cast<uint32_t>(this->sphereRadius.size()));
+      this->sphereX.push_back(sphere->position.x);
+      this->sphereY.push_back(sphere->position.y);
+      this->sphereZ.push_back(sphere->position.z);
+      this->sphereRadius.push_back(sphere->radius);
+      this->sphereMaterials.push_back(material);
+    } else {
+      this->types.push_back(PrimitiveType::Geometry);
+      this->slots.push_back(static_cast<uint32_t>(this->others.size()));
+      this->others.push_back(geometry);
+      this->otherMaterials.push_back(material);
+    }
+
+    this->geometries.push_back(geometryIndex);
+    return *this;
+  }
+
+  /// Copies the given geometry into the primitive again, after it has been
+  /// moved. The geometry has to be the one the primitive was added as.
+  SceneStore<T> &Update(const uint32_t &primitive, const Geometry<T> &geometry) {
+    if (this->types[primitive] == PrimitiveType::Sphere) {
+      const Sphere<T> &sphere = static_cast<const Sphere<T> &>(geometry);
+      const uint32_t &slot = this->slots[primitive];
+      this->sphereX[slot] = sphere.position.x;
+      this->sphereY[slot] = sphere.position.y;
+      this->sphereZ[slot] = sphere.position.z;
+      this->sphereRadius[slot] = sphere.radius;
+    }
+
+    return *this;
+  }
+
+  inline size_t Size() const noexcept { return this->types.size(); }
+
+  /// Gets the distance at which the ray hits the given primitive. Anything but
+  /// an sphere only knows its normal and material while intersecting, like
+  /// the triangle of an mesh which was hit, so those are written to the given
+  /// normal and material. They're left alone for spheres, see Surface().
+  inline std::optional<T> Intersect(const uint32_t &primitive,
+                                    const Ray<T> &ray,
+                                    Vector3D<T> *normal = nullptr,
+                                    uint32_t *material = nullptr) const {
+    const uint32_t &slot = this->slots[primitive];
+    switch (this->types[primitive]) {
+    case PrimitiveType::Sphere:
+      return Sphere<T>::Intersect(ray, this->SphereCenter(slot),
+                                  this->sphereRadius[slot]);
+    case PrimitiveType::Geometry: {
+      const std::optional<RayHitResult<T>> hitResult =
+          this->others[slot]->RayHit(ray);
+      if (!hitResult.has_value()) {
+        return std::nullopt;
+      }
+
+      if (normal != nullptr) {
+        *normal = hitResult->normal;
+      }
+      if (material != nullptr) {
+        *material = this->otherMaterials[slot];
+      }
+
+      return hitResult->distance;
+    }
+    case PrimitiveType::Instance: {
+      const std::optional<HitRecord<T>> hit =
+          this->instances[slot]->ClosestHit(ray);
+      if (!hit.has_value()) {
+        return std::nullopt;
+      }
+
+      if (normal != nullptr) {
+        *normal = hit->normal;
+      }
+      if (material != nullptr) {
+        *material =
+            this->materialMap[this->instanceMaterials[slot] + hit->material];
+      }
+
+      return hit->distance;
+    }
+    }
+
+    return std::nullopt;
+  }
+
+  /// Intersects all the rays in the packet with the given primitive, lanes
+  /// with an closer hit get the primitive as their geometry.
+  inline void IntersectPacket(const uint32_t &primitive,
+                              RayPacket<T> &packet) const {
+    const uint32_t &slot = this->slots[primitive];
+    switch (this->types[primitive]) {
+    case PrimitiveType::Sphere:
+      Sphere<T>::IntersectPacket(packet, this->sphereX[slot],
+                                 this->sphereY[slot], this->sphereZ[slot],
+                                 this->sphereRadius[slot], primitive);
+      break;
+    case PrimitiveType::Geometry:
+    case PrimitiveType::Instance:
+      for (size_t lane = 0; lane < packet.count; ++lane) {
+        const std::optional<T> distance =
+            this->Intersect(primitive, packet.At(lane));
+        if (distance.has_value() &&
+            (*distance < packet.distance[lane] ||
+             (*distance == packet.distance[lane] &&
+              primitive < packet.geometry[lane]))) {
+          packet.distance[lane] = *distance;
+          packet.geometry[lane] = primitive;
+        }
+      }
+      break;
+    }
+  }
+
+  /// Checks if the ray hits the given primitive within the given distance,
+  /// meshes and instances stop at the first hit they find.
+  inline bool Occludes(const uint32_t &primitive, const Ray<T> &ray,
+                       const T &maxDistance) const {
+    const uint32_t &slot = this->slots[primitive];
+    switch (this->types[primitive]) {
+    case PrimitiveType::Sphere: {
+      const std::optional<T> distance = Sphere<T>::Intersect(
+          ray, this->SphereCenter(slot), this->sphereRadius[slot]);
+      return distance.has_value() && *distance <= maxDistance;
+    }
+    case PrimitiveType::Geometry:
+      return this->others[slot]->Occluded(ray, maxDistance);
+    case PrimitiveType::Instance:
+      return this->instances[slot]->Occluded(ray, maxDistance);
+    }
+
+    return false;
+  }
+
+  /// Checks all the rays in the packet against the given primitive, the
+  /// distance of every lane being the one within which it's blocked. Lanes
+  /// which are get the primitive as their geometry, see IntersectPacket().
+  inline void OccludesPacket(const uint32_t &primitive,
+                             RayPacket<T> &packet) const {
+    const uint32_t &slot = this->slots[primitive];
+    if (this->types[primitive] == PrimitiveType::Sphere) {
+      Sphere<T>::IntersectPacket(packet, this->sphereX[slot],
+                                 this->sphereY[slot], this->sphereZ[slot],
+                                 this->sphereRadius[slot], primitive);
+      return;
+    }
+
+    for (size_t lane = 0; lane < packet.count; ++lane) {
+      if (packet.geometry[lane] == RayPacket<T>::noGeometry &&
+          this->Occludes(primitive, packet.At(lane), packet.distance[lane])) {
+        packet.geometry[lane] = primitive;
+      }
+    }
+  }
+
+  /// Gets the normal and the material of the given primitive where the ray
+  /// hits it at the given distance. Anything but an sphere is intersected
+  /// again for this.
+  inline void Surface(const uint32_t &primitive, const Ray<T> &ray,
+                      const T &distance, Vector3D<T> &normal,
+                      uint32_t &material) const {
+    const uint32_t &slot = this->slots[primitive];
+    if (this->types[primitive] == PrimitiveType::Sphere) {
+      normal = ray.origin.Add(ray.direction.Multiply(distance))
+                   .Subtract(this->SphereCenter(slot))
+                   .Normalize();
+      material = this->sphereMaterials[slot];
+      return;
+    }
+
+    this->Intersect(primitive, ray, &normal, &material);
+  }
+
+  ~SceneStore<T>() = default;
+
+private:
+  inline Vector3D<T> SphereCenter(const uint32_t &slot) const noexcept {
+    return Vector3D<T>(this->sphereX[slot], this->sphereY[slot],
+                       this->sphereZ[slot]);
+  }
+
+  /// Gets the index of the given material, identical materials share one.
+  uint32_t AddMaterial(const Material<T> &material) {
+    const std::tuple<T, T, T, T> key(material.color.x, material.color.y,
+                                     material.color.z, material.reflectivity);
+    const auto [iterator, inserted] = this->materialIndices.emplace(
+        key, static_cast<uint32_t>(this->materials.size()));
+    if (inserted) {
+      this->materials.push_back(material);
+    }
+
+    return iterator->second;
+  }
+
+  /// Adds the materials of the given group to the material map, and gets
+  /// where they start in it.
+  uint32_t AddGroupMaterials(const SceneStore<T> &group) {
+    const auto [iterator, inserted] = this->groupMaterials.emplace(
+        &group, static_cast<uint32_t>(this->materialMap.size()));
+    if (inserted) {
+      for (const Material<T> &material : group.materials) {
+        this->materialMap.push_back(this->AddMaterial(material));
+      }
+    }
+
+    return iterator->second;
+  }
+};
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "Animation.hpp"
+#include "BoundingBox.hpp"
+#include "Camera.hpp"
+#include "GeometryRegister.hpp"
+#include "Instance.hpp"
+#include "Material.hpp"
+#include "Matrix3D.hpp"
+#include "Sphere.hpp"
+#include "TriangleMesh.hpp"
+#include "Vector3D.hpp"
+
+/// The scene shown by the viewer: an red sphere in the center, and an green one
+/// next to it.
+template <typename T>
+GeometryRegister<T> &createTwoSphereScene(GeometryRegister<T> &geometryRegister) {
+  geometryRegister
+      .Register(std::make_shared<Sphere<T>>(
+          Vector3D<T>(0.0, 0.0, 30.0),
+          Material<T>(Vector3D<T>(1.0, 0.0, 0.0), 0.9), 20.0))
+      .Register(std::make_shared<Sphere<T>>(
+          Vector3D<T>(-30.0, 0.0, 0.0),
+          Material<T>(Vector3D<T>(0.0, 1.0, 0.0), 0.9), 27.0));
+
+  return geometryRegister;
+}
+
+/// The camera looking at the two sphere scene, with an viewport of the given
+/// size.
+template <typename T>
+Camera<T> createTwoSphereCamera(const size_t &viewportWidth,
+                                const size_t &viewportHeight) {
+  return Camera<T>(Vector3D<T>(0.0, 0.0, -20.0), Vector3D<T>(0.0, 0.0, 0.0),
+                   viewportWidth, viewportHeight);
+}
+
+/// The two spheres, with an small blue one orbiting the red one once every
+/// few seconds. It passes in front of the red one and behind it.
+template <typename T>
+GeometryRegister<T> &createOrbitScene(GeometryRegister<T> &geometryRegister,
+                                      Animator<T> &animator) {
+  createTwoSphereScene(geometryRegister);
+
+  std::shared_ptr<Sphere<T>> moon = std::make_shared<Sphere<T>>(
+      Vector3D<T>(45.0, 0.0, 0.0),
+      Material<T>(Vector3D<T>(0.2, 0.4, 1.0), 0.5), 8.0);
+  geometryRegister.Register(moon);
+
+  // Turns around the center of the red sphere, an quarter per keyframe.
+  Animation<T> orbit;
+  for (size_t quarter = 0; quarter <= 4; ++quarter) {
+    orbit.Add(Keyframe<T>(static_cast<T>(quarter),
+                          Vector3D<T>(0.0, 0.0, 30.0),
+                          Vector3D<T>(0.3, static_cast<T>(quarter * M_PI / 2.0),
+                                      0.0)));
+  }
+  animator.Animate(moon, orbit);
+
+  return geometryRegister;
+}
+
+/// An flat grid of count * count spheres facing the camera, every sphere has
+/// its own color.
+template <typename T>
+GeometryRegister<T> &createSphereGridScene(GeometryRegister<T> &geometryRegister,
+                                           const size_t &count) {
+  const T spacing = 6.0;
+  const T offset = spacing * static_cast<T>(count - 1) / static_cast<T>(2.0);
+
+  for (size_t y = 0; y < count; ++y) {
+    for (size_t x = 0; x < count; ++x) {
+      geometryRegister.Register(std::make_shared<Sphere<T>>(
+          Vector3D<T>(static_cast<T>(x) * spacing - offset,
+                      static_cast<T>(y) * spacing - offset, 100.0),
+          Material<T>(Vector3D<T>(static_cast<T>(x) / static_cast<T>(count),
+                                  static_cast<T>(y) / static_cast<T>(count),
+                                  0.5),
+                      0.5),
+          2.5));
+    }
+  }
+
+  return geometryRegister;
+}
+
+/// The camera looking straight at the sphere grid, one pixel per unit.
+template <typename T>
+Camera<T> createSphereGridCamera(const size_t &viewportWidth,
+                                 const size_t &viewportHeight) {
+  return Camera<T>(Vector3D<T>(0.0, 0.0, 0.0), Vector3D<T>(0.0, 0.0, 0.0),
+                   viewportWidth, viewportHeight);
+}
+
+/// Draws the next number of the given distribution, converted to T. The
+/// random scenes are always drawn in double precision so they're the same
+/// scene in every precision.
+template <typename T>
+inline T draw(std::uniform_real_distribution<double> &distribution,
+              std::mt19937 &random) {
+  return static_cast<T>(distribution(random));
+}
+
+/// Draws an vector, the components are drawn in order.
+template <typename T>
+inline Vector3D<T> drawVector(std::uniform_real_distribution<double> &distribution,
+                              std::mt19937 &random) {
+  const T x = draw<T>(distribution, random);
+  const T y = draw<T>(distribution, random);
+  const T z = draw<T>(distribution, random);
+  return Vector3D<T>(x, y, z);
+}
+
+/// The given number of small spheres, placed randomly in an cube of which the
+/// size grows with the count so the density stays the same. The seed makes
+/// the scene the same on every run.
+template <typename T>
+GeometryRegister<T> &
+createRandomSpheresScene(GeometryRegister<T> &geometryRegister,
+                         const size_t &count, const uint32_t &seed = 1234) {
+  std::mt19937 random(seed);
+  const double side = 20.0 * std::cbrt(static_cast<double>(count));
+  std::uniform_real_distribution<double> position(-side / 2, side / 2);
+  std::uniform_real_distribution<double> channel(0.0, 1.0);
+  std::uniform_real_distribution<double> radius(0.5, 2.0);
+
+  for (size_t i = 0; i < count; ++i) {
+    const Vector3D<T> center =
+        drawVector<T>(position, random)
+            .Add(Vector3D<T>(0.0, 0.0, static_cast<T>(side)));
+    const Vector3D<T> color = drawVector<T>(channel, random);
+    const T reflectivity = draw<T>(channel, random);
+    geometryRegister.Register(std::make_shared<Sphere<T>>(
+        center, Material<T>(color, reflectivity), draw<T>(radius, random)));
+  }
+
+  return geometryRegister;
+}
+
+/// The camera in front of the cube of random spheres.
+template <typename T>
+Camera<T> createRandomSpheresCamera(const size_t &viewportWidth,
+                                    const size_t &viewportHeight) {
+  return Camera<T>(Vector3D<T>(0.0, 0.0, 0.0), Vector3D<T>(0.0, 0.0, 0.0),
+                   viewportWidth, viewportHeight, Projection::Perspective);
+}
+
+/// The random spheres, every one drifting off in its own direction at its own
+/// speed. The further they get the worse an refit hierarchy becomes, so this
+/// shows when rebuilding pays off.
+template <typename T>
+GeometryRegister<T> &
+createDriftingSpheresScene(GeometryRegister<T> &geometryRegister,
+                           Animator<T> &animator, const size_t &count,
+                           const T &duration, const uint32_t &seed = 1234) {
+  createRandomSpheresScene(geometryRegister, count, seed);
+
+  std::mt19937 random(seed + 1);
+  const double side = 20.0 * std::cbrt(static_cast<double>(count));
+  std::uniform_real_distribution<double> drift(-side / 16, side / 16);
+  for (const std::shared_ptr<Geometry<T>> &geometry :
+       geometryRegister.geometries) {
+    Animation<T> animation;
+    animation.Add(Keyframe<T>(0.0, Vector3D<T>(0.0, 0.0, 0.0)))
+        .Add(Keyframe<T>(duration, drawVector<T>(drift, random)));
+    animator.Animate(geometry, animation);
+  }
+
+  return geometryRegister;
+}
+
+/// The distance between the instances of the instanced spheres scene.
+template <typename T>
+T instancedSpheresSpacing(const size_t &groupSize) {
+  return static_cast<T>(30.0) * std::cbrt(static_cast<T>(groupSize));
+}
+
+/// An square grid of instances of one group of random spheres, every instance
+/// turned another way. The group is only stored once, so this scales to many
+/// more spheres than fit in memory.
+template <typename T>
+GeometryRegister<T> &
+createInstancedSpheresScene(GeometryRegister<T> &geometryRegister,
+                            const size_t &instanceCount,
+                            const size_t &groupSize,
+                            const uint32_t &seed = 1234) {
+  std::shared_ptr<GeometryRegister<T>> group =
+      std::make_shared<GeometryRegister<T>>();
+  createRandomSpheresScene(*group, groupSize, seed).Build();
+  const Vector3D<T> groupCenter = group->Bounds().Centroid();
+
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<double> angle(0.0, 2.0 * M_PI);
+  const size_t side = static_cast<size_t>(
+      std::ceil(std::sqrt(static_cast<T>(instanceCount))));
+  const T spacing = instancedSpheresSpacing<T>(groupSize);
+  const T offset = spacing * static_cast<T>(side - 1) / static_cast<T>(2.0);
+
+  for (size_t i = 0; i < instanceCount; ++i) {
+    const Vector3D<T> position(static_cast<T>(i % side) * spacing - offset,
+                               static_cast<T>(i / side) * spacing - offset,
+                               0.0);
+    const Vector3D<T> angles = drawVector<T>(angle, random);
+    geometryRegister.Register(std::make_shared<Instance<T>>(
+        group, AffineMatrix3D<T>::Translation(position)
+                   .Multiply(AffineMatrix3D<T>::Rotation(angles))
+                   .Multiply(AffineMatrix3D<T>::Translation(
+                       groupCenter.Multiply(-1.0)))));
+  }
+
+  return geometryRegister;
+}
+
+/// The camera in front of the grid of instances, far enough back to see all
+/// of them.
+template <typename T>
+Camera<T> createInstancedSpheresCamera(const size_t &viewportWidth,
+                                       const size_t &viewportHeight,
+                                       const size_t &instanceCount,
+                                       const size_t &groupSize) {
+  const T side = std::ceil(std::sqrt(static_cast<T>(instanceCount))) *
+                 instancedSpheresSpacing<T>(groupSize);
+  const T fieldOfView = static_cast<T>(1.0471975511965976); // 60 degrees.
+  const T distance = side / static_cast<T>(2.0) /
+                     std::tan(fieldOfView / static_cast<T>(2.0));
+
+  return Camera<T>(Vector3D<T>(0.0, 0.0, -distance),
+                   Vector3D<T>(0.0, 0.0, 0.0), viewportWidth, viewportHeight,
+                   Projection::Perspective, fieldOfView);
+}
+
+/// An closed box of mirrors with a few colored spheres inside, nearly every ray
+/// bounces until the maximum depth. The walls are huge spheres, which are flat
+/// enough at this scale.
+template <typename T>
+GeometryRegister<T> &createMirrorBoxScene(GeometryRegister<T> &geometryRegister) {
+  const T wallRadius = 1e4;
+  const T halfSize = 50.0;
+  const Material<T> mirror(Vector3D<T>(0.8, 0.8, 0.8), 0.95);
+
+  for (size_t axis = 0; axis < 3; ++axis) {
+    for (const T &side : {static_cast<T>(-1.0), static_cast<T>(1.0)}) {
+      const T distance = side * (wallRadius + halfSize);
+      geometryRegister.Register(std::make_shared<Sphere<T>>(
+          Vector3D<T>(axis == 0 ? distance : 0.0, axis == 1 ? distance : 0.0,
+                      axis == 2 ? distance : 0.0),
+          mirror, wallRadius));
+    }
+  }
+
+  geometryRegister
+      .Register(std::make_shared<Sphere<T>>(
+          Vector3D<T>(-20.0, -20.0, 10.0),
+          Material<T>(Vector3D<T>(1.0, 0.0, 0.0), 0.6), 15.0))
+      .Register(std::make_shared<Sphere<T>>(
+          Vector3D<T>(20.0, 10.0, 20.0),
+          Material<T>(Vector3D<T>(0.0, 1.0, 0.0), 0.6), 12.0))
+      .Register(std::make_shared<Sphere<T>>(
+          Vector3D<T>(5.0, 25.0, -10.0),
+          Material<T>(Vector3D<T>(0.0, 0.0, 1.0), 0.6), 8.0));
+
+  return geometryRegister;
+}
+
+/// The camera inside the mirror box, near one of the walls.
+template <typename T>
+Camera<T> createMirrorBoxCamera(const size_t &viewportWidth,
+                                const size_t &viewportHeight) {
+  return Camera<T>(Vector3D<T>(0.0, 0.0, -45.0), Vector3D<T>(0.0, 0.0, 0.0),
+                   viewportWidth, viewportHeight, Projection::Perspective,
+                   static_cast<T>(1.2217304763960306)); // 70 degrees.
+}
+
+/// The mesh in the given Wavefront OBJ file, in an light blue.
+template <typename T>
+GeometryRegister<T> &createMeshScene(GeometryRegister<T> &geometryRegister,
+                                     const std::string &path) {
+  geometryRegister.Register(TriangleMesh<T>::Load(
+      path, Material<T>(Vector3D<T>(0.4, 0.6, 0.9), 0.5)));
+
+  return geometryRegister;
+}
+
+/// An perspective camera looking along the z axis at the given bounds, far
+/// enough back for all of them to be in view.
+template <typename T>
+Camera<T> createMeshCamera(const BoundingBox<T> &bounds,
+                           const size_t &viewportWidth,
+                           const size_t &viewportHeight,
+                           const T &fieldOfView) {
+  const Vector3D<T> center = bounds.Centroid();
+  const T radius = bounds.max.Subtract(bounds.min).Magnitude() /
+                   static_cast<T>(2.0);
+  const T distance = radius / std::sin(fieldOfView / static_cast<T>(2.0));
+
+  return Camera<T>(center.Subtract(Vector3D<T>(0.0, 0.0, distance)),
+                   Vector3D<T>(0.0, 0.0, 0.0), viewportWidth, viewportHeight,
+                   Projection::Perspective, fieldOfView);
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+
+#include "Animation.hpp"
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "RayCaster.hpp"
+#include "Sampler.hpp"
+#include "ThreadPool.hpp"
+
+/// Describes an frame of an sequence which has just been rendered.
+class SequenceFrame {
+public:
+  size_t index;
+  double time;               // The time in the animation, in seconds.
+  double updateMilliseconds; // Moving the geometry and refitting.
+  double renderMilliseconds;
+  bool rebuilt;       // If the hierarchy was rebuilt instead of refit.
+  double degradation; // The cost of the hierarchy relative to an rebuild.
+};
+
+/// Renders an animated scene frame by frame. The scene is kept twice, so the
+/// geometry of the next frame is moved and refit on an thread of its own while
+/// the current frame is being rendered from the other copy.
+///
+/// Updating uses an pool of its own, which should be small since the update
+/// is usually much cheaper than the render it overlaps with.
+template <typename T> class SequenceRenderer {
+public:
+  using CreateScene = std::function<void(GeometryRegister<T> &, Animator<T> &)>;
+  using FrameCallback =
+      std::function<void(const SequenceFrame &, const FrameBuffer &)>;
+
+private:
+  /// An copy of the scene, with the animations moving its geometry.
+  class SceneBuffer {
+  public:
+    std::shared_ptr<GeometryRegister<T>> geometryRegister;
+    Animator<T> animator;
+  };
+
+  ThreadPool &threadPool;
+  ThreadPool updatePool;
+  SceneBuffer buffers[2];
+  T maximumDegradation;
+  SampleSettings sampling;
+  PathTermination termination;
+
+public:
+  /// Creates both copies of the scene with the given function, which has to
+  /// create the same scene every time.
+  SequenceRenderer<T>(ThreadPool &threadPool, const CreateScene &create,
+                      const size_t &updateThreads = 1,
+                      const T &maximumDegradation = static_cast<T>(1.5))
+      : threadPool(threadPool), updatePool(updateThreads), buffers(),
+        maximumDegradation(maximumDegradation), sampling(), termination() {
+    for (SceneBuffer &buffer : this->buffers) {
+      buffer.geometryRegister = std::make_shared<GeometryRegister<T>>();
+      create(*buffer.geometryRegister, buffer.animator);
+      buffer.geometryRegister->Build();
+    }
+  }
+
+  SequenceRenderer<T>(const SequenceRenderer<T> &) = delete;
+  SequenceRenderer<T> &operator=(const SequenceRenderer<T> &) = delete;
+
+  /// Supersamples the frames rendered from now on, see RayCaster::Supersample().
+  SequenceRenderer<T> &Supersample(const SampleSettings &sampling) noexcept {
+    this->sampling = sampling;
+    return *this;
+  }
+
+  /// Stops the paths of the frames rendered from now on as given, see
+  /// RayCaster::Terminate().
+  SequenceRenderer<T> &Terminate(const PathTermination &termination) noexcept {
+    this->termination = termination;
+    return *this;
+  }
+
+  /// Renders the given number of frames, the given time apart, through the
+  /// camera. The callback gets every frame as soon as it's done, the update
+  /// of the next frame runs while it's called.
+  SequenceRenderer<T> &Render(const size_t &frameCount, const T &frameTime,
+                              Camera<T> camera,
+                              const FrameCallback &callback) {
+    FrameBuffer frameBuffer(camera.viewportWidth, camera.viewportHeight);
+    SequenceFrame frame = this->Update(0, frameTime, this->buffers[0]);
+
+    for (size_t index = 0; index < frameCount; ++index) {
+      SceneBuffer &current = this->buffers[index % 2];
+
+      // Starts moving the other copy to the next frame.
+      std::future<SequenceFrame> next;
+      if (index + 1 < frameCount) {
+        next = std::async(std::launch::async, [this, index, &frameTime]() {
+          return this->Update(index + 1, frameTime,
+                              this->buffers[(index + 1) % 2]);
+        });
+      }
+
+      const auto start = std::chrono::steady_clock::now();
+      RayCaster<T>(frameBuffer, camera, current.geometryRegister)
+          .Supersample(this->sampling)
+          .Terminate(this->termination)
+          .Render(this->threadPool);
+      frame.renderMilliseconds = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count();
+      callback(frame, frameBuffer);
+
+      if (next.valid()) {
+        frame = next.get();
+      }
+    }
+
+    return *this;
+  }
+
+  ~SequenceRenderer<T>() = default;
+
+private:
+  /// Moves the geometry of the given copy to where it is in the given frame,
+  /// and refits its hierarchy.
+  SequenceFrame Update(const size_t &index, const T &frameTime,
+                       SceneBuffer &buffer) {
+    const auto start = std::chrono::steady_clock::now();
+    const T time = static_cast<T>(index) * frameTime;
+    buffer.animator.Apply(time, this->updatePool);
+    const bool rebuilt = buffer.geometryRegister->RefitOrBuild(
+        this->updatePool, this->maximumDegradation);
+
+    SequenceFrame frame;
+    frame.index = index;
+    frame.time = static_cast<double>(time);
+    frame.updateMilliseconds = std::chrono::duration<double, std::milli>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+    frame.renderMilliseconds = 0.0;
+    frame.rebuilt = rebuilt;
+    frame.degradation =
+        static_cast<double>(buffer.geometryRegister->Degradation());
+    return frame;
+  }
+};
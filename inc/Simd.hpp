@@ -0,0 +1,422 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// GCC 12 warns that the AVX-512 intrinsics which pass an undefined register
+// for the lanes they leave alone, like _mm512_sqrt_pd(), use it uninitialized.
+// Only the intrinsics are kept from warning about it.
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+/// An thin wrapper around the widest vector registers the target supports, so
+/// the packet kernels can be written once for all instruction sets. The generic
+/// version is the scalar fallback with an width of one.
+template <typename T> class Simd {
+public:
+  using Register = T;
+  using Mask = bool;
+  static constexpr size_t width = 1;
+
+public:
+  static inline Register Load(const T *data) noexcept { return *data; }
+  static inline void Store(T *data, const Register &a) noexcept { *data = a; }
+  static inline Register Set(const T &value) noexcept { return value; }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return a + b;
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return a - b;
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return a * b;
+  }
+  static inline Register Div(const Register &a, const Register &b) noexcept {
+    return a / b;
+  }
+  static inline Register Sqrt(const Register &a) noexcept {
+    return std::sqrt(a);
+  }
+
+  static inline Mask Greater(const Register &a, const Register &b) noexcept {
+    return a > b;
+  }
+  static inline Mask Less(const Register &a, const Register &b) noexcept {
+    return a < b;
+  }
+  static inline Mask GreaterEqual(const Register &a,
+                                  const Register &b) noexcept {
+    return a >= b;
+  }
+  static inline Mask And(const Mask &a, const Mask &b) noexcept {
+    return a && b;
+  }
+
+  /// Takes a where the mask is set, and b where it's not.
+  static inline Register Select(const Mask &mask, const Register &a,
+                                const Register &b) noexcept {
+    return mask ? a : b;
+  }
+
+  /// Gets the mask as an bitmask, lane zero being the lowest bit.
+  static inline uint32_t Bits(const Mask &mask) noexcept {
+    return mask ? 1 : 0;
+  }
+};
+
+#if defined(__AVX512F__)
+
+template <> class Simd<double> {
+public:
+  using Register = __m512d;
+  using Mask = __mmask8;
+  static constexpr size_t width = 8;
+
+public:
+  static inline Register Load(const double *data) noexcept {
+    return _mm512_loadu_pd(data);
+  }
+  static inline void Store(double *data, const Register &a) noexcept {
+    _mm512_storeu_pd(data, a);
+  }
+  static inline Register Set(const double &value) noexcept {
+    return _mm512_set1_pd(value);
+  }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return _mm512_add_pd(a, b);
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return _mm512_sub_pd(a, b);
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return _mm512_mul_pd(a, b);
+  }
+  static inline Register Div(const Register &a, const Register &b) noexcept {
+    return _mm512_div_pd(a, b);
+  }
+  static inline Register Sqrt(const Register &a) noexcept {
+    return _mm512_sqrt_pd(a);
+  }
+
+  static inline Mask Greater(const Register &a, const Register &b) noexcept {
+    return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ);
+  }
+  static inline Mask Less(const Register &a, const Register &b) noexcept {
+    return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);
+  }
+  static inline Mask GreaterEqual(const Register &a,
+                                  const Register &b) noexcept {
+    return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ);
+  }
+  static inline Mask And(const Mask &a, const Mask &b) noexcept {
+    return a & b;
+  }
+
+  static inline Register Select(const Mask &mask, const Register &a,
+                                const Register &b) noexcept {
+    return _mm512_mask_blend_pd(mask, b, a);
+  }
+
+  static inline uint32_t Bits(const Mask &mask) noexcept { return mask; }
+};
+
+template <> class Simd<float> {
+public:
+  using Register = __m512;
+  using Mask = __mmask16;
+  static constexpr size_t width = 16;
+
+public:
+  static inline Register Load(const float *data) noexcept {
+    return _mm512_loadu_ps(data);
+  }
+  static inline void Store(float *data, const Register &a) noexcept {
+    _mm512_storeu_ps(data, a);
+  }
+  static inline Register Set(const float &value) noexcept {
+    return _mm512_set1_ps(value);
+  }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return _mm512_add_ps(a, b);
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return _mm512_sub_ps(a, b);
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return _mm512_mul_ps(a, b);
+  }
+  static inline Register Div(const Register &a, const Register &b) noexcept {
+    return _mm512_div_ps(a, b);
+  }
+  static inline Register Sqrt(const Register &a) noexcept {
+    return _mm512_sqrt_ps(a);
+  }
+
+  static inline Mask Greater(const Register &a, const Register &b) noexcept {
+    return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);
+  }
+  static inline Mask Less(const Register &a, const Register &b) noexcept {
+    return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+  }
+  static inline Mask GreaterEqual(const Register &a,
+                                  const Register &b) noexcept {
+    return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ);
+  }
+  static inline Mask And(const Mask &a, const Mask &b) noexcept {
+    return a & b;
+  }
+
+  static inline Register Select(const Mask &mask, const Register &a,
+                                const Register &b) noexcept {
+    return _mm512_mask_blend_ps(mask, b, a);
+  }
+
+  static inline uint32_t Bits(const Mask &mask) noexcept { return mask; }
+};
+
+#elif defined(__AVX__)
+
+template <> class Simd<double> {
+public:
+  using Register = __m256d;
+  using Mask = __m256d;
+  static constexpr size_t width = 4;
+
+public:
+  static inline Register Load(const double *data) noexcept {
+    return _mm256_loadu_pd(data);
+  }
+  static inline void Store(double *data, const Register &a) noexcept {
+    _mm256_storeu_pd(data, a);
+  }
+  static inline Register Set(const double &value) noexcept {
+    return _mm256_set1_pd(value);
+  }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return _mm256_add_pd(a, b);
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return _mm256_sub_pd(a, b);
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return _mm256_mul_pd(a, b);
+  }
+  static inline Register Div(const Register &a, const Register &b) noexcept {
+    return _mm256_div_pd(a, b);
+  }
+  static inline Register Sqrt(const Register &a) noexcept {
+    return _mm256_sqrt_pd(a);
+  }
+
+  static inline Mask Greater(const Register &a, const Register &b) noexcept {
+    return _mm256_cmp_pd(a, b, _CMP_GT_OQ);
+  }
+  static inline Mask Less(const Register &a, const Register &b) noexcept {
+    return _mm256_cmp_pd(a, b, _CMP_LT_OQ);
+  }
+  static inline Mask GreaterEqual(const Register &a,
+                                  const Register &b) noexcept {
+    return _mm256_cmp_pd(a, b, _CMP_GE_OQ);
+  }
+  static inline Mask And(const Mask &a, const Mask &b) noexcept {
+    return _mm256_and_pd(a, b);
+  }
+
+  static inline Register Select(const Mask &mask, const Register &a,
+                                const Register &b) noexcept {
+    return _mm256_blendv_pd(b, a, mask);
+  }
+
+  static inline uint32_t Bits(const Mask &mask) noexcept {
+    return static_cast<uint32_t>(_mm256_movemask_pd(mask));
+  }
+};
+
+template <> class Simd<float> {
+public:
+  using Register = __m256;
+  using Mask = __m256;
+  static constexpr size_t width = 8;
+
+public:
+  static inline Register Load(const float *data) noexcept {
+    return _mm256_loadu_ps(data);
+  }
+  static inline void Store(float *data, const Register &a) noexcept {
+    _mm256_storeu_ps(data, a);
+  }
+  static inline Register Set(const float &value) noexcept {
+    return _mm256_set1_ps(value);
+  }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return _mm256_add_ps(a, b);
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return _mm256_sub_ps(a, b);
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return _mm256_mul_ps(a, b);
+  }
+  static inline Register Div(const Register &a, const Register &b) noexcept {
+    return _mm256_div_ps(a, b);
+  }
+  static inline Register Sqrt(const Register &a) noexcept {
+    return _mm256_sqrt_ps(a);
+  }
+
+  static inline Mask Greater(const Register &a, const Register &b) noexcept {
+    return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+  }
+  static inline Mask Less(const Register &a, const Register &b) noexcept {
+    return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+  }
+  static inline Mask GreaterEqual(const Register &a,
+                                  const Register &b) noexcept {
+    return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+  }
+  static inline Mask And(const Mask &a, const Mask &b) noexcept {
+    return _mm256_and_ps(a, b);
+  }
+
+  static inline Register Select(const Mask &mask, const Register &a,
+                                const Register &b) noexcept {
+    return _mm256_blendv_ps(b, a, mask);
+  }
+
+  static inline uint32_t Bits(const Mask &mask) noexcept {
+    return static_cast<uint32_t>(_mm256_movemask_ps(mask));
+  }
+};
+
+#elif defined(__SSE2__)
+
+template <> class Simd<double> {
+public:
+  using Register = __m128d;
+  using Mask = __m128d;
+  static constexpr size_t width = 2;
+
+public:
+  static inline Register Load(const double *data) noexcept {
+    return _mm_loadu_pd(data);
+  }
+  static inline void Store(double *data, const Register &a) noexcept {
+    _mm_storeu_pd(data, a);
+  }
+  static inline Register Set(const double &value) noexcept {
+    return _mm_set1_pd(value);
+  }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return _mm_add_pd(a, b);
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return _mm_sub_pd(a, b);
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return _mm_mul_pd(a, b);
+  }
+  static inline Register Div(const Register &a, const Register &b) noexcept {
+    return _mm_div_pd(a, b);
+  }
+  static inline Register Sqrt(const Register &a) noexcept {
+    return _mm_sqrt_pd(a);
+  }
+
+  static inline Mask Greater(const Register &a, const Register &b) noexcept {
+    return _mm_cmpgt_pd(a, b);
+  }
+  static inline Mask Less(const Register &a, const Register &b) noexcept {
+    return _mm_cmplt_pd(a, b);
+  }
+  static inline Mask GreaterEqual(const Register &a,
+                                  const Register &b) noexcept {
+    return _mm_cmpge_pd(a, b);
+  }
+  static inline Mask And(const Mask &a, const Mask &b) noexcept {
+    return _mm_and_pd(a, b);
+  }
+
+  static inline Register Select(const Mask &mask, const Register &a,
+                                const Register &b) noexcept {
+    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+  }
+
+  static inline uint32_t Bits(const Mask &mask) noexcept {
+    return static_cast<uint32_t>(_mm_movemask_pd(mask));
+  }
+};
+
+template <> class Simd<float> {
+public:
+  using Register = __m128;
+  using Mask = __m128;
+  static constexpr size_t width = 4;
+
+public:
+  static inline Register Load(const float *data) noexcept {
+    return _mm_loadu_ps(data);
+  }
+  static inline void Store(float *data, const Register &a) noexcept {
+    _mm_storeu_ps(data, a);
+  }
+  static inline Register Set(const float &value) noexcept {
+    return _mm_set1_ps(value);
+  }
+
+  static inline Register Add(const Register &a, const Register &b) noexcept {
+    return _mm_add_ps(a, b);
+  }
+  static inline Register Sub(const Register &a, const Register &b) noexcept {
+    return _mm_sub_ps(a, b);
+  }
+  static inline Register Mul(const Register &a, const Register &b) noexcept {
+    return _mm_mul_ps(a, b);
+  }
+  static inline Register Div(const Register &a, const Register &b) noexcept {
+    return _mm_div_ps(a, b);
+  }
+  static inline Register Sqrt(const Register &a) noexcept {
+    return _mm_sqrt_ps(a);
+  }
+
+  static inline Mask Greater(const Register &a, const Register &b) noexcept {
+    return _mm_cmpgt_ps(a, b);
+  }
+  static inline Mask Less(const Register &a, const Register &b) noexcept {
+    return _mm_cmplt_ps(a, b);
+  }
+  static inline Mask GreaterEqual(const Register &a,
+                                  const Register &b) noexcept {
+    return _mm_cmpge_ps(a, b);
+  }
+  static inline Mask And(const Mask &a, const Mask &b) noexcept {
+    return _mm_and_ps(a, b);
+  }
+
+  static inline Register Select(const Mask &mask, const Register &a,
+                                const Register &b) noexcept {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  }
+
+  static inline uint32_t Bits(const Mask &mask) noexcept {
+    return static_cast<uint32_t>(_mm_movemask_ps(mask));
+  }
+};
+
+#endif
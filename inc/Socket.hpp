@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// An connected stream socket, to an Unix domain socket or over TCP. The
+/// connection is closed when this is destroyed. Every failure throws, an
+/// connection which was closed by the other side included.
+///
+/// Addresses are "unix:" followed by the path of an Unix domain socket, or
+/// "host:port" for TCP.
+class Socket {
+private:
+  int descriptor;
+
+public:
+  explicit Socket(const int &descriptor = -1) noexcept;
+
+  Socket(const Socket &) = delete;
+  Socket &operator=(const Socket &) = delete;
+  Socket(Socket &&other) noexcept;
+  Socket &operator=(Socket &&other) noexcept;
+
+  /// Connects to the given address. Keeps trying for the given number of
+  /// milliseconds while nothing listens there yet, so an worker can be started
+  /// before its coordinator.
+  static Socket Connect(const std::string &address,
+                        const size_t &retryMilliseconds = 0);
+
+  /// Sends all of the given bytes, blocking until they're sent.
+  Socket &Send(const void *data, const size_t &size);
+
+  /// Receives exactly the given number of bytes, blocking until they're all
+  /// there.
+  Socket &Receive(void *data, const size_t &size);
+
+  /// Receives whatever is there, up to the given number of bytes, without
+  /// blocking. Gets the number of bytes received, zero if there were none.
+  size_t ReceiveAvailable(void *data, const size_t &size);
+
+  inline int Descriptor() const noexcept { return this->descriptor; }
+
+  ~Socket();
+};
+
+/// An socket waiting for connections on an address, see Socket. The socket
+/// file of an Unix domain socket is removed again when this is destroyed.
+class Listener {
+private:
+  int descriptor;
+  std::string path; // Of the socket file, if any.
+  std::string address;
+
+public:
+  /// Starts listening on the given address, an TCP port of 0 picks any free
+  /// port. Throws when the address can't be used.
+  explicit Listener(const std::string &address);
+
+  Listener(const Listener &) = delete;
+  Listener &operator=(const Listener &) = delete;
+
+  /// Waits for the next connection, and accepts it.
+  Socket Accept();
+
+  /// Gets the address connections can be made to, with the actual port.
+  inline const std::string &Address() const noexcept { return this->address; }
+
+  inline int Descriptor() const noexcept { return this->descriptor; }
+
+  ~Listener();
+};
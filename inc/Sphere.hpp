@@ -1,11 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <optional>
 
 #include "Geometry.hpp"
 #include "Material.hpp"
+#include "RayPacket.hpp"
+#include "Simd.hpp"
 #include "Vector3D.hpp"
 
 template <typename T> class Sphere : public Geometry<T> {
@@ -21,69 +24,171 @@ public:
 
 public:
   virtual std::optional<RayHitResult<T>> RayHit(const Ray<T> &ray) {
-    // Reference: https://en.wikipedia.org/wiki/Line%E2%80%93sphere_intersection
-    // The mathematics used here is directly yanked from this source...
+    const std::optional<T> distance =
+        Sphere<T>::Intersect(ray, this->position, this->radius);
+    if (!distance.has_value()) {
+      return std::nullopt;
+    }
+
+    // Calculates the interception vector, and the normal vector.
+    const Vector3D<T> interceptionVector = ray.origin + ray.direction * *distance;
+    const Vector3D<T> normalVector = this->Normal(interceptionVector);
+
+    // Returns the ray hit result.
+    return RayHitResult<T>(interceptionVector, normalVector, *distance);
+  }
+
+  /// Intersects all the rays in the packet with this sphere, see
+  /// IntersectPacket().
+  void RayHitPacket(RayPacket<T> &packet, const uint32_t &index) const {
+    Sphere<T>::IntersectPacket(packet, this->position.x, this->position.y,
+                               this->position.z, this->radius, index);
+  }
 
-    // Calculates the delta value, this will initially indicate if there are any
-    // interceptions
-    //  with this figure at all, if so, this will help calculate the points of
-    //  interception.
-    const T delta =
-        std::pow(ray.direction.Dot(ray.origin.Subtract(this->position)), 2) -
-        (std::pow(ray.origin.Subtract(this->position).Magnitude(), 2) -
-         std::pow(this->radius, 2));
+  /// Gets the distance at which the ray hits the given sphere, these kernels
+  /// are shared with the flat scene store so both give the same results.
+  static inline std::optional<T> Intersect(const Ray<T> &ray,
+                                           const Vector3D<T> &center,
+                                           const T &radius) noexcept {
+    // Reference: https://en.wikipedia.org/wiki/Line%E2%80%93sphere_intersection
+    // The discriminant is computed from the distance between the center and
+    // the line as in Ray Tracing Gems, chapter 7. The textbook b * b - c loses
+    // all precision in float once the sphere is far from the origin.
+    const Vector3D<T> originToCenter = ray.origin - center;
+    const T b = ray.direction.Dot(originToCenter);
+    const Vector3D<T> perpendicular = originToCenter - ray.direction * b;
+    const T radiusSquared = radius * radius;
+    const T delta = radiusSquared - perpendicular.LengthSquared();
 
     // We'll assume we either have two intersections, or none. Because floats
-    // are imperfect
-    //  trying to compare to 0.0 will be retarded.
+    // are imperfect trying to compare to 0.0 will be retarded.
     if (delta < static_cast<T>(0.0)) {
       return std::nullopt;
     }
 
-    // Calculates the base of the distance, then the alpha and beta distance.
-    //  the alpha and beta distance, will be the distances from the origin at
-    //  which the given ray intercepts the spherical figure.
-    const T d =
-        -std::abs(ray.direction.Dot(ray.origin.Subtract(this->position)));
-    const T distanceAlpha = d + std::sqrt(delta);
-    const T distanceBeta = d - std::sqrt(delta);
-    const T distanceAlphaAbs = std::abs(distanceAlpha);
-    const T distanceBetaAbs = std::abs(distanceBeta);
-
-    // Uses the alpha intersection, if it's nearer by than the beta distance,
-    // and if the alpha distance is not behind the camera.
-    if (distanceAlphaAbs < distanceBetaAbs) {
-      // Calculates the interception alpha vector.
-      const Vector3D<T> interceptionAlphaVector =
-          ray.origin.Add(ray.direction.Multiply(distanceAlpha));
-
-      // Calculates the normal vector.
-      const Vector3D<T> normalAlphaVector =
-          interceptionAlphaVector.Subtract(this->position).Normalize();
-
-      // Returns the ray hit result.
-      return RayHitResult<T>(interceptionAlphaVector, normalAlphaVector,
-                             distanceAlphaAbs);
+    // Calculates the near and far distance, these will be the distances from
+    // the origin at which the given ray intercepts the spherical figure. The
+    // root with the larger magnitude is computed directly and the other one
+    // from their product, so they never cancel out.
+    const T c = originToCenter.LengthSquared() - radiusSquared;
+    const T root = std::sqrt(delta);
+    const T q = b > static_cast<T>(0.0) ? -b - root : -b + root;
+    const T other = c / q;
+    const T distanceNear = other < q ? other : q;
+    const T distanceFar = other < q ? q : other;
+
+    // Uses the nearest intersection which is not behind the origin, the far one
+    // is only used when the origin is inside of the sphere.
+    const T distance = distanceNear > Ray<T>::minimumDistance
+                           ? distanceNear
+                           : distanceFar;
+    if (!(distance > Ray<T>::minimumDistance)) {
+      return std::nullopt;
     }
 
-    // TODO; add check so it's not behind origin.
-
-    // Uses the beta intersection if it's nearer by than the alpha intersection,
-    // and it is not behind the origin.
-    if (distanceBetaAbs >= distanceAlphaAbs) {
-      // Calculates the interception beta vector.
-      const Vector3D<T> interceptionBetaVector =
-          ray.origin.Add(ray.direction.Multiply(distanceBeta));
-
-      // Calculates the normal vector.
-      const Vector3D<T> normalBetaVector =
-          interceptionBetaVector.Subtract(this->position).Normalize();
+    return distance;
+  }
 
-      // Returns the result.
-      return RayHitResult<T>(interceptionBetaVector, normalBetaVector,
-                             distanceBetaAbs);
+  /// Intersects all the rays in the packet at once, this performs the exact
+  /// same operations as Intersect() so the distances are bit-equivalent. Lanes
+  /// which hit the sphere closer than their current distance are updated to
+  /// point at the given index.
+  static void IntersectPacket(RayPacket<T> &packet, const T &centerX,
+                              const T &centerY, const T &centerZ,
+                              const T &radius, const uint32_t &index) noexcept {
+    using S = Simd<T>;
+
+    const typename S::Register positionX = S::Set(centerX);
+    const typename S::Register positionY = S::Set(centerY);
+    const typename S::Register positionZ = S::Set(centerZ);
+    const typename S::Register radiusSquared = S::Set(radius * radius);
+    const typename S::Register zero = S::Set(static_cast<T>(0.0));
+    const typename S::Register minimumDistance =
+        S::Set(Ray<T>::minimumDistance);
+
+    for (size_t lane = 0; lane < RayPacket<T>::size; lane += S::width) {
+      const typename S::Register directionX =
+          S::Load(packet.directionX + lane);
+      const typename S::Register directionY =
+          S::Load(packet.directionY + lane);
+      const typename S::Register directionZ =
+          S::Load(packet.directionZ + lane);
+
+      const typename S::Register originToCenterX =
+          S::Sub(S::Load(packet.originX + lane), positionX);
+      const typename S::Register originToCenterY =
+          S::Sub(S::Load(packet.originY + lane), positionY);
+      const typename S::Register originToCenterZ =
+          S::Sub(S::Load(packet.originZ + lane), positionZ);
+
+      // Calculates the delta value for all the lanes.
+      const typename S::Register b =
+          S::Add(S::Add(S::Mul(directionX, originToCenterX),
+                        S::Mul(directionY, originToCenterY)),
+                 S::Mul(directionZ, originToCenterZ));
+      const typename S::Register perpendicularX =
+          S::Sub(originToCenterX, S::Mul(directionX, b));
+      const typename S::Register perpendicularY =
+          S::Sub(originToCenterY, S::Mul(directionY, b));
+      const typename S::Register perpendicularZ =
+          S::Sub(originToCenterZ, S::Mul(directionZ, b));
+      const typename S::Register delta = S::Sub(
+          radiusSquared,
+          S::Add(S::Add(S::Mul(perpendicularX, perpendicularX),
+                        S::Mul(perpendicularY, perpendicularY)),
+                 S::Mul(perpendicularZ, perpendicularZ)));
+
+      // Calculates the near and far distance, the lanes which missed will
+      // contain garbage here which is masked out below.
+      const typename S::Register lengthSquared =
+          S::Add(S::Add(S::Mul(originToCenterX, originToCenterX),
+                        S::Mul(originToCenterY, originToCenterY)),
+                 S::Mul(originToCenterZ, originToCenterZ));
+      const typename S::Register c = S::Sub(lengthSquared, radiusSquared);
+      const typename S::Register root = S::Sqrt(delta);
+      const typename S::Register negativeB = S::Sub(zero, b);
+      const typename S::Register q =
+          S::Select(S::Greater(b, zero), S::Sub(negativeB, root),
+                    S::Add(negativeB, root));
+      const typename S::Register other = S::Div(c, q);
+      const typename S::Mask otherFirst = S::Less(other, q);
+      const typename S::Register distanceNear = S::Select(otherFirst, other, q);
+      const typename S::Register distanceFar = S::Select(otherFirst, q, other);
+      const typename S::Register distance =
+          S::Select(S::Greater(distanceNear, minimumDistance), distanceNear,
+                    distanceFar);
+
+      // Only accepts hits which are in front of the origin, and closer than
+      // the nearest hit of the lane so far. Of hits at the same distance the
+      // lowest index wins, like in ClosestHit().
+      const typename S::Register nearest = S::Load(packet.distance + lane);
+      const typename S::Mask valid =
+          S::And(S::GreaterEqual(delta, zero),
+                 S::Greater(distance, minimumDistance));
+      const typename S::Mask hit = S::And(valid, S::Less(distance, nearest));
+      const typename S::Mask tie =
+          S::And(valid, S::And(S::GreaterEqual(distance, nearest),
+                               S::GreaterEqual(nearest, distance)));
+
+      S::Store(packet.distance + lane, S::Select(hit, distance, nearest));
+      for (uint32_t bits = S::Bits(hit); bits != 0; bits &= bits - 1) {
+        packet.geometry[lane + __builtin_ctz(bits)] = index;
+      }
+      for (uint32_t bits = S::Bits(tie); bits != 0; bits &= bits - 1) {
+        uint32_t &geometry = packet.geometry[lane + __builtin_ctz(bits)];
+        geometry = std::min(geometry, index);
+      }
     }
+  }
+
+  virtual Vector3D<T> Normal(const Vector3D<T> &point) const {
+    return (point - this->position).Normalize();
+  }
 
-    return std::nullopt;
+  /// Gets the bounds, padded a little for rounding.
+  virtual BoundingBox<T> Bounds() const {
+    const Vector3D<T> extent(this->radius, this->radius, this->radius);
+    return BoundingBox<T>(this->position - extent, this->position + extent)
+        .Pad();
   }
 };
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// An double-ended queue of task indices, the owning thread takes tasks from
+/// the back while other threads steal from the front.
+class WorkStealingQueue {
+public:
+  std::vector<size_t> tasks;
+  size_t head, tail;
+  std::mutex mutex;
+
+public:
+  WorkStealingQueue() : tasks({}), head(0), tail(0) {}
+
+  /// Empties the queue, and makes sure it can hold the given number of tasks
+  /// without allocating.
+  WorkStealingQueue &Reset(const size_t &capacity);
+
+  WorkStealingQueue &Push(const size_t &task);
+
+  /// Takes the most recently pushed task, used by the owning thread.
+  bool Pop(size_t &task);
+
+  /// Takes the least recently pushed task, used by the other threads.
+  bool Steal(size_t &task);
+
+  ~WorkStealingQueue() = default;
+};
+
+/// The statistics of an single worker thread during the last run, aligned so
+/// the workers never write to the same cache line.
+class alignas(64) ThreadStatistics {
+public:
+  size_t tasksExecuted;
+  size_t tasksStolen;
+  uint64_t busyNanoseconds;
+  uint64_t wallNanoseconds;
+
+public:
+  ThreadStatistics() noexcept
+      : tasksExecuted(0), tasksStolen(0), busyNanoseconds(0),
+        wallNanoseconds(0) {}
+
+  /// Gets the fraction of the run this thread spent executing tasks.
+  inline double Utilisation() const noexcept {
+    return this->wallNanoseconds == 0
+               ? 0.0
+               : static_cast<double>(this->busyNanoseconds) /
+                     static_cast<double>(this->wallNanoseconds);
+  }
+
+  ~ThreadStatistics() noexcept = default;
+};
+
+/// An non-owning reference to an callable taking (task, thread), unlike an
+/// std::function this never allocates no matter what the callable captures.
+/// The callable has to outlive the reference, which holds for an lambda passed
+/// straight to ThreadPool::Run().
+class TaskReference {
+private:
+  const void *callable;
+  void (*invoke)(const void *callable, const size_t &task,
+                 const size_t &thread);
+
+public:
+  template <typename F, typename = std::enable_if_t<
+                            !std::is_same_v<std::decay_t<F>, TaskReference>>>
+  TaskReference(const F &callable) noexcept
+      : callable(&callable),
+        invoke([](const void *callable, const size_t &task,
+                  const size_t &thread) {
+          (*static_cast<const F *>(callable))(task, thread);
+        }) {}
+
+  inline void operator()(const size_t &task, const size_t &thread) const {
+    this->invoke(this->callable, task, thread);
+  }
+};
+
+/// An pool of persistent worker threads, each run hands out an range of tasks
+/// through per-thread work-stealing queues so idle threads take work from busy
+/// ones.
+class ThreadPool {
+public:
+  using Task = TaskReference;
+
+private:
+  std::vector<std::thread> threads;
+  std::vector<WorkStealingQueue> queues;
+  std::vector<ThreadStatistics> statistics;
+
+  std::mutex mutex;
+  std::condition_variable startCondition, doneCondition;
+  const Task *task;
+  uint64_t generation;
+  size_t threadsActive;
+  std::exception_ptr exception;
+  bool stopping;
+
+public:
+  /// Creates the pool, zero threads means one per hardware thread.
+  ThreadPool(const size_t &threadCount = 0);
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  inline size_t ThreadCount() const noexcept { return this->threads.size(); }
+
+  /// Executes task(n, thread) for all n in [0, taskCount) on the workers, and
+  /// blocks until all of them are done. An exception thrown by any of the tasks
+  /// is rethrown here.
+  ThreadPool &Run(const size_t &taskCount, const Task &task);
+
+  /// Gets the statistics of all the workers during the last run.
+  inline const std::vector<ThreadStatistics> &Statistics() const noexcept {
+    return this->statistics;
+  }
+
+  /// Prints the per-thread utilisation of the last run.
+  ThreadPool &PrintStatistics(std::ostream &stream);
+
+  ~ThreadPool();
+
+private:
+  void Work(const size_t &thread);
+
+  bool Take(const size_t &thread, size_t &task, bool &stolen);
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/// An rectangular region of the viewport, the unit of work handed to the ray
+/// casting threads.
+class Tile {
+public:
+  size_t x, y;
+  size_t width, height;
+
+public:
+  Tile(const size_t &x, const size_t &y, const size_t &width,
+       const size_t &height) noexcept
+      : x(x), y(y), width(width), height(height) {}
+
+  inline size_t PixelCount() const noexcept {
+    return this->width * this->height;
+  }
+
+  /// Splits an viewport of the given size into tiles of at most size * size
+  /// pixels, row by row.
+  static std::vector<Tile> Split(const size_t &viewportWidth,
+                                 const size_t &viewportHeight,
+                                 const size_t &size) {
+    std::vector<Tile> tiles;
+    tiles.reserve(((viewportWidth + size - 1) / size) *
+                  ((viewportHeight + size - 1) / size));
+
+    for (size_t y = 0; y < viewportHeight; y += size) {
+      for (size_t x = 0; x < viewportWidth; x += size) {
+        tiles.emplace_back(x, y, std::min(size, viewportWidth - x),
+                           std::min(size, viewportHeight - y));
+      }
+    }
+
+    return tiles;
+  }
+
+  ~Tile() noexcept = default;
+};
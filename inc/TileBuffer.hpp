@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "AlignedAllocator.hpp"
+#include "FrameBuffer.hpp"
+#include "Tile.hpp"
+
+/// An buffer private to an single ray casting thread, the colors of an tile are
+/// accumulated here as floating point RGBA and only written to the shared frame
+/// buffer once the entire tile is done.
+class TileBuffer {
+public:
+  std::vector<float, AlignedAllocator<float, 64>> colors;
+  Tile tile;
+
+public:
+  /// Creates an buffer which can hold tiles of up to size * size pixels.
+  TileBuffer(const size_t &size);
+
+  /// Starts accumulating the given tile, all the pixels are cleared.
+  TileBuffer &Reset(const Tile &tile);
+
+  /// Sets the color of an pixel, the coordinates are relative to the tile.
+  inline TileBuffer &Put(const size_t &x, const size_t &y, const float &r,
+                         const float &g, const float &b, const float &a) {
+    float *p = this->colors.data() +
+               (y * this->tile.width + x) * FrameBuffer::channelCount;
+    p[0] = r;
+    p[1] = g;
+    p[2] = b;
+    p[3] = a;
+    return *this;
+  }
+
+  /// Converts the tile to 8 bits and writes it into the frame buffer, row by
+  /// row with vector instructions.
+  const TileBuffer &Flush(FrameBuffer &frameBuffer) const;
+
+  ~TileBuffer() = default;
+};
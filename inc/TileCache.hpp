@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "BoundingBox.hpp"
+#include "Camera.hpp"
+#include "Geometry.hpp"
+#include "GeometryRegister.hpp"
+#include "Instance.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+#include "RayCaster.hpp"
+
+/// What the last update of an tile cache found.
+class TileCacheUpdate {
+public:
+  size_t tiles;       // The number of tiles in the view.
+  size_t reused;      // The tiles which are still valid.
+  size_t invalidated; // The tiles which have to be rendered again.
+
+public:
+  /// Gets the share of the tiles which are still valid.
+  inline double HitRate() const noexcept {
+    return this->tiles != 0 ? static_cast<double>(this->reused) /
+                                  static_cast<double>(this->tiles)
+                            : 0.0;
+  }
+};
+
+/// Keeps track of which tiles of an view are still valid between frames. An
+/// tile is keyed by the camera, and by the primitives whose bounds overlap its
+/// frustum along with their bounds and materials. When either changes, the
+/// tile has to be rendered again. That is the same as invalidating the tiles
+/// under the old and the new footprint of every primitive which changed, see
+/// Camera::Footprint(), which is what Update() does.
+///
+/// Reflected and shadow rays can hit anything, so this is conservative about
+/// them: an tile which shows anything the paths go on from, or anything at all
+/// while there are lights which cast shadows, is invalidated by every change
+/// to the scene. Whether the paths go on from an surface depends on the
+/// termination, see Ends(), by default they go on even from matte surfaces.
+/// Changes are found by comparing the bounds and the materials of the
+/// registered geometry, changes within the groups of instances aren't seen.
+/// An register loaded from an scene file can't be changed, its tiles only
+/// depend on the camera and the lights.
+template <typename T> class TileCache {
+private:
+  /// What the cache remembers of every registered piece of geometry.
+  class Primitive {
+  public:
+    BoundingBox<T> bounds;
+    Material<T> material;
+    bool continues; // If the paths which hit it first can go on from it.
+  };
+
+  size_t tileSize, columns, rows, tileCount;
+
+  std::optional<Camera<T>> camera;
+  PathTermination termination;
+  std::vector<Primitive> primitives;
+  std::vector<Light<T>> lights;
+  std::vector<uint8_t> global; // Per tile, if every change invalidates it.
+
+  TileCacheUpdate last;
+
+public:
+  /// Creates an cache for the tiles of an viewport split by Tile::Split(),
+  /// which are numbered the same way. Every tile starts out invalid.
+  TileCache<T>(const size_t &viewportWidth, const size_t &viewportHeight,
+               const size_t &tileSize)
+      : tileSize(tileSize), columns((viewportWidth + tileSize - 1) / tileSize),
+        rows((viewportHeight + tileSize - 1) / tileSize),
+        tileCount(this->columns * this->rows), camera(), termination(),
+        primitives(),
+        lights(), global(this->tileCount, 0),
+        last{this->tileCount, 0, this->tileCount} {}
+
+  /// Compares the camera, the termination of the paths and the scene with the
+  /// ones of the last update, and gets the indices of the tiles which have to
+  /// be rendered again. The scene must not change while this runs.
+  std::vector<size_t> Update(const Camera<T> &camera,
+                             const GeometryRegister<T> &geometryRegister,
+                             const PathTermination &termination) {
+    std::vector<Primitive> primitives;
+    primitives.reserve(geometryRegister.geometries.size());
+    for (const std::shared_ptr<Geometry<T>> &geometry :
+         geometryRegister.geometries) {
+      // The materials of an instance are the ones of its group.
+      const bool instance =
+          dynamic_cast<const Instance<T> *>(geometry.get()) != nullptr;
+      primitives.push_back(
+          Primitive{geometry->Bounds(), geometry->material,
+                    instance || !Ends(geometry->material, termination)});
+    }
+    const std::vector<Light<T>> lights(geometryRegister.lights.begin(),
+                                       geometryRegister.lights.end());
+
+    std::vector<uint8_t> invalid(this->tileCount, 0);
+    if (!this->camera.has_value() || *this->camera != camera ||
+        !Same(termination, this->termination) ||
+        primitives.size() != this->primitives.size() ||
+        !Same(lights, this->lights)) {
+      std::fill(invalid.begin(), invalid.end(), 1);
+    } else {
+      bool changed = false;
+      for (size_t i = 0; i < primitives.size(); ++i) {
+        if (Same(primitives[i], this->primitives[i])) {
+          continue;
+        }
+
+        changed = true;
+        this->Mark(camera, this->primitives[i].bounds, invalid);
+        this->Mark(camera, primitives[i].bounds, invalid);
+      }
+
+      for (size_t n = 0; changed && n < this->tileCount; ++n) {
+        invalid[n] = invalid[n] | this->global[n];
+      }
+    }
+
+    // Finds the tiles which depend on the entire scene from now on.
+    bool shadows = false;
+    for (const Light<T> &light : lights) {
+      shadows = shadows || light.type != LightType::Ambient;
+    }
+    std::fill(this->global.begin(), this->global.end(), 0);
+    for (const Primitive &primitive : primitives) {
+      if (primitive.continues || shadows) {
+        this->Mark(camera, primitive.bounds, this->global);
+      }
+    }
+
+    this->camera = camera;
+    this->termination = termination;
+    this->primitives = std::move(primitives);
+    this->lights = lights;
+
+    std::vector<size_t> result;
+    for (size_t n = 0; n < this->tileCount; ++n) {
+      if (invalid[n] != 0) {
+        result.push_back(n);
+      }
+    }
+    this->last = TileCacheUpdate{this->tileCount,
+                                 this->tileCount - result.size(),
+                                 result.size()};
+    return result;
+  }
+
+  /// Gets what the last update found.
+  inline const TileCacheUpdate &Last() const noexcept { return this->last; }
+
+  ~TileCache<T>() = default;
+
+private:
+  /// Marks the tiles under the footprint of the given bounds.
+  void Mark(const Camera<T> &camera, const BoundingBox<T> &bounds,
+            std::vector<uint8_t> &marks) const {
+    T minX, minY, maxX, maxY;
+    if (!camera.Footprint(bounds, minX, minY, maxX, maxY)) {
+      return;
+    }
+
+    // The samples of an pixel lie within it, right of and below its corner,
+    // and one more pixel on every side covers the rounding of the projection.
+    const auto column = [this](const T &x) -> size_t {
+      const T pixel = std::floor(x) - static_cast<T>(1.0);
+      const T last = static_cast<T>(this->columns * this->tileSize - 1);
+      return static_cast<size_t>(
+                 std::clamp(pixel, static_cast<T>(0.0), last)) /
+             this->tileSize;
+    };
+    const auto row = [this](const T &y) -> size_t {
+      const T pixel = std::floor(y) - static_cast<T>(1.0);
+      const T last = static_cast<T>(this->rows * this->tileSize - 1);
+      return static_cast<size_t>(
+                 std::clamp(pixel, static_cast<T>(0.0), last)) /
+             this->tileSize;
+    };
+
+    const size_t lastColumn = column(maxX + static_cast<T>(2.0));
+    const size_t lastRow = row(maxY + static_cast<T>(2.0));
+    for (size_t y = row(minY); y <= lastRow; ++y) {
+      for (size_t x = column(minX); x <= lastColumn; ++x) {
+        marks[y * this->columns + x] = 1;
+      }
+    }
+  }
+
+  /// Checks if every path which hits an surface of the given material first
+  /// ends there, see RayCaster::Continue(). The product of the reflectivities
+  /// of such an path is the reflectivity of the material, which is cut off
+  /// below the minimum, but only has no chance at all in the roulette when
+  /// it's zero. An minimum of zero never ends an path early.
+  static bool Ends(const Material<T> &material,
+                   const PathTermination &termination) noexcept {
+    if (termination.maximumRays <= 1) {
+      return true;
+    }
+
+    const T minimum = static_cast<T>(termination.minimumReflectivity);
+    return minimum > static_cast<T>(0.0) &&
+           (termination.russianRoulette
+                ? !(material.reflectivity > static_cast<T>(0.0))
+                : material.reflectivity < minimum);
+  }
+
+  static bool Same(const PathTermination &a,
+                   const PathTermination &b) noexcept {
+    return a.maximumRays == b.maximumRays &&
+           a.minimumReflectivity == b.minimumReflectivity &&
+           a.russianRoulette == b.russianRoulette;
+  }
+
+  static bool Same(const Primitive &a, const Primitive &b) noexcept {
+    return a.bounds.min == b.bounds.min && a.bounds.max == b.bounds.max &&
+           a.material.color == b.material.color &&
+           a.material.reflectivity == b.material.reflectivity;
+  }
+
+  static bool Same(const std::vector<Light<T>> &a,
+                   const std::vector<Light<T>> &b) noexcept {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const Light<T> &a, const Light<T> &b) {
+                        return a.type == b.type && a.vector == b.vector &&
+                               a.radiance == b.radiance;
+                      });
+  }
+};
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BoundingBox.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include "FlatArray.hpp"
+#include "Geometry.hpp"
+#include "Material.hpp"
+#include "ObjLoader.hpp"
+#include "Ray.hpp"
+#include "Vector3D.hpp"
+
+/// An indexed triangle mesh, with its own bounding volume hierarchy over the
+/// triangles so the entire mesh is one piece of geometry in the register. The
+/// triangles are stored in the order of the leaves of that hierarchy.
+template <typename T> class TriangleMesh : public Geometry<T> {
+public:
+  FlatArray<Vector3D<T>> vertices;
+  FlatArray<uint32_t> indices; // Three per triangle.
+  BoundingVolumeHierarchy<T> hierarchy;
+
+public:
+  /// Creates an mesh from the given vertices, and the indices of the three
+  /// vertices of every triangle. The indices have to be valid.
+  TriangleMesh<T>(std::vector<Vector3D<T>> vertices,
+                  std::vector<uint32_t> indices, const Material<T> &material)
+      : Geometry<T>::Geometry(Vector3D<T>(0.0, 0.0, 0.0), material),
+        vertices(std::move(vertices)), indices(std::move(indices)),
+        hierarchy() {
+    this->Build();
+  }
+
+  /// Creates an mesh of triangles which are already in the order of the
+  /// leaves of the given hierarchy, like the meshes in an scene file.
+  TriangleMesh<T>(FlatArray<Vector3D<T>> vertices, FlatArray<uint32_t> indices,
+                  BoundingVolumeHierarchy<T> hierarchy,
+                  const Material<T> &material)
+      : Geometry<T>::Geometry(Vector3D<T>(0.0, 0.0, 0.0), material),
+        vertices(std::move(vertices)), indices(std::move(indices)),
+        hierarchy(std::move(hierarchy)) {
+    this->position = this->Bounds().Centroid();
+  }
+
+  ~TriangleMesh<T>() = default;
+
+  /// Loads the mesh in the given Wavefront OBJ file, throws when it can't be
+  /// read.
+  static std::shared_ptr<TriangleMesh<T>> Load(const std::string &path,
+                                               const Material<T> &material) {
+    ObjMesh mesh = ObjLoader::Load(path);
+
+    std::vector<Vector3D<T>> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for (const Vector3D<double> &vertex : mesh.vertices) {
+      vertices.emplace_back(static_cast<T>(vertex.x), static_cast<T>(vertex.y),
+                            static_cast<T>(vertex.z));
+    }
+
+    return std::make_shared<TriangleMesh<T>>(
+        std::move(vertices), std::move(mesh.indices), material);
+  }
+
+  inline size_t TriangleCount() const noexcept {
+    return this->indices.size() / 3;
+  }
+
+  /// Rebuilds the hierarchy over the triangles, this has to be called after
+  /// the vertices have been moved.
+  TriangleMesh<T> &Build() {
+    std::vector<BoundingBox<T>> bounds;
+    bounds.reserve(this->TriangleCount());
+    for (size_t triangle = 0; triangle < this->TriangleCount(); ++triangle) {
+      BoundingBox<T> box;
+      for (size_t corner = 0; corner < 3; ++corner) {
+        box.Extend(this->vertices[this->indices[triangle * 3 + corner]]);
+      }
+      bounds.push_back(box.Pad());
+    }
+
+    this->hierarchy.Build(bounds);
+
+    // Reorders the triangles into the order of the leaves, so an leaf reads
+    // an contiguous range of indices. Degenerate triangles which were left
+    // out of the hierarchy are dropped.
+    std::vector<uint32_t> ordered;
+    ordered.reserve(this->hierarchy.indices.size() * 3);
+    for (uint32_t &triangle : this->hierarchy.indices) {
+      for (size_t corner = 0; corner < 3; ++corner) {
+        ordered.push_back(this->indices[triangle * 3 + corner]);
+      }
+      triangle = static_cast<uint32_t>(ordered.size() / 3 - 1);
+    }
+    this->indices = FlatArray<uint32_t>(std::move(ordered));
+
+    this->position = this->Bounds().Centroid();
+    return *this;
+  }
+
+  /// Finds the nearest triangle the ray hits, the normal is the geometric
+  /// normal of that triangle facing the origin of the ray.
+  virtual std::optional<RayHitResult<T>> RayHit(const Ray<T> &ray) {
+    const WatertightRay watertight(ray);
+
+    std::optional<uint32_t> nearestTriangle = std::nullopt;
+    T tMax = std::numeric_limits<T>::infinity();
+    this->hierarchy.Traverse(
+        ray, static_cast<T>(0.0), tMax,
+        [&](const uint32_t &triangle, T &nearestDistance) -> bool {
+          const std::optional<T> distance =
+              this->Intersect(watertight, triangle);
+          if (!distance.has_value() || *distance >= nearestDistance) {
+            return false;
+          }
+
+          nearestDistance = *distance;
+          nearestTriangle = triangle;
+          return true;
+        });
+
+    if (!nearestTriangle.has_value()) {
+      return std::nullopt;
+    }
+
+    Vector3D<T> normal = this->TriangleNormal(*nearestTriangle);
+    if (normal.Dot(ray.direction) > static_cast<T>(0.0)) {
+      normal = normal.Multiply(-1.0);
+    }
+
+    return RayHitResult<T>(ray.origin.Add(ray.direction.Multiply(tMax)),
+                           normal, tMax);
+  }
+
+  /// Checks if the ray hits any triangle within the given distance, the
+  /// traversal stops at the first one found.
+  virtual bool Occluded(const Ray<T> &ray, const T &maxDistance) {
+    const WatertightRay watertight(ray);
+    return this->hierarchy.Occluded(
+        ray, static_cast<T>(0.0), maxDistance,
+        [&](const uint32_t &triangle) -> bool {
+          const std::optional<T> distance =
+              this->Intersect(watertight, triangle);
+          return distance.has_value() && *distance <= maxDistance;
+        });
+  }
+
+  /// The normal depends on which triangle was hit, which is unknown for an
+  /// bare point. Use the normal of RayHit() instead.
+  virtual Vector3D<T> Normal(const Vector3D<T> &point) const {
+    return Vector3D<T>(0.0, 0.0, 0.0);
+  }
+
+  virtual BoundingBox<T> Bounds() const {
+    if (this->hierarchy.nodes.empty()) {
+      return BoundingBox<T>();
+    }
+
+    return this->hierarchy.nodes[0].bounds;
+  }
+
+private:
+  /// The per ray constants of the watertight intersection test by Woop, Benthin
+  /// and Wald: the ray is sheared so it points along +z, and the test is done
+  /// on the projections of the triangles on the xy plane. Edges shared by two
+  /// triangles give the same results for both, so rays can't slip through.
+  class WatertightRay {
+  public:
+    Vector3D<T> origin;
+    size_t kx, ky, kz;
+    T shearX, shearY, shearZ;
+
+  public:
+    WatertightRay(const Ray<T> &ray) noexcept : origin(ray.origin) {
+      // Uses the largest component of the direction as z, and swaps x and y
+      // when it's negative to keep the winding of the triangles.
+      const T absoluteX = std::abs(ray.direction.x);
+      const T absoluteY = std::abs(ray.direction.y);
+      const T absoluteZ = std::abs(ray.direction.z);
+      this->kz = absoluteX > absoluteY ? (absoluteX > absoluteZ ? 0 : 2)
+                                       : (absoluteY > absoluteZ ? 1 : 2);
+      this->kx = (this->kz + 1) % 3;
+      this->ky = (this->kx + 1) % 3;
+      if (ray.direction.At(this->kz) < static_cast<T>(0.0)) {
+        std::swap(this->kx, this->ky);
+      }
+
+      this->shearX = ray.direction.At(this->kx) / ray.direction.At(this->kz);
+      this->shearY = ray.direction.At(this->ky) / ray.direction.At(this->kz);
+      this->shearZ = static_cast<T>(1.0) / ray.direction.At(this->kz);
+    }
+  };
+
+  /// Gets the distance at which the ray hits the given triangle.
+  inline std::optional<T> Intersect(const WatertightRay &ray,
+                                    const uint32_t &triangle) const noexcept {
+    const Vector3D<T> a =
+        this->vertices[this->indices[triangle * 3]].Subtract(ray.origin);
+    const Vector3D<T> b =
+        this->vertices[this->indices[triangle * 3 + 1]].Subtract(ray.origin);
+    const Vector3D<T> c =
+        this->vertices[this->indices[triangle * 3 + 2]].Subtract(ray.origin);
+
+    // Shears and scales the vertices.
+    const T ax = a.At(ray.kx) - ray.shearX * a.At(ray.kz);
+    const T ay = a.At(ray.ky) - ray.shearY * a.At(ray.kz);
+    const T bx = b.At(ray.kx) - ray.shearX * b.At(ray.kz);
+    const T by = b.At(ray.ky) - ray.shearY * b.At(ray.kz);
+    const T cx = c.At(ray.kx) - ray.shearX * c.At(ray.kz);
+    const T cy = c.At(ray.ky) - ray.shearY * c.At(ray.kz);
+
+    // The scaled barycentric coordinates, an ray through an edge gives exactly
+    // zero here. Those are recomputed in double precision so the sign is right
+    // when T is float.
+    T u = cx * by - cy * bx;
+    T v = ax * cy - ay * cx;
+    T w = bx * ay - by * ax;
+    if (u == static_cast<T>(0.0) || v == static_cast<T>(0.0) ||
+        w == static_cast<T>(0.0)) {
+      u = static_cast<T>(static_cast<double>(cx) * static_cast<double>(by) -
+                         static_cast<double>(cy) * static_cast<double>(bx));
+      v = static_cast<T>(static_cast<double>(ax) * static_cast<double>(cy) -
+                         static_cast<double>(ay) * static_cast<double>(cx));
+      w = static_cast<T>(static_cast<double>(bx) * static_cast<double>(ay) -
+                         static_cast<double>(by) * static_cast<double>(ax));
+    }
+
+    // The ray misses when the signs differ, both windings are accepted.
+    if ((u < static_cast<T>(0.0) || v < static_cast<T>(0.0) ||
+         w < static_cast<T>(0.0)) &&
+        (u > static_cast<T>(0.0) || v > static_cast<T>(0.0) ||
+         w > static_cast<T>(0.0))) {
+      return std::nullopt;
+    }
+
+    const T determinant = u + v + w;
+    if (determinant == static_cast<T>(0.0)) {
+      return std::nullopt;
+    }
+
+    // Interpolates the depth of the sheared vertices.
+    const T scaled = u * ray.shearZ * a.At(ray.kz) +
+                     v * ray.shearZ * b.At(ray.kz) +
+                     w * ray.shearZ * c.At(ray.kz);
+    const T distance = scaled / determinant;
+    if (!(distance > Ray<T>::minimumDistance)) {
+      return std::nullopt;
+    }
+
+    return distance;
+  }
+
+  /// Gets the unit normal of the given triangle, by its winding.
+  inline Vector3D<T> TriangleNormal(const uint32_t &triangle) const {
+    const Vector3D<T> &a = this->vertices[this->indices[triangle * 3]];
+    const Vector3D<T> &b = this->vertices[this->indices[triangle * 3 + 1]];
+    const Vector3D<T> &c = this->vertices[this->indices[triangle * 3 + 2]];
+    return b.Subtract(a).Cross(c.Subtract(a)).Normalize();
+  }
+};
@@ -1,51 +1,113 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
 #include <iostream>
 
 #include "Colors.hpp"
 
+/// An vector of three components. Everything is inline and branch free, the
+/// operators do the exact same arithmetic as the named methods so either can
+/// be used in the kernels which have to match bit for bit.
 template <typename T> class Vector3D {
 public:
   T x, y, z;
 
 public:
-  Vector3D<T>(const T &x, const T &y, const T &z) noexcept : x(x), y(y), z(z) {}
+  constexpr Vector3D<T>(const T &x, const T &y, const T &z) noexcept
+      : x(x), y(y), z(z) {}
 
-  Vector3D<T> Clone() const noexcept {
+  constexpr Vector3D<T> Clone() const noexcept {
     return Vector3D<T>(this->x, this->y, this->z);
   }
 
-  Vector3D<T> Add(const Vector3D<T> &other) const noexcept {
+  constexpr Vector3D<T> Add(const Vector3D<T> &other) const noexcept {
     return Vector3D<T>(this->x + other.x, this->y + other.y, this->z + other.z);
   }
 
-  Vector3D<T> Subtract(const Vector3D<T> &other) const noexcept {
+  constexpr Vector3D<T> Subtract(const Vector3D<T> &other) const noexcept {
     return Vector3D<T>(this->x - other.x, this->y - other.y, this->z - other.z);
   }
 
-  Vector3D<T> Multiply(const T &multipler) const noexcept {
+  constexpr Vector3D<T> Multiply(const T &multipler) const noexcept {
     return Vector3D<T>(this->x * multipler, this->y * multipler,
                        this->z * multipler);
   }
 
-  Vector3D<T> Divide(const T &divisor) const noexcept {
+  constexpr Vector3D<T> Divide(const T &divisor) const noexcept {
     return Vector3D<T>(this->x / divisor, this->y / divisor, this->z / divisor);
   }
 
-  T Dot(const Vector3D<T> &other) const noexcept {
+  /// Multiplies every component by the one of the other vector, which is how
+  /// an color filters light.
+  constexpr Vector3D<T> Scale(const Vector3D<T> &other) const noexcept {
+    return Vector3D<T>(this->x * other.x, this->y * other.y, this->z * other.z);
+  }
+
+  /// Gets the component along the given axis, zero being X.
+  constexpr T At(const size_t &axis) const noexcept {
+    return axis == 0 ? this->x : (axis == 1 ? this->y : this->z);
+  }
+
+  constexpr T Dot(const Vector3D<T> &other) const noexcept {
     return this->x * other.x + this->y * other.y + this->z * other.z;
   }
 
+  /// Gets the dot product of the vector with itself, this is what distance
+  /// comparisons should use rather than the magnitude.
+  constexpr T LengthSquared() const noexcept { return this->Dot(*this); }
+
+  constexpr Vector3D<T> Cross(const Vector3D<T> &other) const noexcept {
+    return Vector3D<T>(this->y * other.z - this->z * other.y,
+                       this->z * other.x - this->x * other.z,
+                       this->x * other.y - this->y * other.x);
+  }
+
+  /// Scales the vector to an length of one, with an single division.
   Vector3D<T> Normalize() const noexcept {
-    const T magnitude = this->Magnitude();
-    return Vector3D<T>(this->x / magnitude, this->y / magnitude,
-                       this->z / magnitude);
+    return this->Multiply(static_cast<T>(1.0) / this->Magnitude());
   }
 
-  T Magnitude() const noexcept {
-    return static_cast<T>(std::sqrt(
-        std::pow(this->x, 2) + std::pow(this->y, 2) + std::pow(this->z, 2)));
+  T Magnitude() const noexcept { return std::sqrt(this->LengthSquared()); }
+
+  constexpr Vector3D<T> operator+(const Vector3D<T> &other) const noexcept {
+    return this->Add(other);
+  }
+
+  constexpr Vector3D<T> operator-(const Vector3D<T> &other) const noexcept {
+    return this->Subtract(other);
+  }
+
+  constexpr Vector3D<T> operator-() const noexcept {
+    return Vector3D<T>(-this->x, -this->y, -this->z);
+  }
+
+  constexpr Vector3D<T> operator*(const T &multiplier) const noexcept {
+    return this->Multiply(multiplier);
+  }
+
+  constexpr Vector3D<T> operator/(const T &divisor) const noexcept {
+    return this->Divide(divisor);
+  }
+
+  constexpr Vector3D<T> &operator+=(const Vector3D<T> &other) noexcept {
+    return *this = this->Add(other);
+  }
+
+  constexpr Vector3D<T> &operator-=(const Vector3D<T> &other) noexcept {
+    return *this = this->Subtract(other);
+  }
+
+  constexpr Vector3D<T> &operator*=(const T &multiplier) noexcept {
+    return *this = this->Multiply(multiplier);
+  }
+
+  constexpr bool operator==(const Vector3D<T> &other) const noexcept {
+    return this->x == other.x && this->y == other.y && this->z == other.z;
+  }
+
+  constexpr bool operator!=(const Vector3D<T> &other) const noexcept {
+    return !(*this == other);
   }
 
   static Vector3D<T> Mix(const T &p1, const Vector3D<T> &v1, const T &p2,
@@ -56,6 +118,12 @@ public:
   ~Vector3D<T>() noexcept = default;
 };
 
+template <typename T>
+constexpr Vector3D<T> operator*(const T &multiplier,
+                                const Vector3D<T> &vector) noexcept {
+  return vector.Multiply(multiplier);
+}
+
 typedef Vector3D<double> DVector3D;
 
 template <typename T>
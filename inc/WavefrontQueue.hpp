@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "Ray.hpp"
+#include "TileBuffer.hpp"
+#include "Vector3D.hpp"
+
+/// An queue of paths at the same bounce, as structure-of-arrays so every stage
+/// of the wavefront streams through only the components it needs. An path is
+/// its current ray, the pixel it belongs to and the color it has gathered so
+/// far. The extension stage fills in the nearest hit of every ray.
+template <typename T> class WavefrontQueue {
+public:
+  std::vector<T> originX, originY, originZ;
+  std::vector<T> directionX, directionY, directionZ;
+  std::vector<uint32_t> pixels; // Relative to the tile, row by row.
+  std::vector<uint64_t> seeds;  // Where the random numbers of the path start.
+
+  // The color so far and the product of the reflectivities it's mixed with,
+  // the color is unset until the first hit.
+  std::vector<T> colorR, colorG, colorB;
+  std::vector<T> reflectivityProducts;
+  std::vector<uint8_t> colored;
+
+  // The nearest hit of every ray, if there's any.
+  std::vector<uint8_t> hits;
+  std::vector<T> distances;
+  std::vector<T> normalX, normalY, normalZ;
+  std::vector<uint32_t> materials;
+
+  // The light which reaches every hit, summed by the shadow stage.
+  std::vector<T> irradianceR, irradianceG, irradianceB;
+
+  size_t count;
+
+public:
+  WavefrontQueue<T>() : count(0) {}
+
+  /// Empties the queue, and makes sure it can hold the given number of paths
+  /// without allocating.
+  WavefrontQueue<T> &Reset(const size_t &capacity) {
+    if (this->pixels.size() < capacity) {
+      for (std::vector<T> *components :
+           {&this->originX, &this->originY, &this->originZ, &this->directionX,
+            &this->directionY, &this->directionZ, &this->colorR, &this->colorG,
+            &this->colorB, &this->reflectivityProducts, &this->distances,
+            &this->normalX, &this->normalY, &this->normalZ,
+            &this->irradianceR, &this->irradianceG, &this->irradianceB}) {
+        components->resize(capacity);
+      }
+      this->pixels.resize(capacity);
+      this->seeds.resize(capacity);
+      this->colored.resize(capacity);
+      this->hits.resize(capacity);
+      this->materials.resize(capacity);
+    }
+
+    this->count = 0;
+    return *this;
+  }
+
+  /// Adds an path, the caller makes sure there's room for it.
+  inline WavefrontQueue<T> &Push(const Ray<T> &ray, const uint32_t &pixel,
+                                 const uint64_t &seed, const Vector3D<T> &color,
+                                 const bool &isColored,
+                                 const T &reflectivityProduct) noexcept {
+    return this->Set(this->count++, ray, pixel, seed, color, isColored,
+                     reflectivityProduct);
+  }
+
+  /// Copies an path of another queue to the given place, without its hit.
+  inline WavefrontQueue<T> &Copy(const WavefrontQueue<T> &other,
+                                 const size_t &from, const size_t &to) noexcept {
+    return this->Set(to, other.At(from), other.pixels[from], other.seeds[from],
+                     other.Color(from), other.colored[from] != 0,
+                     other.reflectivityProducts[from]);
+  }
+
+  /// Overwrites the path at the given place.
+  inline WavefrontQueue<T> &Set(const size_t &i, const Ray<T> &ray,
+                                const uint32_t &pixel, const uint64_t &seed,
+                                const Vector3D<T> &color, const bool &isColored,
+                                const T &reflectivityProduct) noexcept {
+    this->originX[i] = ray.origin.x;
+    this->originY[i] = ray.origin.y;
+    this->originZ[i] = ray.origin.z;
+    this->directionX[i] = ray.direction.x;
+    this->directionY[i] = ray.direction.y;
+    this->directionZ[i] = ray.direction.z;
+    this->pixels[i] = pixel;
+    this->seeds[i] = seed;
+    this->colorR[i] = color.x;
+    this->colorG[i] = color.y;
+    this->colorB[i] = color.z;
+    this->colored[i] = isColored ? 1 : 0;
+    this->reflectivityProducts[i] = reflectivityProduct;
+    this->hits[i] = 0;
+    return *this;
+  }
+
+  /// Stores the nearest hit of the ray at the given place.
+  inline WavefrontQueue<T> &SetHit(const size_t &i,
+                                   const std::optional<HitRecord<T>> &hit) noexcept {
+    this->hits[i] = hit.has_value() ? 1 : 0;
+    if (hit.has_value()) {
+      this->distances[i] = hit->distance;
+      this->normalX[i] = hit->normal.x;
+      this->normalY[i] = hit->normal.y;
+      this->normalZ[i] = hit->normal.z;
+      this->materials[i] = hit->material;
+    }
+
+    return *this;
+  }
+
+  inline Ray<T> At(const size_t &i) const noexcept {
+    return Ray<T>(
+        Vector3D<T>(this->originX[i], this->originY[i], this->originZ[i]),
+        Vector3D<T>(this->directionX[i], this->directionY[i],
+                    this->directionZ[i]));
+  }
+
+  inline Vector3D<T> Color(const size_t &i) const noexcept {
+    return Vector3D<T>(this->colorR[i], this->colorG[i], this->colorB[i]);
+  }
+
+  inline Vector3D<T> Normal(const size_t &i) const noexcept {
+    return Vector3D<T>(this->normalX[i], this->normalY[i], this->normalZ[i]);
+  }
+
+  inline Vector3D<T> Irradiance(const size_t &i) const noexcept {
+    return Vector3D<T>(this->irradianceR[i], this->irradianceG[i],
+                       this->irradianceB[i]);
+  }
+
+  /// Gets the octant the direction of the ray points into, from 0 to 7.
+  inline uint32_t Octant(const size_t &i) const noexcept {
+    return (this->directionX[i] < static_cast<T>(0.0) ? 1u : 0u) |
+           (this->directionY[i] < static_cast<T>(0.0) ? 2u : 0u) |
+           (this->directionZ[i] < static_cast<T>(0.0) ? 4u : 0u);
+  }
+
+  ~WavefrontQueue<T>() = default;
+};
+
+/// The shadow rays of an wavefront, from every hit towards every light. Lights
+/// which can't be shadowed get an entry with an distance of zero and no ray,
+/// so the light reaching every hit is summed in the order of the lights.
+template <typename T> class ShadowQueue {
+public:
+  std::vector<T> originX, originY, originZ;
+  std::vector<T> directionX, directionY, directionZ;
+  std::vector<T> distances; // Within which anything blocks the light.
+  std::vector<T> irradianceR, irradianceG, irradianceB; // If it's not blocked.
+  std::vector<uint32_t> paths; // The path in the wavefront queue.
+  std::vector<uint8_t> occluded;
+
+  size_t count;
+
+public:
+  ShadowQueue<T>() : count(0) {}
+
+  /// Empties the queue, and makes sure it can hold the given number of rays
+  /// without allocating.
+  ShadowQueue<T> &Reset(const size_t &capacity) {
+    if (this->paths.size() < capacity) {
+      for (std::vector<T> *components :
+           {&this->originX, &this->originY, &this->originZ, &this->directionX,
+            &this->directionY, &this->directionZ, &this->distances,
+            &this->irradianceR, &this->irradianceG, &this->irradianceB}) {
+        components->resize(capacity);
+      }
+      this->paths.resize(capacity);
+      this->occluded.resize(capacity);
+    }
+
+    this->count = 0;
+    return *this;
+  }
+
+  /// Adds an shadow ray, the caller makes sure there's room for it.
+  inline ShadowQueue<T> &Push(const Ray<T> &ray, const T &distance,
+                              const uint32_t &path,
+                              const Vector3D<T> &irradiance) noexcept {
+    const size_t i = this->count++;
+    this->originX[i] = ray.origin.x;
+    this->originY[i] = ray.origin.y;
+    this->originZ[i] = ray.origin.z;
+    this->directionX[i] = ray.direction.x;
+    this->directionY[i] = ray.direction.y;
+    this->directionZ[i] = ray.direction.z;
+    this->distances[i] = distance;
+    this->irradianceR[i] = irradiance.x;
+    this->irradianceG[i] = irradiance.y;
+    this->irradianceB[i] = irradiance.z;
+    this->paths[i] = path;
+    this->occluded[i] = 0;
+    return *this;
+  }
+
+  inline Ray<T> At(const size_t &i) const noexcept {
+    return Ray<T>(
+        Vector3D<T>(this->originX[i], this->originY[i], this->originZ[i]),
+        Vector3D<T>(this->directionX[i], this->directionY[i],
+                    this->directionZ[i]));
+  }
+
+  inline Vector3D<T> Irradiance(const size_t &i) const noexcept {
+    return Vector3D<T>(this->irradianceR[i], this->irradianceG[i],
+                       this->irradianceB[i]);
+  }
+
+  ~ShadowQueue<T>() = default;
+};
+
+/// The state of an thread tracing wavefronts, kept between tiles so tracing
+/// does not allocate. The paths of the current bounce are shaded into the
+/// next queue, which is sorted back into the first.
+template <typename T> class WavefrontBuffer {
+public:
+  WavefrontQueue<T> paths, next;
+  ShadowQueue<T> shadows;
+  TileBuffer tileBuffer;
+  // The sort keys of the paths in the next queue, and the order they're
+  // sorted into.
+  std::vector<uint32_t> keys, order, scratch;
+
+public:
+  /// Creates the buffers for tiles of up to size * size pixels.
+  WavefrontBuffer<T>(const size_t &size)
+      : paths(), next(), shadows(), tileBuffer(size), keys(size * size),
+        order(size * size), scratch(size * size) {
+    this->paths.Reset(size * size);
+    this->next.Reset(size * size);
+  }
+
+  ~WavefrontBuffer<T>() = default;
+};
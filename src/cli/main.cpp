@@ -0,0 +1,454 @@
+#include "main.hpp"
+#include "Camera.hpp"
+#include "DistributedRenderer.hpp"
+#include "FrameBuffer.hpp"
+#include "GeometryRegister.hpp"
+#include "ImageWriter.hpp"
+#include "Profiler.hpp"
+#include "RayCaster.hpp"
+#include "Sampler.hpp"
+#include "SceneFile.hpp"
+#include "Scenes.hpp"
+#include "SequenceRenderer.hpp"
+#include "Socket.hpp"
+#include "ThreadPool.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+/// The precision the scene is rendered in.
+enum class Precision { Float, Double };
+
+/// The options of an headless render, as given on the command line.
+class Options {
+public:
+  size_t width, height;
+  size_t threads;
+  std::string output;
+  std::string obj;                     // The mesh to render, if any.
+  std::string scene;                   // The scene file to render, if any.
+  std::optional<Projection> projection; // Defaults to the one of the scene.
+  double fieldOfView; // In degrees.
+  Precision precision;
+  size_t frames;     // Renders an animation of this many frames, if not zero.
+  double frameRate;  // In frames per second.
+  SampleSettings sampling;
+  TraceMode mode;
+  PathTermination termination;
+  std::string profile, trace; // Where to write the measurements, if anywhere.
+  std::string listen;  // Renders on the workers connecting here, if given.
+  std::string connect; // Works for the coordinator here, if given.
+
+public:
+  Options()
+      : width(500), height(500), threads(0), output("render.png"), obj(), scene(),
+        projection(std::nullopt), fieldOfView(60.0),
+        precision(Precision::Double), frames(0), frameRate(24.0), sampling(),
+        mode(TraceMode::PerPixel), termination(), profile(),
+        trace(), listen(), connect() {}
+
+  /// Parses the command line, throws on anything it does not understand.
+  static Options Parse(int argc, char *argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+      const std::string argument = argv[i];
+      if (i + 1 >= argc) {
+        throw std::runtime_error("Missing value for " + argument);
+      }
+
+      const std::string value = argv[++i];
+      if (argument == "--width") {
+        options.width = std::stoul(value);
+      } else if (argument == "--height") {
+        options.height = std::stoul(value);
+      } else if (argument == "--threads") {
+        options.threads = std::stoul(value);
+      } else if (argument == "--output") {
+        options.output = value;
+      } else if (argument == "--obj") {
+        options.obj = value;
+      } else if (argument == "--scene") {
+        options.scene = value;
+      } else if (argument == "--projection") {
+        if (value == "orthographic") {
+          options.projection = Projection::Orthographic;
+        } else if (value == "perspective") {
+          options.projection = Projection::Perspective;
+        } else {
+          throw std::runtime_error("Unknown projection " + value);
+        }
+      } else if (argument == "--fov") {
+        options.fieldOfView = std::stod(value);
+      } else if (argument == "--precision") {
+        if (value == "float") {
+          options.precision = Precision::Float;
+        } else if (value == "double") {
+          options.precision = Precision::Double;
+        } else {
+          throw std::runtime_error("Unknown precision " + value);
+        }
+      } else if (argument == "--frames") {
+        options.frames = std::stoul(value);
+      } else if (argument == "--frame-rate") {
+        options.frameRate = std::stod(value);
+      } else if (argument == "--samples") {
+        options.sampling.maximumSamples = std::stoul(value);
+      } else if (argument == "--min-samples") {
+        options.sampling.minimumSamples = std::stoul(value);
+      } else if (argument == "--sample-threshold") {
+        options.sampling.threshold = std::stof(value);
+      } else if (argument == "--sample-pattern") {
+        if (value == "stratified") {
+          options.sampling.pattern = SamplePattern::Stratified;
+        } else if (value == "blue-noise") {
+          options.sampling.pattern = SamplePattern::BlueNoise;
+        } else {
+          throw std::runtime_error("Unknown sample pattern " + value);
+        }
+      } else if (argument == "--seed") {
+        options.sampling.seed = std::stoull(value);
+      } else if (argument == "--mode") {
+        if (value == "per-pixel") {
+          options.mode = TraceMode::PerPixel;
+        } else if (value == "wavefront") {
+          options.mode = TraceMode::Wavefront;
+        } else {
+          throw std::runtime_error("Unknown mode " + value);
+        }
+      } else if (argument == "--max-rays") {
+        options.termination.maximumRays = std::stoul(value);
+      } else if (argument == "--min-reflectivity") {
+        options.termination.minimumReflectivity = std::stod(value);
+      } else if (argument == "--termination") {
+        if (value == "cutoff") {
+          options.termination.russianRoulette = false;
+        } else if (value == "roulette") {
+          options.termination.russianRoulette = true;
+        } else {
+          throw std::runtime_error("Unknown termination " + value);
+        }
+      } else if (argument == "--profile") {
+        options.profile = value;
+      } else if (argument == "--trace") {
+        options.trace = value;
+      } else if (argument == "--listen") {
+        options.listen = value;
+      } else if (argument == "--connect") {
+        options.connect = value;
+      } else {
+        throw std::runtime_error("Unknown option " + argument);
+      }
+    }
+
+    if ((!options.obj.empty()) + (!options.scene.empty()) +
+            (options.frames != 0) >
+        1) {
+      throw std::runtime_error(
+          "Only one of --obj, --scene and --frames can be given");
+    }
+
+    if (!options.listen.empty() &&
+        (options.frames != 0 || !options.profile.empty() ||
+         !options.trace.empty() || !options.connect.empty())) {
+      throw std::runtime_error("--listen can't be combined with --frames, "
+                               "--profile, --trace or --connect");
+    }
+
+    if (options.frameRate <= 0.0) {
+      throw std::runtime_error("The frame rate must be positive");
+    }
+
+    if (options.width == 0 || options.height == 0) {
+      throw std::runtime_error("The resolution must be at least 1x1");
+    }
+
+    return options;
+  }
+};
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program
+            << " [--width 500] [--height 500] [--threads 0] "
+               "[--output render.png] [--obj mesh.obj] [--scene scene.bin] "
+               "[--projection orthographic] "
+               "[--fov 60] [--precision double] [--frames 0] [--frame-rate 24] "
+               "[--samples 1] [--min-samples 4] [--sample-threshold 0] "
+               "[--sample-pattern stratified] [--seed 0] [--mode per-pixel] "
+               "[--max-rays 8] [--min-reflectivity 0] [--termination cutoff] "
+               "[--profile profile.json] [--trace trace.json] "
+               "[--listen unix:/tmp/render.sock] [--connect host:port]"
+            << std::endl
+            << "  --obj renders the given mesh instead of the two spheres, "
+               "with an perspective camera in front of it."
+            << std::endl
+            << "  --scene maps an scene file written by convert, and renders "
+               "it the same way."
+            << std::endl
+            << "  --frames renders an animation of the spheres instead, the "
+               "frame number is added to the output name."
+            << std::endl
+            << "  --threads 0 uses one thread per hardware thread, the output "
+               "format (.png or .ppm) follows from the extension."
+            << std::endl
+            << "  --precision float renders in single precision, which is "
+               "faster and fits twice as many rays in an packet."
+            << std::endl
+            << "  --samples takes up to that many samples per pixel, "
+               "--sample-pattern stratified or blue-noise spreads them."
+            << std::endl
+            << "  --sample-threshold stops sampling an pixel once the standard "
+               "error of its mean is below it, after --min-samples."
+            << std::endl
+            << "  --seed picks an other set of samples and roulette choices, "
+               "the image only depends on it, never on --threads."
+            << std::endl
+            << "  --mode wavefront traces the tiles bounce by bounce in large "
+               "batches instead of pixel by pixel, the image is the same."
+            << std::endl
+            << "  --max-rays limits the rays of an path, --min-reflectivity "
+               "stops the paths which reflect less, cut off or by roulette."
+            << std::endl
+            << "  --profile writes the counters and stage times as JSON, "
+               "--trace writes the tiles for chrome://tracing."
+            << std::endl
+            << "  --listen renders on the workers which connect to it, "
+               "started with --connect and only --threads."
+            << std::endl;
+}
+
+/// Renders the frame on the workers which connect to the address of the
+/// options, and writes the image.
+template <typename T>
+static void renderDistributed(const Options &options, FrameBuffer &frameBuffer,
+                              Camera<T> &camera,
+                              std::shared_ptr<GeometryRegister<T>> scene) {
+  Listener listener(options.listen);
+  std::cout << "Waiting for workers on " << listener.Address() << std::endl;
+
+  const auto startTime = std::chrono::steady_clock::now();
+  DistributedRenderer<T> renderer(frameBuffer, camera, scene);
+  const DistributedFrame frame = renderer.Supersample(options.sampling)
+                                     .Mode(options.mode)
+                                     .Terminate(options.termination)
+                                     .Render(listener);
+  const auto endTime = std::chrono::steady_clock::now();
+
+  ImageWriter::Write(frameBuffer, options.output);
+
+  std::cout << "Rendered " << options.width << "x" << options.height
+            << " on " << frame.workers << " workers in "
+            << std::chrono::duration<double, std::milli>(endTime - startTime)
+                   .count()
+            << " ms, written to " << options.output << std::endl
+            << "Sent " << frame.sceneBytes << " bytes of scene to every worker "
+            << "and " << frame.tilesSent << " tiles, " << frame.reassigned
+            << " again after " << frame.workersLost << " workers went away and "
+            << frame.duplicated << " again since their worker was slow"
+            << std::endl;
+}
+
+/// Renders tiles for the coordinator at the address of the options, until
+/// it's done with its frame.
+static void work(const Options &options) {
+  ThreadPool threadPool(options.threads);
+  Socket socket = Socket::Connect(options.connect, 10000);
+  std::cout << "Connected to " << options.connect << " with "
+            << threadPool.ThreadCount() << " threads" << std::endl;
+
+  const auto startTime = std::chrono::steady_clock::now();
+  RenderWorker::Serve(socket, threadPool);
+  const auto endTime = std::chrono::steady_clock::now();
+
+  std::cout << "Worked for "
+            << std::chrono::duration<double, std::milli>(endTime - startTime)
+                   .count()
+            << " ms" << std::endl;
+  threadPool.PrintStatistics(std::cout);
+}
+
+/// Renders the scene in the given precision, and writes the image and the
+/// measurements.
+template <typename T> static void render(const Options &options) {
+  // Sets up the scene, and everything we're going to render it with.
+  std::shared_ptr<GeometryRegister<T>> geometryRegister =
+      std::make_shared<GeometryRegister<T>>();
+  const T fieldOfView = static_cast<T>(options.fieldOfView * M_PI / 180.0);
+  Camera<T> camera = createTwoSphereCamera<T>(options.width, options.height);
+  if (!options.scene.empty()) {
+    const auto loadStart = std::chrono::steady_clock::now();
+    geometryRegister = SceneFile<T>::Load(options.scene);
+    std::cout << "Mapped " << options.scene << " in "
+              << std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - loadStart)
+                     .count()
+              << " ms" << std::endl;
+
+    camera = createMeshCamera(geometryRegister->Bounds(), options.width,
+                              options.height, fieldOfView);
+  } else if (options.obj.empty()) {
+    createTwoSphereScene(*geometryRegister).Build();
+  } else {
+    const auto loadStart = std::chrono::steady_clock::now();
+    createMeshScene(*geometryRegister, options.obj).Build();
+    std::cout << "Loaded " << options.obj << " in "
+              << std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - loadStart)
+                     .count()
+              << " ms" << std::endl;
+
+    camera = createMeshCamera(geometryRegister->Bounds(), options.width,
+                              options.height, fieldOfView);
+  }
+
+  camera.projection = options.projection.value_or(camera.projection);
+  camera.fieldOfView = fieldOfView;
+  camera.Update();
+  FrameBuffer frameBuffer(options.width, options.height);
+  if (!options.listen.empty()) {
+    renderDistributed(options, frameBuffer, camera, geometryRegister);
+    return;
+  }
+  ThreadPool threadPool(options.threads);
+
+  // Renders the frame, and writes it to disk. Profiling slows the render
+  // down a bit, so it's only done when asked for.
+  Profiler profiler;
+  const bool profiling = !options.profile.empty() || !options.trace.empty();
+  const auto startTime = std::chrono::steady_clock::now();
+  RayCaster<T> rayCaster(frameBuffer, camera, geometryRegister);
+  rayCaster.Profile(profiling ? &profiler : nullptr)
+      .Supersample(options.sampling)
+      .Mode(options.mode)
+      .Terminate(options.termination)
+      .Render(threadPool);
+  const auto endTime = std::chrono::steady_clock::now();
+
+  ImageWriter::Write(frameBuffer, options.output);
+
+  std::cout << "Rendered " << options.width << "x" << options.height
+            << " on " << threadPool.ThreadCount() << " threads in "
+            << std::chrono::duration<double, std::milli>(endTime - startTime)
+                   .count()
+            << " ms, written to " << options.output << std::endl;
+  if (options.sampling.Enabled()) {
+    std::cout << "Took "
+              << static_cast<double>(rayCaster.SampleCount()) /
+                     camera.RayCount()
+              << " samples per pixel on average" << std::endl;
+  }
+  threadPool.PrintStatistics(std::cout);
+
+  if (!options.profile.empty()) {
+    std::ofstream stream(options.profile);
+    profiler.WriteJSON(stream);
+    if (!stream) {
+      throw std::runtime_error("Failed to write " + options.profile);
+    }
+  }
+
+  if (!options.trace.empty()) {
+    std::ofstream stream(options.trace);
+    profiler.WriteChromeTrace(stream);
+    if (!stream) {
+      throw std::runtime_error("Failed to write " + options.trace);
+    }
+  }
+}
+
+/// Inserts the given frame number before the extension of the path.
+static std::string framePath(const std::string &path, const size_t &frame) {
+  char number[16];
+  std::snprintf(number, sizeof(number), "-%04zu", frame);
+
+  const size_t dot = path.find_last_of('.');
+  const size_t slash = path.find_last_of('/');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    return path + number;
+  }
+
+  return path.substr(0, dot) + number + path.substr(dot);
+}
+
+/// Renders the animated scene frame by frame, and writes every frame as soon
+/// as it's done. The cost of updating the scene and of rendering is reported
+/// per frame, the updates overlap with the renders of the frames before.
+template <typename T> static void renderSequence(const Options &options) {
+  ThreadPool threadPool(options.threads);
+  SequenceRenderer<T> sequenceRenderer(
+      threadPool, [](GeometryRegister<T> &geometryRegister,
+                     Animator<T> &animator) {
+        createOrbitScene(geometryRegister, animator);
+      });
+  sequenceRenderer.Supersample(options.sampling).Terminate(options.termination);
+
+  Camera<T> camera = createTwoSphereCamera<T>(options.width, options.height);
+  camera.projection = options.projection.value_or(camera.projection);
+  camera.fieldOfView = static_cast<T>(options.fieldOfView * M_PI / 180.0);
+  camera.Update();
+
+  std::cout << "frame     time   update ms   render ms  rebuilt  degradation"
+            << std::endl;
+  double updateTotal = 0.0, renderTotal = 0.0;
+  const auto startTime = std::chrono::steady_clock::now();
+  sequenceRenderer.Render(
+      options.frames, static_cast<T>(1.0 / options.frameRate), camera,
+      [&](const SequenceFrame &frame, const FrameBuffer &frameBuffer) {
+        ImageWriter::Write(frameBuffer, framePath(options.output, frame.index));
+
+        char line[96];
+        std::snprintf(line, sizeof(line), "%5zu %8.3f %11.3f %11.3f %8s %12.3f",
+                      frame.index, frame.time, frame.updateMilliseconds,
+                      frame.renderMilliseconds, frame.rebuilt ? "yes" : "no",
+                      frame.degradation);
+        std::cout << line << std::endl;
+        updateTotal += frame.updateMilliseconds;
+        renderTotal += frame.renderMilliseconds;
+      });
+  const auto endTime = std::chrono::steady_clock::now();
+
+  std::cout << "Rendered " << options.frames << " frames of " << options.width
+            << "x" << options.height << " on " << threadPool.ThreadCount()
+            << " threads in "
+            << std::chrono::duration<double, std::milli>(endTime - startTime)
+                   .count()
+            << " ms, updates took " << updateTotal << " ms and renders "
+            << renderTotal << " ms" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+      printUsage(argv[0]);
+      return 0;
+    }
+  }
+
+  try {
+    const Options options = Options::Parse(argc, argv);
+
+    if (!options.connect.empty()) {
+      work(options);
+    } else if (options.frames != 0 && options.precision == Precision::Float) {
+      renderSequence<float>(options);
+    } else if (options.frames != 0) {
+      renderSequence<double>(options);
+    } else if (options.precision == Precision::Float) {
+      render<float>(options);
+    } else {
+      render<double>(options);
+    }
+  } catch (const std::exception &exception) {
+    std::cerr << "Error: " << exception.what() << std::endl;
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,80 @@
+#include "main.hpp"
+#include "GeometryRegister.hpp"
+#include "SceneDescription.hpp"
+#include "SceneFile.hpp"
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+/// Converts an text scene description into an binary scene file, see
+/// SceneDescription for the text format and SceneFile for the binary one.
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program
+            << " [--precision double] scene.txt scene.bin" << std::endl
+            << "  Builds the hierarchies of the scene, and writes them with "
+               "the scene to an file the renderer maps with --scene."
+            << std::endl
+            << "  --precision float writes an scene for --precision float, "
+               "the precision is part of the file."
+            << std::endl;
+}
+
+template <typename T>
+static void convert(const std::string &input, const std::string &output) {
+  const auto start = std::chrono::steady_clock::now();
+  GeometryRegister<T> geometryRegister;
+  SceneDescription::Load(input, geometryRegister).Build();
+  const auto built = std::chrono::steady_clock::now();
+
+  SceneFile<T>::Write(geometryRegister, output);
+  const auto end = std::chrono::steady_clock::now();
+
+  std::cout << "Read and built " << input << " in "
+            << std::chrono::duration<double, std::milli>(built - start).count()
+            << " ms, " << geometryRegister.store.Size()
+            << " primitives written to " << output << " in "
+            << std::chrono::duration<double, std::milli>(end - built).count()
+            << " ms" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  std::string precision = "double";
+  std::string paths[2];
+  size_t pathCount = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+      printUsage(argv[0]);
+      return 0;
+    }
+
+    if (std::strcmp(argv[i], "--precision") == 0 && i + 1 < argc) {
+      precision = argv[++i];
+    } else if (pathCount < 2) {
+      paths[pathCount++] = argv[i];
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (pathCount != 2 || (precision != "float" && precision != "double")) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  try {
+    if (precision == "float") {
+      convert<float>(paths[0], paths[1]);
+    } else {
+      convert<double>(paths[0], paths[1]);
+    }
+  } catch (const std::exception &exception) {
+    std::cerr << "Error: " << exception.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
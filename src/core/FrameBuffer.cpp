@@ -0,0 +1,33 @@
+#include "FrameBuffer.hpp"
+#include <stdexcept>
+
+FrameBuffer::FrameBuffer(const size_t &width, const size_t &height)
+    : width(width), height(height), pixels(width * height * channelCount, 0) {}
+
+FrameBuffer &FrameBuffer::PutPixel(const size_t &x, const size_t &y,
+                                   const uint8_t r, const uint8_t g,
+                                   const uint8_t b, const uint8_t a) {
+  if (y >= this->height || x >= this->width) {
+    throw std::runtime_error("Invalid coordinates, outside of canvas.");
+  }
+
+  uint8_t *p = this->pixels.data() + y * this->RowStride() + x * channelCount;
+  p[0] = r;
+  p[1] = g;
+  p[2] = b;
+  p[3] = a;
+
+  return *this;
+}
+
+FrameBuffer &FrameBuffer::Fill(const uint8_t r, const uint8_t g,
+                               const uint8_t b, const uint8_t a) {
+  for (size_t i = 0; i < this->pixels.size(); i += channelCount) {
+    this->pixels[i + 0] = r;
+    this->pixels[i + 1] = g;
+    this->pixels[i + 2] = b;
+    this->pixels[i + 3] = a;
+  }
+
+  return *this;
+}
@@ -0,0 +1,155 @@
+#include "ImageWriter.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+/// Appends an 32-bit big-endian integer, as used by PNG and zlib.
+static void appendUInt32(std::vector<uint8_t> &data, const uint32_t &value) {
+  data.push_back(static_cast<uint8_t>(value >> 24));
+  data.push_back(static_cast<uint8_t>(value >> 16));
+  data.push_back(static_cast<uint8_t>(value >> 8));
+  data.push_back(static_cast<uint8_t>(value >> 0));
+}
+
+static uint32_t crc32(const uint8_t *data, const size_t &size) {
+  static uint32_t table[256] = {};
+  if (table[1] == 0) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (size_t k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+  }
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+
+  return crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t adler32(const uint8_t *data, const size_t &size) {
+  uint32_t a = 1, b = 0;
+  for (size_t i = 0; i < size; ++i) {
+    a = (a + data[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+
+  return (b << 16) | a;
+}
+
+/// Writes an PNG chunk, the checksum covers both the type and the data.
+static void writeChunk(std::ofstream &stream, const char type[4],
+                       const std::vector<uint8_t> &data) {
+  std::vector<uint8_t> chunk;
+  chunk.reserve(data.size() + 12);
+  appendUInt32(chunk, static_cast<uint32_t>(data.size()));
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+  appendUInt32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+
+  stream.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+}
+
+static std::ofstream openFile(const std::string &path) {
+  std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+  if (!stream) {
+    throw std::runtime_error("Failed to open " + path + " for writing.");
+  }
+
+  return stream;
+}
+
+void ImageWriter::WritePPM(const FrameBuffer &frameBuffer,
+                           const std::string &path) {
+  std::ofstream stream = openFile(path);
+  stream << "P6\n" << frameBuffer.width << ' ' << frameBuffer.height << "\n255\n";
+
+  // Writes the pixels row by row, without the alpha channel.
+  std::vector<uint8_t> row(frameBuffer.width * 3);
+  for (size_t y = 0; y < frameBuffer.height; ++y) {
+    const uint8_t *pixels = frameBuffer.Row(y);
+    for (size_t x = 0; x < frameBuffer.width; ++x) {
+      row[x * 3 + 0] = pixels[x * FrameBuffer::channelCount + 0];
+      row[x * 3 + 1] = pixels[x * FrameBuffer::channelCount + 1];
+      row[x * 3 + 2] = pixels[x * FrameBuffer::channelCount + 2];
+    }
+
+    stream.write(reinterpret_cast<const char *>(row.data()), row.size());
+  }
+
+  if (!stream) {
+    throw std::runtime_error("Failed to write " + path + ".");
+  }
+}
+
+void ImageWriter::WritePNG(const FrameBuffer &frameBuffer,
+                           const std::string &path) {
+  std::ofstream stream = openFile(path);
+
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  stream.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+
+  // The header: 8 bits per channel, RGBA, no interlacing.
+  std::vector<uint8_t> header;
+  appendUInt32(header, static_cast<uint32_t>(frameBuffer.width));
+  appendUInt32(header, static_cast<uint32_t>(frameBuffer.height));
+  header.insert(header.end(), {8, 6, 0, 0, 0});
+  writeChunk(stream, "IHDR", header);
+
+  // Every row is prefixed with its filter type, we never filter.
+  std::vector<uint8_t> scanlines;
+  scanlines.reserve(frameBuffer.height * (frameBuffer.RowStride() + 1));
+  for (size_t y = 0; y < frameBuffer.height; ++y) {
+    scanlines.push_back(0);
+    scanlines.insert(scanlines.end(), frameBuffer.Row(y),
+                     frameBuffer.Row(y) + frameBuffer.RowStride());
+  }
+
+  // Wraps the scanlines in an zlib stream made of stored deflate blocks, which
+  // can hold at most 65535 bytes each.
+  std::vector<uint8_t> compressed = {0x78, 0x01};
+  size_t offset = 0;
+  do {
+    const size_t length = std::min<size_t>(scanlines.size() - offset, 65535);
+    compressed.push_back(offset + length == scanlines.size() ? 1 : 0);
+    compressed.push_back(static_cast<uint8_t>(length & 0xFF));
+    compressed.push_back(static_cast<uint8_t>(length >> 8));
+    compressed.push_back(static_cast<uint8_t>(~length & 0xFF));
+    compressed.push_back(static_cast<uint8_t>((~length >> 8) & 0xFF));
+    compressed.insert(compressed.end(), scanlines.begin() + offset,
+                      scanlines.begin() + offset + length);
+    offset += length;
+  } while (offset < scanlines.size());
+  appendUInt32(compressed, adler32(scanlines.data(), scanlines.size()));
+  writeChunk(stream, "IDAT", compressed);
+
+  writeChunk(stream, "IEND", {});
+
+  if (!stream) {
+    throw std::runtime_error("Failed to write " + path + ".");
+  }
+}
+
+void ImageWriter::Write(const FrameBuffer &frameBuffer,
+                        const std::string &path) {
+  const size_t dot = path.find_last_of('.');
+  std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](const char &c) { return std::tolower(c); });
+
+  if (extension == "png") {
+    ImageWriter::WritePNG(frameBuffer, path);
+  } else if (extension == "ppm") {
+    ImageWriter::WritePPM(frameBuffer, path);
+  } else {
+    throw std::runtime_error("Unsupported image format: " + path);
+  }
+}
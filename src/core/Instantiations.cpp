@@ -0,0 +1,68 @@
+// Instantiates every class template in both precisions, so all of their
+// members are compiled for float as well as for double even where nothing uses
+// them yet. An member which only compiles for one of them fails the build here.
+
+#include "Animation.hpp"
+#include "BoundingBox.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include "Camera.hpp"
+#include "DistributedRenderer.hpp"
+#include "Geometry.hpp"
+#include "GeometryRegister.hpp"
+#include "Instance.hpp"
+#include "Material.hpp"
+#include "Matrix3D.hpp"
+#include "Ray.hpp"
+#include "RayCaster.hpp"
+#include "SceneFile.hpp"
+#include "SceneStore.hpp"
+#include "SequenceRenderer.hpp"
+#include "Sphere.hpp"
+#include "TriangleMesh.hpp"
+#include "Vector3D.hpp"
+#include "WavefrontQueue.hpp"
+
+template class Vector3D<float>;
+template class Vector3D<double>;
+template class Matrix3D<float>;
+template class Matrix3D<double>;
+template class AffineMatrix3D<float>;
+template class AffineMatrix3D<double>;
+template class Ray<float>;
+template class Ray<double>;
+template class BoundingBox<float>;
+template class BoundingBox<double>;
+template class BoundingVolumeHierarchy<float>;
+template class BoundingVolumeHierarchy<double>;
+template class Material<float>;
+template class Material<double>;
+template class Sphere<float>;
+template class Sphere<double>;
+template class TriangleMesh<float>;
+template class TriangleMesh<double>;
+template class Instance<float>;
+template class Instance<double>;
+template class SceneStore<float>;
+template class SceneStore<double>;
+template class SceneFile<float>;
+template class SceneFile<double>;
+template class GeometryRegister<float>;
+template class GeometryRegister<double>;
+template class Keyframe<float>;
+template class Keyframe<double>;
+template class Animation<float>;
+template class Animation<double>;
+template class Animator<float>;
+template class Animator<double>;
+template class Camera<float>;
+template class Camera<double>;
+template class RayCaster<float>;
+template class RayCaster<double>;
+template class SequenceRenderer<float>;
+template class SequenceRenderer<double>;
+template class DistributedRenderer<float>;
+template class DistributedRenderer<double>;
+template class WavefrontQueue<float>;
+template class WavefrontQueue<double>;
+template class WavefrontBuffer<float>;
+template class WavefrontBuffer<double>;
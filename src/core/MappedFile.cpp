@@ -0,0 +1,61 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path, const MappedFileAccess &access)
+    : data(nullptr), size(0) {
+  const int file = open(path.c_str(), O_RDONLY);
+  if (file < 0) {
+    throw std::runtime_error("Failed to open " + path + ".");
+  }
+
+  struct stat status;
+  if (fstat(file, &status) != 0) {
+    close(file);
+    throw std::runtime_error("Failed to get the size of " + path + ".");
+  }
+
+  // Empty files can't be mapped, they just have no data.
+  this->size = static_cast<size_t>(status.st_size);
+  if (this->size != 0) {
+    void *mapping = mmap(nullptr, this->size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE, file, 0);
+    if (mapping == MAP_FAILED) {
+      close(file);
+      throw std::runtime_error("Failed to map " + path + " into memory.");
+    }
+
+    madvise(mapping, this->size,
+            access == MappedFileAccess::Sequential ? MADV_SEQUENTIAL
+                                                   : MADV_WILLNEED);
+    this->data = static_cast<char *>(mapping);
+  }
+
+  // The mapping stays valid after the file has been closed.
+  close(file);
+}
+
+MappedFile::MappedFile(const size_t &size) : data(nullptr), size(size) {
+  if (this->size != 0) {
+    void *mapping = mmap(nullptr, this->size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Failed to map " + std::to_string(this->size) +
+                               " bytes of memory.");
+    }
+
+    this->data = static_cast<char *>(mapping);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (this->data != nullptr) {
+    munmap(this->data, this->size);
+  }
+}
@@ -0,0 +1,140 @@
+#include "ObjLoader.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#include "MappedFile.hpp"
+
+static inline bool isBlank(const char &c) { return c == ' ' || c == '\t'; }
+
+static inline const char *skipBlanks(const char *p, const char *end) {
+  while (p < end && isBlank(*p)) {
+    ++p;
+  }
+
+  return p;
+}
+
+static std::runtime_error parseError(const char *what, const size_t &line) {
+  return std::runtime_error(std::string(what) + " on line " +
+                            std::to_string(line));
+}
+
+/// Parses an number at p, and moves p past it.
+static double parseNumber(const char *&p, const char *end, const size_t &line) {
+  p = skipBlanks(p, end);
+  if (p < end && *p == '+') {
+    ++p;
+  }
+
+  double value;
+  const std::from_chars_result result = std::from_chars(p, end, value);
+  if (result.ec != std::errc()) {
+    throw parseError("Invalid number", line);
+  }
+
+  p = result.ptr;
+  return value;
+}
+
+/// Parses the position index of an face vertex (i, i/t, i//n or i/t/n) at p,
+/// and moves p past the entire vertex. Negative indices count back from the
+/// last vertex read so far.
+static uint32_t parseIndex(const char *&p, const char *end,
+                           const size_t &vertexCount, const size_t &line) {
+  int64_t index;
+  const std::from_chars_result result = std::from_chars(p, end, index);
+  if (result.ec != std::errc() || index == 0) {
+    throw parseError("Invalid face index", line);
+  }
+
+  p = result.ptr;
+  while (p < end && !isBlank(*p)) {
+    ++p;
+  }
+
+  const int64_t resolved =
+      index < 0 ? static_cast<int64_t>(vertexCount) + index : index - 1;
+  if (resolved < 0 || resolved > static_cast<int64_t>(UINT32_MAX)) {
+    throw parseError("Face index out of range", line);
+  }
+
+  return static_cast<uint32_t>(resolved);
+}
+
+ObjMesh ObjLoader::Load(const std::string &path) {
+  const MappedFile file(path);
+
+  try {
+    return ObjLoader::Parse(file.Data(), file.Size());
+  } catch (const std::runtime_error &error) {
+    throw std::runtime_error(path + ": " + error.what());
+  }
+}
+
+ObjMesh ObjLoader::Parse(const char *data, const size_t &size) {
+  ObjMesh mesh;
+
+  // The indices of the current polygon, this keeps its capacity so only the
+  // first polygons with many vertices allocate.
+  std::vector<uint32_t> polygon;
+  polygon.reserve(16);
+
+  const char *p = data;
+  const char *const end = data + size;
+  for (size_t line = 1; p < end; ++line) {
+    const char *lineEnd =
+        static_cast<const char *>(std::memchr(p, '\n', end - p));
+    if (lineEnd == nullptr) {
+      lineEnd = end;
+    }
+
+    // Ignores the carriage return of files with Windows line endings.
+    const char *contentEnd = lineEnd;
+    if (contentEnd > p && contentEnd[-1] == '\r') {
+      --contentEnd;
+    }
+
+    p = skipBlanks(p, contentEnd);
+    if (contentEnd - p >= 2 && p[0] == 'v' && isBlank(p[1])) {
+      p += 2;
+      const double x = parseNumber(p, contentEnd, line);
+      const double y = parseNumber(p, contentEnd, line);
+      const double z = parseNumber(p, contentEnd, line);
+      mesh.vertices.emplace_back(x, y, z);
+    } else if (contentEnd - p >= 2 && p[0] == 'f' && isBlank(p[1])) {
+      p = skipBlanks(p + 2, contentEnd);
+      polygon.clear();
+      while (p < contentEnd) {
+        polygon.push_back(
+            parseIndex(p, contentEnd, mesh.vertices.size(), line));
+        p = skipBlanks(p, contentEnd);
+      }
+
+      if (polygon.size() < 3) {
+        throw parseError("Face with less than three vertices", line);
+      }
+
+      for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+        mesh.indices.push_back(polygon[0]);
+        mesh.indices.push_back(polygon[i]);
+        mesh.indices.push_back(polygon[i + 1]);
+      }
+    }
+
+    p = lineEnd + 1;
+  }
+
+  // Faces may refer to vertices further down the file, so the indices are
+  // only checked once everything has been read.
+  for (const uint32_t &index : mesh.indices) {
+    if (index >= mesh.vertices.size()) {
+      throw std::runtime_error("Face refers to vertex " +
+                               std::to_string(index + 1) + " of " +
+                               std::to_string(mesh.vertices.size()));
+    }
+  }
+
+  return mesh;
+}
@@ -0,0 +1,153 @@
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <iomanip>
+
+static const char *counterNames[ThreadProfile::counterCount] = {
+    "rays",         "bounces",     "intersectionTests",
+    "nodesVisited", "terminations", "shadowRays"};
+
+static const char *stageNames[ThreadProfile::stageCount] = {
+    "generation", "traversal", "shading", "shadows", "frameBufferWrites"};
+
+static double milliseconds(const uint64_t &nanoseconds) {
+  return static_cast<double>(nanoseconds) / 1e6;
+}
+
+uint64_t ThreadProfile::Time(const ProfileStage &stage,
+                             const uint64_t &start) noexcept {
+  const uint64_t now = Profiler::Now();
+  this->stageNanoseconds[static_cast<size_t>(stage)] += now - start;
+  return now;
+}
+
+ThreadProfile &ThreadProfile::Reset(const size_t &tileCount) {
+  for (uint64_t &counter : this->counters) {
+    counter = 0;
+  }
+
+  for (uint64_t &nanoseconds : this->stageNanoseconds) {
+    nanoseconds = 0;
+  }
+
+  this->tiles.clear();
+  this->tiles.reserve(tileCount);
+  return *this;
+}
+
+Profiler &Profiler::Begin(const size_t &threadCount, const size_t &tileCount) {
+  if (this->threads.size() != threadCount) {
+    this->threads = std::vector<ThreadProfile>(threadCount);
+  }
+
+  // Every thread may end up rendering all the tiles when the others are slow
+  // to start, so every one of them reserves room for all of them.
+  for (ThreadProfile &thread : this->threads) {
+    thread.Reset(tileCount);
+  }
+
+  this->startNanoseconds = Profiler::Now();
+  this->endNanoseconds = this->startNanoseconds;
+  return *this;
+}
+
+Profiler &Profiler::End() {
+  this->endNanoseconds = Profiler::Now();
+  return *this;
+}
+
+uint64_t Profiler::Total(const ProfileCounter &counter) const noexcept {
+  uint64_t total = 0;
+  for (const ThreadProfile &thread : this->threads) {
+    total += thread.Counter(counter);
+  }
+
+  return total;
+}
+
+uint64_t Profiler::TotalNanoseconds(const ProfileStage &stage) const noexcept {
+  uint64_t total = 0;
+  for (const ThreadProfile &thread : this->threads) {
+    total += thread.stageNanoseconds[static_cast<size_t>(stage)];
+  }
+
+  return total;
+}
+
+const Profiler &Profiler::WriteJSON(std::ostream &stream) const {
+  stream << std::fixed << std::setprecision(3);
+  stream << "{\n  \"threads\": " << this->threads.size()
+         << ",\n  \"frameMilliseconds\": "
+         << milliseconds(this->endNanoseconds - this->startNanoseconds);
+
+  // The totals over all threads, the stage times add up to more than the frame
+  // time when multiple threads were busy.
+  stream << ",\n  \"counters\": {";
+  for (size_t i = 0; i < ThreadProfile::counterCount; ++i) {
+    stream << (i == 0 ? "" : ",") << "\n    \"" << counterNames[i]
+           << "\": " << this->Total(static_cast<ProfileCounter>(i));
+  }
+  stream << "\n  },\n  \"stageMilliseconds\": {";
+  for (size_t i = 0; i < ThreadProfile::stageCount; ++i) {
+    stream << (i == 0 ? "" : ",") << "\n    \"" << stageNames[i] << "\": "
+           << milliseconds(this->TotalNanoseconds(static_cast<ProfileStage>(i)));
+  }
+
+  stream << "\n  },\n  \"perThread\": [";
+  for (size_t thread = 0; thread < this->threads.size(); ++thread) {
+    const ThreadProfile &profile = this->threads[thread];
+    stream << (thread == 0 ? "" : ",") << "\n    {\"tiles\": "
+           << profile.tiles.size();
+    for (size_t i = 0; i < ThreadProfile::counterCount; ++i) {
+      stream << ", \"" << counterNames[i] << "\": " << profile.counters[i];
+    }
+    for (size_t i = 0; i < ThreadProfile::stageCount; ++i) {
+      stream << ", \"" << stageNames[i]
+             << "Milliseconds\": " << milliseconds(profile.stageNanoseconds[i]);
+    }
+    stream << "}";
+  }
+  stream << "\n  ]\n}\n";
+
+  return *this;
+}
+
+const Profiler &Profiler::WriteChromeTrace(std::ostream &stream) const {
+  // The timestamps and durations are in microseconds.
+  stream << std::fixed << std::setprecision(3);
+  stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+  bool first = true;
+  for (size_t thread = 0; thread < this->threads.size(); ++thread) {
+    stream << (first ? "" : ",") << "\n  {\"name\": \"thread_name\", "
+           << "\"ph\": \"M\", \"pid\": 0, \"tid\": " << thread
+           << ", \"args\": {\"name\": \"worker " << thread << "\"}}";
+    first = false;
+
+    for (const TileEvent &event : this->threads[thread].tiles) {
+      stream << ",\n  {\"name\": \"tile " << event.tile.x << ',' << event.tile.y
+             << "\", \"cat\": \"tile\", \"ph\": \"X\", \"pid\": 0, \"tid\": "
+             << thread << ", \"ts\": "
+             << static_cast<double>(event.startNanoseconds) / 1e3
+             << ", \"dur\": "
+             << static_cast<double>(event.endNanoseconds -
+                                    event.startNanoseconds) /
+                    1e3
+             << ", \"args\": {\"x\": " << event.tile.x
+             << ", \"y\": " << event.tile.y
+             << ", \"width\": " << event.tile.width
+             << ", \"height\": " << event.tile.height
+             << ", \"rays\": " << event.rays
+             << ", \"nodesVisited\": " << event.nodesVisited << "}}";
+    }
+  }
+
+  stream << "\n]}\n";
+  return *this;
+}
+
+uint64_t Profiler::Now() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
@@ -0,0 +1,186 @@
+#include "Sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+/// The most samples an pixel can take, the patterns take quadratic time to
+/// generate.
+static constexpr size_t maximumPatternSize = 1024;
+
+/// The number of candidates drawn for every blue noise point.
+static constexpr size_t candidateCount = 16;
+
+/// Gets the squared distance of two points in the unit square, wrapping around
+/// the edges so the pattern also tiles evenly across neighbouring pixels.
+static float wrappedDistance(const float &ax, const float &ay, const float &bx,
+                             const float &by) noexcept {
+  float dx = std::fabs(ax - bx), dy = std::fabs(ay - by);
+  dx = std::min(dx, 1.0f - dx);
+  dy = std::min(dy, 1.0f - dy);
+  return dx * dx + dy * dy;
+}
+
+/// Takes the given number of cells of an grid over the pixel, each next one as
+/// far from the ones taken so far as possible, and gives their corners.
+static std::vector<float> stratifiedPoints(const size_t &count,
+                                           float &cellSize) {
+  const size_t side = static_cast<size_t>(
+      std::ceil(std::sqrt(static_cast<double>(count)) - 1e-9));
+  cellSize = 1.0f / static_cast<float>(side);
+
+  std::vector<float> distances(side * side,
+                               std::numeric_limits<float>::infinity());
+  std::vector<float> points;
+  points.reserve(count * 2);
+  size_t cell = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const float x = static_cast<float>(cell % side) * cellSize;
+    const float y = static_cast<float>(cell / side) * cellSize;
+    points.push_back(x);
+    points.push_back(y);
+
+    size_t farthest = 0;
+    for (size_t other = 0; other < distances.size(); ++other) {
+      distances[other] = std::min(
+          distances[other],
+          wrappedDistance(x, y, static_cast<float>(other % side) * cellSize,
+                          static_cast<float>(other / side) * cellSize));
+      farthest = distances[other] > distances[farthest] ? other : farthest;
+    }
+    cell = farthest;
+  }
+
+  return points;
+}
+
+/// Places the given number of points by Mitchell's best candidate algorithm,
+/// each next one is the candidate farthest from the points so far.
+static std::vector<float> blueNoisePoints(const size_t &count) {
+  SampleRandom random(0x5EED);
+  std::vector<float> points;
+  points.reserve(count * 2);
+
+  for (size_t i = 0; i < count; ++i) {
+    float bestX = 0.0f, bestY = 0.0f, bestDistance = -1.0f;
+    for (size_t candidate = 0; candidate < candidateCount; ++candidate) {
+      const float x = random.NextFloat(), y = random.NextFloat();
+      float distance = std::numeric_limits<float>::infinity();
+      for (size_t point = 0; point < i; ++point) {
+        distance = std::min(distance, wrappedDistance(x, y, points[point * 2],
+                                                      points[point * 2 + 1]));
+      }
+
+      if (distance > bestDistance) {
+        bestX = x;
+        bestY = y;
+        bestDistance = distance;
+      }
+    }
+
+    points.push_back(bestX);
+    points.push_back(bestY);
+  }
+
+  return points;
+}
+
+Sampler::Sampler(const SampleSettings &settings)
+    : settings(settings), points(), cellSize(0.0f) {
+  if (settings.maximumSamples == 0 ||
+      settings.maximumSamples > maximumPatternSize) {
+    throw std::invalid_argument("The samples per pixel must be from 1 to " +
+                                std::to_string(maximumPatternSize));
+  }
+
+  if (settings.minimumSamples == 0) {
+    throw std::invalid_argument("The minimum samples must be at least 1");
+  }
+  this->settings.minimumSamples =
+      std::min(settings.minimumSamples, settings.maximumSamples);
+
+  if (!(settings.threshold >= 0.0f)) {
+    throw std::invalid_argument("The sample threshold must not be negative");
+  }
+
+  this->points = settings.pattern == SamplePattern::Stratified
+                     ? stratifiedPoints(settings.maximumSamples, this->cellSize)
+                     : blueNoisePoints(settings.maximumSamples);
+}
+
+SampleBuffer &SampleBuffer::Reset(const size_t &pixelCount) {
+  this->sums.assign(pixelCount * 3, 0.0);
+  this->squares.assign(pixelCount * 3, 0.0);
+  this->counts.assign(pixelCount, 0);
+  this->shifts.resize(pixelCount * 2);
+  this->active.resize(pixelCount);
+  for (size_t pixel = 0; pixel < pixelCount; ++pixel) {
+    this->active[pixel] = static_cast<uint32_t>(pixel);
+  }
+  this->remaining.reserve(pixelCount);
+  this->remaining.clear();
+  this->noisy.assign(pixelCount, 1);
+
+  return *this;
+}
+
+bool SampleBuffer::Converged(const uint32_t &pixel,
+                             const float &threshold) const noexcept {
+  const double count = static_cast<double>(this->counts[pixel]);
+  if (count < 2.0) {
+    return false;
+  }
+
+  // The variance of the mean is the sample variance over the count, compared
+  // squared so there's no root to take.
+  const double limit = static_cast<double>(threshold) * threshold;
+  for (size_t channel = 0; channel < 3; ++channel) {
+    const double sum = this->sums[pixel * 3 + channel];
+    const double variance =
+        (this->squares[pixel * 3 + channel] - sum * sum / count) /
+        (count - 1.0);
+    if (variance / count > limit) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+SampleBuffer &SampleBuffer::Settle(const size_t &width, const size_t &height,
+                                   const float &threshold) {
+  if (!(threshold > 0.0f)) {
+    return *this;
+  }
+
+  for (const uint32_t &pixel : this->active) {
+    this->noisy[pixel] = this->Converged(pixel, threshold) ? 0 : 1;
+  }
+
+  // The settled pixels are never noisy, so only the active ones can keep their
+  // neighbours going.
+  this->remaining.clear();
+  for (const uint32_t &pixel : this->active) {
+    const size_t x = pixel % width, y = pixel / width;
+    if (this->noisy[pixel] || (x > 0 && this->noisy[pixel - 1]) ||
+        (x + 1 < width && this->noisy[pixel + 1]) ||
+        (y > 0 && this->noisy[pixel - width]) ||
+        (y + 1 < height && this->noisy[pixel + width])) {
+      this->remaining.push_back(pixel);
+    }
+  }
+
+  // Only clears the flags once all the neighbours have been looked at.
+  for (const uint32_t &pixel : this->active) {
+    this->noisy[pixel] = 0;
+  }
+  for (const uint32_t &pixel : this->remaining) {
+    this->noisy[pixel] = 1;
+  }
+
+  std::swap(this->active, this->remaining);
+  return *this;
+}
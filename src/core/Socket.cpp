@@ -0,0 +1,267 @@
+#include "Socket.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/// An address split into its parts, and resolved.
+class SocketAddress {
+public:
+  sockaddr_storage storage;
+  socklen_t length;
+  std::string host, path; // The path is only set for Unix domain sockets.
+
+public:
+  /// Resolves the given address, see Socket.
+  explicit SocketAddress(const std::string &address) : storage(), length(0) {
+    static const std::string unixPrefix = "unix:";
+    if (address.compare(0, unixPrefix.size(), unixPrefix) == 0) {
+      this->path = address.substr(unixPrefix.size());
+      sockaddr_un *unixAddress = reinterpret_cast<sockaddr_un *>(&this->storage);
+      if (this->path.empty() ||
+          this->path.size() >= sizeof(unixAddress->sun_path)) {
+        throw std::runtime_error("Invalid socket path in " + address);
+      }
+
+      unixAddress->sun_family = AF_UNIX;
+      std::memcpy(unixAddress->sun_path, this->path.c_str(),
+                  this->path.size() + 1);
+      this->length = sizeof(sockaddr_un);
+      return;
+    }
+
+    const size_t colon = address.find_last_of(':');
+    if (colon == std::string::npos || colon + 1 == address.size()) {
+      throw std::runtime_error("Expected unix:path or host:port, got " +
+                               address);
+    }
+    this->host = address.substr(0, colon);
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo *results = nullptr;
+    const int error =
+        getaddrinfo(this->host.empty() ? nullptr : this->host.c_str(),
+                    address.c_str() + colon + 1, &hints, &results);
+    if (error != 0) {
+      throw std::runtime_error("Failed to resolve " + address + ": " +
+                               gai_strerror(error));
+    }
+
+    std::memcpy(&this->storage, results->ai_addr, results->ai_addrlen);
+    this->length = results->ai_addrlen;
+    freeaddrinfo(results);
+  }
+
+  inline const sockaddr *Get() const noexcept {
+    return reinterpret_cast<const sockaddr *>(&this->storage);
+  }
+
+  inline int Family() const noexcept { return this->storage.ss_family; }
+
+  ~SocketAddress() = default;
+};
+
+/// Gets an exception for the failed system call, with the reason.
+static std::runtime_error systemError(const std::string &what) {
+  return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/// Sends small messages right away, rather than waiting for more to send.
+static void disableDelay(const int &descriptor, const int &family) {
+  if (family != AF_UNIX) {
+    const int enabled = 1;
+    setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &enabled,
+               sizeof(enabled));
+  }
+}
+
+Socket::Socket(const int &descriptor) noexcept : descriptor(descriptor) {}
+
+Socket::Socket(Socket &&other) noexcept : descriptor(other.descriptor) {
+  other.descriptor = -1;
+}
+
+Socket &Socket::operator=(Socket &&other) noexcept {
+  if (this != &other) {
+    if (this->descriptor >= 0) {
+      close(this->descriptor);
+    }
+    this->descriptor = other.descriptor;
+    other.descriptor = -1;
+  }
+
+  return *this;
+}
+
+Socket Socket::Connect(const std::string &address,
+                       const size_t &retryMilliseconds) {
+  const SocketAddress resolved(address);
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(retryMilliseconds);
+
+  while (true) {
+    Socket socket(::socket(resolved.Family(), SOCK_STREAM, 0));
+    if (socket.descriptor < 0) {
+      throw systemError("Failed to create an socket for " + address);
+    }
+
+    if (connect(socket.descriptor, resolved.Get(), resolved.length) == 0) {
+      disableDelay(socket.descriptor, resolved.Family());
+      return socket;
+    }
+
+    // Nothing listens there yet, or the socket file isn't there yet.
+    const bool absent = errno == ECONNREFUSED || errno == ENOENT;
+    if (!absent || std::chrono::steady_clock::now() >= deadline) {
+      throw systemError("Failed to connect to " + address);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+}
+
+Socket &Socket::Send(const void *data, const size_t &size) {
+  const char *bytes = static_cast<const char *>(data);
+  for (size_t sent = 0; sent < size;) {
+    // Gets an error instead of an SIGPIPE when the other side is gone.
+    const ssize_t count =
+        send(this->descriptor, bytes + sent, size - sent, MSG_NOSIGNAL);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw systemError("Failed to send");
+    }
+    sent += static_cast<size_t>(count);
+  }
+
+  return *this;
+}
+
+Socket &Socket::Receive(void *data, const size_t &size) {
+  char *bytes = static_cast<char *>(data);
+  for (size_t received = 0; received < size;) {
+    const ssize_t count =
+        recv(this->descriptor, bytes + received, size - received, 0);
+    if (count == 0) {
+      throw std::runtime_error("The connection was closed");
+    }
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw systemError("Failed to receive");
+    }
+    received += static_cast<size_t>(count);
+  }
+
+  return *this;
+}
+
+size_t Socket::ReceiveAvailable(void *data, const size_t &size) {
+  while (true) {
+    const ssize_t count = recv(this->descriptor, data, size, MSG_DONTWAIT);
+    if (count > 0) {
+      return static_cast<size_t>(count);
+    }
+    if (count == 0) {
+      throw std::runtime_error("The connection was closed");
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    if (errno != EINTR) {
+      throw systemError("Failed to receive");
+    }
+  }
+}
+
+Socket::~Socket() {
+  if (this->descriptor >= 0) {
+    close(this->descriptor);
+  }
+}
+
+Listener::Listener(const std::string &address)
+    : descriptor(-1), path(), address(address) {
+  const SocketAddress resolved(address);
+  this->descriptor = socket(resolved.Family(), SOCK_STREAM, 0);
+  if (this->descriptor < 0) {
+    throw systemError("Failed to create an socket for " + address);
+  }
+
+  if (resolved.Family() != AF_UNIX) {
+    const int enabled = 1;
+    setsockopt(this->descriptor, SOL_SOCKET, SO_REUSEADDR, &enabled,
+               sizeof(enabled));
+  }
+
+  int bound = bind(this->descriptor, resolved.Get(), resolved.length);
+
+  // An socket file nothing listens on anymore is left over from an earlier
+  // run which didn't get to remove it, so it's replaced.
+  if (bound != 0 && errno == EADDRINUSE && resolved.Family() == AF_UNIX) {
+    try {
+      Socket::Connect(address);
+      errno = EADDRINUSE;
+    } catch (const std::runtime_error &) {
+      unlink(resolved.path.c_str());
+      bound = bind(this->descriptor, resolved.Get(), resolved.length);
+    }
+  }
+
+  if (bound != 0 || listen(this->descriptor, 64) != 0) {
+    const std::runtime_error error =
+        systemError("Failed to listen on " + address);
+    close(this->descriptor);
+    throw error;
+  }
+  this->path = resolved.path;
+
+  // Looks up the port which was picked, if any.
+  if (resolved.Family() != AF_UNIX) {
+    sockaddr_storage local;
+    socklen_t length = sizeof(local);
+    getsockname(this->descriptor, reinterpret_cast<sockaddr *>(&local),
+                &length);
+    const uint16_t port =
+        local.ss_family == AF_INET6
+            ? reinterpret_cast<const sockaddr_in6 *>(&local)->sin6_port
+            : reinterpret_cast<const sockaddr_in *>(&local)->sin_port;
+    this->address = resolved.host + ":" + std::to_string(ntohs(port));
+  }
+}
+
+Socket Listener::Accept() {
+  while (true) {
+    const int connection = accept(this->descriptor, nullptr, nullptr);
+    if (connection >= 0) {
+      Socket socket(connection);
+      disableDelay(connection, this->path.empty() ? AF_INET : AF_UNIX);
+      return socket;
+    }
+    if (errno != EINTR) {
+      throw systemError("Failed to accept an connection");
+    }
+  }
+}
+
+Listener::~Listener() {
+  close(this->descriptor);
+  if (!this->path.empty()) {
+    unlink(this->path.c_str());
+  }
+}
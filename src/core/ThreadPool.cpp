@@ -0,0 +1,207 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+static uint64_t nanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+WorkStealingQueue &WorkStealingQueue::Reset(const size_t &capacity) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->tasks.size() < capacity) {
+    this->tasks.resize(capacity);
+  }
+
+  this->head = 0;
+  this->tail = 0;
+  return *this;
+}
+
+WorkStealingQueue &WorkStealingQueue::Push(const size_t &task) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->tasks.at(this->tail++) = task;
+  return *this;
+}
+
+bool WorkStealingQueue::Pop(size_t &task) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->head == this->tail) {
+    return false;
+  }
+
+  task = this->tasks[--this->tail];
+  return true;
+}
+
+bool WorkStealingQueue::Steal(size_t &task) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->head == this->tail) {
+    return false;
+  }
+
+  task = this->tasks[this->head++];
+  return true;
+}
+
+ThreadPool::ThreadPool(const size_t &threadCount)
+    : threads(), queues(std::max<size_t>(
+                       threadCount != 0 ? threadCount
+                                        : std::thread::hardware_concurrency(),
+                       1)),
+      statistics(queues.size()), task(nullptr), generation(0),
+      threadsActive(0), exception(nullptr),
+      stopping(false) {
+  this->threads.reserve(this->queues.size());
+  for (size_t i = 0; i < this->queues.size(); ++i) {
+    this->threads.emplace_back([this, i]() { this->Work(i); });
+  }
+}
+
+ThreadPool &ThreadPool::Run(const size_t &taskCount, const Task &task) {
+  if (taskCount == 0) {
+    return *this;
+  }
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+
+  // Hands every worker an contiguous range of the tasks, so neighbouring tiles
+  // end up on the same thread unless they're stolen.
+  const size_t threadCount = this->threads.size();
+  for (size_t i = 0; i < threadCount; ++i) {
+    const size_t from = i * taskCount / threadCount;
+    const size_t to = (i + 1) * taskCount / threadCount;
+
+    WorkStealingQueue &queue = this->queues[i];
+    queue.Reset(to - from);
+    for (size_t n = to; n > from; --n) {
+      queue.Push(n - 1);
+    }
+
+    this->statistics[i] = ThreadStatistics();
+  }
+
+  // Wakes up the workers, and waits for them to finish all the tasks.
+  const uint64_t start = nanoseconds();
+  this->task = &task;
+  this->threadsActive = threadCount;
+  this->exception = nullptr;
+  ++this->generation;
+  this->startCondition.notify_all();
+
+  this->doneCondition.wait(lock, [this]() { return this->threadsActive == 0; });
+  this->task = nullptr;
+
+  // The utilisation is relative to the entire run, so time spent waiting on
+  // the slowest thread counts as idle.
+  const uint64_t wallNanoseconds = nanoseconds() - start;
+  for (ThreadStatistics &statistics : this->statistics) {
+    statistics.wallNanoseconds = wallNanoseconds;
+  }
+
+  if (this->exception) {
+    std::rethrow_exception(this->exception);
+  }
+
+  return *this;
+}
+
+ThreadPool &ThreadPool::PrintStatistics(std::ostream &stream) {
+  for (size_t i = 0; i < this->statistics.size(); ++i) {
+    const ThreadStatistics &statistics = this->statistics[i];
+    stream << "thread " << std::setw(3) << i << ": " << std::setw(5)
+           << statistics.tasksExecuted << " tasks (" << std::setw(5)
+           << statistics.tasksStolen << " stolen), " << std::fixed
+           << std::setprecision(2)
+           << static_cast<double>(statistics.busyNanoseconds) / 1e6
+           << " ms busy, " << std::setprecision(1)
+           << statistics.Utilisation() * 100.0 << "% utilisation"
+           << std::endl;
+  }
+
+  return *this;
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+
+  this->startCondition.notify_all();
+  for (std::thread &thread : this->threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Work(const size_t &thread) {
+  uint64_t lastGeneration = 0;
+
+  for (;;) {
+    const Task *task = nullptr;
+
+    // Waits for the next run, or for the pool to be destroyed.
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->startCondition.wait(lock, [&]() {
+        return this->stopping || this->generation != lastGeneration;
+      });
+
+      if (this->stopping) {
+        return;
+      }
+
+      lastGeneration = this->generation;
+      task = this->task;
+    }
+
+    ThreadStatistics &statistics = this->statistics[thread];
+
+    // Executes our own tasks, and steals from the others when we run out.
+    size_t n;
+    bool stolen;
+    while (this->Take(thread, n, stolen)) {
+      const uint64_t taskStart = nanoseconds();
+
+      try {
+        (*task)(n, thread);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->exception) {
+          this->exception = std::current_exception();
+        }
+      }
+
+      statistics.busyNanoseconds += nanoseconds() - taskStart;
+      statistics.tasksExecuted += 1;
+      statistics.tasksStolen += stolen ? 1 : 0;
+    }
+
+    // Lets the caller know once the last worker is out of work.
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (--this->threadsActive == 0) {
+      this->doneCondition.notify_one();
+    }
+  }
+}
+
+bool ThreadPool::Take(const size_t &thread, size_t &task, bool &stolen) {
+  stolen = false;
+  if (this->queues[thread].Pop(task)) {
+    return true;
+  }
+
+  // Tries all the other queues, starting at our neighbour so the thieves
+  // spread out over the victims.
+  stolen = true;
+  for (size_t i = 1; i < this->queues.size(); ++i) {
+    if (this->queues[(thread + i) % this->queues.size()].Steal(task)) {
+      return true;
+    }
+  }
+
+  return false;
+}
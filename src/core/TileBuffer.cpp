@@ -0,0 +1,79 @@
+#include "TileBuffer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/// Converts an row of RGBA floats in the range [0, 1] to 8 bits, clamping
+/// anything outside of the range. Produces the same values as Quantize().
+static void quantizeRow(const float *colors, uint8_t *pixels,
+                        const size_t &channels) {
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(255.0f);
+  const __m128 half = _mm_set1_ps(0.5f);
+
+  // Converts four pixels at once: clamps, scales and rounds the sixteen
+  // channels, then narrows them to bytes with saturation.
+  for (; i + 16 <= channels; i += 16) {
+    __m128i quantized[4];
+    for (size_t k = 0; k < 4; ++k) {
+      const __m128 clamped =
+          _mm_min_ps(_mm_max_ps(_mm_loadu_ps(colors + i + k * 4), zero), one);
+      quantized[k] =
+          _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, scale), half));
+    }
+
+    const __m128i low = _mm_packs_epi32(quantized[0], quantized[1]);
+    const __m128i high = _mm_packs_epi32(quantized[2], quantized[3]);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i),
+                     _mm_packus_epi16(low, high));
+  }
+#endif
+
+  for (; i < channels; ++i) {
+    pixels[i] = FrameBuffer::Quantize(colors[i]);
+  }
+}
+
+TileBuffer::TileBuffer(const size_t &size)
+    : colors(size * size * FrameBuffer::channelCount, 0.0f),
+      tile(0, 0, size, size) {}
+
+TileBuffer &TileBuffer::Reset(const Tile &tile) {
+  if (tile.PixelCount() * FrameBuffer::channelCount > this->colors.size()) {
+    throw std::runtime_error("Tile does not fit in the tile buffer.");
+  }
+
+  this->tile = tile;
+  std::fill(this->colors.begin(),
+            this->colors.begin() + tile.PixelCount() * FrameBuffer::channelCount,
+            0.0f);
+  return *this;
+}
+
+const TileBuffer &TileBuffer::Flush(FrameBuffer &frameBuffer) const {
+  if (this->tile.x + this->tile.width > frameBuffer.width ||
+      this->tile.y + this->tile.height > frameBuffer.height) {
+    throw std::runtime_error("Invalid coordinates, outside of canvas.");
+  }
+
+  // Quantizes every row straight into the frame buffer, so the shared cache
+  // lines are only touched once, by an single thread, in one go.
+  const size_t channels = this->tile.width * FrameBuffer::channelCount;
+  for (size_t y = 0; y < this->tile.height; ++y) {
+    quantizeRow(this->colors.data() + y * channels,
+                frameBuffer.Row(this->tile.y + y) +
+                    this->tile.x * FrameBuffer::channelCount,
+                channels);
+  }
+
+  return *this;
+}
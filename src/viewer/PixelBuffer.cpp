@@ -1,4 +1,5 @@
 #include "PixelBuffer.hpp"
+#include <cstring>
 #include <stdexcept>
 
 PixelBuffer::PixelBuffer(const int &width, const int &height)
@@ -28,4 +29,25 @@ PixelBuffer &PixelBuffer::PutPixel(const int &x, const int &y, const uint8_t r,
   return *this;
 }
 
+PixelBuffer &PixelBuffer::Upload(const FrameBuffer &frameBuffer) {
+  const int width = gdk_pixbuf_get_width(this->pixelBuffer);
+  const int height = gdk_pixbuf_get_height(this->pixelBuffer);
+
+  if (static_cast<size_t>(width) != frameBuffer.width ||
+      static_cast<size_t>(height) != frameBuffer.height) {
+    throw std::runtime_error("Frame buffer size does not match the canvas.");
+  }
+
+  // Copies row by row, since the rows of the pixbuf may be padded.
+  const int rowStride = gdk_pixbuf_get_rowstride(this->pixelBuffer);
+  uint8_t *pixels =
+      reinterpret_cast<uint8_t *>(gdk_pixbuf_get_pixels(this->pixelBuffer));
+  for (size_t y = 0; y < frameBuffer.height; ++y) {
+    std::memcpy(pixels + y * rowStride, frameBuffer.Row(y),
+                frameBuffer.RowStride());
+  }
+
+  return *this;
+}
+
 PixelBuffer::~PixelBuffer() { g_object_unref(this->pixelBuffer); }
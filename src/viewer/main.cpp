@@ -0,0 +1,173 @@
+#include "main.hpp"
+#include "Camera.hpp"
+#include "FrameBuffer.hpp"
+#include "PixelBuffer.hpp"
+#include "ProgressiveRenderer.hpp"
+#include "Ray.hpp"
+#include "Scenes.hpp"
+#include "ThreadPool.hpp"
+#include "Vector3D.hpp"
+#include "cairo.h"
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <vector>
+
+#include <gtk/gtk.h>
+
+#include "GeometryRegister.hpp"
+
+static constexpr size_t maximumSamples = 64;
+
+std::shared_ptr<GeometryRegister<double>> geometryRegister;
+FrameBuffer frameBuffer(500, 500);
+PixelBuffer pixelBuffer(500, 500);
+ThreadPool threadPool;
+Camera<double> camera = createTwoSphereCamera<double>(500, 500);
+std::unique_ptr<ProgressiveRenderer<double>> progressiveRenderer;
+
+GtkWidget *image = nullptr;
+GtkWidget *frameTime = nullptr;
+
+// The latest pass the main loop has not shown yet, the render thread only
+// queues an idle callback when there is none waiting already.
+std::mutex pendingPassMutex;
+std::optional<ProgressivePass> pendingPass;
+
+static void setupRenderer() {
+  geometryRegister = std::make_shared<GeometryRegister<double>>();
+
+  frameBuffer.Fill(255, 0, 0, 255);
+  createTwoSphereScene(*geometryRegister).Build();
+  geometryRegister->Print();
+}
+
+/// Shows the latest pass, runs on the main loop.
+static gboolean showPass(gpointer user_data) {
+  std::optional<ProgressivePass> pass;
+  {
+    std::lock_guard<std::mutex> lock(pendingPassMutex);
+    pass.swap(pendingPass);
+  }
+
+  if (!pass.has_value() || progressiveRenderer == nullptr) {
+    return G_SOURCE_REMOVE;
+  }
+
+  progressiveRenderer->CopyResult(frameBuffer);
+  pixelBuffer.Upload(frameBuffer);
+  gtk_image_set_from_pixbuf(GTK_IMAGE(image), pixelBuffer.pixelBuffer);
+
+  std::ostringstream text;
+  if (pass->samples == 0) {
+    text << "1/" << pass->blockSize * pass->blockSize << " resolution";
+  } else {
+    text << pass->samples << '/' << maximumSamples << " samples";
+  }
+  text << ", " << static_cast<uint64_t>(pass->milliseconds) << " ms, "
+       << pass->tiles.reused << '/' << pass->tiles.tiles << " tiles reused ("
+       << static_cast<uint64_t>(pass->tiles.HitRate() * 100.0) << "%), "
+       << pass->tiles.invalidated << " invalidated";
+  gtk_label_set_text(GTK_LABEL(frameTime), text.str().c_str());
+
+  // Prints the utilisation of every thread once the view is done, to confirm
+  // the load is balanced.
+  if (pass->samples == maximumSamples) {
+    threadPool.PrintStatistics(std::cout);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+/// Called by the render thread after every pass, hands it to the main loop.
+static void passFinished(const ProgressivePass &pass) {
+  std::lock_guard<std::mutex> lock(pendingPassMutex);
+  if (!pendingPass.has_value()) {
+    g_idle_add(showPass, nullptr);
+  }
+
+  pendingPass = pass;
+}
+
+static void moveCamera(const double &deltaX) {
+  camera.Move(camera.position.Add(Vector3D<double>(deltaX, 0.0, 0.0)));
+  progressiveRenderer->Restart(camera);
+}
+
+/// Moves the green sphere up, only the tiles it can be seen in are rendered
+/// again.
+static void moveSphere(GtkWidget *widget, gpointer user_data) {
+  progressiveRenderer->Edit([](GeometryRegister<double> &geometryRegister) {
+    geometryRegister.geometries[1]->position +=
+        Vector3D<double>(0.0, 5.0, 0.0);
+    geometryRegister.Refit();
+  });
+}
+
+static void moveLeft(GtkWidget *widget, gpointer user_data) {
+  moveCamera(-5.0);
+}
+
+static void moveRight(GtkWidget *widget, gpointer user_data) {
+  moveCamera(5.0);
+}
+
+static void activate(GtkApplication *app, gpointer user_data) {
+  setupRenderer();
+
+  GtkWidget *window = nullptr;
+  GtkWidget *box = nullptr;
+  GtkWidget *buttons = nullptr;
+  GtkWidget *button = nullptr;
+
+  window = gtk_application_window_new(app);
+  gtk_window_set_title(GTK_WINDOW(window), "Luke's Ray-Tracing");
+  gtk_window_set_default_size(GTK_WINDOW(window), 900, 500);
+
+  box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+  gtk_window_set_child(GTK_WINDOW(window), box);
+
+  pixelBuffer.Upload(frameBuffer);
+  image = gtk_image_new_from_pixbuf(pixelBuffer.pixelBuffer);
+  gtk_widget_set_hexpand(image, TRUE);
+  gtk_widget_set_vexpand(image, TRUE);
+  gtk_box_append(GTK_BOX(box), image);
+
+  buttons = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+  gtk_box_append(GTK_BOX(box), buttons);
+
+  button = gtk_button_new_with_label("Move left");
+  g_signal_connect(button, "clicked", G_CALLBACK(moveLeft), nullptr);
+  gtk_box_append(GTK_BOX(buttons), button);
+
+  button = gtk_button_new_with_label("Move right");
+  g_signal_connect(button, "clicked", G_CALLBACK(moveRight), nullptr);
+  gtk_box_append(GTK_BOX(buttons), button);
+
+  button = gtk_button_new_with_label("Move sphere");
+  g_signal_connect(button, "clicked", G_CALLBACK(moveSphere), nullptr);
+  gtk_box_append(GTK_BOX(buttons), button);
+
+  frameTime = gtk_label_new("Rendering ...");
+  gtk_box_append(GTK_BOX(box), frameTime);
+
+  gtk_widget_show(window);
+
+  // Starts rendering once the window is up, the passes show up as they come.
+  progressiveRenderer = std::make_unique<ProgressiveRenderer<double>>(
+      threadPool, geometryRegister, camera, maximumSamples, passFinished);
+}
+
+int main(int argc, char *argv[]) {
+  GtkApplication *app = nullptr;
+  int status;
+
+  app = gtk_application_new("nl.fannst.raytrace", G_APPLICATION_FLAGS_NONE);
+  g_signal_connect(app, "activate", G_CALLBACK(activate), nullptr);
+  status = g_application_run(G_APPLICATION(app), argc, argv);
+  progressiveRenderer.reset();
+  g_object_unref(app);
+
+  return status;
+}